@@ -0,0 +1,102 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures the throughput of the SHA-256 functions used to compute object and
+// commit ids: hashing values in one shot, and with the streaming hash as done
+// when objects are written to disk.
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "apps/ledger/src/glue/crypto/hash.h"
+#include "lib/ftl/command_line.h"
+#include "lib/ftl/strings/string_number_conversions.h"
+#include "lib/ftl/time/time_delta.h"
+#include "lib/ftl/time/time_point.h"
+
+namespace {
+constexpr ftl::StringView kValueCountFlag = "value-count";
+constexpr ftl::StringView kValueSizeFlag = "value-size";
+// Size of the chunks given to the streaming hash, matching the size of the
+// reads of the socket drainer.
+constexpr size_t kStreamingChunkSize = 64 * 1024;
+
+void PrintUsage(const char* executable_name) {
+  std::cout << "Usage: " << executable_name << " --" << kValueCountFlag
+            << "=<int> --" << kValueSizeFlag << "=<int>" << std::endl;
+}
+
+void PrintResult(const std::string& name,
+                 size_t total_size,
+                 ftl::TimeDelta duration) {
+  double seconds = duration.ToSecondsF();
+  std::cout << name << ": " << duration.ToMilliseconds() << " ms";
+  if (seconds > 0) {
+    std::cout << ", " << (total_size / seconds / (1024 * 1024)) << " MB/s";
+  }
+  std::cout << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, const char** argv) {
+  ftl::CommandLine command_line = ftl::CommandLineFromArgcArgv(argc, argv);
+
+  std::string value_count_str;
+  int value_count;
+  std::string value_size_str;
+  int value_size;
+  if (!command_line.GetOptionValue(kValueCountFlag.ToString(),
+                                   &value_count_str) ||
+      !ftl::StringToNumberWithError(value_count_str, &value_count) ||
+      value_count <= 0 ||
+      !command_line.GetOptionValue(kValueSizeFlag.ToString(),
+                                   &value_size_str) ||
+      !ftl::StringToNumberWithError(value_size_str, &value_size) ||
+      value_size <= 0) {
+    PrintUsage(argv[0]);
+    return -1;
+  }
+
+  std::vector<std::string> values;
+  values.reserve(value_count);
+  for (int i = 0; i < value_count; ++i) {
+    std::string value = std::to_string(i);
+    value.resize(value_size, 'a');
+    values.push_back(std::move(value));
+  }
+  size_t total_size = static_cast<size_t>(value_count) * value_size;
+
+  std::vector<std::string> results;
+  results.reserve(value_count);
+  ftl::TimePoint start = ftl::TimePoint::Now();
+  for (const auto& value : values) {
+    results.push_back(glue::SHA256Hash(value.data(), value.size()));
+  }
+  PrintResult("SHA256Hash", total_size, ftl::TimePoint::Now() - start);
+
+  start = ftl::TimePoint::Now();
+  for (size_t i = 0; i < values.size(); ++i) {
+    const std::string& value = values[i];
+    glue::SHA256StreamingHash hash;
+    for (size_t offset = 0; offset < value.size();
+         offset += kStreamingChunkSize) {
+      hash.Update(value.data() + offset,
+                  std::min(kStreamingChunkSize, value.size() - offset));
+    }
+    std::string result;
+    hash.Finish(&result);
+    if (result != results[i]) {
+      std::cout << "SHA256StreamingHash returned a different digest."
+                << std::endl;
+      return 1;
+    }
+  }
+  PrintResult("SHA256StreamingHash", total_size,
+              ftl::TimePoint::Now() - start);
+
+  return 0;
+}
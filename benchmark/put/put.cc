@@ -20,10 +20,12 @@ namespace {
 constexpr ftl::StringView kStoragePath = "/data/benchmark/ledger/put";
 constexpr ftl::StringView kEntryCountFlag = "entry-count";
 constexpr ftl::StringView kValueSizeFlag = "value-size";
+constexpr ftl::StringView kTransactionSizeFlag = "transaction-size";
 
 void PrintUsage(const char* executable_name) {
   std::cout << "Usage: " << executable_name << " --" << kEntryCountFlag
-            << "=<int> --" << kValueSizeFlag << "=<int>" << std::endl;
+            << "=<int> --" << kValueSizeFlag << "=<int> [--"
+            << kTransactionSizeFlag << "=<int>]" << std::endl;
 }
 
 fidl::Array<uint8_t> MakeKey(int i) {
@@ -40,13 +42,17 @@ fidl::Array<uint8_t> MakeValue(int i, size_t size) {
 
 namespace benchmark {
 
-PutBenchmark::PutBenchmark(int entry_count, int value_size)
+PutBenchmark::PutBenchmark(int entry_count,
+                           int value_size,
+                           int transaction_size)
     : tmp_dir_(kStoragePath),
       application_context_(app::ApplicationContext::CreateFromStartupInfo()),
       entry_count_(entry_count),
-      value_size_(value_size) {
+      value_size_(value_size),
+      transaction_size_(transaction_size) {
   FTL_DCHECK(entry_count > 0);
   FTL_DCHECK(value_size > 0);
+  FTL_DCHECK(transaction_size >= 0);
   tracing::InitializeTracer(application_context_.get(),
                             {"benchmark_ledger_put"});
 }
@@ -67,6 +73,20 @@ void PutBenchmark::RunSingle(int i, int count) {
     return;
   }
 
+  if (transaction_size_ > 0 && i % transaction_size_ == 0) {
+    TRACE_ASYNC_BEGIN("benchmark", "transaction", i / transaction_size_);
+    page_->StartTransaction([this, i, count](ledger::Status status) {
+      if (benchmark::QuitOnError(status, "Page::StartTransaction")) {
+        return;
+      }
+      PutEntry(i, count);
+    });
+    return;
+  }
+  PutEntry(i, count);
+}
+
+void PutBenchmark::PutEntry(int i, int count) {
   fidl::Array<uint8_t> key = MakeKey(i);
   fidl::Array<uint8_t> value = MakeValue(i, value_size_);
   TRACE_ASYNC_BEGIN("benchmark", "put", i);
@@ -76,10 +96,27 @@ void PutBenchmark::RunSingle(int i, int count) {
                  return;
                }
                TRACE_ASYNC_END("benchmark", "put", i);
+               if (transaction_size_ > 0 &&
+                   ((i + 1) % transaction_size_ == 0 || i + 1 == count)) {
+                 CommitAndRunNext(i, count);
+                 return;
+               }
                RunSingle(i + 1, count);
              });
 }
 
+void PutBenchmark::CommitAndRunNext(int i, int count) {
+  TRACE_ASYNC_BEGIN("benchmark", "commit", i / transaction_size_);
+  page_->Commit([this, i, count](ledger::Status status) {
+    if (benchmark::QuitOnError(status, "Page::Commit")) {
+      return;
+    }
+    TRACE_ASYNC_END("benchmark", "commit", i / transaction_size_);
+    TRACE_ASYNC_END("benchmark", "transaction", i / transaction_size_);
+    RunSingle(i + 1, count);
+  });
+}
+
 void PutBenchmark::ShutDown() {
   // Shut down the Ledger process first as it relies on |tmp_dir_| storage.
   ledger_controller_->Kill();
@@ -108,8 +145,19 @@ int main(int argc, const char** argv) {
     return -1;
   }
 
+  std::string transaction_size_str;
+  int transaction_size = 0;
+  if (command_line.GetOptionValue(kTransactionSizeFlag.ToString(),
+                                  &transaction_size_str) &&
+      (!ftl::StringToNumberWithError(transaction_size_str,
+                                     &transaction_size) ||
+       transaction_size < 0)) {
+    PrintUsage(argv[0]);
+    return -1;
+  }
+
   mtl::MessageLoop loop;
-  benchmark::PutBenchmark app(entry_count, value_size);
+  benchmark::PutBenchmark app(entry_count, value_size, transaction_size);
   loop.task_runner()->PostTask([&app] { app.Run(); });
   loop.Run();
   return 0;
@@ -18,14 +18,18 @@ namespace benchmark {
 // Parameters:
 //   --entry-count=<int> the number of entries to be put
 //   --value-size=<int> the size of a single value in bytes
+//   --transaction-size=<int> the number of puts per transaction, or 0 (the
+//     default) to make each put outside of any transaction
 class PutBenchmark {
  public:
-  PutBenchmark(int entry_count, int value_size);
+  PutBenchmark(int entry_count, int value_size, int transaction_size);
 
   void Run();
 
  private:
   void RunSingle(int i, int count);
+  void PutEntry(int i, int count);
+  void CommitAndRunNext(int i, int count);
 
   void ShutDown();
 
@@ -33,6 +37,7 @@ class PutBenchmark {
   std::unique_ptr<app::ApplicationContext> application_context_;
   const int entry_count_;
   const int value_size_;
+  const int transaction_size_;
 
   app::ApplicationControllerPtr ledger_controller_;
   ledger::PagePtr page_;
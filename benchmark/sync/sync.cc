@@ -76,8 +76,8 @@ void SyncBenchmark::Run() {
   beta->GetRootPage(beta_page_.NewRequest(),
                     benchmark::QuitOnErrorCallback("GetRootPage"));
   ledger::PageSnapshotPtr snapshot;
-  beta_page_->GetSnapshot(snapshot.NewRequest(),
-                          page_watcher_binding_.NewBinding(),
+  beta_page_->GetSnapshot(snapshot.NewRequest(), nullptr,
+                          page_watcher_binding_.NewBinding(), -1,
                           [this](ledger::Status status) {
                             if (benchmark::QuitOnError(status, "GetSnapshot")) {
                               return;
@@ -70,6 +70,8 @@ class App {
     }
     environment_ = std::make_unique<Environment>(
         std::move(config), std::move(main_runner), network_service_.get());
+    FTL_LOG(INFO) << "Storage settings: "
+                  << environment_->db_options()->ToString();
 
     factory_impl_ =
         std::make_unique<LedgerRepositoryFactoryImpl>(environment_.get());
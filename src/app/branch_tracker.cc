@@ -6,8 +6,8 @@
 
 #include <vector>
 
-#include "apps/ledger/src/app/diff_utils.h"
 #include "apps/ledger/src/app/fidl/serialization_size.h"
+#include "apps/ledger/src/app/page_change_cache.h"
 #include "apps/ledger/src/app/page_manager.h"
 #include "apps/ledger/src/callback/waiter.h"
 #include "lib/ftl/functional/auto_call.h"
@@ -19,13 +19,15 @@ class BranchTracker::PageWatcherContainer {
   PageWatcherContainer(coroutine::CoroutineService* coroutine_service,
                        PageWatcherPtr watcher,
                        PageManager* page_manager,
-                       storage::PageStorage* storage,
-                       std::unique_ptr<const storage::Commit> base_commit)
+                       std::unique_ptr<const storage::Commit> base_commit,
+                       std::string key_prefix,
+                       int64_t max_value_size)
       : change_in_flight_(false),
         last_commit_(std::move(base_commit)),
+        key_prefix_(std::move(key_prefix)),
+        max_value_size_(max_value_size),
         coroutine_service_(coroutine_service),
         manager_(page_manager),
-        storage_(storage),
         interface_(std::move(watcher)) {
     interface_.set_connection_error_handler([this] {
       if (handler_) {
@@ -166,8 +168,8 @@ class BranchTracker::PageWatcherContainer {
     change_in_flight_ = true;
 
     // TODO(etiennej): See LE-74: clean object ownership
-    diff_utils::ComputePageChange(
-        storage_, *last_commit_, *current_commit_,
+    manager_->page_change_cache()->GetPageChange(
+        *last_commit_, *current_commit_, key_prefix_, max_value_size_,
         ftl::MakeCopyable([ this, new_commit = std::move(current_commit_) ](
             Status status, PageChangePtr page_change_ptr) mutable {
           if (status != Status::OK) {
@@ -179,6 +181,8 @@ class BranchTracker::PageWatcherContainer {
             return;
           }
 
+          // A null change means that nothing in the watched range changed:
+          // the watcher is not woken up.
           if (!page_change_ptr) {
             change_in_flight_ = false;
             last_commit_.swap(new_commit);
@@ -229,10 +233,11 @@ class BranchTracker::PageWatcherContainer {
   bool change_in_flight_;
   std::unique_ptr<const storage::Commit> last_commit_;
   std::unique_ptr<const storage::Commit> current_commit_;
+  const std::string key_prefix_;
+  const int64_t max_value_size_;
   coroutine::CoroutineService* coroutine_service_;
   coroutine::CoroutineHandler* handler_ = nullptr;
   PageManager* manager_;
-  storage::PageStorage* storage_;
   PageWatcherPtr interface_;
 };
 
@@ -339,9 +344,12 @@ void BranchTracker::StopTransaction(
 
 void BranchTracker::RegisterPageWatcher(
     PageWatcherPtr page_watcher_ptr,
-    std::unique_ptr<const storage::Commit> base_commit) {
+    std::unique_ptr<const storage::Commit> base_commit,
+    std::string key_prefix,
+    int64_t max_value_size) {
   watchers_.emplace(coroutine_service_, std::move(page_watcher_ptr), manager_,
-                    storage_, std::move(base_commit));
+                    std::move(base_commit), std::move(key_prefix),
+                    max_value_size);
 }
 
 bool BranchTracker::IsEmpty() {
@@ -34,9 +34,14 @@ class BranchTracker : public storage::CommitWatcher {
   // Returns the head commit of the currently tracked branch.
   const storage::CommitId& GetBranchHeadId();
 
-  // Registers a new PageWatcher interface.
+  // Registers a new PageWatcher interface. The watcher is only notified of
+  // changes to keys starting with |key_prefix|. If |max_value_size| is not
+  // negative, values bigger than |max_value_size| bytes are not sent to the
+  // watcher.
   void RegisterPageWatcher(PageWatcherPtr page_watcher_ptr,
-                           std::unique_ptr<const storage::Commit> base_commit);
+                           std::unique_ptr<const storage::Commit> base_commit,
+                           std::string key_prefix,
+                           int64_t max_value_size);
 
   // Informs the BranchTracker that a transaction is in progress. It first
   // drains all pending Watcher updates, then stop sending them until
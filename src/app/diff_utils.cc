@@ -6,6 +6,7 @@
 
 #include <limits>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include "apps/ledger/src/app/page_utils.h"
@@ -16,12 +17,83 @@
 
 namespace ledger {
 namespace diff_utils {
+namespace {
+// The value of a changed entry.
+struct Value {
+  mx::vmo buffer;
+  // Whether |buffer| is empty because the value is bigger than the maximal
+  // size requested.
+  bool too_large = false;
+};
+
+Value MakeValue(mx::vmo buffer) {
+  Value value;
+  value.buffer = std::move(buffer);
+  return value;
+}
+
+// Retrieves the value with the given |object_id|. If the value is not
+// available locally, |callback| is called with an empty buffer. If
+// |max_value_size| is not negative and the value is bigger than
+// |max_value_size| bytes, |callback| is called with an empty buffer and the
+// value marked as too large.
+void GetValue(storage::PageStorage* storage,
+              storage::ObjectIdView object_id,
+              int64_t max_value_size,
+              std::function<void(Status, Value)> callback) {
+  if (max_value_size < 0) {
+    PageUtils::GetPartialReferenceAsBuffer(
+        storage, object_id, 0u, std::numeric_limits<int64_t>::max(),
+        storage::PageStorage::Location::LOCAL, Status::OK,
+        [callback = std::move(callback)](Status status, mx::vmo buffer) {
+          callback(status, MakeValue(std::move(buffer)));
+        });
+    return;
+  }
+  storage->GetObject(
+      object_id, storage::PageStorage::Location::LOCAL,
+      [ max_value_size, callback = std::move(callback) ](
+          storage::Status status,
+          std::unique_ptr<const storage::Object> object) {
+        if (status != storage::Status::OK) {
+          callback(PageUtils::ConvertStatus(status, Status::OK), Value());
+          return;
+        }
+        uint64_t size;
+        status = object->GetSize(&size);
+        if (status != storage::Status::OK) {
+          callback(PageUtils::ConvertStatus(status), Value());
+          return;
+        }
+        if (size > static_cast<uint64_t>(max_value_size)) {
+          Value value;
+          value.too_large = true;
+          callback(Status::OK, std::move(value));
+          return;
+        }
+        ftl::StringView data;
+        status = object->GetData(&data);
+        if (status != storage::Status::OK) {
+          callback(PageUtils::ConvertStatus(status), Value());
+          return;
+        }
+        mx::vmo buffer;
+        if (!mtl::VmoFromString(data, &buffer)) {
+          callback(Status::UNKNOWN_ERROR, Value());
+          return;
+        }
+        callback(Status::OK, MakeValue(std::move(buffer)));
+      });
+}
+}  // namespace
 
 void ComputePageChange(storage::PageStorage* storage,
                        const storage::Commit& base,
                        const storage::Commit& other,
+                       std::string prefix,
+                       int64_t max_value_size,
                        std::function<void(Status, PageChangePtr)> callback) {
-  auto waiter = callback::Waiter<Status, mx::vmo>::Create(Status::OK);
+  auto waiter = callback::Waiter<Status, Value>::Create(Status::OK);
 
   PageChangePtr page_change = PageChange::New();
   page_change->timestamp = other.GetTimestamp();
@@ -29,8 +101,14 @@ void ComputePageChange(storage::PageStorage* storage,
   page_change->deleted_keys = fidl::Array<fidl::Array<uint8_t>>::New(0);
 
   // |on_next| is called for each change on the diff
-  auto on_next = [ storage, waiter, page_change = page_change.get() ](
-      storage::EntryChange change) {
+  auto on_next = [
+    storage, waiter, prefix, max_value_size, page_change = page_change.get()
+  ](storage::EntryChange change) {
+    // The diff is computed starting at |prefix|: the first key not matching it
+    // ends the range of interest.
+    if (!PageUtils::MatchesPrefix(change.entry.key, prefix)) {
+      return false;
+    }
     if (change.deleted) {
       page_change->deleted_keys.push_back(convert::ToArray(change.entry.key));
       return true;
@@ -42,11 +120,8 @@ void ComputePageChange(storage::PageStorage* storage,
                           ? Priority::EAGER
                           : Priority::LAZY;
     page_change->changes.push_back(std::move(entry));
-    PageUtils::GetPartialReferenceAsBuffer(
-        storage, change.entry.object_id, 0u,
-        std::numeric_limits<int64_t>::max(),
-        storage::PageStorage::Location::LOCAL, Status::OK,
-        waiter->NewCallback());
+    GetValue(storage, change.entry.object_id, max_value_size,
+             waiter->NewCallback());
     return true;
   };
 
@@ -71,7 +146,7 @@ void ComputePageChange(storage::PageStorage* storage,
     // asynchronous calls and |result_callback| processes them.
     auto result_callback = ftl::MakeCopyable([
       page_change = std::move(page_change), callback = std::move(callback)
-    ](Status status, std::vector<mx::vmo> results) mutable {
+    ](Status status, std::vector<Value> results) mutable {
       if (status != Status::OK) {
         FTL_LOG(ERROR)
             << "Error while reading changed values when computing PageChange: "
@@ -81,17 +156,18 @@ void ComputePageChange(storage::PageStorage* storage,
       }
       FTL_DCHECK(results.size() == page_change->changes.size());
       for (size_t i = 0; i < results.size(); i++) {
-        if (!results[i]) {
+        page_change->changes[i]->value_too_large = results[i].too_large;
+        if (!results[i].buffer) {
           continue;
         }
-        page_change->changes[i]->value = std::move(results[i]);
+        page_change->changes[i]->value = std::move(results[i].buffer);
       }
       callback(Status::OK, std::move(page_change));
     });
     waiter->Finalize(result_callback);
   });
-  storage->GetCommitContentsDiff(base, other, std::move(on_next),
-                                 std::move(on_done));
+  storage->GetCommitContentsDiff(base, other, std::move(prefix),
+                                 std::move(on_next), std::move(on_done));
 }
 
 }  // namespace diff_utils
@@ -14,10 +14,16 @@
 namespace ledger {
 namespace diff_utils {
 // Asynchronously creates a PageChange representing the diff of the two provided
-// commits. The result, or an error, will be provided in |callback|.
+// commits, restricted to the keys starting with |prefix|. The result, or an
+// error, will be provided in |callback|. If there is no change in the requested
+// range, |callback| is called with a null PageChangePtr.
+// If |max_value_size| is not negative, values bigger than |max_value_size|
+// bytes are not read, and the corresponding entries have a null value.
 void ComputePageChange(storage::PageStorage* storage,
                        const storage::Commit& base,
                        const storage::Commit& other,
+                       std::string prefix,
+                       int64_t max_value_size,
                        std::function<void(Status, PageChangePtr)> callback);
 
 }  // namespace diff_utils
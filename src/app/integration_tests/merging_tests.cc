@@ -159,7 +159,8 @@ TEST_F(MergingIntegrationTest, Merging) {
   Watcher watcher1(GetProxy(&watcher1_ptr),
                    [] { mtl::MessageLoop::GetCurrent()->PostQuitTask(); });
   PageSnapshotPtr snapshot1;
-  page1->GetSnapshot(snapshot1.NewRequest(), std::move(watcher1_ptr),
+  page1->GetSnapshot(snapshot1.NewRequest(), nullptr,
+                     std::move(watcher1_ptr), -1,
                      [](Status status) { EXPECT_EQ(Status::OK, status); });
   EXPECT_TRUE(page1.WaitForIncomingResponse());
 
@@ -167,7 +168,8 @@ TEST_F(MergingIntegrationTest, Merging) {
   Watcher watcher2(GetProxy(&watcher2_ptr),
                    [] { mtl::MessageLoop::GetCurrent()->PostQuitTask(); });
   PageSnapshotPtr snapshot2;
-  page2->GetSnapshot(snapshot2.NewRequest(), std::move(watcher2_ptr),
+  page2->GetSnapshot(snapshot2.NewRequest(), nullptr,
+                     std::move(watcher2_ptr), -1,
                      [](Status status) { EXPECT_EQ(Status::OK, status); });
   EXPECT_TRUE(page2.WaitForIncomingResponse());
 
@@ -258,7 +260,8 @@ TEST_F(MergingIntegrationTest, MergingWithConflictResolutionFactory) {
   Watcher watcher1(GetProxy(&watcher1_ptr),
                    [] { mtl::MessageLoop::GetCurrent()->PostQuitTask(); });
   PageSnapshotPtr snapshot1;
-  page1->GetSnapshot(snapshot1.NewRequest(), std::move(watcher1_ptr),
+  page1->GetSnapshot(snapshot1.NewRequest(), nullptr,
+                     std::move(watcher1_ptr), -1,
                      [](Status status) { EXPECT_EQ(Status::OK, status); });
   EXPECT_TRUE(page1.WaitForIncomingResponse());
 
@@ -266,7 +269,8 @@ TEST_F(MergingIntegrationTest, MergingWithConflictResolutionFactory) {
   Watcher watcher2(GetProxy(&watcher2_ptr),
                    [] { mtl::MessageLoop::GetCurrent()->PostQuitTask(); });
   PageSnapshotPtr snapshot2;
-  page2->GetSnapshot(snapshot2.NewRequest(), std::move(watcher2_ptr),
+  page2->GetSnapshot(snapshot2.NewRequest(), nullptr,
+                     std::move(watcher2_ptr), -1,
                      [](Status status) { EXPECT_EQ(Status::OK, status); });
   EXPECT_TRUE(page2.WaitForIncomingResponse());
 
@@ -465,7 +469,8 @@ TEST_F(MergingIntegrationTest, CustomConflictResolutionNoConflict) {
   Watcher watcher(GetProxy(&watcher_ptr),
                   [] { mtl::MessageLoop::GetCurrent()->PostQuitTask(); });
   PageSnapshotPtr snapshot2;
-  page1->GetSnapshot(snapshot2.NewRequest(), std::move(watcher_ptr),
+  page1->GetSnapshot(snapshot2.NewRequest(), nullptr,
+                     std::move(watcher_ptr), -1,
                      [](Status status) { EXPECT_EQ(Status::OK, status); });
   EXPECT_TRUE(page1.WaitForIncomingResponse());
 
@@ -664,7 +669,8 @@ TEST_F(MergingIntegrationTest, AutoConflictResolutionNoConflict) {
   Watcher watcher(GetProxy(&watcher_ptr),
                   []() { mtl::MessageLoop::GetCurrent()->PostQuitTask(); });
   PageSnapshotPtr snapshot2;
-  page1->GetSnapshot(snapshot2.NewRequest(), std::move(watcher_ptr),
+  page1->GetSnapshot(snapshot2.NewRequest(), nullptr,
+                     std::move(watcher_ptr), -1,
                      [](Status status) { EXPECT_EQ(Status::OK, status); });
   EXPECT_TRUE(page1.WaitForIncomingResponse());
 
@@ -815,7 +821,8 @@ TEST_F(MergingIntegrationTest, AutoConflictResolutionWithConflict) {
   Watcher watcher(GetProxy(&watcher_ptr),
                   []() { mtl::MessageLoop::GetCurrent()->PostQuitTask(); });
   PageSnapshotPtr snapshot2;
-  page1->GetSnapshot(snapshot2.NewRequest(), std::move(watcher_ptr),
+  page1->GetSnapshot(snapshot2.NewRequest(), nullptr,
+                     std::move(watcher_ptr), -1,
                      [](Status status) { EXPECT_EQ(Status::OK, status); });
   EXPECT_TRUE(page1.WaitForIncomingResponse());
 
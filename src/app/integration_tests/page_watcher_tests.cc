@@ -64,7 +64,7 @@ TEST_F(PageWatcherIntegrationTest, PageWatcherSimple) {
                   [] { mtl::MessageLoop::GetCurrent()->PostQuitTask(); });
 
   PageSnapshotPtr snapshot;
-  page->GetSnapshot(snapshot.NewRequest(), std::move(watcher_ptr),
+  page->GetSnapshot(snapshot.NewRequest(), nullptr, std::move(watcher_ptr), -1,
                     [](Status status) { EXPECT_EQ(Status::OK, status); });
   EXPECT_TRUE(page.WaitForIncomingResponse());
 
@@ -92,7 +92,7 @@ TEST_F(PageWatcherIntegrationTest, PageWatcherDelete) {
                   [] { mtl::MessageLoop::GetCurrent()->PostQuitTask(); });
 
   PageSnapshotPtr snapshot;
-  page->GetSnapshot(snapshot.NewRequest(), std::move(watcher_ptr),
+  page->GetSnapshot(snapshot.NewRequest(), nullptr, std::move(watcher_ptr), -1,
                     [](Status status) { EXPECT_EQ(Status::OK, status); });
   EXPECT_TRUE(page.WaitForIncomingResponse());
 
@@ -109,6 +109,123 @@ TEST_F(PageWatcherIntegrationTest, PageWatcherDelete) {
   EXPECT_EQ("foo", convert::ToString(change->deleted_keys[0]));
 }
 
+TEST_F(PageWatcherIntegrationTest, PageWatcherPrefix) {
+  PagePtr page = GetTestPage();
+  PageWatcherPtr watcher_ptr;
+  Watcher watcher(watcher_ptr.NewRequest(),
+                  [] { mtl::MessageLoop::GetCurrent()->PostQuitTask(); });
+
+  PageSnapshotPtr snapshot;
+  page->GetSnapshot(snapshot.NewRequest(), convert::ToArray("01"),
+                    std::move(watcher_ptr), -1,
+                    [](Status status) { EXPECT_EQ(Status::OK, status); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+
+  // A change outside of the prefix does not wake the watcher.
+  page->Put(convert::ToArray("00-key"), convert::ToArray("value-00"),
+            [](Status status) { EXPECT_EQ(status, Status::OK); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  EXPECT_TRUE(RunLoopWithTimeout());
+  EXPECT_EQ(0u, watcher.changes_seen);
+
+  page->StartTransaction([](Status status) { EXPECT_EQ(status, Status::OK); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  page->Put(convert::ToArray("01-key"), convert::ToArray("value-01"),
+            [](Status status) { EXPECT_EQ(status, Status::OK); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  page->Put(convert::ToArray("02-key"), convert::ToArray("value-02"),
+            [](Status status) { EXPECT_EQ(status, Status::OK); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  page->Commit([](Status status) { EXPECT_EQ(status, Status::OK); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  // Only the change matching the prefix is reported.
+  EXPECT_EQ(1u, watcher.changes_seen);
+  EXPECT_EQ(ResultState::COMPLETED, watcher.last_result_state_);
+  PageChangePtr change = std::move(watcher.last_page_change_);
+  ASSERT_EQ(1u, change->changes.size());
+  EXPECT_EQ("01-key", convert::ToString(change->changes[0]->key));
+  EXPECT_EQ("value-01", ToString(change->changes[0]->value));
+  EXPECT_EQ(0u, change->deleted_keys.size());
+}
+
+TEST_F(PageWatcherIntegrationTest, PageWatcherMaxValueSize) {
+  PagePtr page = GetTestPage();
+  PageWatcherPtr watcher_ptr;
+  Watcher watcher(watcher_ptr.NewRequest(),
+                  [] { mtl::MessageLoop::GetCurrent()->PostQuitTask(); });
+
+  PageSnapshotPtr snapshot;
+  page->GetSnapshot(snapshot.NewRequest(), nullptr, std::move(watcher_ptr), 5,
+                    [](Status status) { EXPECT_EQ(Status::OK, status); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+
+  page->StartTransaction([](Status status) { EXPECT_EQ(status, Status::OK); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  page->Put(convert::ToArray("big"), convert::ToArray("big value"),
+            [](Status status) { EXPECT_EQ(status, Status::OK); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  page->Put(convert::ToArray("small"), convert::ToArray("value"),
+            [](Status status) { EXPECT_EQ(status, Status::OK); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  page->Commit([](Status status) { EXPECT_EQ(status, Status::OK); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  // Only the value fitting in the size limit is sent inline.
+  EXPECT_EQ(1u, watcher.changes_seen);
+  PageChangePtr change = std::move(watcher.last_page_change_);
+  ASSERT_EQ(2u, change->changes.size());
+  EXPECT_EQ("big", convert::ToString(change->changes[0]->key));
+  EXPECT_FALSE(change->changes[0]->value);
+  EXPECT_TRUE(change->changes[0]->value_too_large);
+  EXPECT_EQ("small", convert::ToString(change->changes[1]->key));
+  EXPECT_EQ("value", ToString(change->changes[1]->value));
+  EXPECT_FALSE(change->changes[1]->value_too_large);
+}
+
+TEST_F(PageWatcherIntegrationTest, PageWatcherSharedChange) {
+  PagePtr page = GetTestPage();
+  size_t notified_watchers = 0;
+  auto on_change = [&notified_watchers] {
+    if (++notified_watchers == 2) {
+      mtl::MessageLoop::GetCurrent()->PostQuitTask();
+    }
+  };
+
+  // Both watchers are registered on the same commit, and will be notified
+  // of the same change.
+  PageWatcherPtr watcher1_ptr;
+  Watcher watcher1(watcher1_ptr.NewRequest(), on_change);
+  PageWatcherPtr watcher2_ptr;
+  Watcher watcher2(watcher2_ptr.NewRequest(), on_change);
+  PageSnapshotPtr snapshot1;
+  page->GetSnapshot(snapshot1.NewRequest(), nullptr,
+                    std::move(watcher1_ptr), -1,
+                    [](Status status) { EXPECT_EQ(Status::OK, status); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  PageSnapshotPtr snapshot2;
+  page->GetSnapshot(snapshot2.NewRequest(), nullptr,
+                    std::move(watcher2_ptr), -1,
+                    [](Status status) { EXPECT_EQ(Status::OK, status); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+
+  page->Put(convert::ToArray("name"), convert::ToArray("Alice"),
+            [](Status status) { EXPECT_EQ(status, Status::OK); });
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  for (Watcher* watcher : {&watcher1, &watcher2}) {
+    EXPECT_EQ(1u, watcher->changes_seen);
+    EXPECT_EQ(ResultState::COMPLETED, watcher->last_result_state_);
+    PageChangePtr change = std::move(watcher->last_page_change_);
+    ASSERT_EQ(1u, change->changes.size());
+    EXPECT_EQ("name", convert::ToString(change->changes[0]->key));
+    EXPECT_EQ("Alice", ToString(change->changes[0]->value));
+  }
+}
+
 TEST_F(PageWatcherIntegrationTest, PageWatcherBigChange) {
   size_t entry_count = 70;
   PagePtr page = GetTestPage();
@@ -117,7 +234,7 @@ TEST_F(PageWatcherIntegrationTest, PageWatcherBigChange) {
                   [] { mtl::MessageLoop::GetCurrent()->PostQuitTask(); });
 
   PageSnapshotPtr snapshot;
-  page->GetSnapshot(snapshot.NewRequest(), std::move(watcher_ptr),
+  page->GetSnapshot(snapshot.NewRequest(), nullptr, std::move(watcher_ptr), -1,
                     [](Status status) { EXPECT_EQ(Status::OK, status); });
   EXPECT_TRUE(page.WaitForIncomingResponse());
 
@@ -171,7 +288,7 @@ TEST_F(PageWatcherIntegrationTest, PageWatcherSnapshot) {
                   [] { mtl::MessageLoop::GetCurrent()->PostQuitTask(); });
 
   PageSnapshotPtr snapshot;
-  page->GetSnapshot(snapshot.NewRequest(), std::move(watcher_ptr),
+  page->GetSnapshot(snapshot.NewRequest(), nullptr, std::move(watcher_ptr), -1,
                     [](Status status) { EXPECT_EQ(Status::OK, status); });
   EXPECT_TRUE(page.WaitForIncomingResponse());
 
@@ -197,7 +314,7 @@ TEST_F(PageWatcherIntegrationTest, PageWatcherTransaction) {
                   [] { mtl::MessageLoop::GetCurrent()->PostQuitTask(); });
 
   PageSnapshotPtr snapshot;
-  page->GetSnapshot(snapshot.NewRequest(), std::move(watcher_ptr),
+  page->GetSnapshot(snapshot.NewRequest(), nullptr, std::move(watcher_ptr), -1,
                     [](Status status) { EXPECT_EQ(Status::OK, status); });
   EXPECT_TRUE(page.WaitForIncomingResponse());
 
@@ -239,7 +356,8 @@ TEST_F(PageWatcherIntegrationTest, PageWatcherParallel) {
   Watcher watcher1(watcher1_ptr.NewRequest(),
                    [] { mtl::MessageLoop::GetCurrent()->PostQuitTask(); });
   PageSnapshotPtr snapshot1;
-  page1->GetSnapshot(snapshot1.NewRequest(), std::move(watcher1_ptr),
+  page1->GetSnapshot(snapshot1.NewRequest(), nullptr,
+                     std::move(watcher1_ptr), -1,
                      [](Status status) { EXPECT_EQ(Status::OK, status); });
   EXPECT_TRUE(page1.WaitForIncomingResponse());
 
@@ -247,7 +365,8 @@ TEST_F(PageWatcherIntegrationTest, PageWatcherParallel) {
   Watcher watcher2(watcher2_ptr.NewRequest(),
                    [] { mtl::MessageLoop::GetCurrent()->PostQuitTask(); });
   PageSnapshotPtr snapshot2;
-  page2->GetSnapshot(snapshot2.NewRequest(), std::move(watcher2_ptr),
+  page2->GetSnapshot(snapshot2.NewRequest(), nullptr,
+                     std::move(watcher2_ptr), -1,
                      [](Status status) { EXPECT_EQ(Status::OK, status); });
   EXPECT_TRUE(page2.WaitForIncomingResponse());
 
@@ -307,7 +426,7 @@ TEST_F(PageWatcherIntegrationTest, PageWatcherEmptyTransaction) {
                   [] { mtl::MessageLoop::GetCurrent()->PostQuitTask(); });
 
   PageSnapshotPtr snapshot;
-  page->GetSnapshot(snapshot.NewRequest(), std::move(watcher_ptr),
+  page->GetSnapshot(snapshot.NewRequest(), nullptr, std::move(watcher_ptr), -1,
                     [](Status status) { EXPECT_EQ(Status::OK, status); });
   EXPECT_TRUE(page.WaitForIncomingResponse());
 
@@ -337,7 +456,8 @@ TEST_F(PageWatcherIntegrationTest, PageWatcher1Change2Pages) {
   Watcher watcher1(watcher1_ptr.NewRequest(),
                    [] { mtl::MessageLoop::GetCurrent()->PostQuitTask(); });
   PageSnapshotPtr snapshot1;
-  page1->GetSnapshot(snapshot1.NewRequest(), std::move(watcher1_ptr),
+  page1->GetSnapshot(snapshot1.NewRequest(), nullptr,
+                     std::move(watcher1_ptr), -1,
                      [](Status status) { EXPECT_EQ(Status::OK, status); });
   EXPECT_TRUE(page1.WaitForIncomingResponse());
 
@@ -345,7 +465,8 @@ TEST_F(PageWatcherIntegrationTest, PageWatcher1Change2Pages) {
   Watcher watcher2(watcher2_ptr.NewRequest(),
                    [] { mtl::MessageLoop::GetCurrent()->PostQuitTask(); });
   PageSnapshotPtr snapshot2;
-  page2->GetSnapshot(snapshot2.NewRequest(), std::move(watcher2_ptr),
+  page2->GetSnapshot(snapshot2.NewRequest(), nullptr,
+                     std::move(watcher2_ptr), -1,
                      [](Status status) { EXPECT_EQ(Status::OK, status); });
   EXPECT_TRUE(page2.WaitForIncomingResponse());
 
@@ -411,7 +532,7 @@ TEST_F(PageWatcherIntegrationTest, PageWatcherConcurrentTransaction) {
   });
 
   PageSnapshotPtr snapshot;
-  page->GetSnapshot(snapshot.NewRequest(), std::move(watcher_ptr),
+  page->GetSnapshot(snapshot.NewRequest(), nullptr, std::move(watcher_ptr), -1,
                     [](Status status) { EXPECT_EQ(Status::OK, status); });
   EXPECT_TRUE(page.WaitForIncomingResponse());
 
@@ -60,7 +60,7 @@ fidl::Array<uint8_t> PageGetId(PagePtr* page) {
 
 PageSnapshotPtr PageGetSnapshot(PagePtr* page) {
   PageSnapshotPtr snapshot;
-  (*page)->GetSnapshot(snapshot.NewRequest(), nullptr,
+  (*page)->GetSnapshot(snapshot.NewRequest(), nullptr, nullptr, -1,
                        [](Status status) { EXPECT_EQ(Status::OK, status); });
   EXPECT_TRUE(page->WaitForIncomingResponse());
   return snapshot;
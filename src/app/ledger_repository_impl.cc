@@ -44,7 +44,10 @@ void LedgerRepositoryImpl::GetLedger(
         std::make_unique<storage::LedgerStorageImpl>(
             environment_->main_runner(), environment_->GetIORunner(),
             environment_->coroutine_service(), base_storage_dir_,
-            name_as_string);
+            name_as_string, environment_->db_options(),
+            environment_->configuration().storage_params.use_ledger_database
+                ? storage::LedgerStorageImpl::DbLayout::PER_LEDGER
+                : storage::LedgerStorageImpl::DbLayout::PER_PAGE);
     std::unique_ptr<cloud_sync::LedgerSync> ledger_sync;
     if (environment_->configuration().use_sync) {
       ledger_sync = std::make_unique<cloud_sync::LedgerSyncImpl>(
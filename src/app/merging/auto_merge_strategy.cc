@@ -4,12 +4,14 @@
 
 #include "apps/ledger/src/app/merging/auto_merge_strategy.h"
 
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "apps/ledger/src/app/merging/conflict_resolver_client.h"
 #include "apps/ledger/src/app/page_manager.h"
+#include "apps/ledger/src/callback/waiter.h"
 #include "lib/ftl/functional/closure.h"
 #include "lib/ftl/functional/make_copyable.h"
 #include "lib/ftl/memory/weak_ptr.h"
@@ -108,7 +110,7 @@ void AutoMergeStrategy::AutoMerger::Start() {
     }
   });
 
-  storage_->GetCommitContentsDiff(*ancestor_, *right_, std::move(on_next),
+  storage_->GetCommitContentsDiff(*ancestor_, *right_, "", std::move(on_next),
                                   std::move(on_done));
 }
 
@@ -173,7 +175,7 @@ void AutoMergeStrategy::AutoMerger::OnRightChangeReady(
     }
   });
 
-  storage_->GetCommitContentsDiff(*ancestor_, *left_, std::move(on_next),
+  storage_->GetCommitContentsDiff(*ancestor_, *left_, "", std::move(on_next),
                                   std::move(on_done));
 }
 
@@ -256,6 +258,177 @@ void AutoMergeStrategy::AutoMerger::Done() {
   on_done();
 }
 
+// Merges more than two heads in one pass. The merge succeeds only if the
+// changes of all heads since their common ancestor are pairwise compatible,
+// i.e. no key is modified differently by two heads. Otherwise, nothing is
+// committed and the heads are left to be merged two by two.
+class AutoMergeStrategy::MultipleHeadsMerger {
+ public:
+  MultipleHeadsMerger(
+      storage::PageStorage* storage,
+      std::vector<std::unique_ptr<const storage::Commit>> heads,
+      std::unique_ptr<const storage::Commit> ancestor,
+      std::function<void(std::unique_ptr<const storage::Commit>)> on_done);
+  ~MultipleHeadsMerger();
+
+  void Start();
+  void Cancel();
+
+ private:
+  void OnDiffsReady(
+      storage::Status status,
+      std::vector<std::unique_ptr<std::vector<storage::EntryChange>>> diffs);
+  void Done(std::unique_ptr<const storage::Commit> merge_commit);
+
+  storage::PageStorage* const storage_;
+
+  std::vector<std::unique_ptr<const storage::Commit>> heads_;
+  std::unique_ptr<const storage::Commit> ancestor_;
+
+  std::function<void(std::unique_ptr<const storage::Commit>)> on_done_;
+
+  std::unique_ptr<storage::Journal> journal_;
+  bool cancelled_ = false;
+
+  // This must be the last member of the class.
+  ftl::WeakPtrFactory<AutoMergeStrategy::MultipleHeadsMerger> weak_factory_;
+};
+
+AutoMergeStrategy::MultipleHeadsMerger::MultipleHeadsMerger(
+    storage::PageStorage* storage,
+    std::vector<std::unique_ptr<const storage::Commit>> heads,
+    std::unique_ptr<const storage::Commit> ancestor,
+    std::function<void(std::unique_ptr<const storage::Commit>)> on_done)
+    : storage_(storage),
+      heads_(std::move(heads)),
+      ancestor_(std::move(ancestor)),
+      on_done_(std::move(on_done)),
+      weak_factory_(this) {
+  FTL_DCHECK(heads_.size() >= 2);
+  FTL_DCHECK(on_done_);
+}
+
+AutoMergeStrategy::MultipleHeadsMerger::~MultipleHeadsMerger() {
+  if (journal_) {
+    journal_->Rollback();
+  }
+}
+
+void AutoMergeStrategy::MultipleHeadsMerger::Start() {
+  auto waiter = callback::Waiter<
+      storage::Status, std::unique_ptr<std::vector<storage::EntryChange>>>::
+      Create(storage::Status::OK);
+  for (const auto& head : heads_) {
+    std::unique_ptr<std::vector<storage::EntryChange>> changes(
+        new std::vector<storage::EntryChange>());
+    auto on_next =
+        [ weak_this = weak_factory_.GetWeakPtr(),
+          changes = changes.get() ](storage::EntryChange change) {
+      if (!weak_this || weak_this->cancelled_) {
+        return false;
+      }
+      changes->push_back(std::move(change));
+      return true;
+    };
+    auto on_done = ftl::MakeCopyable([
+      changes = std::move(changes), callback = waiter->NewCallback()
+    ](storage::Status status) mutable {
+      callback(status, std::move(changes));
+    });
+    storage_->GetCommitContentsDiff(*ancestor_, *head, "", std::move(on_next),
+                                    std::move(on_done));
+  }
+  waiter->Finalize([weak_this = weak_factory_.GetWeakPtr()](
+      storage::Status status,
+      std::vector<std::unique_ptr<std::vector<storage::EntryChange>>> diffs) {
+    if (weak_this) {
+      weak_this->OnDiffsReady(status, std::move(diffs));
+    }
+  });
+}
+
+void AutoMergeStrategy::MultipleHeadsMerger::OnDiffsReady(
+    storage::Status status,
+    std::vector<std::unique_ptr<std::vector<storage::EntryChange>>> diffs) {
+  if (cancelled_) {
+    Done(nullptr);
+    return;
+  }
+
+  if (status != storage::Status::OK) {
+    FTL_LOG(ERROR) << "Unable to compute diff due to error " << status
+                   << ", aborting.";
+    Done(nullptr);
+    return;
+  }
+
+  // Union of the changes of all heads but the first one, which is the base of
+  // the merge commit.
+  std::map<std::string, const storage::EntryChange*> changes;
+  for (size_t i = 1; i < diffs.size(); ++i) {
+    for (const storage::EntryChange& change : *diffs[i]) {
+      auto it = changes.find(change.entry.key);
+      if (it == changes.end()) {
+        changes[change.entry.key] = &change;
+        continue;
+      }
+      if (!(*it->second == change)) {
+        Done(nullptr);
+        return;
+      }
+    }
+  }
+  for (const storage::EntryChange& change : *diffs[0]) {
+    auto it = changes.find(change.entry.key);
+    if (it != changes.end() && !(*it->second == change)) {
+      Done(nullptr);
+      return;
+    }
+  }
+
+  storage::Status s = storage_->StartMergeCommit(
+      heads_[0]->GetId(), heads_[1]->GetId(), &journal_);
+  if (s != storage::Status::OK) {
+    FTL_LOG(ERROR) << "Unable to start merge commit: " << s;
+    Done(nullptr);
+    return;
+  }
+  for (const auto& change : changes) {
+    if (change.second->deleted) {
+      journal_->Delete(change.first);
+    } else {
+      journal_->Put(change.first, change.second->entry.object_id,
+                    change.second->entry.priority);
+    }
+  }
+  journal_->Commit([weak_this = weak_factory_.GetWeakPtr()](
+      storage::Status status,
+      std::unique_ptr<const storage::Commit> merge_commit) {
+    if (status != storage::Status::OK) {
+      FTL_LOG(ERROR) << "Unable to commit merge journal: " << status;
+    }
+    if (weak_this) {
+      weak_this->journal_.reset();
+      weak_this->Done(std::move(merge_commit));
+    }
+  });
+}
+
+void AutoMergeStrategy::MultipleHeadsMerger::Cancel() {
+  cancelled_ = true;
+}
+
+void AutoMergeStrategy::MultipleHeadsMerger::Done(
+    std::unique_ptr<const storage::Commit> merge_commit) {
+  if (journal_) {
+    journal_->Rollback();
+    journal_.reset();
+  }
+  auto on_done = std::move(on_done_);
+  on_done_ = nullptr;
+  on_done(std::move(merge_commit));
+}
+
 AutoMergeStrategy::AutoMergeStrategy(ConflictResolverPtr conflict_resolver)
     : conflict_resolver_(std::move(conflict_resolver)) {
   conflict_resolver_.set_connection_error_handler([this]() {
@@ -265,6 +438,9 @@ AutoMergeStrategy::AutoMergeStrategy(ConflictResolverPtr conflict_resolver)
       // callback.
       in_progress_merge_->Cancel();
     }
+    if (in_progress_multiple_merge_) {
+      in_progress_multiple_merge_->Cancel();
+    }
     if (on_error_) {
       // It is safe to call |on_error_| because the error handler waits for the
       // merges to finish before deleting this object.
@@ -287,6 +463,7 @@ void AutoMergeStrategy::Merge(storage::PageStorage* storage,
                               ftl::Closure on_done) {
   FTL_DCHECK(head_1->GetTimestamp() <= head_2->GetTimestamp());
   FTL_DCHECK(!in_progress_merge_);
+  FTL_DCHECK(!in_progress_multiple_merge_);
 
   in_progress_merge_ = std::make_unique<AutoMergeStrategy::AutoMerger>(
       storage, page_manager, conflict_resolver_.get(), std::move(head_2),
@@ -299,9 +476,38 @@ void AutoMergeStrategy::Merge(storage::PageStorage* storage,
   in_progress_merge_->Start();
 }
 
+bool AutoMergeStrategy::SupportsMultipleHeads() {
+  return true;
+}
+
+void AutoMergeStrategy::MergeMultiple(
+    storage::PageStorage* storage,
+    PageManager* page_manager,
+    std::vector<std::unique_ptr<const storage::Commit>> heads,
+    std::unique_ptr<const storage::Commit> ancestor,
+    std::function<void(std::unique_ptr<const storage::Commit>)> on_done) {
+  FTL_DCHECK(!in_progress_merge_);
+  FTL_DCHECK(!in_progress_multiple_merge_);
+
+  in_progress_multiple_merge_ =
+      std::make_unique<AutoMergeStrategy::MultipleHeadsMerger>(
+          storage, std::move(heads), std::move(ancestor),
+          [ this, on_done = std::move(on_done) ](
+              std::unique_ptr<const storage::Commit> merge_commit) {
+            in_progress_multiple_merge_.reset();
+            on_done(std::move(merge_commit));
+          });
+
+  in_progress_multiple_merge_->Start();
+}
+
 void AutoMergeStrategy::Cancel() {
-  FTL_DCHECK(in_progress_merge_);
-  in_progress_merge_->Cancel();
+  FTL_DCHECK(in_progress_merge_ || in_progress_multiple_merge_);
+  if (in_progress_merge_) {
+    in_progress_merge_->Cancel();
+  } else {
+    in_progress_multiple_merge_->Cancel();
+  }
 }
 
 }  // namespace ledger
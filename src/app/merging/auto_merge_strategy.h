@@ -6,6 +6,8 @@
 #define APPS_LEDGER_SRC_APP_MERGING_AUTO_MERGE_STRATEGY_H_
 
 #include <memory>
+#include <vector>
+
 #include "apps/ledger/services/public/ledger.fidl.h"
 #include "apps/ledger/src/app/merging/merge_strategy.h"
 #include "apps/ledger/src/storage/public/commit.h"
@@ -29,16 +31,27 @@ class AutoMergeStrategy : public MergeStrategy {
              std::unique_ptr<const storage::Commit> ancestor,
              ftl::Closure on_done) override;
 
+  bool SupportsMultipleHeads() override;
+
+  void MergeMultiple(storage::PageStorage* storage,
+                     PageManager* page_manager,
+                     std::vector<std::unique_ptr<const storage::Commit>> heads,
+                     std::unique_ptr<const storage::Commit> ancestor,
+                     std::function<void(std::unique_ptr<const storage::Commit>)>
+                         on_done) override;
+
   void Cancel() override;
 
  private:
   class AutoMerger;
+  class MultipleHeadsMerger;
 
   ftl::Closure on_error_;
 
   ConflictResolverPtr conflict_resolver_;
 
   std::unique_ptr<AutoMerger> in_progress_merge_;
+  std::unique_ptr<MultipleHeadsMerger> in_progress_multiple_merge_;
 
   FTL_DISALLOW_COPY_AND_ASSIGN(AutoMergeStrategy);
 };
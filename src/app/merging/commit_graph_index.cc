@@ -0,0 +1,178 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/app/merging/commit_graph_index.h"
+
+#include "lib/ftl/logging.h"
+
+namespace ledger {
+
+CommitGraphIndex::CommitGraphIndex(size_t max_size) : max_size_(max_size) {
+  FTL_DCHECK(max_size_ > 0);
+}
+
+CommitGraphIndex::~CommitGraphIndex() {}
+
+void CommitGraphIndex::AddCommit(const storage::Commit& commit) {
+  if (FindNode(commit.GetId())) {
+    return;
+  }
+  IndexedNode indexed_node;
+  indexed_node.node.generation = commit.GetGeneration();
+  for (storage::CommitIdView parent_id : commit.GetParentIds()) {
+    indexed_node.node.parent_ids.push_back(parent_id.ToString());
+  }
+  indexed_node.position = node_ids_.insert(node_ids_.end(), commit.GetId());
+  nodes_.emplace(commit.GetId(), std::move(indexed_node));
+  while (node_ids_.size() > max_size_) {
+    nodes_.erase(node_ids_.front());
+    node_ids_.pop_front();
+  }
+}
+
+const CommitGraphIndex::Node* CommitGraphIndex::GetNode(
+    storage::CommitIdView commit_id) {
+  IndexedNode* indexed_node = FindNode(commit_id);
+  if (!indexed_node) {
+    return nullptr;
+  }
+  return &indexed_node->node;
+}
+
+bool CommitGraphIndex::GetLinearAncestor(storage::CommitIdView commit_id,
+                                         uint64_t min_generation,
+                                         storage::CommitId* ancestor_id,
+                                         uint64_t* ancestor_generation) {
+  ComputeSkip(commit_id);
+  IndexedNode* current = FindNode(commit_id);
+  IndexedNode* start = current;
+  storage::CommitIdView current_id = commit_id;
+  while (current && current->node.generation > min_generation &&
+         !current->skip_id.empty()) {
+    IndexedNode* next = nullptr;
+    if (current->skip_generation >= min_generation) {
+      next = FindNode(current->skip_id);
+      if (next) {
+        current_id = current->skip_id;
+      }
+    }
+    if (!next) {
+      // The skip pointer goes past |min_generation|, or its target has been
+      // evicted: go to the parent.
+      next = FindNode(current->node.parent_ids[0]);
+      if (next) {
+        current_id = current->node.parent_ids[0];
+      }
+    }
+    linear_ancestor_lookups_++;
+    if (!next) {
+      break;
+    }
+    current = next;
+  }
+  if (!current || current == start) {
+    return false;
+  }
+  *ancestor_id = current_id.ToString();
+  *ancestor_generation = current->node.generation;
+  return true;
+}
+
+void CommitGraphIndex::SetCommonAncestor(storage::CommitIdView commit_id_1,
+                                         storage::CommitIdView commit_id_2,
+                                         storage::CommitIdView ancestor_id) {
+  CommitIdPair key = MakePair(commit_id_1, commit_id_2);
+  if (common_ancestors_.find(key) != common_ancestors_.end()) {
+    return;
+  }
+  CommonAncestor common_ancestor;
+  common_ancestor.ancestor_id = ancestor_id.ToString();
+  common_ancestor.position =
+      common_ancestor_keys_.insert(common_ancestor_keys_.end(), key);
+  common_ancestors_.emplace(std::move(key), std::move(common_ancestor));
+  while (common_ancestor_keys_.size() > max_size_) {
+    common_ancestors_.erase(common_ancestor_keys_.front());
+    common_ancestor_keys_.pop_front();
+  }
+}
+
+bool CommitGraphIndex::GetCommonAncestor(storage::CommitIdView commit_id_1,
+                                         storage::CommitIdView commit_id_2,
+                                         storage::CommitId* ancestor_id) {
+  auto it = common_ancestors_.find(MakePair(commit_id_1, commit_id_2));
+  if (it == common_ancestors_.end()) {
+    return false;
+  }
+  common_ancestor_keys_.splice(common_ancestor_keys_.end(),
+                               common_ancestor_keys_, it->second.position);
+  *ancestor_id = it->second.ancestor_id;
+  return true;
+}
+
+CommitGraphIndex::CommitIdPair CommitGraphIndex::MakePair(
+    storage::CommitIdView commit_id_1,
+    storage::CommitIdView commit_id_2) {
+  if (commit_id_2 < commit_id_1) {
+    return CommitIdPair(commit_id_2.ToString(), commit_id_1.ToString());
+  }
+  return CommitIdPair(commit_id_1.ToString(), commit_id_2.ToString());
+}
+
+CommitGraphIndex::IndexedNode* CommitGraphIndex::FindNode(
+    storage::CommitIdView commit_id) {
+  auto it = nodes_.find(commit_id);
+  if (it == nodes_.end()) {
+    return nullptr;
+  }
+  node_ids_.splice(node_ids_.end(), node_ids_, it->second.position);
+  return &it->second;
+}
+
+void CommitGraphIndex::ComputeSkip(storage::CommitIdView commit_id) {
+  // Collect the commits of the chain whose skip pointer is missing, from the
+  // most recent one.
+  std::vector<IndexedNode*> chain;
+  auto it = nodes_.find(commit_id);
+  while (it != nodes_.end() && !it->second.has_skip) {
+    IndexedNode* indexed_node = &it->second;
+    if (indexed_node->node.parent_ids.size() != 1) {
+      // Merge commits and the first commit end the chain.
+      indexed_node->has_skip = true;
+      break;
+    }
+    chain.push_back(indexed_node);
+    it = nodes_.find(indexed_node->node.parent_ids[0]);
+  }
+
+  // Compute the skip pointers from the oldest commit. The skip pointer of a
+  // commit is the skip pointer of the skip pointer of its parent if the two
+  // jumps have the same length, and its parent otherwise: the lengths of the
+  // jumps follow a skew binary decomposition of the generations.
+  for (auto chain_it = chain.rbegin(); chain_it != chain.rend(); ++chain_it) {
+    IndexedNode* indexed_node = *chain_it;
+    const storage::CommitId& parent_id = indexed_node->node.parent_ids[0];
+    indexed_node->has_skip = true;
+    indexed_node->skip_id = parent_id;
+    indexed_node->skip_generation = indexed_node->node.generation - 1;
+
+    auto parent_it = nodes_.find(parent_id);
+    if (parent_it == nodes_.end() || parent_it->second.skip_id.empty()) {
+      continue;
+    }
+    const IndexedNode& parent = parent_it->second;
+    indexed_node->skip_generation = parent.node.generation;
+    auto skip_it = nodes_.find(parent.skip_id);
+    if (skip_it == nodes_.end() || skip_it->second.skip_id.empty()) {
+      continue;
+    }
+    const IndexedNode& skip = skip_it->second;
+    if (parent.node.generation - skip.node.generation ==
+        skip.node.generation - skip.skip_generation) {
+      indexed_node->skip_id = skip.skip_id;
+      indexed_node->skip_generation = skip.skip_generation;
+    }
+  }
+}
+
+}  // namespace ledger
@@ -0,0 +1,125 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPS_LEDGER_SRC_APP_MERGING_COMMIT_GRAPH_INDEX_H_
+#define APPS_LEDGER_SRC_APP_MERGING_COMMIT_GRAPH_INDEX_H_
+
+#include <list>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "apps/ledger/src/convert/convert.h"
+#include "apps/ledger/src/storage/public/commit.h"
+#include "apps/ledger/src/storage/public/types.h"
+#include "lib/ftl/macros.h"
+
+namespace ledger {
+
+// In-memory index of the commit graph of a page. For each known commit, it
+// holds the generation and the ids of the parents, so that the commit graph
+// can be walked without reading and parsing commits from storage. It also
+// remembers the lowest common ancestors previously computed.
+//
+// Linear chains of commits, i.e. commits having a single parent, are walked
+// through skip pointers: each commit of a chain points to an ancestor of the
+// chain, at a generation chosen so that the ancestor of a commit at any given
+// generation of the chain is found in a number of steps logarithmic in the
+// length of the chain.
+//
+// The index is bounded: when it grows past its maximal size, the least
+// recently used entries are evicted. Clients must thus be ready to fall back
+// to the storage when a commit is not found in the index.
+class CommitGraphIndex {
+ public:
+  struct Node {
+    uint64_t generation;
+    std::vector<storage::CommitId> parent_ids;
+  };
+
+  explicit CommitGraphIndex(size_t max_size);
+  ~CommitGraphIndex();
+
+  // Adds the given commit to the index.
+  void AddCommit(const storage::Commit& commit);
+
+  // Returns the node of the commit with the given id, or nullptr if it is not
+  // in the index. The returned pointer is invalidated by the next call to
+  // |AddCommit|.
+  const Node* GetNode(storage::CommitIdView commit_id);
+
+  // Walks the linear chain of ancestors of the commit |commit_id| down to
+  // |min_generation|. Returns true and sets |ancestor_id| and
+  // |ancestor_generation| to the lowest ancestor reached, which has a
+  // generation of at least |min_generation|, if the walk went past
+  // |commit_id|. The walk stops early at commits that don't have exactly one
+  // parent, and at commits that are not in the index.
+  bool GetLinearAncestor(storage::CommitIdView commit_id,
+                         uint64_t min_generation,
+                         storage::CommitId* ancestor_id,
+                         uint64_t* ancestor_generation);
+
+  // Records |ancestor_id| as the lowest common ancestor of |commit_id_1| and
+  // |commit_id_2|.
+  void SetCommonAncestor(storage::CommitIdView commit_id_1,
+                         storage::CommitIdView commit_id_2,
+                         storage::CommitIdView ancestor_id);
+
+  // Returns true and sets |ancestor_id| if the lowest common ancestor of
+  // |commit_id_1| and |commit_id_2| is known.
+  bool GetCommonAncestor(storage::CommitIdView commit_id_1,
+                         storage::CommitIdView commit_id_2,
+                         storage::CommitId* ancestor_id);
+
+  // Returns the number of nodes read from the index by |GetLinearAncestor|
+  // since the creation of the index.
+  size_t linear_ancestor_lookups() const { return linear_ancestor_lookups_; }
+
+ private:
+  using CommitIdPair = std::pair<storage::CommitId, storage::CommitId>;
+
+  struct IndexedNode {
+    Node node;
+    // Whether the skip pointer has been computed.
+    bool has_skip = false;
+    // Ancestor of the commit in its linear chain, and its generation. Empty if
+    // the commit doesn't have exactly one parent.
+    storage::CommitId skip_id;
+    uint64_t skip_generation = 0;
+    // Position of the commit in |node_ids_|.
+    std::list<storage::CommitId>::iterator position;
+  };
+
+  struct CommonAncestor {
+    storage::CommitId ancestor_id;
+    // Position of the pair in |common_ancestor_keys_|.
+    std::list<CommitIdPair>::iterator position;
+  };
+
+  static CommitIdPair MakePair(storage::CommitIdView commit_id_1,
+                               storage::CommitIdView commit_id_2);
+
+  // Returns the indexed node of |commit_id| and marks it as recently used, or
+  // nullptr if it is not in the index.
+  IndexedNode* FindNode(storage::CommitIdView commit_id);
+  // Computes the skip pointers of |commit_id| and of its indexed ancestors in
+  // its linear chain that don't have one yet.
+  void ComputeSkip(storage::CommitIdView commit_id);
+
+  const size_t max_size_;
+  std::map<storage::CommitId, IndexedNode, convert::StringViewComparator>
+      nodes_;
+  // Ids of the commits in |nodes_|, from the least to the most recently used.
+  std::list<storage::CommitId> node_ids_;
+  std::map<CommitIdPair, CommonAncestor> common_ancestors_;
+  // Keys of |common_ancestors_|, from the least to the most recently used.
+  std::list<CommitIdPair> common_ancestor_keys_;
+  size_t linear_ancestor_lookups_ = 0;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(CommitGraphIndex);
+};
+
+}  // namespace ledger
+
+#endif  // APPS_LEDGER_SRC_APP_MERGING_COMMIT_GRAPH_INDEX_H_
@@ -0,0 +1,154 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/app/merging/commit_graph_index.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "apps/ledger/src/storage/test/commit_empty_impl.h"
+#include "gtest/gtest.h"
+
+namespace ledger {
+namespace {
+
+class TestCommit : public storage::test::CommitEmptyImpl {
+ public:
+  TestCommit(storage::CommitId id,
+             uint64_t generation,
+             std::vector<storage::CommitId> parent_ids)
+      : id_(std::move(id)),
+        generation_(generation),
+        parent_ids_(std::move(parent_ids)) {}
+  ~TestCommit() override = default;
+
+  const storage::CommitId& GetId() const override { return id_; }
+
+  std::vector<storage::CommitIdView> GetParentIds() const override {
+    std::vector<storage::CommitIdView> result;
+    for (const auto& parent_id : parent_ids_) {
+      result.push_back(parent_id);
+    }
+    return result;
+  }
+
+  uint64_t GetGeneration() const override { return generation_; }
+
+ private:
+  const storage::CommitId id_;
+  const uint64_t generation_;
+  const std::vector<storage::CommitId> parent_ids_;
+};
+
+std::string ChainId(size_t generation) {
+  return "commit" + std::to_string(generation);
+}
+
+// Adds a linear chain of |length| commits to |index|, from the newest one if
+// |newest_first| is true.
+void AddChain(CommitGraphIndex* index, size_t length, bool newest_first) {
+  for (size_t i = 0; i < length; ++i) {
+    size_t generation = newest_first ? length - 1 - i : i;
+    std::vector<storage::CommitId> parent_ids;
+    if (generation > 0) {
+      parent_ids.push_back(ChainId(generation - 1));
+    }
+    index->AddCommit(
+        TestCommit(ChainId(generation), generation, std::move(parent_ids)));
+  }
+}
+
+TEST(CommitGraphIndexTest, GetNode) {
+  CommitGraphIndex index(10u);
+  index.AddCommit(TestCommit("commit1", 1u, {"commit0"}));
+
+  const CommitGraphIndex::Node* node = index.GetNode("commit1");
+  ASSERT_TRUE(node);
+  EXPECT_EQ(1u, node->generation);
+  EXPECT_EQ(std::vector<storage::CommitId>({"commit0"}), node->parent_ids);
+  EXPECT_FALSE(index.GetNode("commit0"));
+}
+
+TEST(CommitGraphIndexTest, EvictLeastRecentlyUsed) {
+  CommitGraphIndex index(2u);
+  index.AddCommit(TestCommit("commit1", 1u, {"commit0"}));
+  index.AddCommit(TestCommit("commit2", 1u, {"commit0"}));
+  EXPECT_TRUE(index.GetNode("commit1"));
+  index.AddCommit(TestCommit("commit3", 1u, {"commit0"}));
+
+  EXPECT_TRUE(index.GetNode("commit1"));
+  EXPECT_FALSE(index.GetNode("commit2"));
+  EXPECT_TRUE(index.GetNode("commit3"));
+}
+
+TEST(CommitGraphIndexTest, LinearAncestorLogarithmicLookups) {
+  const size_t kChainLength = 4096;
+  for (bool newest_first : {false, true}) {
+    CommitGraphIndex index(kChainLength);
+    AddChain(&index, kChainLength, newest_first);
+
+    storage::CommitId ancestor_id;
+    uint64_t ancestor_generation;
+    ASSERT_TRUE(index.GetLinearAncestor(ChainId(kChainLength - 1), 1u,
+                                        &ancestor_id, &ancestor_generation));
+    EXPECT_EQ(ChainId(1), ancestor_id);
+    EXPECT_EQ(1u, ancestor_generation);
+    size_t lookups = index.linear_ancestor_lookups();
+    // The walk takes a number of steps logarithmic in the length of the chain,
+    // i.e. at most 3 * log2(4096).
+    EXPECT_GE(36u, lookups);
+
+    ASSERT_TRUE(index.GetLinearAncestor(ChainId(3000), 1234u, &ancestor_id,
+                                        &ancestor_generation));
+    EXPECT_EQ(ChainId(1234), ancestor_id);
+    EXPECT_EQ(1234u, ancestor_generation);
+    EXPECT_GE(36u, index.linear_ancestor_lookups() - lookups);
+  }
+}
+
+TEST(CommitGraphIndexTest, LinearAncestorStopsAtMergeCommits) {
+  CommitGraphIndex index(10u);
+  index.AddCommit(TestCommit("commit0", 0u, {}));
+  index.AddCommit(TestCommit("left1", 1u, {"commit0"}));
+  index.AddCommit(TestCommit("right1", 1u, {"commit0"}));
+  index.AddCommit(TestCommit("merge2", 2u, {"left1", "right1"}));
+  index.AddCommit(TestCommit("commit3", 3u, {"merge2"}));
+  index.AddCommit(TestCommit("commit4", 4u, {"commit3"}));
+
+  storage::CommitId ancestor_id;
+  uint64_t ancestor_generation;
+  ASSERT_TRUE(index.GetLinearAncestor("commit4", 0u, &ancestor_id,
+                                      &ancestor_generation));
+  EXPECT_EQ("merge2", ancestor_id);
+  EXPECT_EQ(2u, ancestor_generation);
+  EXPECT_FALSE(index.GetLinearAncestor("merge2", 0u, &ancestor_id,
+                                       &ancestor_generation));
+}
+
+TEST(CommitGraphIndexTest, LinearAncestorStopsAtMissingCommits) {
+  CommitGraphIndex index(10u);
+  index.AddCommit(TestCommit("commit2", 2u, {"commit1"}));
+  index.AddCommit(TestCommit("commit3", 3u, {"commit2"}));
+
+  storage::CommitId ancestor_id;
+  uint64_t ancestor_generation;
+  ASSERT_TRUE(index.GetLinearAncestor("commit3", 0u, &ancestor_id,
+                                      &ancestor_generation));
+  EXPECT_EQ("commit2", ancestor_id);
+  EXPECT_EQ(2u, ancestor_generation);
+}
+
+TEST(CommitGraphIndexTest, CommonAncestor) {
+  CommitGraphIndex index(10u);
+  storage::CommitId ancestor_id;
+  EXPECT_FALSE(index.GetCommonAncestor("commit1", "commit2", &ancestor_id));
+
+  index.SetCommonAncestor("commit1", "commit2", "commit0");
+  ASSERT_TRUE(index.GetCommonAncestor("commit2", "commit1", &ancestor_id));
+  EXPECT_EQ("commit0", ancestor_id);
+}
+
+}  // namespace
+}  // namespace ledger
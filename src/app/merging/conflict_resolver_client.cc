@@ -117,24 +117,16 @@ void ConflictResolverClient::OnMergeDone(
   ftl::RefPtr<callback::Waiter<storage::Status, storage::ObjectId>> waiter =
       callback::Waiter<storage::Status, storage::ObjectId>::Create(
           storage::Status::OK);
+  // Values coming from the right commit are all retrieved with a single lookup
+  // in the right commit.
+  std::vector<std::string> right_keys;
+  std::vector<std::function<void(storage::Status, storage::ObjectId)>>
+      right_callbacks;
   for (const MergedValuePtr& merged_value : merged_values) {
     switch (merged_value->source) {
       case ValueSource::RIGHT: {
-        std::string key = convert::ToString(merged_value->key);
-        storage_->GetEntryFromCommit(*right_, key, [
-          key, callback = waiter->NewCallback()
-        ](storage::Status status, storage::Entry entry) {
-          if (status != storage::Status::OK) {
-            if (status == storage::Status::NOT_FOUND) {
-              FTL_LOG(ERROR)
-                  << "Key " << key
-                  << " is not present in the right change. Unable to proceed";
-            }
-            callback(status, storage::ObjectId());
-            return;
-          }
-          callback(storage::Status::OK, entry.object_id);
-        });
+        right_keys.push_back(convert::ToString(merged_value->key));
+        right_callbacks.push_back(waiter->NewCallback());
         break;
       }
       case ValueSource::NEW: {
@@ -163,6 +155,29 @@ void ConflictResolverClient::OnMergeDone(
     }
   }
 
+  if (!right_keys.empty()) {
+    storage_->GetEntriesFromCommit(
+        *right_, std::move(right_keys),
+        [right_callbacks = std::move(right_callbacks)](
+            storage::Status status, std::vector<storage::Entry> entries) {
+          if (status != storage::Status::OK) {
+            if (status == storage::Status::NOT_FOUND) {
+              FTL_LOG(ERROR) << "Some keys are not present in the right "
+                                "change. Unable to proceed";
+            }
+            for (const auto& callback : right_callbacks) {
+              callback(status, storage::ObjectId());
+            }
+            return;
+          }
+          FTL_DCHECK(entries.size() == right_callbacks.size());
+          for (size_t i = 0; i < entries.size(); ++i) {
+            right_callbacks[i](storage::Status::OK,
+                               std::move(entries[i].object_id));
+          }
+        });
+  }
+
   waiter->Finalize(ftl::MakeCopyable([
     weak_this = weak_factory_.GetWeakPtr(),
     merged_values = std::move(merged_values)
@@ -6,6 +6,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "apps/ledger/src/app/page_manager.h"
 #include "lib/ftl/functional/closure.h"
@@ -15,26 +16,31 @@ namespace ledger {
 
 class LastOneWinsMergeStrategy::LastOneWinsMerger {
  public:
-  LastOneWinsMerger(storage::PageStorage* storage,
-                    std::unique_ptr<const storage::Commit> left,
-                    std::unique_ptr<const storage::Commit> right,
-                    std::unique_ptr<const storage::Commit> ancestor,
-                    ftl::Closure on_done);
+  // |heads| must be sorted by timestamp. The merge commit has the first two
+  // heads as parents, and the changes of all other heads since |ancestor| are
+  // applied on top of the first one.
+  LastOneWinsMerger(
+      storage::PageStorage* storage,
+      std::vector<std::unique_ptr<const storage::Commit>> heads,
+      std::unique_ptr<const storage::Commit> ancestor,
+      std::function<void(std::unique_ptr<const storage::Commit>)> on_done);
   ~LastOneWinsMerger();
 
   void Start();
   void Cancel();
 
  private:
-  void Done();
+  // Applies the changes of the head at |head_index| to the journal.
+  void ApplyDiff(size_t head_index);
+  void CommitJournal();
+  void Done(std::unique_ptr<const storage::Commit> merge_commit);
 
   storage::PageStorage* const storage_;
 
-  std::unique_ptr<const storage::Commit> const left_;
-  std::unique_ptr<const storage::Commit> const right_;
+  std::vector<std::unique_ptr<const storage::Commit>> const heads_;
   std::unique_ptr<const storage::Commit> const ancestor_;
 
-  ftl::Closure on_done_;
+  std::function<void(std::unique_ptr<const storage::Commit>)> on_done_;
 
   std::unique_ptr<storage::Journal> journal_;
   bool cancelled_ = false;
@@ -45,16 +51,15 @@ class LastOneWinsMergeStrategy::LastOneWinsMerger {
 
 LastOneWinsMergeStrategy::LastOneWinsMerger::LastOneWinsMerger(
     storage::PageStorage* storage,
-    std::unique_ptr<const storage::Commit> left,
-    std::unique_ptr<const storage::Commit> right,
+    std::vector<std::unique_ptr<const storage::Commit>> heads,
     std::unique_ptr<const storage::Commit> ancestor,
-    ftl::Closure on_done)
+    std::function<void(std::unique_ptr<const storage::Commit>)> on_done)
     : storage_(storage),
-      left_(std::move(left)),
-      right_(std::move(right)),
+      heads_(std::move(heads)),
       ancestor_(std::move(ancestor)),
       on_done_(std::move(on_done)),
       weak_factory_(this) {
+  FTL_DCHECK(heads_.size() >= 2);
   FTL_DCHECK(on_done_);
 }
 
@@ -65,10 +70,15 @@ LastOneWinsMergeStrategy::LastOneWinsMerger::~LastOneWinsMerger() {
 }
 
 void LastOneWinsMergeStrategy::LastOneWinsMerger::Start() {
-  storage::Status s =
-      storage_->StartMergeCommit(left_->GetId(), right_->GetId(), &journal_);
+  storage::Status s = storage_->StartMergeCommit(
+      heads_[0]->GetId(), heads_[1]->GetId(), &journal_);
   FTL_DCHECK(s == storage::Status::OK);
 
+  ApplyDiff(1);
+}
+
+void LastOneWinsMergeStrategy::LastOneWinsMerger::ApplyDiff(
+    size_t head_index) {
   auto on_next = [weak_this =
                       weak_factory_.GetWeakPtr()](storage::EntryChange change) {
     if (!weak_this || weak_this->cancelled_) {
@@ -89,33 +99,42 @@ void LastOneWinsMergeStrategy::LastOneWinsMerger::Start() {
     return true;
   };
 
-  auto on_diff_done = [weak_this =
-                           weak_factory_.GetWeakPtr()](storage::Status s) {
+  auto on_diff_done = [ weak_this = weak_factory_.GetWeakPtr(),
+                        head_index ](storage::Status s) {
     if (!weak_this) {
       return;
     }
     if (weak_this->cancelled_) {
-      weak_this->Done();
+      weak_this->Done(nullptr);
       return;
     }
     if (s != storage::Status::OK) {
       FTL_LOG(ERROR) << "Unable to create diff for merging: " << s;
-      weak_this->Done();
+      weak_this->Done(nullptr);
+      return;
+    }
+    // Later heads are applied last, so that their changes win.
+    if (head_index + 1 < weak_this->heads_.size()) {
+      weak_this->ApplyDiff(head_index + 1);
       return;
     }
-    weak_this->journal_->Commit(
-        [weak_this](storage::Status s, std::unique_ptr<const storage::Commit>) {
-          if (s != storage::Status::OK) {
-            FTL_LOG(ERROR) << "Unable to commit merge journal: " << s;
-          }
-          if (!weak_this) {
-            return;
-          }
-          weak_this->Done();
-        });
+    weak_this->CommitJournal();
   };
-  storage_->GetCommitContentsDiff(*ancestor_, *right_, std::move(on_next),
-                                  std::move(on_diff_done));
+  storage_->GetCommitContentsDiff(*ancestor_, *heads_[head_index], "",
+                                  std::move(on_next), std::move(on_diff_done));
+}
+
+void LastOneWinsMergeStrategy::LastOneWinsMerger::CommitJournal() {
+  journal_->Commit([weak_this = weak_factory_.GetWeakPtr()](
+      storage::Status s, std::unique_ptr<const storage::Commit> merge_commit) {
+    if (s != storage::Status::OK) {
+      FTL_LOG(ERROR) << "Unable to commit merge journal: " << s;
+    }
+    if (!weak_this) {
+      return;
+    }
+    weak_this->Done(std::move(merge_commit));
+  });
 }
 
 void LastOneWinsMergeStrategy::LastOneWinsMerger::Cancel() {
@@ -126,10 +145,11 @@ void LastOneWinsMergeStrategy::LastOneWinsMerger::Cancel() {
   }
 }
 
-void LastOneWinsMergeStrategy::LastOneWinsMerger::Done() {
+void LastOneWinsMergeStrategy::LastOneWinsMerger::Done(
+    std::unique_ptr<const storage::Commit> merge_commit) {
   auto on_done = std::move(on_done_);
   on_done_ = nullptr;
-  on_done();
+  on_done(std::move(merge_commit));
 }
 
 LastOneWinsMergeStrategy::LastOneWinsMergeStrategy() {}
@@ -148,10 +168,14 @@ void LastOneWinsMergeStrategy::Merge(
   FTL_DCHECK(!in_progress_merge_);
   FTL_DCHECK(head_1->GetTimestamp() <= head_2->GetTimestamp());
 
+  std::vector<std::unique_ptr<const storage::Commit>> heads;
+  heads.push_back(std::move(head_1));
+  heads.push_back(std::move(head_2));
   in_progress_merge_ =
       std::make_unique<LastOneWinsMergeStrategy::LastOneWinsMerger>(
-          storage, std::move(head_1), std::move(head_2), std::move(ancestor),
-          [ this, on_done = std::move(on_done) ] {
+          storage, std::move(heads), std::move(ancestor),
+          [ this, on_done = std::move(on_done) ](
+              std::unique_ptr<const storage::Commit> merge_commit) {
             in_progress_merge_.reset();
             on_done();
           });
@@ -159,6 +183,31 @@ void LastOneWinsMergeStrategy::Merge(
   in_progress_merge_->Start();
 }
 
+bool LastOneWinsMergeStrategy::SupportsMultipleHeads() {
+  return true;
+}
+
+void LastOneWinsMergeStrategy::MergeMultiple(
+    storage::PageStorage* storage,
+    PageManager* page_manager,
+    std::vector<std::unique_ptr<const storage::Commit>> heads,
+    std::unique_ptr<const storage::Commit> ancestor,
+    std::function<void(std::unique_ptr<const storage::Commit>)> on_done) {
+  FTL_DCHECK(!in_progress_merge_);
+  FTL_DCHECK(heads.size() >= 2);
+
+  in_progress_merge_ =
+      std::make_unique<LastOneWinsMergeStrategy::LastOneWinsMerger>(
+          storage, std::move(heads), std::move(ancestor),
+          [ this, on_done = std::move(on_done) ](
+              std::unique_ptr<const storage::Commit> merge_commit) {
+            in_progress_merge_.reset();
+            on_done(std::move(merge_commit));
+          });
+
+  in_progress_merge_->Start();
+}
+
 void LastOneWinsMergeStrategy::Cancel() {
   FTL_DCHECK(in_progress_merge_);
   in_progress_merge_->Cancel();
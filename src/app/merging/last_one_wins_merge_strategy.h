@@ -15,7 +15,10 @@
 namespace ledger {
 // Strategy for merging commits using a last-one-wins policy for conflicts.
 // Commits are merged key-by-key. When a key has been modified on both sides,
-// the value from the most recent commit is used.
+// the value from the most recent commit is used. When more than two heads are
+// merged at once, the changes of each head since the common ancestor of all
+// heads are applied in timestamp order, so that the most recent change of each
+// key wins.
 class LastOneWinsMergeStrategy : public MergeStrategy {
  public:
   LastOneWinsMergeStrategy();
@@ -30,6 +33,15 @@ class LastOneWinsMergeStrategy : public MergeStrategy {
              std::unique_ptr<const storage::Commit> ancestor,
              ftl::Closure on_done) override;
 
+  bool SupportsMultipleHeads() override;
+
+  void MergeMultiple(storage::PageStorage* storage,
+                     PageManager* page_manager,
+                     std::vector<std::unique_ptr<const storage::Commit>> heads,
+                     std::unique_ptr<const storage::Commit> ancestor,
+                     std::function<void(std::unique_ptr<const storage::Commit>)>
+                         on_done) override;
+
   void Cancel() override;
 
  private:
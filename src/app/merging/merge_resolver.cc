@@ -5,6 +5,7 @@
 #include "apps/ledger/src/app/merging/merge_resolver.h"
 
 #include <algorithm>
+#include <iterator>
 #include <memory>
 #include <queue>
 #include <set>
@@ -20,70 +21,104 @@
 
 namespace ledger {
 namespace {
-// Comparator for commits that order commits based on their generation, then on
-// their id.
-struct GenerationComparator {
-  bool operator()(const std::unique_ptr<const storage::Commit>& lhs,
-                  const std::unique_ptr<const storage::Commit>& rhs) const {
-    uint64_t lhs_generation = lhs->GetGeneration();
-    uint64_t rhs_generation = rhs->GetGeneration();
-    return lhs_generation == rhs_generation ? lhs->GetId() < rhs->GetId()
-                                            : lhs_generation < rhs_generation;
-  }
-};
+// Maximal number of commits kept in the commit graph index.
+constexpr size_t kCommitGraphIndexSize = 4096;
+
+// Maximal delay of a merge while remote commits are being downloaded.
+constexpr ftl::TimeDelta kMaxMergeDelay = ftl::TimeDelta::FromSeconds(5);
+
+// Set of commits, identified by generation and id, ordered by generation, then
+// by id.
+using GenerationSet = std::set<std::pair<uint64_t, storage::CommitId>>;
 
-// Recursively retrieves the parents of the most recent commits in the given
-// set, i.e. the commits with the highest generation. The recursion stops when
-// only one commit is left in the set, which is the lowest common ancestor.
+// Recursively replaces the most recent commits in the given set, i.e. the
+// commits with the highest generation, by their parents. The recursion stops
+// when only one commit is left in the set, which is the lowest common ancestor.
+// Generations and parents are read from |index| when available, and commits
+// are only retrieved from |storage| otherwise. Linear chains of indexed commits
+// are skipped over in logarithmic time.
 void FindCommonAncestorInGeneration(
     storage::PageStorage* storage,
-    std::set<std::unique_ptr<const storage::Commit>, GenerationComparator>*
-        commits,
-    std::function<void(Status, std::unique_ptr<const storage::Commit>)>
-        callback) {
+    CommitGraphIndex* index,
+    GenerationSet* commits,
+    std::function<void(Status, storage::CommitId)> callback) {
   FTL_DCHECK(!commits->empty());
-  // If there is only one commit in the set it is the lowest common ancestor.
-  if (commits->size() == 1) {
-    callback(Status::OK,
-             std::move(const_cast<std::unique_ptr<const storage::Commit>&>(
-                 *commits->rbegin())));
-    return;
-  }
-  // Pop the newest commits and retrieve their parents.
-  uint64_t expected_generation = (*commits->rbegin())->GetGeneration();
   auto waiter = callback::
       Waiter<storage::Status, std::unique_ptr<const storage::Commit>>::Create(
           storage::Status::OK);
-  while (commits->size() > 1 &&
-         expected_generation == (*commits->rbegin())->GetGeneration()) {
-    // Pop the newest commit.
-    std::unique_ptr<const storage::Commit> commit =
-        std::move(const_cast<std::unique_ptr<const storage::Commit>&>(
-            *commits->rbegin()));
-    auto it = commits->end();
-    --it;
-    commits->erase(it);
-    // Request its parents.
-    for (const auto& parent_id : commit->GetParentIds()) {
-      storage->GetCommit(parent_id, waiter->NewCallback());
+  bool pending_requests = false;
+  // Walk the graph synchronously as long as all the needed commits are in the
+  // index.
+  while (!pending_requests) {
+    // If there is only one commit in the set it is the lowest common ancestor.
+    if (commits->size() == 1) {
+      callback(Status::OK, commits->rbegin()->second);
+      return;
     }
+    // If the newest commit is alone in its generation, none of the commits
+    // between it and the generation of the next commit can be an ancestor of
+    // the other commits: if it is part of a linear chain, replace it directly
+    // by its ancestor at that generation.
+    auto newest = commits->rbegin();
+    uint64_t next_generation = std::next(newest)->first;
+    storage::CommitId ancestor_id;
+    uint64_t ancestor_generation;
+    if (newest->first > next_generation &&
+        index->GetLinearAncestor(newest->second, next_generation,
+                                 &ancestor_id, &ancestor_generation)) {
+      commits->erase(std::prev(commits->end()));
+      commits->emplace(ancestor_generation, std::move(ancestor_id));
+      continue;
+    }
+    // Pop the newest commits and retrieve their parents.
+    uint64_t expected_generation = commits->rbegin()->first;
+    GenerationSet indexed_parents;
+    while (commits->size() > 1 &&
+           expected_generation == commits->rbegin()->first) {
+      // Pop the newest commit.
+      auto it = commits->end();
+      --it;
+      storage::CommitId commit_id = it->second;
+      commits->erase(it);
+      const CommitGraphIndex::Node* node = index->GetNode(commit_id);
+      if (!node) {
+        // The commit has been evicted from the index: retrieve it again, it
+        // will be added back to the set.
+        storage->GetCommit(commit_id, waiter->NewCallback());
+        pending_requests = true;
+        continue;
+      }
+      // Request its parents.
+      for (const auto& parent_id : node->parent_ids) {
+        const CommitGraphIndex::Node* parent_node = index->GetNode(parent_id);
+        if (parent_node) {
+          indexed_parents.emplace(parent_node->generation, parent_id);
+        } else {
+          storage->GetCommit(parent_id, waiter->NewCallback());
+          pending_requests = true;
+        }
+      }
+    }
+    commits->insert(indexed_parents.begin(), indexed_parents.end());
   }
   // Once the parents have been retrieved, recursively try to find the common
   // ancestor in that generation.
-  waiter->Finalize(
-      ftl::MakeCopyable([ storage, commits, callback = std::move(callback) ](
-          storage::Status status,
-          std::vector<std::unique_ptr<const storage::Commit>> parents) mutable {
-        if (status != storage::Status::OK) {
-          callback(PageUtils::ConvertStatus(status), nullptr);
-          return;
-        }
-        // Push the parents in the commit set.
-        for (auto& parent : parents) {
-          commits->insert(std::move(parent));
-        }
-        FindCommonAncestorInGeneration(storage, commits, std::move(callback));
-      }));
+  waiter->Finalize(ftl::MakeCopyable([
+    storage, index, commits, callback = std::move(callback)
+  ](storage::Status status,
+    std::vector<std::unique_ptr<const storage::Commit>> parents) mutable {
+    if (status != storage::Status::OK) {
+      callback(PageUtils::ConvertStatus(status), "");
+      return;
+    }
+    // Push the parents in the commit set.
+    for (auto& parent : parents) {
+      index->AddCommit(*parent);
+      commits->emplace(parent->GetGeneration(), parent->GetId());
+    }
+    FindCommonAncestorInGeneration(storage, index, commits,
+                                   std::move(callback));
+  }));
 }
 
 // Sets merge_in_progress value to true on construction and false on
@@ -117,7 +152,10 @@ class MergeInProgress {
 
 MergeResolver::MergeResolver(ftl::Closure on_destroyed,
                              storage::PageStorage* storage)
-    : storage_(storage), on_destroyed_(on_destroyed), weak_ptr_factory_(this) {
+    : storage_(storage),
+      on_destroyed_(on_destroyed),
+      commit_graph_index_(kCommitGraphIndexSize),
+      weak_ptr_factory_(this) {
   storage_->AddCommitWatcher(this);
   PostCheckConflicts();
 }
@@ -132,7 +170,7 @@ void MergeResolver::set_on_empty(ftl::Closure on_empty_callback) {
 }
 
 bool MergeResolver::IsEmpty() {
-  return !merge_in_progress_;
+  return !merge_in_progress_ && merge_deferred_since_ == ftl::TimePoint();
 }
 
 void MergeResolver::SetMergeStrategy(std::unique_ptr<MergeStrategy> strategy) {
@@ -140,7 +178,10 @@ void MergeResolver::SetMergeStrategy(std::unique_ptr<MergeStrategy> strategy) {
     FTL_DCHECK(strategy_);
     next_strategy_ = std::move(strategy);
     switch_strategy_ = true;
-    strategy_->Cancel();
+    // When folding heads into a merge commit, the strategy is already done.
+    if (!fold_journal_) {
+      strategy_->Cancel();
+    }
     return;
   }
   strategy_.swap(strategy);
@@ -154,24 +195,69 @@ void MergeResolver::SetPageManager(PageManager* page_manager) {
   page_manager_ = page_manager;
 }
 
+void MergeResolver::SetIsDownloadIdle(std::function<bool()> is_download_idle) {
+  is_download_idle_ = std::move(is_download_idle);
+}
+
+void MergeResolver::OnDownloadIdle() {
+  if (merge_deferred_since_ != ftl::TimePoint()) {
+    PostCheckConflicts();
+  }
+}
+
 void MergeResolver::OnNewCommits(
     const std::vector<std::unique_ptr<const storage::Commit>>& commits,
     storage::ChangeSource source) {
+  for (const auto& commit : commits) {
+    commit_graph_index_.AddCommit(*commit);
+  }
   PostCheckConflicts();
 }
 
 void MergeResolver::PostCheckConflicts() {
+  if (check_conflicts_posted_) {
+    return;
+  }
+  check_conflicts_posted_ = true;
   mtl::MessageLoop::GetCurrent()
       ->task_runner()
       ->PostTask([weak_this_ptr = weak_ptr_factory_.GetWeakPtr()]() {
         if (weak_this_ptr) {
+          weak_this_ptr->check_conflicts_posted_ = false;
           weak_this_ptr->CheckConflicts();
         }
       });
 }
+
+void MergeResolver::PostDelayedCheckConflicts(ftl::TimeDelta delay) {
+  if (delayed_check_conflicts_posted_) {
+    return;
+  }
+  delayed_check_conflicts_posted_ = true;
+  mtl::MessageLoop::GetCurrent()->task_runner()->PostDelayedTask(
+      [weak_this_ptr = weak_ptr_factory_.GetWeakPtr()]() {
+        if (weak_this_ptr) {
+          weak_this_ptr->delayed_check_conflicts_posted_ = false;
+          weak_this_ptr->CheckConflicts();
+        }
+      },
+      delay);
+}
+
 void MergeResolver::CheckConflicts() {
-  if (!strategy_ || merge_in_progress_) {
-    // No strategy, or a merge already in progress. Let's bail out early.
+  if (merge_in_progress_) {
+    // A merge already in progress. Let's bail out early.
+    return;
+  }
+
+  ftl::TimePoint deferred_since = merge_deferred_since_;
+  bool was_deferred = deferred_since != ftl::TimePoint();
+  merge_deferred_since_ = ftl::TimePoint();
+  if (!strategy_) {
+    // No strategy.
+    if (was_deferred && on_empty_callback_) {
+      on_empty_callback_();
+    }
     return;
   }
 
@@ -180,24 +266,56 @@ void MergeResolver::CheckConflicts() {
   FTL_DCHECK(s == storage::Status::OK);
   if (heads.size() == 1) {
     // No conflict.
+    if (was_deferred && on_empty_callback_) {
+      on_empty_callback_();
+    }
     return;
   }
+
+  if (is_download_idle_ && !is_download_idle_()) {
+    // Remote commits are being added to the page: wait for the download to be
+    // done before merging, so that all of them are merged at once, but not
+    // longer than |kMaxMergeDelay|.
+    ftl::TimePoint now = ftl::TimePoint::Now();
+    if (!was_deferred) {
+      deferred_since = now;
+    }
+    ftl::TimeDelta elapsed = now - deferred_since;
+    if (elapsed < kMaxMergeDelay) {
+      merge_deferred_since_ = deferred_since;
+      PostDelayedCheckConflicts(kMaxMergeDelay - elapsed);
+      return;
+    }
+  }
   ResolveConflicts(std::move(heads));
 }
 
 void MergeResolver::ResolveConflicts(std::vector<storage::CommitId> heads) {
   FTL_DCHECK(heads.size() >= 2);
   MergeInProgress merge_token(&merge_in_progress_);
+  ftl::Closure on_merge_done =
+      ftl::MakeCopyable([ this, merge_token = std::move(merge_token) ]() {
+        merge_in_progress_ = false;
+        if (switch_strategy_) {
+          strategy_ = std::move(next_strategy_);
+          next_strategy_.reset();
+          switch_strategy_ = false;
+        }
+        PostCheckConflicts();
+        // Call on_empty_callback_ at the very end as this might delete this.
+        if (on_empty_callback_) {
+          on_empty_callback_();
+        }
+      });
   auto waiter = callback::
       Waiter<storage::Status, std::unique_ptr<const storage::Commit>>::Create(
           storage::Status::OK);
   for (const storage::CommitId& id : heads) {
     storage_->GetCommit(id, waiter->NewCallback());
   }
-  waiter->Finalize(ftl::MakeCopyable([
-    this, merge_token = std::move(merge_token)
-  ](storage::Status status,
-    std::vector<std::unique_ptr<const storage::Commit>> commits) mutable {
+  waiter->Finalize([ this, on_merge_done = std::move(on_merge_done) ](
+      storage::Status status,
+      std::vector<std::unique_ptr<const storage::Commit>> commits) {
     if (status != storage::Status::OK) {
       FTL_LOG(ERROR) << "Failed to retrieve head commits.";
       return;
@@ -209,66 +327,239 @@ void MergeResolver::ResolveConflicts(std::vector<storage::CommitId> heads) {
                 return lhs->GetTimestamp() < rhs->GetTimestamp();
               });
 
+    if (commits.size() > 2 && strategy_->SupportsMultipleHeads()) {
+      MergeMultipleHeads(std::move(commits), on_merge_done);
+      return;
+    }
     // Merge the first two commits using the most recent one as the base.
-    auto head1 = std::move(commits[0]);
-    auto head2 = std::move(commits[1]);
-    FindCommonAncestor(
-        head1->Clone(), head2->Clone(),
-        ftl::MakeCopyable([
-          this, head1 = std::move(head1), head2 = std::move(head2),
-          merge_token = std::move(merge_token)
-        ](Status status,
-          std::unique_ptr<const storage::Commit> common_ancestor) mutable {
-          if (status != Status::OK) {
-            FTL_LOG(ERROR) << "Failed to find common ancestor of head commits.";
-            return;
-          }
-          strategy_->Merge(
-              storage_, page_manager_, std::move(head1), std::move(head2),
-              std::move(common_ancestor),
-              ftl::MakeCopyable(
-                  [ this, merge_token = std::move(merge_token) ]() {
-                    merge_in_progress_ = false;
-                    if (switch_strategy_) {
-                      strategy_ = std::move(next_strategy_);
-                      next_strategy_.reset();
-                      switch_strategy_ = false;
-                    }
-                    PostCheckConflicts();
-                    // Call on_empty_callback_ at the very end as this
-                    // might delete this.
-                    if (on_empty_callback_) {
-                      on_empty_callback_();
-                    }
-                  }));
-        }));
+    MergeTwoHeads(std::move(commits[0]), std::move(commits[1]), on_merge_done);
+  });
+}
+
+void MergeResolver::MergeTwoHeads(std::unique_ptr<const storage::Commit> head1,
+                                  std::unique_ptr<const storage::Commit> head2,
+                                  ftl::Closure on_done) {
+  std::vector<std::unique_ptr<const storage::Commit>> heads;
+  heads.push_back(head1->Clone());
+  heads.push_back(head2->Clone());
+  FindCommonAncestor(
+      std::move(heads), ftl::MakeCopyable([
+        this, head1 = std::move(head1), head2 = std::move(head2),
+        on_done = std::move(on_done)
+      ](Status status,
+        std::unique_ptr<const storage::Commit> common_ancestor) mutable {
+        if (status != Status::OK) {
+          FTL_LOG(ERROR) << "Failed to find common ancestor of head commits.";
+          return;
+        }
+        strategy_->Merge(storage_, page_manager_, std::move(head1),
+                         std::move(head2), std::move(common_ancestor),
+                         std::move(on_done));
+      }));
+}
+
+void MergeResolver::MergeMultipleHeads(
+    std::vector<std::unique_ptr<const storage::Commit>> heads,
+    ftl::Closure on_done) {
+  std::vector<std::unique_ptr<const storage::Commit>> heads_clone;
+  for (const auto& head : heads) {
+    heads_clone.push_back(head->Clone());
+  }
+  FindCommonAncestor(
+      std::move(heads_clone), ftl::MakeCopyable([
+        this, heads = std::move(heads), on_done = std::move(on_done)
+      ](Status status,
+        std::unique_ptr<const storage::Commit> common_ancestor) mutable {
+        if (status != Status::OK) {
+          FTL_LOG(ERROR) << "Failed to find common ancestor of head commits.";
+          return;
+        }
+        std::vector<std::unique_ptr<const storage::Commit>> heads_clone;
+        for (const auto& head : heads) {
+          heads_clone.push_back(head->Clone());
+        }
+        storage::CommitId ancestor_id = common_ancestor->GetId();
+        HaveDisjointHistories(
+            std::move(heads_clone), ancestor_id, ftl::MakeCopyable([
+              this, heads = std::move(heads),
+              common_ancestor = std::move(common_ancestor),
+              on_done = std::move(on_done)
+            ](Status status, bool disjoint) mutable {
+              if (status != Status::OK) {
+                FTL_LOG(ERROR)
+                    << "Failed to find common ancestors of head commits.";
+                return;
+              }
+              if (!disjoint) {
+                // Some heads share changes made since the common ancestor,
+                // which would be applied again on top of later changes of the
+                // other heads: merge the heads two by two.
+                MergeTwoHeads(std::move(heads[0]), std::move(heads[1]),
+                              std::move(on_done));
+                return;
+              }
+              MergeDisjointHeads(std::move(heads), std::move(common_ancestor),
+                                 std::move(on_done));
+            }));
+      }));
+}
+
+void MergeResolver::MergeDisjointHeads(
+    std::vector<std::unique_ptr<const storage::Commit>> heads,
+    std::unique_ptr<const storage::Commit> common_ancestor,
+    ftl::Closure on_done) {
+  // The strategy merges the first two heads. The other ones are folded in
+  // timestamp order into the resulting commit.
+  std::vector<storage::CommitId> head_ids;
+  for (size_t i = heads.size() - 1; i >= 2; --i) {
+    head_ids.push_back(heads[i]->GetId());
+  }
+  auto head1 = heads[0]->Clone();
+  auto head2 = heads[1]->Clone();
+  strategy_->MergeMultiple(
+      storage_, page_manager_, std::move(heads), std::move(common_ancestor),
+      ftl::MakeCopyable([
+        this, head1 = std::move(head1), head2 = std::move(head2),
+        head_ids = std::move(head_ids), on_done = std::move(on_done)
+      ](std::unique_ptr<const storage::Commit> merge_commit) mutable {
+        if (merge_commit) {
+          FoldHeads(merge_commit->GetId(), std::move(head_ids),
+                    std::move(on_done));
+          return;
+        }
+        if (switch_strategy_) {
+          // The merge has been cancelled.
+          on_done();
+          return;
+        }
+        // The heads could not be merged in one pass: fall back to merging the
+        // first two.
+        MergeTwoHeads(std::move(head1), std::move(head2), std::move(on_done));
+      }));
+}
+
+void MergeResolver::HaveDisjointHistories(
+    std::vector<std::unique_ptr<const storage::Commit>> heads,
+    const storage::CommitId& ancestor_id,
+    std::function<void(Status, bool)> callback) {
+  // The common ancestors of the pairs of heads are mostly found from
+  // |commit_graph_index_|, populated by the search of the common ancestor of
+  // all heads.
+  auto waiter = callback::
+      Waiter<Status, std::unique_ptr<const storage::Commit>>::Create(
+          Status::OK);
+  for (size_t i = 0; i < heads.size(); ++i) {
+    for (size_t j = i + 1; j < heads.size(); ++j) {
+      std::vector<std::unique_ptr<const storage::Commit>> pair;
+      pair.push_back(heads[i]->Clone());
+      pair.push_back(heads[j]->Clone());
+      FindCommonAncestor(std::move(pair), waiter->NewCallback());
+    }
+  }
+  waiter->Finalize([ ancestor_id, callback = std::move(callback) ](
+      Status status,
+      std::vector<std::unique_ptr<const storage::Commit>> ancestors) {
+    if (status != Status::OK) {
+      callback(status, false);
+      return;
+    }
+    for (const auto& ancestor : ancestors) {
+      if (ancestor->GetId() != ancestor_id) {
+        callback(Status::OK, false);
+        return;
+      }
+    }
+    callback(Status::OK, true);
+  });
+}
+
+void MergeResolver::FoldHeads(storage::CommitId merge_id,
+                              std::vector<storage::CommitId> head_ids,
+                              ftl::Closure on_done) {
+  if (head_ids.empty()) {
+    on_done();
+    return;
+  }
+  storage::CommitId head_id = std::move(head_ids.back());
+  head_ids.pop_back();
+  storage::Status s =
+      storage_->StartMergeCommit(merge_id, head_id, &fold_journal_);
+  if (s != storage::Status::OK) {
+    FTL_LOG(ERROR) << "Unable to start merge commit: " << s;
+    on_done();
+    return;
+  }
+  // The journal is committed without any change: the new commit has the
+  // content of its first parent, and no new tree node is built.
+  fold_journal_->Commit(ftl::MakeCopyable([
+    this, head_ids = std::move(head_ids), on_done = std::move(on_done)
+  ](storage::Status status,
+    std::unique_ptr<const storage::Commit> merge_commit) mutable {
+    fold_journal_.reset();
+    if (status != storage::Status::OK) {
+      FTL_LOG(ERROR) << "Unable to commit merge journal: " << status;
+      on_done();
+      return;
+    }
+    FoldHeads(merge_commit->GetId(), std::move(head_ids), std::move(on_done));
   }));
 }
 
 void MergeResolver::FindCommonAncestor(
-    std::unique_ptr<const storage::Commit> head1,
-    std::unique_ptr<const storage::Commit> head2,
+    std::vector<std::unique_ptr<const storage::Commit>> heads,
     std::function<void(Status, std::unique_ptr<const storage::Commit>)>
         callback) {
+  auto get_ancestor = [
+    storage = storage_, callback = std::move(callback)
+  ](Status status, storage::CommitId ancestor_id) {
+    if (status != Status::OK) {
+      callback(status, nullptr);
+      return;
+    }
+    storage->GetCommit(
+        ancestor_id,
+        [callback](storage::Status status,
+                   std::unique_ptr<const storage::Commit> ancestor) {
+          callback(PageUtils::ConvertStatus(status), std::move(ancestor));
+        });
+  };
+
+  // Repeated merges of the same heads (e.g. after a cancelled merge) reuse the
+  // previously computed ancestor.
+  storage::CommitId ancestor_id;
+  if (heads.size() == 2 &&
+      commit_graph_index_.GetCommonAncestor(heads[0]->GetId(),
+                                            heads[1]->GetId(), &ancestor_id)) {
+    get_ancestor(Status::OK, std::move(ancestor_id));
+    return;
+  }
+
   // The algorithm goes as follows: we keep a set of "active" commits, ordered
   // by generation order. Until this set has only one element, we take the
   // commit with the greater generation (the one deepest in the commit graph)
-  // and replace it by its parent. If we seed the initial set with two commits,
-  // we get their unique lowest common ancestor.
+  // and replace it by its parent. If we seed the initial set with two or more
+  // commits, we get their unique lowest common ancestor.
   // At each step of the recursion (FindCommonAncestorInGeneration) we request
-  // the parent commits of all commits with the same generation.
+  // the parent commits of all commits with the same generation. The generation
+  // and parents of already seen commits are read from |commit_graph_index_|.
 
   // commits set should not be deleted before the callback is executed.
-  auto commits = std::make_unique<
-      std::set<std::unique_ptr<const storage::Commit>, GenerationComparator>>();
+  auto commits = std::make_unique<GenerationSet>();
 
-  commits->emplace(std::move(head1));
-  commits->emplace(std::move(head2));
+  for (const auto& head : heads) {
+    commit_graph_index_.AddCommit(*head);
+    commits->emplace(head->GetGeneration(), head->GetId());
+  }
   FindCommonAncestorInGeneration(
-      storage_, commits.get(), ftl::MakeCopyable([
-        commits = std::move(commits), callback = std::move(callback)
-      ](Status status, std::unique_ptr<const storage::Commit> ancestor) {
-        callback(status, std::move(ancestor));
+      storage_, &commit_graph_index_, commits.get(), ftl::MakeCopyable([
+        this, commits = std::move(commits), heads = std::move(heads),
+        get_ancestor = std::move(get_ancestor)
+      ](Status status, storage::CommitId ancestor_id) {
+        if (status == Status::OK && heads.size() == 2) {
+          commit_graph_index_.SetCommonAncestor(
+              heads[0]->GetId(), heads[1]->GetId(), ancestor_id);
+        }
+        get_ancestor(status, std::move(ancestor_id));
       }));
 }
 
@@ -5,13 +5,19 @@
 #ifndef APPS_LEDGER_SRC_APP_MERGING_MERGE_RESOLVER_H_
 #define APPS_LEDGER_SRC_APP_MERGING_MERGE_RESOLVER_H_
 
+#include <functional>
+#include <memory>
 #include <vector>
 
 #include "apps/ledger/services/public/ledger.fidl.h"
+#include "apps/ledger/src/app/merging/commit_graph_index.h"
+#include "apps/ledger/src/storage/public/journal.h"
 #include "apps/ledger/src/storage/public/page_storage.h"
 #include "lib/ftl/functional/closure.h"
 #include "lib/ftl/macros.h"
 #include "lib/ftl/memory/weak_ptr.h"
+#include "lib/ftl/time/time_delta.h"
+#include "lib/ftl/time/time_point.h"
 
 namespace ledger {
 class PageManager;
@@ -34,18 +40,61 @@ class MergeResolver : public storage::CommitWatcher {
 
   void SetPageManager(PageManager* page_manager);
 
+  // Sets a function returning true when no remote commits are being added to
+  // the page. While remote commits are being added, merges are deferred, as
+  // the new commits would likely create new conflicts with the merge commit.
+  // |OnDownloadIdle| must be called when the download of remote commits is
+  // done.
+  void SetIsDownloadIdle(std::function<bool()> is_download_idle);
+
+  // Notifies this resolver that remote commits are no longer being added to
+  // the page.
+  void OnDownloadIdle();
+
  private:
   // storage::CommitWatcher:
   void OnNewCommits(
       const std::vector<std::unique_ptr<const storage::Commit>>& commits,
       storage::ChangeSource source) override;
 
+  // Schedules a check for conflicts. Multiple calls before the check runs
+  // result in a single check.
   void PostCheckConflicts();
+  void PostDelayedCheckConflicts(ftl::TimeDelta delay);
   void CheckConflicts();
   void ResolveConflicts(std::vector<storage::CommitId> heads);
+  // Merges |head1| and |head2|, |head1| being the oldest one.
+  void MergeTwoHeads(std::unique_ptr<const storage::Commit> head1,
+                     std::unique_ptr<const storage::Commit> head2,
+                     ftl::Closure on_done);
+  // Merges all |heads|, sorted by timestamp, in a single pass.
+  void MergeMultipleHeads(
+      std::vector<std::unique_ptr<const storage::Commit>> heads,
+      ftl::Closure on_done);
+  // Merges all |heads|, sorted by timestamp, which share no history since
+  // |common_ancestor|.
+  void MergeDisjointHeads(
+      std::vector<std::unique_ptr<const storage::Commit>> heads,
+      std::unique_ptr<const storage::Commit> common_ancestor,
+      ftl::Closure on_done);
+  // Checks whether |ancestor_id| is the lowest common ancestor of each pair of
+  // |heads|, i.e. whether the heads share no history since |ancestor_id|. The
+  // changes of each head since the common ancestor of all heads can only be
+  // applied in a single pass if that is the case.
+  void HaveDisjointHistories(
+      std::vector<std::unique_ptr<const storage::Commit>> heads,
+      const storage::CommitId& ancestor_id,
+      std::function<void(Status, bool)> callback);
+  // Folds the heads in |head_ids| into the merge commit |merge_id|. Each head
+  // is added with a new merge commit having the previous merge commit and the
+  // head as parents, and the same content as |merge_id|. |head_ids| are folded
+  // from the last to the first one.
+  void FoldHeads(storage::CommitId merge_id,
+                 std::vector<storage::CommitId> head_ids,
+                 ftl::Closure on_done);
+  // Finds the lowest common ancestor of all |heads|.
   void FindCommonAncestor(
-      std::unique_ptr<const storage::Commit> head1,
-      std::unique_ptr<const storage::Commit> head2,
+      std::vector<std::unique_ptr<const storage::Commit>> heads,
       std::function<void(Status, std::unique_ptr<const storage::Commit>)>
           callback);
 
@@ -55,8 +104,16 @@ class MergeResolver : public storage::CommitWatcher {
   std::unique_ptr<MergeStrategy> next_strategy_;
   bool switch_strategy_ = false;
   bool merge_in_progress_ = false;
+  bool check_conflicts_posted_ = false;
+  bool delayed_check_conflicts_posted_ = false;
+  std::function<bool()> is_download_idle_;
+  // Time at which merging was first deferred because of remote commits being
+  // downloaded, or null if merging is not deferred.
+  ftl::TimePoint merge_deferred_since_;
   ftl::Closure on_empty_callback_;
   ftl::Closure on_destroyed_;
+  CommitGraphIndex commit_graph_index_;
+  std::unique_ptr<storage::Journal> fold_journal_;
 
   // WeakPtrFactory must be the last field of the class.
   ftl::WeakPtrFactory<MergeResolver> weak_ptr_factory_;
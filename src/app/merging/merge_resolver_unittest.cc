@@ -201,6 +201,36 @@ TEST_F(MergeResolverTest, CommonAncestor) {
   EXPECT_TRUE(resolver.IsEmpty());
 }
 
+TEST_F(MergeResolverTest, CommonAncestorLongBranches) {
+  // Set up conflict between two long branches.
+  storage::CommitId ancestor = CreateCommit(
+      storage::kFirstPageCommitId, AddKeyValueToJournal("key1", "val1.0"));
+
+  storage::CommitId head1 = ancestor;
+  storage::CommitId head2 = ancestor;
+  for (size_t i = 0; i < 20; ++i) {
+    std::string suffix = std::to_string(i);
+    head1 = CreateCommit(head1, AddKeyValueToJournal("key2", "val2." + suffix));
+    head2 = CreateCommit(head2, AddKeyValueToJournal("key3", "val3." + suffix));
+  }
+  // Make one branch longer than the other.
+  head2 = CreateCommit(head2, DeleteKeyFromJournal("key1"));
+
+  std::vector<storage::CommitId> ids;
+  EXPECT_EQ(storage::Status::OK, page_storage_->GetHeadCommitIds(&ids));
+  EXPECT_EQ(2u, ids.size());
+
+  std::unique_ptr<VerifyingMergeStrategy> strategy =
+      std::make_unique<VerifyingMergeStrategy>(message_loop_.task_runner(),
+                                               head1, head2, ancestor);
+  MergeResolver resolver([] {}, page_storage_.get());
+  resolver.SetMergeStrategy(std::move(strategy));
+  resolver.set_on_empty([this] { message_loop_.QuitNow(); });
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  EXPECT_TRUE(resolver.IsEmpty());
+}
+
 TEST_F(MergeResolverTest, LastOneWins) {
   // Set up conflict
   storage::CommitId commit_1 = CreateCommit(
@@ -252,6 +282,135 @@ TEST_F(MergeResolverTest, LastOneWins) {
   EXPECT_EQ(MakeObjectId("val3.0"), content_vector[1].object_id);
 }
 
+TEST_F(MergeResolverTest, LastOneWinsMultipleHeads) {
+  // Set up a conflict between four heads.
+  storage::CommitId commit_1 = CreateCommit(
+      storage::kFirstPageCommitId, AddKeyValueToJournal("key1", "val1.0"));
+  CreateCommit(commit_1, AddKeyValueToJournal("key2", "val2.0"));
+  CreateCommit(commit_1, AddKeyValueToJournal("key3", "val3.0"));
+  CreateCommit(commit_1, DeleteKeyFromJournal("key1"));
+  storage::CommitId commit_5 =
+      CreateCommit(commit_1, AddKeyValueToJournal("key4", "val4.0"));
+  CreateCommit(commit_5, AddKeyValueToJournal("key5", "val5.0"));
+
+  std::vector<storage::CommitId> ids;
+  EXPECT_EQ(storage::Status::OK, page_storage_->GetHeadCommitIds(&ids));
+  EXPECT_EQ(4u, ids.size());
+
+  std::unique_ptr<LastOneWinsMergeStrategy> strategy =
+      std::make_unique<LastOneWinsMergeStrategy>();
+  MergeResolver resolver([] {}, page_storage_.get());
+  resolver.SetMergeStrategy(std::move(strategy));
+  resolver.set_on_empty([this] { message_loop_.PostQuitTask(); });
+
+  // All heads are merged in a single pass.
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  EXPECT_TRUE(resolver.IsEmpty());
+  EXPECT_EQ(storage::Status::OK, page_storage_->GetHeadCommitIds(&ids));
+  EXPECT_EQ(1u, ids.size());
+  storage::Status status;
+  std::unique_ptr<const storage::Commit> commit;
+  page_storage_->GetCommit(
+      ids[0], ::callback::Capture([this] { message_loop_.PostQuitTask(); },
+                                  &status, &commit));
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(storage::Status::OK, status);
+
+  std::vector<storage::Entry> content_vector = GetCommitContents(*commit);
+  // Entries are ordered by keys
+  ASSERT_EQ(4u, content_vector.size());
+  EXPECT_EQ("key2", content_vector[0].key);
+  EXPECT_EQ(MakeObjectId("val2.0"), content_vector[0].object_id);
+  EXPECT_EQ("key3", content_vector[1].key);
+  EXPECT_EQ(MakeObjectId("val3.0"), content_vector[1].object_id);
+  EXPECT_EQ("key4", content_vector[2].key);
+  EXPECT_EQ(MakeObjectId("val4.0"), content_vector[2].object_id);
+  EXPECT_EQ("key5", content_vector[3].key);
+  EXPECT_EQ(MakeObjectId("val5.0"), content_vector[3].object_id);
+}
+
+TEST_F(MergeResolverTest, LastOneWinsMultipleHeadsSharedHistory) {
+  // Set up a conflict between three heads, two of them sharing a commit made
+  // since the common ancestor of all heads:
+  //   commit_a <- commit_b <- head_0
+  //                        <- head_1
+  //            <- head_2
+  storage::CommitId commit_a = CreateCommit(
+      storage::kFirstPageCommitId, AddKeyValueToJournal("key1", "val1.0"));
+  storage::CommitId commit_b =
+      CreateCommit(commit_a, AddKeyValueToJournal("key1", "val1.1"));
+  CreateCommit(commit_b, AddKeyValueToJournal("key1", "val1.2"));
+  CreateCommit(commit_b, AddKeyValueToJournal("key2", "val2.0"));
+  CreateCommit(commit_a, AddKeyValueToJournal("key3", "val3.0"));
+
+  std::vector<storage::CommitId> ids;
+  EXPECT_EQ(storage::Status::OK, page_storage_->GetHeadCommitIds(&ids));
+  EXPECT_EQ(3u, ids.size());
+
+  std::unique_ptr<LastOneWinsMergeStrategy> strategy =
+      std::make_unique<LastOneWinsMergeStrategy>();
+  MergeResolver resolver([] {}, page_storage_.get());
+  resolver.SetMergeStrategy(std::move(strategy));
+  resolver.set_on_empty([this, &resolver] {
+    // The heads are merged two by two.
+    std::vector<storage::CommitId> heads;
+    EXPECT_EQ(storage::Status::OK, page_storage_->GetHeadCommitIds(&heads));
+    if (heads.size() == 1u && resolver.IsEmpty()) {
+      message_loop_.PostQuitTask();
+    }
+  });
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  EXPECT_EQ(storage::Status::OK, page_storage_->GetHeadCommitIds(&ids));
+  ASSERT_EQ(1u, ids.size());
+  storage::Status status;
+  std::unique_ptr<const storage::Commit> commit;
+  page_storage_->GetCommit(
+      ids[0], ::callback::Capture([this] { message_loop_.PostQuitTask(); },
+                                  &status, &commit));
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(storage::Status::OK, status);
+
+  // The change of commit_b shared by head_0 and head_1 does not override the
+  // later change of head_0.
+  std::vector<storage::Entry> content_vector = GetCommitContents(*commit);
+  ASSERT_EQ(3u, content_vector.size());
+  EXPECT_EQ("key1", content_vector[0].key);
+  EXPECT_EQ(MakeObjectId("val1.2"), content_vector[0].object_id);
+  EXPECT_EQ("key2", content_vector[1].key);
+  EXPECT_EQ(MakeObjectId("val2.0"), content_vector[1].object_id);
+  EXPECT_EQ("key3", content_vector[2].key);
+  EXPECT_EQ(MakeObjectId("val3.0"), content_vector[2].object_id);
+}
+
+TEST_F(MergeResolverTest, DeferMergeDuringDownload) {
+  // Set up conflict
+  CreateCommit(storage::kFirstPageCommitId, AddKeyValueToJournal("foo", "bar"));
+  CreateCommit(storage::kFirstPageCommitId, AddKeyValueToJournal("foo", "baz"));
+  std::unique_ptr<LastOneWinsMergeStrategy> strategy =
+      std::make_unique<LastOneWinsMergeStrategy>();
+  MergeResolver resolver([] {}, page_storage_.get());
+  bool download_idle = false;
+  resolver.SetIsDownloadIdle([&download_idle] { return download_idle; });
+  resolver.SetMergeStrategy(std::move(strategy));
+  resolver.set_on_empty([this] { message_loop_.PostQuitTask(); });
+
+  // No merge happens while remote commits are being downloaded.
+  EXPECT_TRUE(RunLoopWithTimeout(ftl::TimeDelta::FromMilliseconds(50)));
+  EXPECT_FALSE(resolver.IsEmpty());
+  std::vector<storage::CommitId> ids;
+  EXPECT_EQ(storage::Status::OK, page_storage_->GetHeadCommitIds(&ids));
+  EXPECT_EQ(2u, ids.size());
+
+  download_idle = true;
+  resolver.OnDownloadIdle();
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_TRUE(resolver.IsEmpty());
+  EXPECT_EQ(storage::Status::OK, page_storage_->GetHeadCommitIds(&ids));
+  EXPECT_EQ(1u, ids.size());
+}
+
 TEST_F(MergeResolverTest, None) {
   // Set up conflict
   storage::CommitId commit_1 = CreateCommit(
@@ -5,12 +5,15 @@
 #ifndef APPS_LEDGER_SRC_APP_MERGING_MERGE_STRATEGY_H_
 #define APPS_LEDGER_SRC_APP_MERGING_MERGE_STRATEGY_H_
 
+#include <functional>
 #include <memory>
+#include <vector>
 
 #include "apps/ledger/services/public/ledger.fidl.h"
 #include "apps/ledger/src/app/merging/merge_resolver.h"
 #include "apps/ledger/src/storage/public/commit.h"
 #include "apps/ledger/src/storage/public/page_storage.h"
+#include "lib/ftl/logging.h"
 
 namespace ledger {
 class PageManager;
@@ -37,6 +40,29 @@ class MergeStrategy {
                      std::unique_ptr<const storage::Commit> ancestor,
                      ftl::Closure on_done) = 0;
 
+  // Returns true if this strategy is able to merge more than two heads at once
+  // using |MergeMultiple|.
+  virtual bool SupportsMultipleHeads() { return false; }
+
+  // Merges all the given |heads|, sorted by timestamp, in a single pass.
+  // |ancestor| is the lowest common ancestor of all heads, and of each pair of
+  // them: the heads share no change made since |ancestor|. Commits have at most
+  // two parents: the strategy creates a merge commit of the first two heads,
+  // holding the merged content of all heads, and calls |on_done| with it. The
+  // caller is responsible for folding the remaining heads into that commit. If
+  // the heads cannot be merged in one pass, nothing is committed and |on_done|
+  // is called with a null commit. This must only be called if
+  // |SupportsMultipleHeads| returns true.
+  virtual void MergeMultiple(
+      storage::PageStorage* storage,
+      PageManager* page_manager,
+      std::vector<std::unique_ptr<const storage::Commit>> heads,
+      std::unique_ptr<const storage::Commit> ancestor,
+      std::function<void(std::unique_ptr<const storage::Commit>)> on_done) {
+    FTL_NOTREACHED();
+    on_done(nullptr);
+  }
+
   // Cancel an in-progress merge. This must be called after |Merge| has been
   // called, and before the |on_done| callback.
   virtual void Cancel() = 0;
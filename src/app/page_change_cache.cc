@@ -0,0 +1,141 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/app/page_change_cache.h"
+
+#include <utility>
+
+#include "apps/ledger/src/app/diff_utils.h"
+#include "lib/ftl/logging.h"
+
+namespace ledger {
+namespace {
+// Maximum number of computed PageChanges kept in the cache.
+constexpr size_t kMaxCachedPageChanges = 8;
+}  // namespace
+
+PageChangeCache::PageChangeCache(storage::PageStorage* storage)
+    : storage_(storage), weak_ptr_factory_(this) {}
+
+PageChangeCache::~PageChangeCache() {}
+
+void PageChangeCache::GetPageChange(
+    const storage::Commit& base,
+    const storage::Commit& other,
+    std::string prefix,
+    int64_t max_value_size,
+    std::function<void(Status, PageChangePtr)> callback) {
+  // All negative sizes are equivalent.
+  if (max_value_size < 0) {
+    max_value_size = -1;
+  }
+  CacheKey key(base.GetId(), other.GetId(), prefix, max_value_size);
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    CacheEntry& entry = it->second;
+    if (!entry.computed) {
+      entry.pending_callbacks.push_back(std::move(callback));
+      return;
+    }
+    if (!entry.page_change) {
+      callback(Status::OK, nullptr);
+      return;
+    }
+    PageChangePtr result;
+    Status status = ClonePageChange(entry.page_change, &result);
+    callback(status, std::move(result));
+    return;
+  }
+
+  CacheEntry& entry = entries_[key];
+  entry.base = base.Clone();
+  entry.other = other.Clone();
+  entry.pending_callbacks.push_back(std::move(callback));
+  diff_utils::ComputePageChange(
+      storage_, *entry.base, *entry.other, std::move(prefix), max_value_size,
+      [ weak_this = weak_ptr_factory_.GetWeakPtr(), key ](
+          Status status, PageChangePtr page_change) {
+        if (weak_this) {
+          weak_this->OnPageChangeComputed(key, status, std::move(page_change));
+        }
+      });
+}
+
+void PageChangeCache::OnPageChangeComputed(const CacheKey& key,
+                                           Status status,
+                                           PageChangePtr page_change) {
+  auto it = entries_.find(key);
+  FTL_DCHECK(it != entries_.end());
+  std::vector<std::function<void(Status, PageChangePtr)>> callbacks;
+  callbacks.swap(it->second.pending_callbacks);
+
+  if (status != Status::OK) {
+    // Errors are not cached: the next request will try again.
+    entries_.erase(it);
+    for (auto& callback : callbacks) {
+      callback(status, nullptr);
+    }
+    return;
+  }
+
+  // Compute the results of all pending callbacks before calling any of them,
+  // as they may modify the cache.
+  std::vector<std::pair<Status, PageChangePtr>> results(callbacks.size());
+  for (size_t i = 0; i < callbacks.size(); ++i) {
+    if (!page_change) {
+      results[i].first = Status::OK;
+      continue;
+    }
+    results[i].first = ClonePageChange(page_change, &results[i].second);
+  }
+
+  it->second.computed = true;
+  it->second.page_change = std::move(page_change);
+  it->second.base.reset();
+  it->second.other.reset();
+  computed_keys_.push_back(key);
+  while (computed_keys_.size() > kMaxCachedPageChanges) {
+    entries_.erase(computed_keys_.front());
+    computed_keys_.pop_front();
+  }
+
+  for (size_t i = 0; i < callbacks.size(); ++i) {
+    callbacks[i](results[i].first, std::move(results[i].second));
+  }
+}
+
+Status PageChangeCache::ClonePageChange(const PageChangePtr& page_change,
+                                        PageChangePtr* result) {
+  PageChangePtr clone = PageChange::New();
+  clone->timestamp = page_change->timestamp;
+  clone->changes = fidl::Array<EntryPtr>::New(0);
+  clone->deleted_keys = fidl::Array<fidl::Array<uint8_t>>::New(0);
+  for (const auto& entry : page_change->changes) {
+    EntryPtr entry_clone = Entry::New();
+    entry_clone->key = entry->key.Clone();
+    entry_clone->priority = entry->priority;
+    entry_clone->value_too_large = entry->value_too_large;
+    if (entry->value) {
+      // The VMO is shared by all the watchers: clients can read and map it, but
+      // not write it.
+      mx_status_t mx_status = entry->value.duplicate(
+          MX_RIGHT_DUPLICATE | MX_RIGHT_TRANSFER | MX_RIGHT_READ |
+              MX_RIGHT_MAP | MX_RIGHT_GET_PROPERTY,
+          &entry_clone->value);
+      if (mx_status != NO_ERROR) {
+        FTL_LOG(ERROR) << "Unable to duplicate a value for a PageChange: "
+                       << mx_status;
+        return Status::INTERNAL_ERROR;
+      }
+    }
+    clone->changes.push_back(std::move(entry_clone));
+  }
+  for (const auto& deleted_key : page_change->deleted_keys) {
+    clone->deleted_keys.push_back(deleted_key.Clone());
+  }
+  *result = std::move(clone);
+  return Status::OK;
+}
+
+}  // namespace ledger
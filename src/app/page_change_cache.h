@@ -0,0 +1,84 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPS_LEDGER_SRC_APP_PAGE_CHANGE_CACHE_H_
+#define APPS_LEDGER_SRC_APP_PAGE_CHANGE_CACHE_H_
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "apps/ledger/services/public/ledger.fidl.h"
+#include "apps/ledger/src/storage/public/commit.h"
+#include "apps/ledger/src/storage/public/page_storage.h"
+#include "lib/ftl/macros.h"
+#include "lib/ftl/memory/weak_ptr.h"
+
+namespace ledger {
+
+// Computes and caches the PageChanges sent to the watchers of a page.
+//
+// Watchers of a page are usually notified of the same pairs of commits. This
+// cache ensures that the diff between two commits, and the values of the
+// changed entries, are only computed once for all of them: concurrent requests
+// for the same pair of commits and the same key prefix share a single
+// computation, and the most recent results are kept for watchers that are
+// lagging behind.
+class PageChangeCache {
+ public:
+  explicit PageChangeCache(storage::PageStorage* storage);
+  ~PageChangeCache();
+
+  // Returns the PageChange representing the diff between |base| and |other|,
+  // restricted to keys starting with |prefix| and to values of at most
+  // |max_value_size| bytes, as computed by |diff_utils::ComputePageChange|.
+  // Each caller receives its own PageChange object, but the values of the
+  // entries are duplicated handles of the same VMOs.
+  void GetPageChange(const storage::Commit& base,
+                     const storage::Commit& other,
+                     std::string prefix,
+                     int64_t max_value_size,
+                     std::function<void(Status, PageChangePtr)> callback);
+
+ private:
+  // Key of a cached change: ids of the base and other commits, prefix and
+  // maximal size of the values.
+  using CacheKey =
+      std::tuple<storage::CommitId, storage::CommitId, std::string, int64_t>;
+
+  struct CacheEntry {
+    bool computed = false;
+    // The commits being compared, kept alive while the diff is computed.
+    std::unique_ptr<const storage::Commit> base;
+    std::unique_ptr<const storage::Commit> other;
+    PageChangePtr page_change;
+    std::vector<std::function<void(Status, PageChangePtr)>> pending_callbacks;
+  };
+
+  void OnPageChangeComputed(const CacheKey& key,
+                            Status status,
+                            PageChangePtr page_change);
+
+  // Creates a copy of |page_change| sharing the values of its entries.
+  static Status ClonePageChange(const PageChangePtr& page_change,
+                                PageChangePtr* result);
+
+  storage::PageStorage* const storage_;
+  std::map<CacheKey, CacheEntry> entries_;
+  // Keys of the computed entries, from the oldest to the most recent.
+  std::deque<CacheKey> computed_keys_;
+
+  // This must be the last member of the class.
+  ftl::WeakPtrFactory<PageChangeCache> weak_ptr_factory_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(PageChangeCache);
+};
+
+}  // namespace ledger
+
+#endif  // APPS_LEDGER_SRC_APP_PAGE_CHANGE_CACHE_H_
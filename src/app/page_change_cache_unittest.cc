@@ -0,0 +1,246 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/app/page_change_cache.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "apps/ledger/src/convert/convert.h"
+#include "apps/ledger/src/storage/public/object.h"
+#include "apps/ledger/src/storage/public/types.h"
+#include "apps/ledger/src/storage/test/commit_empty_impl.h"
+#include "apps/ledger/src/storage/test/page_storage_empty_impl.h"
+#include "apps/ledger/src/test/test_with_message_loop.h"
+#include "gtest/gtest.h"
+#include "lib/ftl/macros.h"
+#include "lib/mtl/tasks/message_loop.h"
+#include "lib/mtl/vmo/strings.h"
+
+namespace ledger {
+namespace {
+
+class TestCommit : public storage::test::CommitEmptyImpl {
+ public:
+  TestCommit(storage::CommitId id, int64_t timestamp)
+      : id_(std::move(id)), timestamp_(timestamp) {}
+  ~TestCommit() override = default;
+
+  std::unique_ptr<storage::Commit> Clone() const override {
+    return std::make_unique<TestCommit>(id_, timestamp_);
+  }
+
+  const storage::CommitId& GetId() const override { return id_; }
+
+  int64_t GetTimestamp() const override { return timestamp_; }
+
+ private:
+  const storage::CommitId id_;
+  const int64_t timestamp_;
+};
+
+class TestObject : public storage::Object {
+ public:
+  TestObject(storage::ObjectId id, std::string data)
+      : id_(std::move(id)), data_(std::move(data)) {}
+  ~TestObject() override = default;
+
+  storage::ObjectId GetId() const override { return id_; }
+
+  storage::Status GetData(ftl::StringView* data) const override {
+    *data = data_;
+    return storage::Status::OK;
+  }
+
+  storage::Status GetSize(uint64_t* size) const override {
+    *size = data_.size();
+    return storage::Status::OK;
+  }
+
+ private:
+  const storage::ObjectId id_;
+  const std::string data_;
+};
+
+// Fake implementation of storage::PageStorage returning the same diff,
+// asynchronously, for all pairs of commits.
+class TestPageStorage : public storage::test::PageStorageEmptyImpl {
+ public:
+  explicit TestPageStorage(mtl::MessageLoop* message_loop)
+      : message_loop_(message_loop) {}
+  ~TestPageStorage() override = default;
+
+  void GetObject(
+      storage::ObjectIdView object_id,
+      Location location,
+      const std::function<void(storage::Status,
+                               std::unique_ptr<const storage::Object>)>&
+          callback) override {
+    get_object_calls++;
+    auto it = objects.find(object_id.ToString());
+    if (it == objects.end()) {
+      callback(storage::Status::NOT_FOUND, nullptr);
+      return;
+    }
+    callback(storage::Status::OK,
+             std::make_unique<TestObject>(it->first, it->second));
+  }
+
+  void GetCommitContentsDiff(
+      const storage::Commit& base_commit,
+      const storage::Commit& other_commit,
+      std::string min_key,
+      std::function<bool(storage::EntryChange)> on_next_diff,
+      std::function<void(storage::Status)> on_done) override {
+    get_commit_contents_diff_calls++;
+    message_loop_->task_runner()->PostTask(
+        [this, min_key, on_next_diff, on_done] {
+          for (const auto& change : changes) {
+            if (change.entry.key < min_key) {
+              continue;
+            }
+            if (!on_next_diff(change)) {
+              break;
+            }
+          }
+          on_done(storage::Status::OK);
+        });
+  }
+
+  // Changes returned by GetCommitContentsDiff(), ordered by key.
+  std::vector<storage::EntryChange> changes;
+  // Content of the objects returned by GetObject(), by id.
+  std::map<storage::ObjectId, std::string> objects;
+  int get_commit_contents_diff_calls = 0;
+  int get_object_calls = 0;
+
+ private:
+  mtl::MessageLoop* const message_loop_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(TestPageStorage);
+};
+
+storage::EntryChange MakeChange(std::string key, std::string object_id) {
+  return storage::EntryChange{
+      {std::move(key), std::move(object_id), storage::KeyPriority::EAGER},
+      false};
+}
+
+class PageChangeCacheTest : public test::TestWithMessageLoop {
+ public:
+  PageChangeCacheTest()
+      : storage_(&message_loop_),
+        cache_(&storage_),
+        base_("base", 1),
+        other_("other", 2) {}
+  ~PageChangeCacheTest() override {}
+
+ protected:
+  // Retrieves the change between |base_| and |other_| from the cache.
+  PageChangePtr GetPageChange(std::string prefix, int64_t max_value_size) {
+    Status status = Status::UNKNOWN_ERROR;
+    PageChangePtr page_change;
+    cache_.GetPageChange(
+        base_, other_, std::move(prefix), max_value_size,
+        [this, &status, &page_change](Status s, PageChangePtr change) {
+          status = s;
+          page_change = std::move(change);
+          message_loop_.PostQuitTask();
+        });
+    EXPECT_FALSE(RunLoopWithTimeout());
+    EXPECT_EQ(Status::OK, status);
+    return page_change;
+  }
+
+  TestPageStorage storage_;
+  PageChangeCache cache_;
+  TestCommit base_;
+  TestCommit other_;
+
+ private:
+  FTL_DISALLOW_COPY_AND_ASSIGN(PageChangeCacheTest);
+};
+
+// Verifies that the values too large to be sent are flagged in the changes
+// returned from the cache.
+TEST_F(PageChangeCacheTest, ValueTooLarge) {
+  storage_.changes.push_back(MakeChange("key1", "object1"));
+  storage_.changes.push_back(MakeChange("key2", "object2"));
+  storage_.objects["object1"] = "small";
+  storage_.objects["object2"] = std::string(100, 'a');
+
+  // The first request computes the change, the second one is served from the
+  // cache.
+  for (int i = 0; i < 2; ++i) {
+    PageChangePtr page_change = GetPageChange("", 10);
+    ASSERT_TRUE(page_change);
+    ASSERT_EQ(2u, page_change->changes.size());
+
+    EXPECT_EQ("key1", convert::ToString(page_change->changes[0]->key));
+    EXPECT_FALSE(page_change->changes[0]->value_too_large);
+    std::string value;
+    ASSERT_TRUE(mtl::StringFromVmo(page_change->changes[0]->value, &value));
+    EXPECT_EQ("small", value);
+
+    EXPECT_EQ("key2", convert::ToString(page_change->changes[1]->key));
+    EXPECT_TRUE(page_change->changes[1]->value_too_large);
+    EXPECT_FALSE(page_change->changes[1]->value);
+  }
+}
+
+// Verifies that the watchers requesting the same change share a single
+// computation, and that a different request triggers a new one.
+TEST_F(PageChangeCacheTest, SharedComputation) {
+  storage_.changes.push_back(MakeChange("key1", "object1"));
+  storage_.changes.push_back(MakeChange("key2", "object2"));
+  storage_.objects["object1"] = "value1";
+  storage_.objects["object2"] = "value2";
+
+  // Two concurrent requests for the same change.
+  std::vector<PageChangePtr> page_changes;
+  for (int i = 0; i < 2; ++i) {
+    cache_.GetPageChange(
+        base_, other_, "", -1,
+        [this, &page_changes](Status status, PageChangePtr page_change) {
+          EXPECT_EQ(Status::OK, status);
+          page_changes.push_back(std::move(page_change));
+          if (page_changes.size() == 2u) {
+            message_loop_.PostQuitTask();
+          }
+        });
+  }
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(1, storage_.get_commit_contents_diff_calls);
+  EXPECT_EQ(2, storage_.get_object_calls);
+
+  ASSERT_EQ(2u, page_changes.size());
+  for (const auto& page_change : page_changes) {
+    ASSERT_TRUE(page_change);
+    ASSERT_EQ(2u, page_change->changes.size());
+    std::string value;
+    ASSERT_TRUE(mtl::StringFromVmo(page_change->changes[1]->value, &value));
+    EXPECT_EQ("value2", value);
+  }
+  // Each watcher receives its own handles.
+  EXPECT_NE(page_changes[0]->changes[0]->value.get(),
+            page_changes[1]->changes[0]->value.get());
+
+  // A later request for the same change is served from the cache.
+  EXPECT_TRUE(GetPageChange("", -1));
+  EXPECT_EQ(1, storage_.get_commit_contents_diff_calls);
+  EXPECT_EQ(2, storage_.get_object_calls);
+
+  // A request with a different prefix computes a new change.
+  PageChangePtr page_change = GetPageChange("key2", -1);
+  EXPECT_EQ(2, storage_.get_commit_contents_diff_calls);
+  EXPECT_EQ(3, storage_.get_object_calls);
+  ASSERT_TRUE(page_change);
+  ASSERT_EQ(1u, page_change->changes.size());
+  EXPECT_EQ("key2", convert::ToString(page_change->changes[0]->key));
+}
+
+}  // namespace
+}  // namespace ledger
@@ -41,17 +41,23 @@ void PageDelegate::GetId(const Page::GetIdCallback& callback) {
   callback(convert::ToArray(storage_->GetId()));
 }
 
-// GetSnapshot(PageSnapshot& snapshot, PageWatcher& watcher) => (Status status);
+// GetSnapshot(PageSnapshot& snapshot, array<uint8>? key_prefix,
+//             PageWatcher& watcher, int64 max_value_size)
+//     => (Status status);
 void PageDelegate::GetSnapshot(
     fidl::InterfaceRequest<PageSnapshot> snapshot_request,
+    fidl::Array<uint8_t> key_prefix,
     fidl::InterfaceHandle<PageWatcher> watcher,
+    int64_t max_value_size,
     const Page::GetSnapshotCallback& callback) {
   auto tracked_callback = TrackCallback(std::move(callback));
   storage_->GetCommit(
       GetCurrentCommitId(),
       ftl::MakeCopyable([
         this, snapshot_request = std::move(snapshot_request),
-        watcher = std::move(watcher), callback = std::move(tracked_callback)
+        key_prefix = convert::ToString(key_prefix),
+        watcher = std::move(watcher), max_value_size,
+        callback = std::move(tracked_callback)
       ](storage::Status status,
         std::unique_ptr<const storage::Commit> commit) mutable {
         if (status != storage::Status::OK) {
@@ -64,7 +70,9 @@ void PageDelegate::GetSnapshot(
           PageWatcherPtr watcher_ptr =
               PageWatcherPtr::Create(std::move(watcher));
           branch_tracker_.RegisterPageWatcher(std::move(watcher_ptr),
-                                              std::move(commit));
+                                              std::move(commit),
+                                              std::move(key_prefix),
+                                              max_value_size);
         }
         callback(Status::OK);
       }));
@@ -45,7 +45,9 @@ class PageDelegate {
   void GetId(const Page::GetIdCallback& callback);
 
   void GetSnapshot(fidl::InterfaceRequest<PageSnapshot> snapshot_request,
+                   fidl::Array<uint8_t> key_prefix,
                    fidl::InterfaceHandle<PageWatcher> watcher,
+                   int64_t max_value_size,
                    const Page::GetSnapshotCallback& callback);
 
   void Put(fidl::Array<uint8_t> key,
@@ -22,14 +22,19 @@ void PageImpl::GetId(const GetIdCallback& callback) {
   delegate_->GetId(std::move(timed_callback));
 }
 
-// GetSnapshot(PageSnapshot& snapshot, PageWatcher& watcher) => (Status status);
+// GetSnapshot(PageSnapshot& snapshot, array<uint8>? key_prefix,
+//             PageWatcher& watcher, int64 max_value_size)
+//     => (Status status);
 void PageImpl::GetSnapshot(
     fidl::InterfaceRequest<PageSnapshot> snapshot_request,
+    fidl::Array<uint8_t> key_prefix,
     fidl::InterfaceHandle<PageWatcher> watcher,
+    int64_t max_value_size,
     const GetSnapshotCallback& callback) {
   auto timed_callback =
       TRACE_CALLBACK(std::move(callback), "ledger", "page_get_snapshot");
-  delegate_->GetSnapshot(std::move(snapshot_request), std::move(watcher),
+  delegate_->GetSnapshot(std::move(snapshot_request), std::move(key_prefix),
+                         std::move(watcher), max_value_size,
                          std::move(timed_callback));
 }
 
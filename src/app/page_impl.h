@@ -22,7 +22,9 @@ class PageImpl : public Page {
   void GetId(const GetIdCallback& callback) override;
 
   void GetSnapshot(fidl::InterfaceRequest<PageSnapshot> snapshot_request,
+                   fidl::Array<uint8_t> key_prefix,
                    fidl::InterfaceHandle<PageWatcher> watcher,
+                   int64_t max_value_size,
                    const GetSnapshotCallback& callback) override;
 
   void Put(fidl::Array<uint8_t> key,
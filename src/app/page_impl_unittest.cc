@@ -122,7 +122,7 @@ class PageImplTest : public test::TestWithMessageLoop {
       message_loop_.PostQuitTask();
     };
     PageSnapshotPtr snapshot;
-    page_ptr_->GetSnapshot(snapshot.NewRequest(), nullptr,
+    page_ptr_->GetSnapshot(snapshot.NewRequest(), nullptr, nullptr, -1,
                            callback_getsnapshot);
     EXPECT_FALSE(RunLoopWithTimeout());
     return snapshot;
@@ -830,9 +830,11 @@ TEST_F(PageImplTest, ParallelPut) {
     EXPECT_EQ(Status::OK, status);
     message_loop_.PostQuitTask();
   };
-  page_ptr_->GetSnapshot(snapshot1.NewRequest(), nullptr, callback_getsnapshot);
+  page_ptr_->GetSnapshot(snapshot1.NewRequest(), nullptr, nullptr, -1,
+                         callback_getsnapshot);
   EXPECT_FALSE(RunLoopWithTimeout());
-  page_ptr2->GetSnapshot(snapshot2.NewRequest(), nullptr, callback_getsnapshot);
+  page_ptr2->GetSnapshot(snapshot2.NewRequest(), nullptr, nullptr, -1,
+                         callback_getsnapshot);
   EXPECT_FALSE(RunLoopWithTimeout());
 
   std::string actual_value1;
@@ -18,6 +18,7 @@ PageManager::PageManager(
     std::unique_ptr<MergeResolver> merge_resolver)
     : environment_(environment),
       page_storage_(std::move(page_storage)),
+      page_change_cache_(page_storage_.get()),
       page_sync_context_(std::move(page_sync_context)),
       merge_resolver_(std::move(merge_resolver)),
       sync_backlog_downloaded_(false) {
@@ -28,6 +29,11 @@ PageManager::PageManager(
   }
 
   if (page_sync_context_) {
+    // Merges are deferred while remote commits are being downloaded.
+    merge_resolver_->SetIsDownloadIdle(
+        [this] { return page_sync_context_->page_sync->IsDownloadIdle(); });
+    page_sync_context_->page_sync->SetOnDownloadIdle(
+        [this] { merge_resolver_->OnDownloadIdle(); });
     page_sync_context_->page_sync->SetOnBacklogDownloaded(
         [this] { OnSyncBacklogDownloaded(); });
     page_sync_context_->page_sync->Start();
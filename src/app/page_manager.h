@@ -10,6 +10,7 @@
 
 #include "apps/ledger/src/app/fidl/bound_interface.h"
 #include "apps/ledger/src/app/merging/merge_resolver.h"
+#include "apps/ledger/src/app/page_change_cache.h"
 #include "apps/ledger/src/app/page_delegate.h"
 #include "apps/ledger/src/app/page_snapshot_impl.h"
 #include "apps/ledger/src/callback/auto_cleanable.h"
@@ -49,6 +50,9 @@ class PageManager {
   void BindPageSnapshot(std::unique_ptr<const storage::Commit> commit,
                         fidl::InterfaceRequest<PageSnapshot> snapshot_request);
 
+  // Returns the cache of PageChanges shared by all watchers of this page.
+  PageChangeCache* page_change_cache() { return &page_change_cache_; }
+
   void set_on_empty(const ftl::Closure& on_empty_callback) {
     on_empty_callback_ = on_empty_callback;
   }
@@ -59,6 +63,7 @@ class PageManager {
 
   Environment* const environment_;
   std::unique_ptr<storage::PageStorage> page_storage_;
+  PageChangeCache page_change_cache_;
   std::unique_ptr<cloud_sync::PageSyncContext> page_sync_context_;
   std::unique_ptr<MergeResolver> merge_resolver_;
   callback::AutoCleanableSet<BoundInterface<PageSnapshot, PageSnapshotImpl>>
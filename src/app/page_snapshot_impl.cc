@@ -32,11 +32,6 @@ EntryPtr CreateEntry(const storage::Entry& entry) {
   return entry_ptr;
 }
 
-bool MatchesPrefix(const std::string& key, const std::string& prefix) {
-  return convert::ExtendedStringView(key).substr(0, prefix.size()) ==
-         convert::ExtendedStringView(prefix);
-}
-
 }  // namespace
 
 PageSnapshotImpl::PageSnapshotImpl(
@@ -76,7 +71,7 @@ void PageSnapshotImpl::GetEntries(fidl::Array<uint8_t> key_prefix,
   std::string prefix = convert::ToString(key_prefix);
   auto on_next = ftl::MakeCopyable(
       [ this, prefix, context = context.get(), waiter ](storage::Entry entry) {
-        if (!MatchesPrefix(entry.key, prefix)) {
+        if (!PageUtils::MatchesPrefix(entry.key, prefix)) {
           return false;
         }
         context->size += fidl_serialization::GetEntrySize(entry.key.size());
@@ -184,7 +179,7 @@ void PageSnapshotImpl::GetKeys(fidl::Array<uint8_t> key_prefix,
   auto on_next = ftl::MakeCopyable([
     key_prefix = convert::ToString(key_prefix), context = context.get()
   ](storage::Entry entry) {
-    if (!MatchesPrefix(entry.key, key_prefix)) {
+    if (!PageUtils::MatchesPrefix(entry.key, key_prefix)) {
       return false;
     }
     context->size += fidl_serialization::GetByteArraySize(entry.key.size());
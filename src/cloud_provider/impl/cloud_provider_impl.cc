@@ -4,6 +4,10 @@
 
 #include "apps/ledger/src/cloud_provider/impl/cloud_provider_impl.h"
 
+#include <algorithm>
+#include <memory>
+#include <utility>
+
 #include "apps/ledger/src/cloud_provider/impl/encoding.h"
 #include "apps/ledger/src/cloud_provider/impl/timestamp_conversions.h"
 #include "apps/ledger/src/firebase/encoding.h"
@@ -20,9 +24,28 @@ namespace {
 // The root path under which all commits are stored.
 constexpr ftl::StringView kCommitRoot = "commits";
 
-// Returns the path under which the given commit is stored.
-std::string GetCommitPath(const Commit& commit) {
-  return ftl::Concatenate({kCommitRoot, "/", firebase::EncodeKey(commit.id)});
+// Returns the path under which the commit of the given id is stored.
+std::string GetCommitPath(const CommitId& commit_id) {
+  return ftl::Concatenate({kCommitRoot, "/", firebase::EncodeKey(commit_id)});
+}
+
+// Retrieves the commits matching |query|, decoding them as they are received.
+void QueryCommits(firebase::Firebase* firebase,
+                  const std::string& query,
+                  std::function<void(Status, std::vector<Record>)> callback) {
+  auto decoder = std::make_shared<CommitsDecoder>();
+  firebase->GetObjectMembers(
+      kCommitRoot.ToString(), query,
+      [decoder](const std::string& key, const rapidjson::Value& value) {
+        return decoder->AddCommit(value);
+      },
+      [ decoder, callback = std::move(callback) ](firebase::Status status) {
+        if (status != firebase::Status::OK) {
+          callback(ConvertFirebaseStatus(status), std::vector<Record>());
+          return;
+        }
+        callback(Status::OK, decoder->TakeRecords());
+      });
 }
 }  // namespace
 
@@ -38,12 +61,26 @@ void CloudProviderImpl::AddCommit(const Commit& commit,
   bool ok = EncodeCommit(commit, &encoded_commit);
   FTL_DCHECK(ok);
 
-  firebase_->Put(GetCommitPath(commit), encoded_commit,
+  firebase_->Put(GetCommitPath(commit.id), encoded_commit,
                  [callback](firebase::Status status) {
                    callback(ConvertFirebaseStatus(status));
                  });
 }
 
+void CloudProviderImpl::AddCommits(
+    std::vector<Commit> commits,
+    const std::function<void(Status)>& callback) {
+  std::string encoded_commits;
+  bool ok = EncodeCommits(commits, &encoded_commits);
+  FTL_DCHECK(ok);
+
+  // A multi-path update of the commit root writes all the commits atomically.
+  firebase_->Patch(kCommitRoot.ToString(), encoded_commits,
+                   [callback](firebase::Status status) {
+                     callback(ConvertFirebaseStatus(status));
+                   });
+}
+
 void CloudProviderImpl::WatchCommits(const std::string& min_timestamp,
                                      CommitWatcher* watcher) {
   watchers_[watcher] = std::make_unique<WatchClientImpl>(
@@ -58,28 +95,76 @@ void CloudProviderImpl::UnwatchCommits(CommitWatcher* watcher) {
 void CloudProviderImpl::GetCommits(
     const std::string& min_timestamp,
     std::function<void(Status, std::vector<Record>)> callback) {
+  QueryCommits(firebase_, GetTimestampQuery(min_timestamp),
+               std::move(callback));
+}
+
+void CloudProviderImpl::GetCommitsPage(
+    const std::string& min_timestamp,
+    size_t max_count,
+    std::function<void(Status, std::vector<Record>, std::string)> callback) {
+  FTL_DCHECK(max_count > 0);
+  std::string query = "orderBy=\"timestamp\"&limitToFirst=" +
+                      ftl::NumberToString(max_count);
+  if (!min_timestamp.empty()) {
+    query += "&startAt=" +
+             ftl::NumberToString(BytesToServerTimestamp(min_timestamp));
+  }
+
+  QueryCommits(firebase_, query, [
+    this, max_count, callback = std::move(callback)
+  ](Status status, std::vector<Record> records) {
+    if (status != Status::OK) {
+      callback(status, std::vector<Record>(), "");
+      return;
+    }
+    if (records.size() < max_count) {
+      callback(Status::OK, std::move(records), "");
+      return;
+    }
+
+    // The page is full: the commits sharing the timestamp of the last one can
+    // continue past the page, leave all of them for the next page.
+    int64_t last_timestamp = BytesToServerTimestamp(records.back().timestamp);
+    auto first_last = std::find_if(
+        records.begin(), records.end(), [last_timestamp](const Record& record) {
+          return BytesToServerTimestamp(record.timestamp) == last_timestamp;
+        });
+    if (first_last != records.begin()) {
+      records.erase(first_last, records.end());
+      callback(Status::OK, std::move(records),
+               ServerTimestampToBytes(last_timestamp));
+      return;
+    }
+
+    // All the commits of the page share the same timestamp: retrieve all of
+    // them in a single page.
+    GetCommitsWithTimestamp(last_timestamp, std::move(callback));
+  });
+}
+
+void CloudProviderImpl::GetCommit(
+    const CommitId& commit_id,
+    std::function<void(Status, Commit)> callback) {
   firebase_->Get(
-      kCommitRoot.ToString(), GetTimestampQuery(min_timestamp),
-      [callback](firebase::Status status, const rapidjson::Value& value) {
+      GetCommitPath(commit_id), "",
+      [callback = std::move(callback)](firebase::Status status,
+                                       const rapidjson::Value& value) {
         if (status != firebase::Status::OK) {
-          callback(ConvertFirebaseStatus(status), std::vector<Record>());
+          callback(ConvertFirebaseStatus(status), Commit());
           return;
         }
+        // Firebase returns null for locations holding no data.
         if (value.IsNull()) {
-          // No commits synced for this page yet.
-          callback(Status::OK, std::vector<Record>());
+          callback(Status::NOT_FOUND, Commit());
           return;
         }
-        if (!value.IsObject()) {
-          callback(Status::PARSE_ERROR, std::vector<Record>());
+        std::unique_ptr<Record> record;
+        if (!DecodeCommitFromValue(value, &record)) {
+          callback(Status::PARSE_ERROR, Commit());
           return;
         }
-        std::vector<Record> records;
-        if (!DecodeMultipleCommitsFromValue(value, &records)) {
-          callback(Status::PARSE_ERROR, std::vector<Record>());
-          return;
-        }
-        callback(Status::OK, std::move(records));
+        callback(Status::OK, std::move(record->commit));
       });
 }
 
@@ -108,6 +193,23 @@ void CloudProviderImpl::GetObject(
       });
 }
 
+void CloudProviderImpl::GetCommitsWithTimestamp(
+    int64_t timestamp,
+    std::function<void(Status, std::vector<Record>, std::string)> callback) {
+  QueryCommits(
+      firebase_,
+      "orderBy=\"timestamp\"&equalTo=" + ftl::NumberToString(timestamp),
+      [ timestamp, callback = std::move(callback) ](
+          Status status, std::vector<Record> records) {
+        if (status != Status::OK) {
+          callback(status, std::vector<Record>(), "");
+          return;
+        }
+        callback(Status::OK, std::move(records),
+                 ServerTimestampToBytes(timestamp + 1));
+      });
+}
+
 std::string CloudProviderImpl::GetTimestampQuery(
     const std::string& min_timestamp) {
   if (min_timestamp.empty()) {
@@ -30,6 +30,9 @@ class CloudProviderImpl : public CloudProvider {
   void AddCommit(const Commit& commit,
                  const std::function<void(Status)>& callback) override;
 
+  void AddCommits(std::vector<Commit> commits,
+                  const std::function<void(Status)>& callback) override;
+
   void WatchCommits(const std::string& min_timestamp,
                     CommitWatcher* watcher) override;
 
@@ -39,6 +42,15 @@ class CloudProviderImpl : public CloudProvider {
       const std::string& min_timestamp,
       std::function<void(Status, std::vector<Record>)> callback) override;
 
+  void GetCommitsPage(
+      const std::string& min_timestamp,
+      size_t max_count,
+      std::function<void(Status, std::vector<Record>, std::string)> callback)
+      override;
+
+  void GetCommit(const CommitId& commit_id,
+                 std::function<void(Status, Commit)> callback) override;
+
   void AddObject(ObjectIdView object_id,
                  mx::vmo data,
                  std::function<void(Status)> callback) override;
@@ -49,6 +61,12 @@ class CloudProviderImpl : public CloudProvider {
           callback) override;
 
  private:
+  // Retrieves all the commits with the given |timestamp|, as a page of
+  // GetCommitsPage().
+  void GetCommitsWithTimestamp(
+      int64_t timestamp,
+      std::function<void(Status, std::vector<Record>, std::string)> callback);
+
   // Returns the Firebase query filtering the commits so that only commits not
   // older than |min_timestamp| are returned. Passing empty |min_timestamp|
   // returns empty query.
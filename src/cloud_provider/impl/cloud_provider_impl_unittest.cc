@@ -75,6 +75,31 @@ class CloudProviderImplTest : public test::TestWithMessageLoop,
     });
   }
 
+  void GetObjectMembers(
+      const std::string& key,
+      const std::string& query,
+      std::function<bool(const std::string& key, const rapidjson::Value& value)>
+          on_member,
+      std::function<void(firebase::Status status)> on_done) override {
+    get_keys_.push_back(key);
+    get_queries_.push_back(query);
+    message_loop_.task_runner()->PostTask([this, on_member, on_done]() {
+      firebase::Status status = firebase::Status::OK;
+      if (get_response_->IsObject()) {
+        for (auto& it : get_response_->GetObject()) {
+          if (!on_member(it.name.GetString(), it.value)) {
+            status = firebase::Status::PARSE_ERROR;
+            break;
+          }
+        }
+      } else if (!get_response_->IsNull()) {
+        status = firebase::Status::PARSE_ERROR;
+      }
+      on_done(status);
+      message_loop_.PostQuitTask();
+    });
+  }
+
   void Put(
       const std::string& key,
       const std::string& data,
@@ -87,6 +112,18 @@ class CloudProviderImplTest : public test::TestWithMessageLoop,
     });
   }
 
+  void Patch(
+      const std::string& key,
+      const std::string& data,
+      const std::function<void(firebase::Status status)>& callback) override {
+    patch_keys_.push_back(key);
+    patch_data_.push_back(data);
+    message_loop_.task_runner()->PostTask([this, callback]() {
+      callback(firebase::Status::OK);
+      message_loop_.PostQuitTask();
+    });
+  }
+
   void Delete(
       const std::string& key,
       const std::function<void(firebase::Status status)>& callback) override {
@@ -136,6 +173,8 @@ class CloudProviderImplTest : public test::TestWithMessageLoop,
   std::vector<std::string> get_queries_;
   std::vector<std::string> put_keys_;
   std::vector<std::string> put_data_;
+  std::vector<std::string> patch_keys_;
+  std::vector<std::string> patch_data_;
   std::vector<std::string> watch_keys_;
   std::vector<std::string> watch_queries_;
   unsigned int unwatch_count_ = 0u;
@@ -172,11 +211,12 @@ TEST_F(CloudProviderImplTest, AddCommit) {
   EXPECT_EQ(put_keys_.size(), put_data_.size());
   EXPECT_EQ("commits/commit_idV", put_keys_[0]);
   EXPECT_EQ(
-      "{\"id\":\"commit_idV\","
-      "\"content\":\"some_contentV\","
+      "{\"version\":1,"
+      "\"id\":\"Y29tbWl0X2lkU\","
+      "\"content\":\"c29tZV9jb250ZW50U\","
       "\"objects\":{"
-      "\"object_aV\":\"data_aV\","
-      "\"object_bV\":\"data_bV\"},"
+      "\"b2JqZWN0X2EU\":\"ZGF0YV9hU\","
+      "\"b2JqZWN0X2IU\":\"ZGF0YV9iU\"},"
       "\"timestamp\":{\".sv\":\"timestamp\"}"
       "}",
       put_data_[0]);
@@ -184,6 +224,41 @@ TEST_F(CloudProviderImplTest, AddCommit) {
   EXPECT_EQ(0u, unwatch_count_);
 }
 
+TEST_F(CloudProviderImplTest, AddCommits) {
+  std::vector<Commit> commits;
+  commits.emplace_back("id1", "content1", std::map<ObjectId, Data>{});
+  commits.emplace_back("id2", "content2",
+                       std::map<ObjectId, Data>{{"object_a", "data_a"}});
+
+  Status status;
+  cloud_provider_->AddCommits(
+      std::move(commits),
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status));
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  EXPECT_EQ(Status::OK, status);
+  EXPECT_TRUE(put_keys_.empty());
+  EXPECT_EQ(1u, patch_keys_.size());
+  EXPECT_EQ(patch_keys_.size(), patch_data_.size());
+  EXPECT_EQ("commits", patch_keys_[0]);
+  EXPECT_EQ(
+      "{\"id1V\":"
+      "{\"version\":1,"
+      "\"id\":\"aWQxU\","
+      "\"content\":\"Y29udGVudDEU\","
+      "\"batch_position\":0,"
+      "\"timestamp\":{\".sv\":\"timestamp\"}},"
+      "\"id2V\":"
+      "{\"version\":1,"
+      "\"id\":\"aWQyU\","
+      "\"content\":\"Y29udGVudDIU\","
+      "\"objects\":{\"b2JqZWN0X2EU\":\"ZGF0YV9hU\"},"
+      "\"batch_position\":1,"
+      "\"timestamp\":{\".sv\":\"timestamp\"}}"
+      "}",
+      patch_data_[0]);
+}
+
 TEST_F(CloudProviderImplTest, WatchUnwatch) {
   cloud_provider_->WatchCommits("", this);
   EXPECT_EQ(1u, watch_keys_.size());
@@ -264,6 +339,40 @@ TEST_F(CloudProviderImplTest, WatchAndGetNotifiedSingle) {
   EXPECT_EQ(expected_timestamp, server_timestamps_[0]);
 }
 
+// Tests handling a server event containing a batch of commits added in a single
+// AddCommits() call.
+TEST_F(CloudProviderImplTest, WatchAndGetNotifiedBatch) {
+  cloud_provider_->WatchCommits("", this);
+
+  std::string patch_content =
+      "{\"id_2V\":"
+      "{\"content\":\"some_other_contentV\","
+      "\"id\":\"id_2V\","
+      "\"batch_position\":1,"
+      "\"timestamp\":42"
+      "},"
+      "\"id_1V\":"
+      "{\"content\":\"some_contentV\","
+      "\"id\":\"id_1V\","
+      "\"batch_position\":0,"
+      "\"timestamp\":42"
+      "}}";
+  rapidjson::Document document;
+  document.Parse(patch_content.c_str(), patch_content.size());
+  ASSERT_FALSE(document.HasParseError());
+
+  watch_client_->OnPatch("/", document);
+
+  Commit expected_n1("id_1", "some_content", std::map<ObjectId, Data>{});
+  Commit expected_n2("id_2", "some_other_content", std::map<ObjectId, Data>{});
+  EXPECT_EQ(2u, commits_.size());
+  EXPECT_EQ(expected_n1, commits_[0]);
+  EXPECT_EQ(expected_n2, commits_[1]);
+  EXPECT_EQ(ServerTimestampToBytes(42), server_timestamps_[0]);
+  EXPECT_EQ(ServerTimestampToBytes(42), server_timestamps_[1]);
+  EXPECT_EQ(0u, malformed_notification_calls_);
+}
+
 // Verifies that the initial response when there is no matching commits is
 // ignored.
 TEST_F(CloudProviderImplTest, WatchWhenThereIsNothingToWatch) {
@@ -391,6 +500,125 @@ TEST_F(CloudProviderImplTest, GetCommitsWhenThereAreNone) {
   EXPECT_TRUE(records.empty());
 }
 
+// Verifies that a full page of commits is cut before the commits sharing the
+// timestamp of the last one, which are left for the next page.
+TEST_F(CloudProviderImplTest, GetCommitsPage) {
+  std::string get_response_content =
+      "{\"id1V\":{\"content\":\"c1V\",\"id\":\"id1V\",\"timestamp\":42},"
+      "\"id2V\":{\"content\":\"c2V\",\"id\":\"id2V\",\"timestamp\":43},"
+      "\"id3V\":{\"content\":\"c3V\",\"id\":\"id3V\",\"timestamp\":43}}";
+  get_response_ = std::make_unique<rapidjson::Document>();
+  get_response_->Parse(get_response_content.c_str(),
+                       get_response_content.size());
+
+  Status status;
+  std::vector<Record> records;
+  std::string next_timestamp;
+  cloud_provider_->GetCommitsPage(
+      ServerTimestampToBytes(42), 3,
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status,
+                        &records, &next_timestamp));
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  EXPECT_EQ(Status::OK, status);
+  ASSERT_EQ(1u, records.size());
+  EXPECT_EQ("id1", records[0].commit.id);
+  EXPECT_EQ(ServerTimestampToBytes(43), next_timestamp);
+  EXPECT_EQ(1u, get_queries_.size());
+  EXPECT_EQ("orderBy=\"timestamp\"&limitToFirst=3&startAt=42",
+            get_queries_[0]);
+}
+
+// Verifies that a page that is not full is the last one.
+TEST_F(CloudProviderImplTest, GetCommitsLastPage) {
+  std::string get_response_content =
+      "{\"id1V\":{\"content\":\"c1V\",\"id\":\"id1V\",\"timestamp\":42},"
+      "\"id2V\":{\"content\":\"c2V\",\"id\":\"id2V\",\"timestamp\":43}}";
+  get_response_ = std::make_unique<rapidjson::Document>();
+  get_response_->Parse(get_response_content.c_str(),
+                       get_response_content.size());
+
+  Status status;
+  std::vector<Record> records;
+  std::string next_timestamp = "not empty";
+  cloud_provider_->GetCommitsPage(
+      "", 3,
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status,
+                        &records, &next_timestamp));
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  EXPECT_EQ(Status::OK, status);
+  EXPECT_EQ(2u, records.size());
+  EXPECT_EQ("", next_timestamp);
+  EXPECT_EQ(1u, get_queries_.size());
+  EXPECT_EQ("orderBy=\"timestamp\"&limitToFirst=3", get_queries_[0]);
+}
+
+// Verifies that when all the commits of a full page share the same timestamp,
+// all the commits with this timestamp are retrieved.
+TEST_F(CloudProviderImplTest, GetCommitsPageSameTimestamp) {
+  std::string get_response_content =
+      "{\"id1V\":{\"content\":\"c1V\",\"id\":\"id1V\",\"timestamp\":42},"
+      "\"id2V\":{\"content\":\"c2V\",\"id\":\"id2V\",\"timestamp\":42}}";
+  get_response_ = std::make_unique<rapidjson::Document>();
+  get_response_->Parse(get_response_content.c_str(),
+                       get_response_content.size());
+
+  Status status;
+  std::vector<Record> records;
+  std::string next_timestamp;
+  cloud_provider_->GetCommitsPage(
+      ServerTimestampToBytes(42), 2,
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status,
+                        &records, &next_timestamp));
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  EXPECT_EQ(Status::OK, status);
+  EXPECT_EQ(2u, records.size());
+  EXPECT_EQ(ServerTimestampToBytes(43), next_timestamp);
+  ASSERT_EQ(2u, get_queries_.size());
+  EXPECT_EQ("orderBy=\"timestamp\"&equalTo=42", get_queries_[1]);
+}
+
+TEST_F(CloudProviderImplTest, GetCommit) {
+  std::string get_response_content =
+      "{\"content\":\"xyzV\","
+      "\"id\":\"id1V\","
+      "\"timestamp\":42"
+      "}";
+  get_response_ = std::make_unique<rapidjson::Document>();
+  get_response_->Parse(get_response_content.c_str(),
+                       get_response_content.size());
+
+  Status status;
+  Commit commit;
+  cloud_provider_->GetCommit(
+      "id1", callback::Capture([this] { message_loop_.PostQuitTask(); },
+                               &status, &commit));
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(Status::OK, status);
+  EXPECT_EQ(Commit("id1", "xyz", std::map<ObjectId, Data>{}), commit);
+
+  EXPECT_EQ(1u, get_keys_.size());
+  EXPECT_EQ("commits/id1V", get_keys_[0]);
+  EXPECT_EQ("", get_queries_[0]);
+}
+
+TEST_F(CloudProviderImplTest, GetCommitNotFound) {
+  std::string get_response_content = "null";
+  get_response_ = std::make_unique<rapidjson::Document>();
+  get_response_->Parse(get_response_content.c_str(),
+                       get_response_content.size());
+
+  Status status;
+  Commit commit;
+  cloud_provider_->GetCommit(
+      "id1", callback::Capture([this] { message_loop_.PostQuitTask(); },
+                               &status, &commit));
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(Status::NOT_FOUND, status);
+}
+
 TEST_F(CloudProviderImplTest, AddObject) {
   mx::vmo data;
   ASSERT_TRUE(mtl::VmoFromString("bazinga", &data));
@@ -5,6 +5,7 @@
 #include "apps/ledger/src/cloud_provider/impl/encoding.h"
 
 #include <algorithm>
+#include <utility>
 
 #include "apps/ledger/src/cloud_provider/impl/timestamp_conversions.h"
 #include "apps/ledger/src/firebase/encoding.h"
@@ -22,6 +23,98 @@ const char kIdKey[] = "id";
 const char kContentKey[] = "content";
 const char kObjectsKey[] = "objects";
 const char kTimestampKey[] = "timestamp";
+const char kBatchPositionKey[] = "batch_position";
+const char kVersionKey[] = "version";
+const char kBundledObjectsKey[] = "bundled_objects";
+const char kBundleIdKey[] = "bundle";
+const char kOffsetKey[] = "offset";
+const char kSizeKey[] = "size";
+
+// Versions of the encoding of the commits. Commits without a version were
+// written with version 0, which encoded the values with
+// firebase::EncodeValue(). Version 1 encodes all of them with
+// firebase::EncodeCompact(). Version 2 adds the locations of bundled objects.
+// Each commit is tagged with the lowest version able to read it, and decoding
+// supports all the versions up to the latest one.
+constexpr int64_t kCompactEncodingVersion = 1;
+constexpr int64_t kBundledObjectsVersion = 2;
+constexpr int64_t kLatestEncodingVersion = kBundledObjectsVersion;
+
+// Writes the JSON representation of |commit| to |writer|. If |batch_position|
+// is not negative, it is recorded as the position of the commit in its batch.
+void WriteCommit(const Commit& commit,
+                 int64_t batch_position,
+                 rapidjson::Writer<rapidjson::StringBuffer>* writer) {
+  writer->StartObject();
+
+  writer->Key(kVersionKey);
+  writer->Int64(commit.bundled_objects.empty() ? kCompactEncodingVersion
+                                               : kBundledObjectsVersion);
+
+  writer->Key(kIdKey);
+  std::string id = firebase::EncodeCompact(commit.id);
+  writer->String(id.c_str(), id.size());
+
+  writer->Key(kContentKey);
+  std::string content = firebase::EncodeCompact(commit.content);
+  writer->String(content.c_str(), content.size());
+
+  if (!commit.storage_objects.empty()) {
+    writer->Key(kObjectsKey);
+    writer->StartObject();
+    for (const auto& entry : commit.storage_objects) {
+      std::string key = firebase::EncodeCompact(entry.first);
+      writer->Key(key.c_str(), key.size());
+      std::string value = firebase::EncodeCompact(entry.second);
+      writer->String(value.c_str(), value.size());
+    }
+    writer->EndObject();
+  }
+
+  if (!commit.bundled_objects.empty()) {
+    writer->Key(kBundledObjectsKey);
+    writer->StartObject();
+    for (const auto& entry : commit.bundled_objects) {
+      std::string key = firebase::EncodeCompact(entry.first);
+      writer->Key(key.c_str(), key.size());
+      writer->StartObject();
+      writer->Key(kBundleIdKey);
+      std::string bundle_id = firebase::EncodeCompact(entry.second.bundle_id);
+      writer->String(bundle_id.c_str(), bundle_id.size());
+      writer->Key(kOffsetKey);
+      writer->Uint64(entry.second.offset);
+      writer->Key(kSizeKey);
+      writer->Uint64(entry.second.size);
+      writer->EndObject();
+    }
+    writer->EndObject();
+  }
+
+  if (batch_position >= 0) {
+    writer->Key(kBatchPositionKey);
+    writer->Int64(batch_position);
+  }
+
+  writer->Key(kTimestampKey);
+  // Placeholder that Firebase will replace with server timestamp. See
+  // https://firebase.google.com/docs/database/rest/save-data.
+  writer->StartObject();
+  writer->Key(".sv");
+  writer->String("timestamp");
+  writer->EndObject();
+
+  writer->EndObject();
+}
+
+// Returns the position of the commit encoded in |value| in the batch it was
+// written with, or 0 if it was written on its own.
+int64_t GetBatchPosition(const rapidjson::Value& value) {
+  if (!value.HasMember(kBatchPositionKey) ||
+      !value[kBatchPositionKey].IsInt64()) {
+    return 0;
+  }
+  return value[kBatchPositionKey].GetInt64();
+}
 
 }  // namespace
 
@@ -29,36 +122,30 @@ bool EncodeCommit(const Commit& commit, std::string* output_json) {
   rapidjson::StringBuffer string_buffer;
   rapidjson::Writer<rapidjson::StringBuffer> writer(string_buffer);
 
-  writer.StartObject();
+  WriteCommit(commit, -1, &writer);
 
-  writer.Key(kIdKey);
-  std::string id = firebase::EncodeValue(commit.id);
-  writer.String(id.c_str(), id.size());
+  if (!writer.IsComplete()) {
+    return false;
+  }
 
-  writer.Key(kContentKey);
-  std::string content = firebase::EncodeValue(commit.content);
-  writer.String(content.c_str(), content.size());
+  std::string result = string_buffer.GetString();
+  output_json->swap(result);
+  return true;
+}
 
-  if (!commit.storage_objects.empty()) {
-    writer.Key(kObjectsKey);
-    writer.StartObject();
-    for (const auto& entry : commit.storage_objects) {
-      std::string key = firebase::EncodeKey(entry.first);
-      writer.Key(key.c_str(), key.size());
-      std::string value = firebase::EncodeValue(entry.second);
-      writer.String(value.c_str(), value.size());
-    }
-    writer.EndObject();
-  }
+bool EncodeCommits(const std::vector<Commit>& commits,
+                   std::string* output_json) {
+  rapidjson::StringBuffer string_buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(string_buffer);
 
-  writer.Key(kTimestampKey);
-  // Placeholder that Firebase will replace with server timestamp. See
-  // https://firebase.google.com/docs/database/rest/save-data.
   writer.StartObject();
-  writer.Key(".sv");
-  writer.String("timestamp");
-  writer.EndObject();
-
+  for (size_t i = 0; i < commits.size(); ++i) {
+    // The key is the location of the commit, which doesn't depend on the
+    // encoding version.
+    std::string key = firebase::EncodeKey(commits[i].id);
+    writer.Key(key.c_str(), key.size());
+    WriteCommit(commits[i], i, &writer);
+  }
   writer.EndObject();
 
   if (!writer.IsComplete()) {
@@ -107,29 +194,14 @@ bool DecodeMultipleCommitsFromValue(const rapidjson::Value& value,
   FTL_DCHECK(output_records);
   FTL_DCHECK(value.IsObject());
 
-  std::vector<Record> records;
+  CommitsDecoder decoder;
   for (auto& it : value.GetObject()) {
-    std::string encoded_id = it.name.GetString();
-
-    if (!it.value.IsObject()) {
-      return false;
-    }
-
-    std::unique_ptr<Record> record;
-    if (!DecodeCommitFromValue(it.value, &record)) {
+    if (!decoder.AddCommit(it.value)) {
       return false;
     }
-    FTL_DCHECK(record);
-    records.push_back(std::move(*record));
   }
 
-  std::sort(records.begin(), records.end(),
-            [](const Record& lhs, const Record& rhs) {
-              return BytesToServerTimestamp(lhs.timestamp) <
-                     BytesToServerTimestamp(rhs.timestamp);
-            });
-
-  output_records->swap(records);
+  *output_records = decoder.TakeRecords();
   return true;
 }
 
@@ -138,6 +210,14 @@ bool DecodeCommitFromValue(const rapidjson::Value& value,
   FTL_DCHECK(output_record);
   FTL_DCHECK(value.IsObject());
 
+  if (value.HasMember(kVersionKey)) {
+    // Commits written by a newer client can't be read.
+    if (!value[kVersionKey].IsInt64() ||
+        value[kVersionKey].GetInt64() > kLatestEncodingVersion) {
+      return false;
+    }
+  }
+
   CommitId commit_id;
   if (!value.HasMember(kIdKey) || !value[kIdKey].IsString() ||
       !firebase::Decode(value[kIdKey].GetString(), &commit_id)) {
@@ -167,16 +247,86 @@ bool DecodeCommitFromValue(const rapidjson::Value& value,
     }
   }
 
+  std::map<ObjectId, ObjectLocation> bundled_objects;
+  if (value.HasMember(kBundledObjectsKey)) {
+    if (!value[kBundledObjectsKey].IsObject()) {
+      return false;
+    }
+    for (auto& it : value[kBundledObjectsKey].GetObject()) {
+      ObjectId object_id;
+      if (!firebase::Decode(it.name.GetString(), &object_id)) {
+        return false;
+      }
+
+      ObjectLocation location;
+      if (!it.value.IsObject() || !it.value.HasMember(kBundleIdKey) ||
+          !it.value[kBundleIdKey].IsString() ||
+          !firebase::Decode(it.value[kBundleIdKey].GetString(),
+                            &location.bundle_id) ||
+          !it.value.HasMember(kOffsetKey) || !it.value[kOffsetKey].IsUint64() ||
+          !it.value.HasMember(kSizeKey) || !it.value[kSizeKey].IsUint64()) {
+        return false;
+      }
+      location.offset = it.value[kOffsetKey].GetUint64();
+      location.size = it.value[kSizeKey].GetUint64();
+      bundled_objects[object_id] = std::move(location);
+    }
+  }
+
   if (!value.HasMember(kTimestampKey) || !value[kTimestampKey].IsNumber()) {
     return false;
   }
 
+  Commit commit(std::move(commit_id), std::move(commit_content),
+                std::move(storage_objects));
+  commit.bundled_objects = std::move(bundled_objects);
   auto record = std::make_unique<Record>(
-      Commit(std::move(commit_id), std::move(commit_content),
-             std::move(storage_objects)),
+      std::move(commit),
       ServerTimestampToBytes(value[kTimestampKey].GetInt64()));
   output_record->swap(record);
   return true;
 }
 
+CommitsDecoder::CommitsDecoder() {}
+
+CommitsDecoder::~CommitsDecoder() {}
+
+bool CommitsDecoder::AddCommit(const rapidjson::Value& value) {
+  if (!value.IsObject()) {
+    return false;
+  }
+
+  std::unique_ptr<Record> record;
+  if (!DecodeCommitFromValue(value, &record)) {
+    return false;
+  }
+  FTL_DCHECK(record);
+  sort_keys_.emplace_back(BytesToServerTimestamp(record->timestamp),
+                          GetBatchPosition(value));
+  records_.push_back(std::move(*record));
+  return true;
+}
+
+std::vector<Record> CommitsDecoder::TakeRecords() {
+  // Commits written in a single batch share the same server timestamp: they
+  // are ordered by their position in the batch.
+  std::vector<size_t> order(records_.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [this](size_t lhs, size_t rhs) {
+    return sort_keys_[lhs] < sort_keys_[rhs];
+  });
+
+  std::vector<Record> records;
+  records.reserve(order.size());
+  for (size_t index : order) {
+    records.push_back(std::move(records_[index]));
+  }
+
+  records_.clear();
+  sort_keys_.clear();
+  return records;
+}
+
 }  // namespace cloud_provider
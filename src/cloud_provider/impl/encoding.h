@@ -6,10 +6,12 @@
 #define APPS_LEDGER_SRC_CLOUD_PROVIDER_IMPL_ENCODING_H_
 
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include "apps/ledger/src/cloud_provider/public/commit.h"
 #include "apps/ledger/src/cloud_provider/public/record.h"
+#include "lib/ftl/macros.h"
 
 #include <rapidjson/document.h>
 
@@ -24,6 +26,14 @@ namespace cloud_provider {
 // server timestamp.
 bool EncodeCommit(const Commit& commit, std::string* output_json);
 
+// Encodes multiple commits as a JSON object suitable for a multi-path update of
+// the commits collection in Firebase Realtime Database: each commit is stored
+// under its encoded id. As all commits written in a single update are tagged
+// with the same server timestamp, each of them also records its position in
+// |commits|, so that the order of the batch is preserved when decoding.
+bool EncodeCommits(const std::vector<Commit>& commits,
+                   std::string* output_json);
+
 // Decodes a commit from the JSON representation in Firebase
 // Realtime Database. If successful, the method returns true, and
 // |output_record| contains the decoded commit, along with opaque
@@ -44,6 +54,30 @@ bool DecodeCommitFromValue(const rapidjson::Value& value,
 bool DecodeMultipleCommitsFromValue(const rapidjson::Value& value,
                                     std::vector<Record>* output_records);
 
+// Decodes commits one by one, as the members of an object holding them in
+// Firebase Realtime Database are received, without requiring the whole object
+// to be held in memory.
+class CommitsDecoder {
+ public:
+  CommitsDecoder();
+  ~CommitsDecoder();
+
+  // Decodes the commit represented by |value|. Returns false if |value| is not
+  // a valid commit.
+  bool AddCommit(const rapidjson::Value& value);
+
+  // Returns the commits decoded so far, in the same order as
+  // DecodeMultipleCommitsFromValue().
+  std::vector<Record> TakeRecords();
+
+ private:
+  std::vector<Record> records_;
+  // Timestamp and batch position of each commit of |records_|.
+  std::vector<std::pair<int64_t, int64_t>> sort_keys_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(CommitsDecoder);
+};
+
 }  // namespace cloud_provider
 
 #endif  // APPS_LEDGER_SRC_CLOUD_PROVIDER_IMPL_ENCODING_H_
@@ -27,11 +27,12 @@ TEST(EncodingTest, Encode) {
   std::string encoded;
   EXPECT_TRUE(EncodeCommit(commit, &encoded));
   EXPECT_EQ(
-      "{\"id\":\"some_idV\","
-      "\"content\":\"some_contentV\","
+      "{\"version\":1,"
+      "\"id\":\"c29tZV9pZAU\","
+      "\"content\":\"c29tZV9jb250ZW50U\","
       "\"objects\":{"
-      "\"object_aV\":\"data_aV\","
-      "\"object_bV\":\"data_bV\"},"
+      "\"b2JqZWN0X2EU\":\"ZGF0YV9hU\","
+      "\"b2JqZWN0X2IU\":\"ZGF0YV9iU\"},"
       "\"timestamp\":{\".sv\":\"timestamp\"}"
       "}",
       encoded);
@@ -57,6 +58,40 @@ TEST(EncodingTest, Decode) {
   EXPECT_EQ(ServerTimestampToBytes(1472722368296), record->timestamp);
 }
 
+TEST(EncodingTest, DecodeCompact) {
+  std::string json =
+      "{\"version\":1,"
+      "\"content\":\"eHl6U\","
+      "\"id\":\"YWJjU\","
+      "\"objects\":{"
+      "\"b2JqZWN0X2EU\":\"YQU\","
+      "\"b2JqZWN0X2IU\":\"Av8U\"},"
+      "\"timestamp\":1472722368296"
+      "}";
+
+  std::unique_ptr<Record> record;
+  EXPECT_TRUE(DecodeCommit(json, &record));
+  EXPECT_EQ("abc", record->commit.id);
+  EXPECT_EQ("xyz", record->commit.content);
+  EXPECT_EQ(2u, record->commit.storage_objects.size());
+  EXPECT_EQ("a", record->commit.storage_objects.at("object_a"));
+  EXPECT_EQ("\x02\xFF", record->commit.storage_objects.at("object_b"));
+  EXPECT_EQ(ServerTimestampToBytes(1472722368296), record->timestamp);
+}
+
+// Verifies that commits written with an unknown encoding version are rejected.
+TEST(EncodingTest, DecodeNewerVersion) {
+  std::string json =
+      "{\"version\":3,"
+      "\"content\":\"eHl6U\","
+      "\"id\":\"YWJjU\","
+      "\"timestamp\":1472722368296"
+      "}";
+
+  std::unique_ptr<Record> record;
+  EXPECT_FALSE(DecodeCommit(json, &record));
+}
+
 TEST(EncodingTest, DecodeMultiple) {
   std::string json =
       "{\"id2V\":"
@@ -91,6 +126,69 @@ TEST(EncodingTest, DecodeMultiple) {
   EXPECT_EQ(ServerTimestampToBytes(1472722368296), records[1].timestamp);
 }
 
+TEST(EncodingTest, EncodeMultiple) {
+  std::vector<Commit> commits;
+  commits.emplace_back("id1", "content1", std::map<ObjectId, Data>{});
+  commits.emplace_back("id2", "content2",
+                       std::map<ObjectId, Data>{{"object_a", "data_a"}});
+
+  std::string encoded;
+  EXPECT_TRUE(EncodeCommits(commits, &encoded));
+  EXPECT_EQ(
+      "{\"id1V\":"
+      "{\"version\":1,"
+      "\"id\":\"aWQxU\","
+      "\"content\":\"Y29udGVudDEU\","
+      "\"batch_position\":0,"
+      "\"timestamp\":{\".sv\":\"timestamp\"}},"
+      "\"id2V\":"
+      "{\"version\":1,"
+      "\"id\":\"aWQyU\","
+      "\"content\":\"Y29udGVudDIU\","
+      "\"objects\":{\"b2JqZWN0X2EU\":\"ZGF0YV9hU\"},"
+      "\"batch_position\":1,"
+      "\"timestamp\":{\".sv\":\"timestamp\"}}"
+      "}",
+      encoded);
+}
+
+// Verifies that commits written in a single batch, which share the same
+// timestamp, are decoded in the order of the batch.
+TEST(EncodingTest, DecodeMultipleSameTimestamp) {
+  std::string json =
+      "{\"id1V\":"
+      "{\"content\":\"content1V\","
+      "\"id\":\"id1V\","
+      "\"batch_position\":2,"
+      "\"timestamp\":42"
+      "},"
+      "\"id2V\":"
+      "{\"content\":\"content2V\","
+      "\"id\":\"id2V\","
+      "\"batch_position\":0,"
+      "\"timestamp\":42"
+      "},"
+      "\"id3V\":"
+      "{\"content\":\"content3V\","
+      "\"id\":\"id3V\","
+      "\"batch_position\":1,"
+      "\"timestamp\":42"
+      "},"
+      "\"id4V\":"
+      "{\"content\":\"content4V\","
+      "\"id\":\"id4V\","
+      "\"timestamp\":41"
+      "}}";
+
+  std::vector<Record> records;
+  EXPECT_TRUE(DecodeMultipleCommits(json, &records));
+  ASSERT_EQ(4u, records.size());
+  EXPECT_EQ("id4", records[0].commit.id);
+  EXPECT_EQ("id2", records[1].commit.id);
+  EXPECT_EQ("id3", records[2].commit.id);
+  EXPECT_EQ("id1", records[3].commit.id);
+}
+
 // Verifies that encoding and JSON parsing we use work with zero bytes within
 // strings.
 TEST(EncodingTest, EncodeDecodeZeroByte) {
@@ -111,5 +209,38 @@ TEST(EncodingTest, EncodeDecodeZeroByte) {
   EXPECT_EQ(ServerTimestampToBytes(42), output_record->timestamp);
 }
 
+TEST(EncodingTest, EncodeDecodeBundledObjects) {
+  Commit commit("id", "content", std::map<ObjectId, Data>{});
+  ObjectLocation location_a;
+  location_a.bundle_id = "bundle";
+  location_a.offset = 0;
+  location_a.size = 3;
+  ObjectLocation location_b;
+  location_b.bundle_id = "bundle";
+  location_b.offset = 3;
+  location_b.size = 5;
+  commit.bundled_objects["object_a"] = location_a;
+  commit.bundled_objects["object_b"] = location_b;
+
+  std::string encoded;
+  EXPECT_TRUE(EncodeCommit(commit, &encoded));
+  EXPECT_EQ(
+      "{\"version\":2,"
+      "\"id\":\"aWQU\","
+      "\"content\":\"Y29udGVudAU\","
+      "\"bundled_objects\":{"
+      "\"b2JqZWN0X2EU\":{\"bundle\":\"YnVuZGxlU\",\"offset\":0,\"size\":3},"
+      "\"b2JqZWN0X2IU\":{\"bundle\":\"YnVuZGxlU\",\"offset\":3,\"size\":5}},"
+      "\"timestamp\":{\".sv\":\"timestamp\"}"
+      "}",
+      encoded);
+
+  std::string pattern = "{\".sv\":\"timestamp\"}";
+  encoded.replace(encoded.find(pattern), pattern.size(), "42");
+  std::unique_ptr<Record> output_record;
+  EXPECT_TRUE(DecodeCommit(encoded, &output_record));
+  EXPECT_EQ(commit, output_record->commit);
+}
+
 }  // namespace
 }  // namespace cloud_provider
@@ -76,6 +76,35 @@ void WatchClientImpl::OnPut(const std::string& path,
                                   std::move(record->timestamp));
 }
 
+void WatchClientImpl::OnPatch(const std::string& path,
+                              const rapidjson::Value& value) {
+  if (errored_) {
+    return;
+  }
+
+  // Commits added in a batch through AddCommits() are delivered as a single
+  // patch event of the commit root, holding all the commits of the batch.
+  if (path != "/") {
+    HandleDecodingError(path, value, "invalid path");
+    return;
+  }
+
+  if (!value.IsObject()) {
+    HandleDecodingError(path, value, "received data is not a dictionary");
+    return;
+  }
+
+  std::vector<Record> records;
+  if (!DecodeMultipleCommitsFromValue(value, &records)) {
+    HandleDecodingError(path, value, "failed to decode a batch of commits");
+    return;
+  }
+  for (auto& record : records) {
+    commit_watcher_->OnRemoteCommit(std::move(record.commit),
+                                    std::move(record.timestamp));
+  }
+}
+
 void WatchClientImpl::OnMalformedEvent() {
   // Firebase already prints out debug info before calling here.
   HandleError();
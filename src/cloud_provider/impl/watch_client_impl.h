@@ -25,6 +25,8 @@ class WatchClientImpl : public firebase::WatchClient {
 
   // firebase::WatchClient:
   void OnPut(const std::string& path, const rapidjson::Value& value) override;
+  void OnPatch(const std::string& path,
+               const rapidjson::Value& value) override;
   void OnMalformedEvent() override;
   void OnConnectionError() override;
 
@@ -38,6 +38,13 @@ class CloudProvider {
   virtual void AddCommit(const Commit& commit,
                          const std::function<void(Status)>& callback) = 0;
 
+  // Adds the given commits to the cloud in a single operation: either all of
+  // them are added, or none is. The commits are delivered to watchers in the
+  // order of |commits|. The given callback will be called asynchronously with
+  // Status::OK if the operation have succeeded.
+  virtual void AddCommits(std::vector<Commit> commits,
+                          const std::function<void(Status)>& callback) = 0;
+
   // Registers the given watcher to be notified about commits already present
   // and these being added to the cloud later. This includes commits added by
   // the same CloudProvider instance through AddCommit().
@@ -68,6 +75,25 @@ class CloudProvider {
       const std::string& min_timestamp,
       std::function<void(Status, std::vector<Record>)> callback) = 0;
 
+  // Retrieves a page of the commits not older than the given |min_timestamp|,
+  // holding about |max_count| of the oldest ones. Passing empty
+  // |min_timestamp| starts from the first commit.
+  //
+  // Along with the commits, ordered by timestamp, |callback| receives the
+  // timestamp to pass to retrieve the next page, or an empty string if this is
+  // the last page. Commits sharing the same timestamp are always returned in
+  // the same page, which can thus be bigger than |max_count|.
+  virtual void GetCommitsPage(
+      const std::string& min_timestamp,
+      size_t max_count,
+      std::function<void(Status, std::vector<Record>, std::string)>
+          callback) = 0;
+
+  // Retrieves the commit of the given id. |callback| is called with NOT_FOUND
+  // if there is no such commit in the cloud.
+  virtual void GetCommit(const CommitId& commit_id,
+                         std::function<void(Status, Commit)> callback) = 0;
+
   // Uploads the given object to the cloud under the given id.
   virtual void AddObject(ObjectIdView object_id,
                          mx::vmo data,
@@ -8,6 +8,11 @@
 
 namespace cloud_provider {
 
+bool ObjectLocation::operator==(const ObjectLocation& other) const {
+  return bundle_id == other.bundle_id && offset == other.offset &&
+         size == other.size;
+}
+
 Commit::Commit() = default;
 
 Commit::Commit(CommitId id,
@@ -25,7 +30,8 @@ Commit& Commit::operator=(Commit&&) = default;
 
 bool Commit::operator==(const Commit& other) const {
   return id == other.id && content == other.content &&
-         storage_objects == other.storage_objects;
+         storage_objects == other.storage_objects &&
+         bundled_objects == other.bundled_objects;
 }
 
 Commit Commit::Clone() const {
@@ -33,6 +39,7 @@ Commit Commit::Clone() const {
   clone.id = id;
   clone.content = content;
   clone.storage_objects = storage_objects;
+  clone.bundled_objects = bundled_objects;
   return clone;
 }
 
@@ -5,6 +5,8 @@
 #ifndef APPS_LEDGER_SRC_CLOUD_PROVIDER_PUBLIC_COMMIT_H_
 #define APPS_LEDGER_SRC_CLOUD_PROVIDER_PUBLIC_COMMIT_H_
 
+#include <stdint.h>
+
 #include <map>
 #include <string>
 
@@ -13,6 +15,17 @@
 
 namespace cloud_provider {
 
+// Location of a storage object packed with other objects in a bundle. Bundles
+// are stored in the cloud as regular objects, under the id |bundle_id|.
+struct ObjectLocation {
+  ObjectId bundle_id;
+  // Position of the object data in the bundle.
+  uint64_t offset = 0;
+  uint64_t size = 0;
+
+  bool operator==(const ObjectLocation& other) const;
+};
+
 // Represents a commit.
 struct Commit {
   Commit();
@@ -38,6 +51,9 @@ struct Commit {
   // The inline storage objects.
   std::map<ObjectId, Data> storage_objects;
 
+  // The locations of the storage objects uploaded in bundles with this commit.
+  std::map<ObjectId, ObjectLocation> bundled_objects;
+
  private:
   FTL_DISALLOW_COPY_AND_ASSIGN(Commit);
 };
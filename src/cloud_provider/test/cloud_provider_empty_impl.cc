@@ -15,6 +15,12 @@ void CloudProviderEmptyImpl::AddCommit(
   FTL_NOTIMPLEMENTED();
 }
 
+void CloudProviderEmptyImpl::AddCommits(
+    std::vector<Commit> commits,
+    const std::function<void(Status)>& callback) {
+  FTL_NOTIMPLEMENTED();
+}
+
 void CloudProviderEmptyImpl::WatchCommits(const std::string& min_timestamp,
                                           CommitWatcher* watcher) {
   FTL_NOTIMPLEMENTED();
@@ -30,6 +36,19 @@ void CloudProviderEmptyImpl::GetCommits(
   FTL_NOTIMPLEMENTED();
 }
 
+void CloudProviderEmptyImpl::GetCommitsPage(
+    const std::string& min_timestamp,
+    size_t max_count,
+    std::function<void(Status, std::vector<Record>, std::string)> callback) {
+  FTL_NOTIMPLEMENTED();
+}
+
+void CloudProviderEmptyImpl::GetCommit(
+    const CommitId& commit_id,
+    std::function<void(Status, Commit)> callback) {
+  FTL_NOTIMPLEMENTED();
+}
+
 void CloudProviderEmptyImpl::AddObject(ObjectIdView object_id,
                                        mx::vmo data,
                                        std::function<void(Status)> callback) {
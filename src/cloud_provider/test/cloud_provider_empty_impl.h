@@ -26,6 +26,9 @@ class CloudProviderEmptyImpl : public CloudProvider {
   void AddCommit(const Commit& commit,
                  const std::function<void(Status)>& callback) override;
 
+  void AddCommits(std::vector<Commit> commits,
+                  const std::function<void(Status)>& callback) override;
+
   void WatchCommits(const std::string& min_timestamp,
                     CommitWatcher* watcher) override;
 
@@ -35,6 +38,15 @@ class CloudProviderEmptyImpl : public CloudProvider {
       const std::string& min_timestamp,
       std::function<void(Status, std::vector<Record>)> callback) override;
 
+  void GetCommitsPage(
+      const std::string& min_timestamp,
+      size_t max_count,
+      std::function<void(Status, std::vector<Record>, std::string)> callback)
+      override;
+
+  void GetCommit(const CommitId& commit_id,
+                 std::function<void(Status, Commit)> callback) override;
+
   void AddObject(ObjectIdView object_id,
                  mx::vmo data,
                  std::function<void(Status)> callback) override;
@@ -4,19 +4,27 @@
 
 #include "apps/ledger/src/cloud_sync/impl/batch_download.h"
 
+#include <map>
 #include <utility>
 
+#include "lib/ftl/logging.h"
+
 namespace cloud_sync {
 
 BatchDownload::BatchDownload(storage::PageStorage* storage,
+                             cloud_provider::CloudProvider* cloud_provider,
                              std::vector<cloud_provider::Record> records,
                              ftl::Closure on_done,
-                             ftl::Closure on_error)
+                             ftl::Closure on_error,
+                             Mode mode)
     : storage_(storage),
       records_(std::move(records)),
       on_done_(std::move(on_done)),
-      on_error_(std::move(on_error)) {
+      on_error_(std::move(on_error)),
+      mode_(mode),
+      bundle_download_(storage, cloud_provider) {
   FTL_DCHECK(storage);
+  FTL_DCHECK(cloud_provider);
 }
 
 BatchDownload::~BatchDownload() {}
@@ -24,27 +32,50 @@ BatchDownload::~BatchDownload() {}
 void BatchDownload::Start() {
   FTL_DCHECK(!started_);
   started_ = true;
-  std::vector<storage::PageStorage::CommitIdAndBytes> commits;
-  for (auto& record : records_) {
-    commits.push_back(storage::PageStorage::CommitIdAndBytes(
-        std::move(record.commit.id), std::move(record.commit.content)));
+
+  std::map<cloud_provider::ObjectId, cloud_provider::ObjectLocation>
+      bundled_objects;
+  for (const auto& record : records_) {
+    bundled_objects.insert(record.commit.bundled_objects.begin(),
+                           record.commit.bundled_objects.end());
   }
-  storage_->AddCommitsFromSync(
-      std::move(commits), [this](storage::Status status) {
+  bundle_download_.AddBundledObjects(
+      bundled_objects, [this](storage::Status status) {
         if (status != storage::Status::OK) {
           on_error_();
           return;
         }
+        AddCommits();
+      });
+}
 
-        if (storage_->SetSyncMetadata(std::move(records_.back().timestamp)) !=
-            storage::Status::OK) {
-          on_error_();
-          return;
-        }
+void BatchDownload::AddCommits() {
+  std::vector<storage::PageStorage::CommitIdAndBytes> commits;
+  for (auto& record : records_) {
+    commits.push_back(storage::PageStorage::CommitIdAndBytes(
+        std::move(record.commit.id), std::move(record.commit.content)));
+  }
+  auto on_commits_added = [this](storage::Status status) {
+    if (status != storage::Status::OK) {
+      on_error_();
+      return;
+    }
 
-        // Can be deleted within.
-        on_done_();
-      });
+    if (storage_->SetSyncMetadata(std::move(records_.back().timestamp)) !=
+        storage::Status::OK) {
+      on_error_();
+      return;
+    }
+
+    // Can be deleted within.
+    on_done_();
+  };
+  if (mode_ == Mode::SHALLOW) {
+    storage_->AddShallowCommitsFromSync(std::move(commits),
+                                        std::move(on_commits_added));
+    return;
+  }
+  storage_->AddCommitsFromSync(std::move(commits), std::move(on_commits_added));
 }
 
 }  // namespace cloud_sync
@@ -5,9 +5,15 @@
 #ifndef APPS_LEDGER_SRC_CLOUD_SYNC_IMPL_BATCH_DOWNLOAD_H_
 #define APPS_LEDGER_SRC_CLOUD_SYNC_IMPL_BATCH_DOWNLOAD_H_
 
+#include <functional>
+#include <vector>
+
+#include "apps/ledger/src/cloud_provider/public/cloud_provider.h"
 #include "apps/ledger/src/cloud_provider/public/record.h"
+#include "apps/ledger/src/cloud_sync/impl/bundle_download.h"
 #include "apps/ledger/src/storage/public/page_storage.h"
 #include "lib/ftl/functional/closure.h"
+#include "lib/ftl/macros.h"
 
 namespace cloud_sync {
 
@@ -17,25 +23,42 @@ namespace cloud_sync {
 // storage, and waits until storage confirms that the operation completed before
 // calling |on_done|.
 //
+// The objects uploaded in bundles with the commits are added to storage first,
+// as their location is only known from the commits. See BundleDownload.
+//
+// In SHALLOW mode, only the commits that are not parents of other commits of
+// the batch are added to storage along with their objects, and the others are
+// left to be retrieved from the cloud provider when needed. See
+// PageStorage::AddShallowCommitsFromSync().
+//
 // The operation is not retryable, and errors reported through |on_error| are
 // not recoverable.
 class BatchDownload {
  public:
+  enum class Mode { FULL, SHALLOW };
+
   BatchDownload(storage::PageStorage* storage,
+                cloud_provider::CloudProvider* cloud_provider,
                 std::vector<cloud_provider::Record> records,
                 ftl::Closure on_done,
-                ftl::Closure on_error);
+                ftl::Closure on_error,
+                Mode mode = Mode::FULL);
   ~BatchDownload();
 
   // Can be called only once.
   void Start();
 
  private:
+  // Adds the commits to storage.
+  void AddCommits();
+
   storage::PageStorage* const storage_;
   std::vector<cloud_provider::Record> records_;
   ftl::Closure on_done_;
   ftl::Closure on_error_;
+  const Mode mode_;
   bool started_ = false;
+  BundleDownload bundle_download_;
 
   FTL_DISALLOW_COPY_AND_ASSIGN(BatchDownload);
 };
@@ -4,23 +4,25 @@
 
 #include "apps/ledger/src/cloud_sync/impl/batch_download.h"
 
+#include <map>
+#include <set>
 #include <unordered_map>
 
+#include "apps/ledger/src/cloud_provider/test/cloud_provider_empty_impl.h"
 #include "apps/ledger/src/storage/test/page_storage_empty_impl.h"
 #include "apps/ledger/src/test/test_with_message_loop.h"
 #include "gtest/gtest.h"
 #include "lib/ftl/functional/make_copyable.h"
 #include "lib/ftl/macros.h"
+#include "lib/mtl/socket/strings.h"
 #include "lib/mtl/tasks/message_loop.h"
 
 namespace cloud_sync {
 
 namespace {
 
-// Fake implementation of storage::PageStorage. Injects the data that
-// CommitUpload asks about: page id and unsynced objects to be uploaded.
-// Registers the reported results of the upload: commits and objects marked as
-// synced.
+// Fake implementation of storage::PageStorage. Registers the commits and the
+// objects added from sync.
 class TestPageStorage : public storage::test::PageStorageEmptyImpl {
  public:
   TestPageStorage(mtl::MessageLoop* message_loop)
@@ -43,19 +45,81 @@ class TestPageStorage : public storage::test::PageStorageEmptyImpl {
         }));
   }
 
+  void AddShallowCommitsFromSync(
+      std::vector<storage::PageStorage::CommitIdAndBytes> ids_and_bytes,
+      std::function<void(storage::Status status)> callback) override {
+    add_shallow_commits_calls++;
+    AddCommitsFromSync(std::move(ids_and_bytes), std::move(callback));
+  }
+
+  void AddObjectFromSync(
+      storage::ObjectIdView object_id,
+      mx::socket data,
+      size_t size,
+      const std::function<void(storage::Status)>& callback) override {
+    std::string content;
+    EXPECT_TRUE(mtl::BlockingCopyToString(std::move(data), &content));
+    EXPECT_EQ(size, content.size());
+    received_objects[object_id.ToString()] = std::move(content);
+    message_loop_->task_runner()->PostTask(
+        [callback]() { callback(storage::Status::OK); });
+  }
+
+  void GetObject(
+      storage::ObjectIdView object_id,
+      Location location,
+      const std::function<void(storage::Status,
+                               std::unique_ptr<const storage::Object>)>&
+          callback) override {
+    // Only the presence of the object is reported.
+    storage::Status status = local_objects.count(object_id.ToString())
+                                 ? storage::Status::OK
+                                 : storage::Status::NOT_FOUND;
+    message_loop_->task_runner()->PostTask(
+        [callback, status]() { callback(status, nullptr); });
+  }
+
   storage::Status SetSyncMetadata(ftl::StringView sync_state) override {
     sync_metadata = sync_state.ToString();
     return storage::Status::OK;
   }
 
   bool should_fail_add_commit_from_sync = false;
+  unsigned int add_shallow_commits_calls = 0u;
+  std::set<storage::ObjectId> local_objects;
   std::unordered_map<storage::CommitId, std::string> received_commits;
+  std::map<storage::ObjectId, std::string> received_objects;
   std::string sync_metadata;
 
  private:
   mtl::MessageLoop* message_loop_;
 };
 
+// Fake implementation of cloud_provider::CloudProvider. Serves the objects
+// injected by the test.
+class TestCloudProvider : public cloud_provider::test::CloudProviderEmptyImpl {
+ public:
+  TestCloudProvider() = default;
+  ~TestCloudProvider() override = default;
+
+  void GetObject(cloud_provider::ObjectIdView object_id,
+                 std::function<void(cloud_provider::Status status,
+                                    uint64_t size,
+                                    mx::socket data)> callback) override {
+    get_object_calls++;
+    auto it = objects_to_return.find(object_id.ToString());
+    if (it == objects_to_return.end()) {
+      callback(cloud_provider::Status::NOT_FOUND, 0u, mx::socket());
+      return;
+    }
+    callback(cloud_provider::Status::OK, it->second.size(),
+             mtl::WriteStringToSocket(it->second));
+  }
+
+  std::map<cloud_provider::ObjectId, std::string> objects_to_return;
+  unsigned int get_object_calls = 0u;
+};
+
 class BatchDownloadTest : public test::TestWithMessageLoop {
  public:
   BatchDownloadTest() : storage_(&message_loop_) {}
@@ -63,6 +127,7 @@ class BatchDownloadTest : public test::TestWithMessageLoop {
 
  protected:
   TestPageStorage storage_;
+  TestCloudProvider cloud_provider_;
 
  private:
   FTL_DISALLOW_COPY_AND_ASSIGN(BatchDownloadTest);
@@ -73,7 +138,7 @@ TEST_F(BatchDownloadTest, AddCommit) {
   int error_calls = 0;
   std::vector<cloud_provider::Record> records;
   records.emplace_back(cloud_provider::Commit("id1", "content1", {}), "42");
-  BatchDownload batch_download(&storage_, std::move(records),
+  BatchDownload batch_download(&storage_, &cloud_provider_, std::move(records),
                                [this, &done_calls] {
                                  done_calls++;
                                  message_loop_.PostQuitTask();
@@ -95,7 +160,7 @@ TEST_F(BatchDownloadTest, AddMultipleCommits) {
   std::vector<cloud_provider::Record> records;
   records.emplace_back(cloud_provider::Commit("id1", "content1", {}), "42");
   records.emplace_back(cloud_provider::Commit("id2", "content2", {}), "43");
-  BatchDownload batch_download(&storage_, std::move(records),
+  BatchDownload batch_download(&storage_, &cloud_provider_, std::move(records),
                                [this, &done_calls] {
                                  done_calls++;
                                  message_loop_.PostQuitTask();
@@ -112,12 +177,35 @@ TEST_F(BatchDownloadTest, AddMultipleCommits) {
   EXPECT_EQ("43", storage_.sync_metadata);
 }
 
+TEST_F(BatchDownloadTest, AddShallowCommits) {
+  int done_calls = 0;
+  int error_calls = 0;
+  std::vector<cloud_provider::Record> records;
+  records.emplace_back(cloud_provider::Commit("id1", "content1", {}), "42");
+  records.emplace_back(cloud_provider::Commit("id2", "content2", {}), "43");
+  BatchDownload batch_download(&storage_, &cloud_provider_, std::move(records),
+                               [this, &done_calls] {
+                                 done_calls++;
+                                 message_loop_.PostQuitTask();
+                               },
+                               [&error_calls] { error_calls++; },
+                               BatchDownload::Mode::SHALLOW);
+  batch_download.Start();
+
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(1, done_calls);
+  EXPECT_EQ(0, error_calls);
+  EXPECT_EQ(1u, storage_.add_shallow_commits_calls);
+  EXPECT_EQ(2u, storage_.received_commits.size());
+  EXPECT_EQ("43", storage_.sync_metadata);
+}
+
 TEST_F(BatchDownloadTest, FailToAddCommit) {
   int done_calls = 0;
   int error_calls = 0;
   std::vector<cloud_provider::Record> records;
   records.emplace_back(cloud_provider::Commit("id1", "content1", {}), "42");
-  BatchDownload batch_download(&storage_, std::move(records),
+  BatchDownload batch_download(&storage_, &cloud_provider_, std::move(records),
                                [&done_calls] { done_calls++; },
                                [this, &error_calls] {
                                  error_calls++;
@@ -133,6 +221,87 @@ TEST_F(BatchDownloadTest, FailToAddCommit) {
   EXPECT_EQ("", storage_.sync_metadata);
 }
 
+TEST_F(BatchDownloadTest, AddBundledObjects) {
+  int done_calls = 0;
+  int error_calls = 0;
+  cloud_provider_.objects_to_return["bundle"] = "obj_data1obj_data2";
+  storage_.local_objects.insert("obj_id2");
+  std::vector<cloud_provider::Record> records;
+  cloud_provider::Commit commit("id1", "content1", {});
+  commit.bundled_objects["obj_id1"].bundle_id = "bundle";
+  commit.bundled_objects["obj_id1"].offset = 0u;
+  commit.bundled_objects["obj_id1"].size = 9u;
+  commit.bundled_objects["obj_id2"].bundle_id = "bundle";
+  commit.bundled_objects["obj_id2"].offset = 9u;
+  commit.bundled_objects["obj_id2"].size = 9u;
+  records.emplace_back(std::move(commit), "42");
+  BatchDownload batch_download(&storage_, &cloud_provider_, std::move(records),
+                               [this, &done_calls] {
+                                 done_calls++;
+                                 message_loop_.PostQuitTask();
+                               },
+                               [&error_calls] { error_calls++; });
+  batch_download.Start();
+
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(1, done_calls);
+  EXPECT_EQ(0, error_calls);
+  EXPECT_EQ(1u, cloud_provider_.get_object_calls);
+  // Only the object missing from storage is added.
+  EXPECT_EQ(1u, storage_.received_objects.size());
+  EXPECT_EQ("obj_data1", storage_.received_objects["obj_id1"]);
+  EXPECT_EQ("content1", storage_.received_commits["id1"]);
+}
+
+TEST_F(BatchDownloadTest, SkipBundleOfLocalObjects) {
+  int done_calls = 0;
+  int error_calls = 0;
+  storage_.local_objects.insert("obj_id1");
+  std::vector<cloud_provider::Record> records;
+  cloud_provider::Commit commit("id1", "content1", {});
+  commit.bundled_objects["obj_id1"].bundle_id = "bundle";
+  commit.bundled_objects["obj_id1"].size = 9u;
+  records.emplace_back(std::move(commit), "42");
+  BatchDownload batch_download(&storage_, &cloud_provider_, std::move(records),
+                               [this, &done_calls] {
+                                 done_calls++;
+                                 message_loop_.PostQuitTask();
+                               },
+                               [&error_calls] { error_calls++; });
+  batch_download.Start();
+
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(1, done_calls);
+  EXPECT_EQ(0, error_calls);
+  EXPECT_EQ(0u, cloud_provider_.get_object_calls);
+  EXPECT_TRUE(storage_.received_objects.empty());
+  EXPECT_EQ("content1", storage_.received_commits["id1"]);
+}
+
+TEST_F(BatchDownloadTest, FailToGetBundle) {
+  int done_calls = 0;
+  int error_calls = 0;
+  std::vector<cloud_provider::Record> records;
+  cloud_provider::Commit commit("id1", "content1", {});
+  commit.bundled_objects["obj_id1"].bundle_id = "bundle";
+  commit.bundled_objects["obj_id1"].size = 9u;
+  records.emplace_back(std::move(commit), "42");
+  BatchDownload batch_download(&storage_, &cloud_provider_, std::move(records),
+                               [&done_calls] { done_calls++; },
+                               [this, &error_calls] {
+                                 error_calls++;
+                                 message_loop_.PostQuitTask();
+                               });
+  batch_download.Start();
+
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(0, done_calls);
+  EXPECT_EQ(1, error_calls);
+  EXPECT_EQ(3u, cloud_provider_.get_object_calls);
+  EXPECT_TRUE(storage_.received_commits.empty());
+  EXPECT_EQ("", storage_.sync_metadata);
+}
+
 }  // namespace
 
 }  // namespace cloud_sync
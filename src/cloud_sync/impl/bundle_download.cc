@@ -0,0 +1,154 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/cloud_sync/impl/bundle_download.h"
+
+#include <memory>
+
+#include "apps/ledger/src/callback/waiter.h"
+#include "lib/ftl/functional/make_copyable.h"
+#include "lib/ftl/logging.h"
+#include "lib/mtl/socket/strings.h"
+
+namespace cloud_sync {
+
+namespace {
+// Number of times the retrieval of a bundle is attempted before the download
+// of its objects is considered failed.
+constexpr int kMaxBundleDownloadAttempts = 3;
+}  // namespace
+
+BundleDownload::BundleDownload(storage::PageStorage* storage,
+                               cloud_provider::CloudProvider* cloud_provider)
+    : storage_(storage), cloud_provider_(cloud_provider) {
+  FTL_DCHECK(storage);
+  FTL_DCHECK(cloud_provider);
+}
+
+BundleDownload::~BundleDownload() {}
+
+void BundleDownload::AddBundledObjects(
+    const std::map<cloud_provider::ObjectId, cloud_provider::ObjectLocation>&
+        bundled_objects,
+    std::function<void(storage::Status)> callback) {
+  std::map<cloud_provider::ObjectId, std::vector<BundledObject>> bundles;
+  for (const auto& entry : bundled_objects) {
+    bundles[entry.second.bundle_id].emplace_back(entry.first, entry.second);
+  }
+  if (bundles.empty()) {
+    callback(storage::Status::OK);
+    return;
+  }
+
+  auto waiter =
+      callback::StatusWaiter<storage::Status>::Create(storage::Status::OK);
+  for (auto& bundle : bundles) {
+    DownloadBundle(bundle.first, std::move(bundle.second),
+                   waiter->NewCallback());
+  }
+  waiter->Finalize(std::move(callback));
+}
+
+void BundleDownload::DownloadBundle(
+    cloud_provider::ObjectId bundle_id,
+    std::vector<BundledObject> objects,
+    std::function<void(storage::Status)> callback) {
+  // The bundle is only retrieved if some of its objects are missing, which is
+  // not the case for the commits of this device.
+  auto waiter =
+      callback::Waiter<storage::Status, bool>::Create(storage::Status::OK);
+  for (const auto& entry : objects) {
+    storage_->GetObject(
+        entry.first, storage::PageStorage::Location::LOCAL,
+        [callback = waiter->NewCallback()](
+            storage::Status status,
+            std::unique_ptr<const storage::Object> object) {
+          if (status == storage::Status::NOT_FOUND) {
+            callback(storage::Status::OK, true);
+            return;
+          }
+          callback(status, false);
+        });
+  }
+  waiter->Finalize(ftl::MakeCopyable([
+    this, bundle_id = std::move(bundle_id), objects = std::move(objects),
+    callback = std::move(callback)
+  ](storage::Status status, std::vector<bool> missing) mutable {
+    if (status != storage::Status::OK) {
+      callback(status);
+      return;
+    }
+    std::vector<BundledObject> missing_objects;
+    for (size_t i = 0; i < objects.size(); ++i) {
+      if (missing[i]) {
+        missing_objects.push_back(std::move(objects[i]));
+      }
+    }
+    if (missing_objects.empty()) {
+      callback(storage::Status::OK);
+      return;
+    }
+    FetchBundle(std::move(bundle_id), std::move(missing_objects),
+                kMaxBundleDownloadAttempts, std::move(callback));
+  }));
+}
+
+void BundleDownload::FetchBundle(
+    cloud_provider::ObjectId bundle_id,
+    std::vector<BundledObject> objects,
+    int remaining_attempts,
+    std::function<void(storage::Status)> callback) {
+  cloud_provider_->GetObject(bundle_id, ftl::MakeCopyable([
+    this, bundle_id, objects = std::move(objects), remaining_attempts,
+    callback = std::move(callback)
+  ](cloud_provider::Status status, uint64_t size, mx::socket data) mutable {
+    if (status != cloud_provider::Status::OK) {
+      if (remaining_attempts > 1) {
+        FetchBundle(std::move(bundle_id), std::move(objects),
+                    remaining_attempts - 1, std::move(callback));
+        return;
+      }
+      FTL_LOG(ERROR) << "Failed to retrieve a bundle of objects, status: "
+                     << status;
+      callback(storage::Status::IO_ERROR);
+      return;
+    }
+
+    auto& drainer = drainers_.emplace();
+    drainer.Start(std::move(data), ftl::MakeCopyable([
+      this, objects = std::move(objects), callback = std::move(callback)
+    ](const std::string& bundle) mutable {
+      AddObjectsFromBundle(bundle, objects, std::move(callback));
+    }));
+  }));
+}
+
+void BundleDownload::AddObjectsFromBundle(
+    const std::string& bundle,
+    const std::vector<BundledObject>& objects,
+    std::function<void(storage::Status)> callback) {
+  for (const auto& object : objects) {
+    const cloud_provider::ObjectLocation& location = object.second;
+    if (location.offset > bundle.size() ||
+        location.size > bundle.size() - location.offset) {
+      FTL_LOG(ERROR) << "Object out of the bounds of its bundle.";
+      callback(storage::Status::FORMAT_ERROR);
+      return;
+    }
+  }
+
+  auto waiter =
+      callback::StatusWaiter<storage::Status>::Create(storage::Status::OK);
+  for (const auto& object : objects) {
+    const cloud_provider::ObjectLocation& location = object.second;
+    storage_->AddObjectFromSync(
+        object.first,
+        mtl::WriteStringToSocket(
+            ftl::StringView(bundle.data() + location.offset, location.size)),
+        location.size, waiter->NewCallback());
+  }
+  waiter->Finalize(std::move(callback));
+}
+
+}  // namespace cloud_sync
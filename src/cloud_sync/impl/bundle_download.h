@@ -0,0 +1,77 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPS_LEDGER_SRC_CLOUD_SYNC_IMPL_BUNDLE_DOWNLOAD_H_
+#define APPS_LEDGER_SRC_CLOUD_SYNC_IMPL_BUNDLE_DOWNLOAD_H_
+
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "apps/ledger/src/callback/auto_cleanable.h"
+#include "apps/ledger/src/cloud_provider/public/cloud_provider.h"
+#include "apps/ledger/src/cloud_provider/public/commit.h"
+#include "apps/ledger/src/glue/socket/socket_drainer_client.h"
+#include "apps/ledger/src/storage/public/page_storage.h"
+#include "lib/ftl/macros.h"
+
+namespace cloud_sync {
+
+// Adds to storage the objects uploaded in bundles with remote commits.
+//
+// Bundled objects have no copy in the cloud under their own id: their location
+// is only known from the commits that carry them. Each bundle holding objects
+// missing from storage is retrieved as a whole from the cloud provider, and
+// split into its objects.
+//
+// Only the objects that storage retrieves eagerly are bundled, see
+// CommitUpload::BundleSmallObjects(), so adding them when the commit is
+// retrieved doesn't fetch any object that wouldn't be fetched anyway.
+class BundleDownload {
+ public:
+  BundleDownload(storage::PageStorage* storage,
+                 cloud_provider::CloudProvider* cloud_provider);
+  ~BundleDownload();
+
+  // Adds to storage the objects of |bundled_objects| that are missing from it,
+  // and calls |callback| once they are added.
+  void AddBundledObjects(
+      const std::map<cloud_provider::ObjectId, cloud_provider::ObjectLocation>&
+          bundled_objects,
+      std::function<void(storage::Status)> callback);
+
+ private:
+  using BundledObject =
+      std::pair<cloud_provider::ObjectId, cloud_provider::ObjectLocation>;
+
+  // Adds to storage the given bundled |objects| of the bundle |bundle_id| that
+  // are missing from it.
+  void DownloadBundle(cloud_provider::ObjectId bundle_id,
+                      std::vector<BundledObject> objects,
+                      std::function<void(storage::Status)> callback);
+
+  // Retrieves the bundle |bundle_id| and adds the given |objects| of it to
+  // storage, retrying at most |remaining_attempts| - 1 times on failure.
+  void FetchBundle(cloud_provider::ObjectId bundle_id,
+                   std::vector<BundledObject> objects,
+                   int remaining_attempts,
+                   std::function<void(storage::Status)> callback);
+
+  // Adds the given |objects| of the retrieved |bundle| to storage.
+  void AddObjectsFromBundle(const std::string& bundle,
+                            const std::vector<BundledObject>& objects,
+                            std::function<void(storage::Status)> callback);
+
+  storage::PageStorage* const storage_;
+  cloud_provider::CloudProvider* const cloud_provider_;
+  callback::AutoCleanableSet<glue::SocketDrainerClient> drainers_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(BundleDownload);
+};
+
+}  // namespace cloud_sync
+
+#endif  // APPS_LEDGER_SRC_CLOUD_SYNC_IMPL_BUNDLE_DOWNLOAD_H_
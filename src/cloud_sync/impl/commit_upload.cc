@@ -4,25 +4,48 @@
 
 #include "apps/ledger/src/cloud_sync/impl/commit_upload.h"
 
+#include "apps/ledger/src/callback/waiter.h"
 #include "apps/ledger/src/cloud_provider/public/commit.h"
 #include "apps/ledger/src/cloud_provider/public/types.h"
+#include "apps/ledger/src/glue/crypto/hash.h"
+#include "lib/ftl/functional/make_copyable.h"
 #include "lib/ftl/logging.h"
 #include "lib/mtl/vmo/strings.h"
 
 namespace cloud_sync {
 
+namespace {
+// Number of times the upload of a single object is attempted before the upload
+// of the commit is considered failed.
+constexpr int kMaxObjectUploadAttempts = 3;
+
+void OnObjectMarkedAsSynced(storage::Status status) {
+  if (status != storage::Status::OK) {
+    FTL_LOG(ERROR) << "Failed to mark an object as synced: " << status;
+  }
+}
+}  // namespace
+
+constexpr size_t CommitUpload::kDefaultMaxConcurrentUploads;
+constexpr uint64_t CommitUpload::kDefaultMaxInFlightBytes;
+
 CommitUpload::CommitUpload(storage::PageStorage* storage,
                            cloud_provider::CloudProvider* cloud_provider,
                            std::unique_ptr<const storage::Commit> commit,
                            ftl::Closure on_done,
-                           ftl::Closure on_error)
+                           ftl::Closure on_error,
+                           size_t max_concurrent_uploads,
+                           uint64_t max_in_flight_bytes)
     : storage_(storage),
       cloud_provider_(cloud_provider),
       commit_(std::move(commit)),
       on_done_(on_done),
-      on_error_(on_error) {
+      on_error_(on_error),
+      max_concurrent_uploads_(max_concurrent_uploads),
+      max_in_flight_bytes_(max_in_flight_bytes) {
   FTL_DCHECK(storage);
   FTL_DCHECK(cloud_provider);
+  FTL_DCHECK(max_concurrent_uploads > 0);
 }
 
 CommitUpload::~CommitUpload() {}
@@ -31,35 +54,105 @@ void CommitUpload::Start() {
   FTL_DCHECK(!active_or_finished_);
   current_attempt_++;
   active_or_finished_ = true;
+  objects_uploaded_ = false;
+  pending_object_ids_.clear();
+  objects_in_flight_ = 0;
+  bytes_in_flight_ = 0;
+  bundle_data_.clear();
+  bundled_objects_.clear();
+  lazy_object_ids_.clear();
+
+  storage_->GetUnsyncedObjectIds(commit_->GetId(), [
+    this, upload_attempt = current_attempt_
+  ](storage::Status status, std::vector<storage::ObjectId> object_ids) {
+    if (upload_attempt != current_attempt_) {
+      return;
+    }
+    if (status != storage::Status::OK) {
+      HandleError();
+      return;
+    }
 
-  storage_->GetUnsyncedObjectIds(
-      commit_->GetId(), [this](storage::Status status,
-                               std::vector<storage::ObjectId> object_ids) {
-        FTL_DCHECK(status == storage::Status::OK);
+    // If there are no unsynced objects referenced by the commit, upload the
+    // commit directly.
+    if (object_ids.empty()) {
+      OnObjectsUploaded();
+      return;
+    }
+
+    // Upload all unsynced objects referenced by the commit. The last upload
+    // that succeeds triggers uploading the commit.
+    objects_to_upload_ = object_ids.size();
+    pending_object_ids_ = std::move(object_ids);
+    if (bundle_small_objects_) {
+      FindLazyValues();
+      return;
+    }
+    UploadNextObjects();
+  });
+}
 
-        // If there are no unsynced objects referenced by the commit, upload the
-        // commit directly.
-        if (object_ids.empty()) {
-          UploadCommit();
+void CommitUpload::FindLazyValues() {
+  storage_->GetCommitContents(
+      *commit_, "",
+      [ this, upload_attempt = current_attempt_ ](storage::Entry entry) {
+        if (upload_attempt != current_attempt_) {
+          return false;
+        }
+        if (entry.priority == storage::KeyPriority::LAZY) {
+          lazy_object_ids_.insert(std::move(entry.object_id));
+        }
+        return true;
+      },
+      [ this, upload_attempt = current_attempt_ ](storage::Status status) {
+        if (upload_attempt != current_attempt_) {
           return;
         }
-
-        // Upload all unsynced objects referenced by the commit. The last upload
-        // that succeeds triggers uploading the commit.
-        objects_to_upload_ = object_ids.size();
-        for (const auto& id : object_ids) {
-          storage_->GetObject(
-              id, storage::PageStorage::Location::LOCAL,
-              [this](storage::Status storage_status,
-                     std::unique_ptr<const storage::Object> object) {
-                FTL_DCHECK(storage_status == storage::Status::OK);
-                UploadObject(std::move(object));
-              });
+        if (status != storage::Status::OK) {
+          HandleError();
+          return;
         }
+        UploadNextObjects();
       });
 }
 
-void CommitUpload::UploadObject(std::unique_ptr<const storage::Object> object) {
+void CommitUpload::UploadNextObjects() {
+  while (active_or_finished_ && !pending_object_ids_.empty() &&
+         objects_in_flight_ < max_concurrent_uploads_ &&
+         (objects_in_flight_ == 0 || bytes_in_flight_ < max_in_flight_bytes_)) {
+    storage::ObjectId id = std::move(pending_object_ids_.back());
+    pending_object_ids_.pop_back();
+    objects_in_flight_++;
+    storage_->GetObject(id, storage::PageStorage::Location::LOCAL, [
+      this, upload_attempt = current_attempt_
+    ](storage::Status storage_status,
+      std::unique_ptr<const storage::Object> object) {
+      if (upload_attempt != current_attempt_) {
+        return;
+      }
+      if (storage_status != storage::Status::OK) {
+        HandleError();
+        return;
+      }
+      uint64_t size;
+      storage_status = object->GetSize(&size);
+      if (storage_status != storage::Status::OK) {
+        HandleError();
+        return;
+      }
+      if (bundle_small_objects_ && size <= max_bundled_object_size_ &&
+          lazy_object_ids_.count(object->GetId()) == 0) {
+        AddToBundle(std::move(object));
+        return;
+      }
+      bytes_in_flight_ += size;
+      UploadObject(std::move(object), kMaxObjectUploadAttempts);
+    });
+  }
+}
+
+void CommitUpload::UploadObject(std::unique_ptr<const storage::Object> object,
+                                int remaining_attempts) {
   ftl::StringView data_view;
   auto status = object->GetData(&data_view);
   FTL_DCHECK(status == storage::Status::OK);
@@ -71,42 +164,175 @@ void CommitUpload::UploadObject(std::unique_ptr<const storage::Object> object) {
   FTL_DCHECK(result);
 
   storage::ObjectId id = object->GetId();
-  cloud_provider_->AddObject(object->GetId(), std::move(data), [
-    this, id = std::move(id), upload_attempt = current_attempt_
-  ](cloud_provider::Status status) {
+  cloud_provider_->AddObject(id, std::move(data), ftl::MakeCopyable([
+    this, object = std::move(object), remaining_attempts,
+    upload_attempt = current_attempt_
+  ](cloud_provider::Status status) mutable {
     if (upload_attempt != current_attempt_) {
       // Object upload was completed for a previous .Start() call. If it
       // succeeded, we still mark it as synced, as this allows to avoid
       // re-uploading this object upon the next upload attempt.
       if (status == cloud_provider::Status::OK) {
-        storage_->MarkObjectSynced(id);
+        storage_->MarkObjectSynced(object->GetId(), OnObjectMarkedAsSynced);
       }
       return;
     }
 
     if (status != cloud_provider::Status::OK) {
-      if (active_or_finished_) {
-        active_or_finished_ = false;
-        on_error_();
+      if (active_or_finished_ && remaining_attempts > 1) {
+        UploadObject(std::move(object), remaining_attempts - 1);
+        return;
+      }
+      HandleError();
+      return;
+    }
+    storage_->MarkObjectSynced(object->GetId(), OnObjectMarkedAsSynced);
+
+    uint64_t size = 0;
+    object->GetSize(&size);
+    objects_in_flight_--;
+    bytes_in_flight_ -= size;
+    OnObjectDone();
+  }));
+}
+
+void CommitUpload::AddToBundle(std::unique_ptr<const storage::Object> object) {
+  ftl::StringView data;
+  auto status = object->GetData(&data);
+  FTL_DCHECK(status == storage::Status::OK);
+
+  cloud_provider::ObjectLocation location;
+  location.offset = bundle_data_.size();
+  location.size = data.size();
+  bundle_data_.append(data.data(), data.size());
+  bundled_objects_[object->GetId()] = std::move(location);
+
+  objects_in_flight_--;
+  OnObjectDone();
+}
+
+void CommitUpload::OnObjectDone() {
+  objects_to_upload_--;
+  if (objects_to_upload_ == 0) {
+    // All the referenced objects are uploaded or bundled, upload the bundle,
+    // then the commit.
+    UploadBundle(kMaxObjectUploadAttempts);
+    return;
+  }
+  UploadNextObjects();
+}
+
+void CommitUpload::UploadBundle(int remaining_attempts) {
+  if (bundled_objects_.empty()) {
+    OnObjectsUploaded();
+    return;
+  }
+
+  // A single object is not worth a bundle: upload it on its own. Otherwise,
+  // the bundle is stored under the hash of its content, like the objects.
+  bool single_object = bundled_objects_.size() == 1;
+  cloud_provider::ObjectId id =
+      single_object
+          ? bundled_objects_.begin()->first
+          : glue::SHA256Hash(bundle_data_.data(), bundle_data_.size());
+
+  mx::vmo data;
+  auto result = mtl::VmoFromString(bundle_data_, &data);
+  FTL_DCHECK(result);
+
+  cloud_provider_->AddObject(id, std::move(data), [
+    this, id, single_object, remaining_attempts,
+    upload_attempt = current_attempt_
+  ](cloud_provider::Status status) {
+    if (upload_attempt != current_attempt_) {
+      return;
+    }
+
+    if (status != cloud_provider::Status::OK) {
+      if (active_or_finished_ && remaining_attempts > 1) {
+        UploadBundle(remaining_attempts - 1);
+        return;
       }
+      HandleError();
       return;
     }
-    storage_->MarkObjectSynced(id);
-    objects_to_upload_--;
-    if (objects_to_upload_ == 0) {
-      // All the referenced objects are uploaded, upload the commit.
-      UploadCommit();
+
+    std::string().swap(bundle_data_);
+    if (single_object) {
+      storage_->MarkObjectSynced(id, OnObjectMarkedAsSynced);
+      bundled_objects_.clear();
+    } else {
+      for (auto& entry : bundled_objects_) {
+        entry.second.bundle_id = id;
+      }
     }
+    OnObjectsUploaded();
   });
 }
 
-void CommitUpload::UploadCommit() {
+void CommitUpload::MarkCommitSynced() {
+  auto waiter =
+      callback::StatusWaiter<storage::Status>::Create(storage::Status::OK);
+  for (const auto& entry : bundled_objects_) {
+    storage_->MarkObjectSynced(entry.first, waiter->NewCallback());
+  }
+  storage_->MarkCommitSynced(commit_->GetId(), waiter->NewCallback());
+  waiter->Finalize([this](storage::Status status) {
+    if (status != storage::Status::OK) {
+      FTL_LOG(ERROR) << "Failed to mark the commit as synced: " << status;
+    }
+    on_done_();
+  });
+}
+
+void CommitUpload::BundleSmallObjects(uint64_t max_object_size) {
+  FTL_DCHECK(!active_or_finished_);
+  bundle_small_objects_ = true;
+  max_bundled_object_size_ = max_object_size;
+}
+
+void CommitUpload::DeferCommitUpload(ftl::Closure on_objects_uploaded) {
+  FTL_DCHECK(!active_or_finished_);
+  FTL_DCHECK(on_objects_uploaded);
+  on_objects_uploaded_ = std::move(on_objects_uploaded);
+}
+
+bool CommitUpload::IsCommitReady() const {
+  return on_objects_uploaded_ && active_or_finished_ && objects_uploaded_;
+}
+
+cloud_provider::Commit CommitUpload::GetCommitToUpload() const {
   cloud_provider::Commit commit(
       commit_->GetId(), commit_->GetStorageBytes().ToString(),
       std::map<cloud_provider::ObjectId, cloud_provider::Data>{});
-  storage::CommitId commit_id = commit_->GetId();
-  cloud_provider_->AddCommit(commit, [ this, commit_id = std::move(commit_id) ](
-                                         cloud_provider::Status status) {
+  commit.bundled_objects = bundled_objects_;
+  return commit;
+}
+
+void CommitUpload::OnCommitUploaded() {
+  FTL_DCHECK(IsCommitReady());
+  MarkCommitSynced();
+}
+
+void CommitUpload::OnObjectsUploaded() {
+  objects_uploaded_ = true;
+  if (on_objects_uploaded_) {
+    on_objects_uploaded_();
+    return;
+  }
+  UploadCommit();
+}
+
+void CommitUpload::HandleError() {
+  if (active_or_finished_) {
+    active_or_finished_ = false;
+    on_error_();
+  }
+}
+
+void CommitUpload::UploadCommit() {
+  cloud_provider::Commit commit = GetCommitToUpload();
+  cloud_provider_->AddCommit(commit, [this](cloud_provider::Status status) {
     // UploadCommit() is called as a last step of a so-far-successful upload
     // attempt, so we couldn't have failed before.
     FTL_DCHECK(active_or_finished_);
@@ -115,8 +341,7 @@ void CommitUpload::UploadCommit() {
       on_error_();
       return;
     }
-    storage_->MarkCommitSynced(commit_id);
-    on_done_();
+    MarkCommitSynced();
   });
 }
 
@@ -6,9 +6,14 @@
 #define APPS_LEDGER_SRC_CLOUD_SYNC_IMPL_COMMIT_UPLOAD_H_
 
 #include <functional>
+#include <map>
 #include <memory>
+#include <set>
+#include <string>
+#include <vector>
 
 #include "apps/ledger/src/cloud_provider/public/cloud_provider.h"
+#include "apps/ledger/src/cloud_provider/public/commit.h"
 #include "apps/ledger/src/storage/public/commit.h"
 #include "apps/ledger/src/storage/public/page_storage.h"
 #include "lib/ftl/functional/closure.h"
@@ -24,6 +29,12 @@ namespace cloud_sync {
 // uploaded. The entire commit is marked as synced once all objects are uploaded
 // and the commit itself is uploaded.
 //
+// Objects are read from storage and uploaded only as the previous uploads
+// complete: at most |max_concurrent_uploads| objects are in flight at any
+// time, and no new object is read while the objects in flight total
+// |max_in_flight_bytes| or more. An object upload that fails is retried a few
+// times before the whole upload attempt is considered failed.
+//
 // Usage: call Start() to kick off the upload. |on_done| is called after upload
 // is successfully completed. |on_error| will be called at most once after each
 // Start() call when an error occurs. After |on_error| is called the client can
@@ -35,11 +46,16 @@ namespace cloud_sync {
 // long as the lifetime of page storage and page sync is managed together.
 class CommitUpload {
  public:
+  static constexpr size_t kDefaultMaxConcurrentUploads = 10;
+  static constexpr uint64_t kDefaultMaxInFlightBytes = 4 * 1024 * 1024;
+
   CommitUpload(storage::PageStorage* storage,
                cloud_provider::CloudProvider* cloud_provider,
                std::unique_ptr<const storage::Commit> commit,
                ftl::Closure on_done,
-               ftl::Closure on_error);
+               ftl::Closure on_error,
+               size_t max_concurrent_uploads = kDefaultMaxConcurrentUploads,
+               uint64_t max_in_flight_bytes = kDefaultMaxInFlightBytes);
   ~CommitUpload();
 
   // Starts a new upload attempt. Results are reported through |on_done|
@@ -47,9 +63,69 @@ class CommitUpload {
   // called the client can retry by calling Start() again.
   void Start();
 
+  // Leaves the upload of the commit itself to the client, so that several
+  // commits can be uploaded together through CloudProvider::AddCommits(). Once
+  // the objects are uploaded, |on_objects_uploaded| is called instead of
+  // uploading the commit: the client then uploads the commit returned by
+  // GetCommitToUpload() and calls OnCommitUploaded() once it is uploaded. Must
+  // be called before Start().
+  void DeferCommitUpload(ftl::Closure on_objects_uploaded);
+
+  // Packs the objects of at most |max_object_size| bytes in a single bundle,
+  // uploaded to the cloud as one object, instead of uploading each of them on
+  // its own. The locations of the bundled objects are recorded in the uploaded
+  // commit, and the bundled objects are only marked as synced once the commit
+  // is uploaded. The values of LAZY entries are never bundled: they are
+  // fetched on demand, by id, after the commit is downloaded. Must be called
+  // before Start().
+  void BundleSmallObjects(uint64_t max_object_size);
+
+  // Returns true iff the upload of the commit is deferred and its objects are
+  // uploaded.
+  bool IsCommitReady() const;
+
+  // Returns the commit to upload to the cloud.
+  cloud_provider::Commit GetCommitToUpload() const;
+
+  // Marks the commit as synced and reports the upload as done. Must only be
+  // called for deferred uploads, once IsCommitReady() returns true and the
+  // commit returned by GetCommitToUpload() is uploaded.
+  void OnCommitUploaded();
+
  private:
-  // Uploads the given object.
-  void UploadObject(std::unique_ptr<const storage::Object> object);
+  // Reads and starts uploading the next pending objects, as long as the
+  // objects in flight allow it.
+  void UploadNextObjects();
+
+  // Collects the values of the LAZY entries of the commit in
+  // |lazy_object_ids_|, then starts uploading the objects.
+  void FindLazyValues();
+
+  // Uploads the given object, retrying at most |remaining_attempts| - 1 times
+  // on failure.
+  void UploadObject(std::unique_ptr<const storage::Object> object,
+                    int remaining_attempts);
+
+  // Adds the given object to the bundle of the current upload attempt.
+  void AddToBundle(std::unique_ptr<const storage::Object> object);
+
+  // Called when an object is uploaded or bundled.
+  void OnObjectDone();
+
+  // Uploads the bundle of the current upload attempt, if any, retrying at most
+  // |remaining_attempts| - 1 times on failure, then reports the objects as
+  // uploaded.
+  void UploadBundle(int remaining_attempts);
+
+  // Marks the objects of the bundle and the commit as synced, then calls
+  // |on_done_|.
+  void MarkCommitSynced();
+
+  // Marks the current upload attempt as failed, if it is not already.
+  void HandleError();
+
+  // Called when all objects of the current upload attempt are uploaded.
+  void OnObjectsUploaded();
 
   // Uploads the commit.
   void UploadCommit();
@@ -59,6 +135,8 @@ class CommitUpload {
   std::unique_ptr<const storage::Commit> commit_;
   ftl::Closure on_done_;
   ftl::Closure on_error_;
+  const size_t max_concurrent_uploads_;
+  const uint64_t max_in_flight_bytes_;
   // Incremented on every upload attempt / Start() call. Tracked to detect stale
   // callbacks executing for the previous upload attempts.
   int current_attempt_ = 0;
@@ -68,9 +146,31 @@ class CommitUpload {
   // attempt. This is not reset after completing the upload, so that it's an
   // error to call .Start() on an upload that is complete.
   bool active_or_finished_ = false;
+  // If set, the upload of the commit is deferred to the client, and this is
+  // called once the objects are uploaded.
+  ftl::Closure on_objects_uploaded_;
+  // Objects of at most this size are bundled, if |bundle_small_objects_| is
+  // set.
+  bool bundle_small_objects_ = false;
+  uint64_t max_bundled_object_size_ = 0;
+  // Data of the bundle of the current upload attempt, and locations of the
+  // objects in it. The id of the bundle is only set once it is uploaded.
+  std::string bundle_data_;
+  std::map<cloud_provider::ObjectId, cloud_provider::ObjectLocation>
+      bundled_objects_;
+  // Values of the LAZY entries of the commit, which are not bundled.
+  std::set<storage::ObjectId> lazy_object_ids_;
+  // True iff all objects of the current upload attempt are uploaded.
+  bool objects_uploaded_ = false;
   // Count of the remaining objects to be uploaded in the current upload
   // attempt.
   int objects_to_upload_ = 0;
+  // Ids of the objects not yet read from storage in the current upload attempt.
+  std::vector<storage::ObjectId> pending_object_ids_;
+  // Number of objects being read or uploaded, and total size of the ones being
+  // uploaded, in the current upload attempt.
+  size_t objects_in_flight_ = 0;
+  uint64_t bytes_in_flight_ = 0;
 
   FTL_DISALLOW_COPY_AND_ASSIGN(CommitUpload);
 };
@@ -4,12 +4,14 @@
 
 #include "apps/ledger/src/cloud_sync/impl/commit_upload.h"
 
+#include <algorithm>
 #include <functional>
 #include <unordered_map>
 #include <utility>
 
 #include "apps/ledger/src/cloud_provider/public/cloud_provider.h"
 #include "apps/ledger/src/cloud_provider/test/cloud_provider_empty_impl.h"
+#include "apps/ledger/src/glue/crypto/hash.h"
 #include "apps/ledger/src/storage/public/commit.h"
 #include "apps/ledger/src/storage/public/object.h"
 #include "apps/ledger/src/storage/public/page_storage.h"
@@ -52,12 +54,18 @@ class TestObject : public storage::Object {
     return storage::Status::OK;
   }
 
+  storage::Status GetSize(uint64_t* size) const override {
+    *size = data.size();
+    return storage::Status::OK;
+  }
+
   storage::ObjectId id;
   std::string data;
 };
 
 // Fake implementation of storage::PageStorage. Injects the data that
-// CommitUpload asks about: page id and unsynced objects to be uploaded.
+// CommitUpload asks about: page id, unsynced objects to be uploaded and entries
+// of the commit.
 // Registers the reported results of the upload: commits and objects marked as
 // synced.
 class TestPageStorage : public storage::test::PageStorageEmptyImpl {
@@ -86,19 +94,36 @@ class TestPageStorage : public storage::test::PageStorageEmptyImpl {
              std::move(unsynced_objects_to_return[object_id.ToString()]));
   }
 
-  storage::Status MarkObjectSynced(storage::ObjectIdView object_id) override {
+  void GetCommitContents(
+      const storage::Commit& commit,
+      std::string min_key,
+      std::function<bool(storage::Entry)> on_next,
+      std::function<void(storage::Status)> on_done) override {
+    for (const auto& entry : entries_to_return) {
+      if (!on_next(entry)) {
+        break;
+      }
+    }
+    on_done(storage::Status::OK);
+  }
+
+  void MarkObjectSynced(
+      storage::ObjectIdView object_id,
+      std::function<void(storage::Status)> callback) override {
     objects_marked_as_synced.insert(object_id.ToString());
-    return storage::Status::OK;
+    callback(storage::Status::OK);
   }
 
-  storage::Status MarkCommitSynced(
-      const storage::CommitId& commit_id) override {
+  void MarkCommitSynced(
+      const storage::CommitId& commit_id,
+      std::function<void(storage::Status)> callback) override {
     commits_marked_as_synced.insert(commit_id);
-    return storage::Status::OK;
+    callback(storage::Status::OK);
   }
 
   std::unordered_map<storage::ObjectId, std::unique_ptr<const TestObject>>
       unsynced_objects_to_return;
+  std::vector<storage::Entry> entries_to_return;
   std::set<storage::ObjectId> objects_marked_as_synced;
   std::set<storage::CommitId> commits_marked_as_synced;
 };
@@ -129,11 +154,27 @@ class TestCloudProvider : public cloud_provider::test::CloudProviderEmptyImpl {
     ASSERT_TRUE(mtl::StringFromVmo(std::move(data), &received_data));
     received_objects.insert(
         std::make_pair(object_id.ToString(), received_data));
-    message_loop_->task_runner()->PostTask(
-        [this, callback]() { callback(object_status_to_return); });
+    add_object_calls++;
+    objects_in_flight++;
+    max_objects_in_flight = std::max(max_objects_in_flight, objects_in_flight);
+    bool fail = object_uploads_to_fail > 0;
+    if (fail) {
+      object_uploads_to_fail--;
+    }
+    message_loop_->task_runner()->PostTask([this, callback, fail]() {
+      objects_in_flight--;
+      callback(fail ? cloud_provider::Status::NETWORK_ERROR
+                    : object_status_to_return);
+    });
   }
 
   cloud_provider::Status object_status_to_return = cloud_provider::Status::OK;
+  // Number of the next object uploads that fail regardless of
+  // |object_status_to_return|.
+  unsigned int object_uploads_to_fail = 0u;
+  unsigned int add_object_calls = 0u;
+  unsigned int objects_in_flight = 0u;
+  unsigned int max_objects_in_flight = 0u;
   cloud_provider::Status commit_status_to_return = cloud_provider::Status::OK;
   std::vector<cloud_provider::Commit> received_commits;
   std::map<cloud_provider::ObjectId, std::string> received_objects;
@@ -235,6 +276,52 @@ TEST_F(CommitUploadTest, WithObjects) {
   EXPECT_EQ(1u, storage_.objects_marked_as_synced.count("obj_id2"));
 }
 
+// Test an upload whose commit upload is deferred to the client.
+TEST_F(CommitUploadTest, DeferredCommitUpload) {
+  auto commit = std::make_unique<TestCommit>();
+  commit->id = "id";
+  commit->storage_bytes = "content";
+
+  storage_.unsynced_objects_to_return["obj_id1"] =
+      std::make_unique<TestObject>("obj_id1", "obj_data1");
+
+  auto done_calls = 0u;
+  auto error_calls = 0u;
+  auto objects_uploaded_calls = 0u;
+  CommitUpload commit_upload(&storage_, &cloud_provider_, std::move(commit),
+                             [&done_calls] { done_calls++; },
+                             [this, &error_calls] {
+                               error_calls++;
+                               message_loop_.PostQuitTask();
+                             });
+  commit_upload.DeferCommitUpload([this, &objects_uploaded_calls] {
+    objects_uploaded_calls++;
+    message_loop_.PostQuitTask();
+  });
+
+  EXPECT_FALSE(commit_upload.IsCommitReady());
+  commit_upload.Start();
+  message_loop_.Run();
+  EXPECT_EQ(1u, objects_uploaded_calls);
+  EXPECT_EQ(0u, error_calls);
+  EXPECT_TRUE(commit_upload.IsCommitReady());
+
+  // The objects are uploaded, but the commit is left to the client.
+  EXPECT_TRUE(cloud_provider_.received_commits.empty());
+  EXPECT_EQ(1u, cloud_provider_.received_objects.size());
+  EXPECT_TRUE(storage_.commits_marked_as_synced.empty());
+  EXPECT_EQ(0u, done_calls);
+
+  cloud_provider::Commit commit_to_upload = commit_upload.GetCommitToUpload();
+  EXPECT_EQ("id", commit_to_upload.id);
+  EXPECT_EQ("content", commit_to_upload.content);
+
+  commit_upload.OnCommitUploaded();
+  EXPECT_EQ(1u, done_calls);
+  EXPECT_EQ(1u, storage_.commits_marked_as_synced.size());
+  EXPECT_EQ(1u, storage_.commits_marked_as_synced.count("id"));
+}
+
 // Test un upload that fails on uploading objects.
 TEST_F(CommitUploadTest, FailedObjectUpload) {
   auto commit = std::make_unique<TestCommit>();
@@ -375,6 +462,225 @@ TEST_F(CommitUploadTest, ErrorAndRetry) {
   EXPECT_EQ(1u, storage_.objects_marked_as_synced.count("obj_id2"));
 }
 
+// Test that the number of objects uploaded concurrently is bounded.
+TEST_F(CommitUploadTest, BoundedConcurrentUploads) {
+  auto commit = std::make_unique<TestCommit>();
+  commit->id = "id";
+  commit->storage_bytes = "content";
+
+  for (int i = 0; i < 10; ++i) {
+    std::string id = "obj_id" + std::to_string(i);
+    storage_.unsynced_objects_to_return[id] =
+        std::make_unique<TestObject>(id, "obj_data" + std::to_string(i));
+  }
+
+  auto done_calls = 0u;
+  auto error_calls = 0u;
+  CommitUpload commit_upload(&storage_, &cloud_provider_, std::move(commit),
+                             [this, &done_calls] {
+                               done_calls++;
+                               message_loop_.PostQuitTask();
+                             },
+                             [this, &error_calls] {
+                               error_calls++;
+                               message_loop_.PostQuitTask();
+                             },
+                             3u, 1024u);
+
+  commit_upload.Start();
+  message_loop_.Run();
+  EXPECT_EQ(1u, done_calls);
+  EXPECT_EQ(0u, error_calls);
+
+  EXPECT_EQ(3u, cloud_provider_.max_objects_in_flight);
+  EXPECT_EQ(10u, cloud_provider_.received_objects.size());
+  EXPECT_EQ(10u, storage_.objects_marked_as_synced.size());
+  EXPECT_EQ(1u, cloud_provider_.received_commits.size());
+  EXPECT_EQ(1u, storage_.commits_marked_as_synced.count("id"));
+}
+
+// Test that no new object is uploaded while the objects in flight exceed the
+// byte budget.
+TEST_F(CommitUploadTest, BoundedInFlightBytes) {
+  auto commit = std::make_unique<TestCommit>();
+  commit->id = "id";
+  commit->storage_bytes = "content";
+
+  for (int i = 0; i < 5; ++i) {
+    std::string id = "obj_id" + std::to_string(i);
+    storage_.unsynced_objects_to_return[id] =
+        std::make_unique<TestObject>(id, std::string(100, 'a'));
+  }
+
+  auto done_calls = 0u;
+  auto error_calls = 0u;
+  CommitUpload commit_upload(&storage_, &cloud_provider_, std::move(commit),
+                             [this, &done_calls] {
+                               done_calls++;
+                               message_loop_.PostQuitTask();
+                             },
+                             [this, &error_calls] {
+                               error_calls++;
+                               message_loop_.PostQuitTask();
+                             },
+                             10u, 100u);
+
+  commit_upload.Start();
+  message_loop_.Run();
+  EXPECT_EQ(1u, done_calls);
+  EXPECT_EQ(0u, error_calls);
+
+  EXPECT_EQ(1u, cloud_provider_.max_objects_in_flight);
+  EXPECT_EQ(5u, storage_.objects_marked_as_synced.size());
+}
+
+// Test that a failed object upload is retried without failing the whole
+// upload.
+TEST_F(CommitUploadTest, ObjectUploadRetry) {
+  auto commit = std::make_unique<TestCommit>();
+  commit->id = "id";
+  commit->storage_bytes = "content";
+
+  storage_.unsynced_objects_to_return["obj_id1"] =
+      std::make_unique<TestObject>("obj_id1", "obj_data1");
+
+  auto done_calls = 0u;
+  auto error_calls = 0u;
+  CommitUpload commit_upload(&storage_, &cloud_provider_, std::move(commit),
+                             [this, &done_calls] {
+                               done_calls++;
+                               message_loop_.PostQuitTask();
+                             },
+                             [this, &error_calls] {
+                               error_calls++;
+                               message_loop_.PostQuitTask();
+                             });
+
+  cloud_provider_.object_uploads_to_fail = 1u;
+  commit_upload.Start();
+  message_loop_.Run();
+  EXPECT_EQ(1u, done_calls);
+  EXPECT_EQ(0u, error_calls);
+
+  EXPECT_EQ(2u, cloud_provider_.add_object_calls);
+  EXPECT_EQ(1u, storage_.objects_marked_as_synced.count("obj_id1"));
+  EXPECT_EQ(1u, storage_.commits_marked_as_synced.count("id"));
+}
+
+// Test an upload packing the small objects in a bundle.
+TEST_F(CommitUploadTest, BundledObjects) {
+  auto commit = std::make_unique<TestCommit>();
+  commit->id = "id";
+  commit->storage_bytes = "content";
+
+  storage_.unsynced_objects_to_return["obj_id1"] =
+      std::make_unique<TestObject>("obj_id1", "obj_data1");
+  storage_.unsynced_objects_to_return["obj_id2"] =
+      std::make_unique<TestObject>("obj_id2", "obj_data2");
+  storage_.unsynced_objects_to_return["obj_id3"] =
+      std::make_unique<TestObject>("obj_id3", "large_obj_data3");
+
+  auto done_calls = 0u;
+  auto error_calls = 0u;
+  auto objects_uploaded_calls = 0u;
+  CommitUpload commit_upload(&storage_, &cloud_provider_, std::move(commit),
+                             [&done_calls] { done_calls++; },
+                             [this, &error_calls] {
+                               error_calls++;
+                               message_loop_.PostQuitTask();
+                             });
+  commit_upload.BundleSmallObjects(10u);
+  commit_upload.DeferCommitUpload([this, &objects_uploaded_calls] {
+    objects_uploaded_calls++;
+    message_loop_.PostQuitTask();
+  });
+
+  commit_upload.Start();
+  message_loop_.Run();
+  EXPECT_EQ(1u, objects_uploaded_calls);
+  EXPECT_EQ(0u, error_calls);
+
+  // The large object is uploaded on its own, the small ones in a bundle stored
+  // under the hash of its content.
+  EXPECT_EQ(2u, cloud_provider_.add_object_calls);
+  EXPECT_EQ("large_obj_data3", cloud_provider_.received_objects["obj_id3"]);
+  cloud_provider::Commit commit_to_upload = commit_upload.GetCommitToUpload();
+  const auto& bundled_objects = commit_to_upload.bundled_objects;
+  ASSERT_EQ(2u, bundled_objects.size());
+  const cloud_provider::ObjectLocation& location1 =
+      bundled_objects.at("obj_id1");
+  const cloud_provider::ObjectLocation& location2 =
+      bundled_objects.at("obj_id2");
+  EXPECT_EQ(location1.bundle_id, location2.bundle_id);
+  ASSERT_EQ(1u, cloud_provider_.received_objects.count(location1.bundle_id));
+  const std::string& bundle =
+      cloud_provider_.received_objects[location1.bundle_id];
+  EXPECT_EQ(glue::SHA256Hash(bundle.data(), bundle.size()),
+            location1.bundle_id);
+  EXPECT_EQ(18u, bundle.size());
+  EXPECT_EQ("obj_data1", bundle.substr(location1.offset, location1.size));
+  EXPECT_EQ("obj_data2", bundle.substr(location2.offset, location2.size));
+
+  // The bundled objects are only marked as synced with the commit.
+  EXPECT_EQ(1u, storage_.objects_marked_as_synced.size());
+  EXPECT_EQ(1u, storage_.objects_marked_as_synced.count("obj_id3"));
+
+  commit_upload.OnCommitUploaded();
+  EXPECT_EQ(1u, done_calls);
+  EXPECT_EQ(3u, storage_.objects_marked_as_synced.size());
+  EXPECT_EQ(1u, storage_.commits_marked_as_synced.count("id"));
+}
+
+// Verifies that the values of LAZY entries are uploaded on their own, so that
+// they can be retrieved on demand.
+TEST_F(CommitUploadTest, LazyValuesNotBundled) {
+  auto commit = std::make_unique<TestCommit>();
+  commit->id = "id";
+  commit->storage_bytes = "content";
+
+  storage_.unsynced_objects_to_return["obj_id1"] =
+      std::make_unique<TestObject>("obj_id1", "obj_data1");
+  storage_.unsynced_objects_to_return["obj_id2"] =
+      std::make_unique<TestObject>("obj_id2", "obj_data2");
+  storage_.unsynced_objects_to_return["obj_id3"] =
+      std::make_unique<TestObject>("obj_id3", "obj_data3");
+  storage_.entries_to_return.push_back(
+      storage::Entry{"key1", "obj_id1", storage::KeyPriority::LAZY});
+  storage_.entries_to_return.push_back(
+      storage::Entry{"key2", "obj_id2", storage::KeyPriority::EAGER});
+
+  auto objects_uploaded_calls = 0u;
+  auto error_calls = 0u;
+  CommitUpload commit_upload(&storage_, &cloud_provider_, std::move(commit),
+                             [] {},
+                             [this, &error_calls] {
+                               error_calls++;
+                               message_loop_.PostQuitTask();
+                             });
+  commit_upload.BundleSmallObjects(10u);
+  commit_upload.DeferCommitUpload([this, &objects_uploaded_calls] {
+    objects_uploaded_calls++;
+    message_loop_.PostQuitTask();
+  });
+
+  commit_upload.Start();
+  message_loop_.Run();
+  EXPECT_EQ(1u, objects_uploaded_calls);
+  EXPECT_EQ(0u, error_calls);
+
+  // The lazy value is uploaded under its own id, the other objects in a
+  // bundle.
+  EXPECT_EQ(2u, cloud_provider_.add_object_calls);
+  EXPECT_EQ("obj_data1", cloud_provider_.received_objects["obj_id1"]);
+  EXPECT_EQ(1u, storage_.objects_marked_as_synced.count("obj_id1"));
+  cloud_provider::Commit commit_to_upload = commit_upload.GetCommitToUpload();
+  const auto& bundled_objects = commit_to_upload.bundled_objects;
+  EXPECT_EQ(2u, bundled_objects.size());
+  EXPECT_EQ(0u, bundled_objects.count("obj_id1"));
+  EXPECT_EQ(1u, bundled_objects.count("obj_id2"));
+  EXPECT_EQ(1u, bundled_objects.count("obj_id3"));
+}
+
 }  // namespace
 
 }  // namespace cloud_sync
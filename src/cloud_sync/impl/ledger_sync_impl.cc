@@ -82,9 +82,12 @@ std::unique_ptr<PageSyncContext> LedgerSyncImpl::CreatePageContext(
       GetGcsPrefixForPage(app_gcs_prefix_, page_storage->GetId()));
   result->cloud_provider = std::make_unique<cloud_provider::CloudProviderImpl>(
       result->firebase.get(), result->cloud_storage.get());
-  result->page_sync = std::make_unique<PageSyncImpl>(
+  auto page_sync = std::make_unique<PageSyncImpl>(
       environment_->main_runner(), page_storage, result->cloud_provider.get(),
       std::make_unique<backoff::ExponentialBackoff>(), error_callback);
+  // A device joining a page only needs its latest state to start using it.
+  page_sync->EnableShallowInitialSync();
+  result->page_sync = std::move(page_sync);
   return result;
 }
 
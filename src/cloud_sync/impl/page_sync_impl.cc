@@ -15,6 +15,11 @@
 
 namespace cloud_sync {
 
+constexpr size_t PageSyncImpl::kMaxConcurrentCommitUploads;
+constexpr size_t PageSyncImpl::kMaxCommitsPerBatch;
+constexpr size_t PageSyncImpl::kBacklogPageSize;
+constexpr uint64_t PageSyncImpl::kMaxBundledObjectSize;
+
 PageSyncImpl::PageSyncImpl(ftl::RefPtr<ftl::TaskRunner> task_runner,
                            storage::PageStorage* storage,
                            cloud_provider::CloudProvider* cloud_provider,
@@ -25,6 +30,7 @@ PageSyncImpl::PageSyncImpl(ftl::RefPtr<ftl::TaskRunner> task_runner,
       cloud_provider_(cloud_provider),
       backoff_(std::move(backoff)),
       on_error_(on_error),
+      bundle_download_(storage, cloud_provider),
       weak_factory_(this) {
   FTL_DCHECK(storage);
   FTL_DCHECK(cloud_provider);
@@ -40,6 +46,11 @@ PageSyncImpl::~PageSyncImpl() {
   }
 }
 
+void PageSyncImpl::EnableShallowInitialSync() {
+  FTL_DCHECK(!started_);
+  shallow_initial_sync_ = true;
+}
+
 void PageSyncImpl::Start() {
   FTL_DCHECK(!started_);
   started_ = true;
@@ -48,10 +59,10 @@ void PageSyncImpl::Start() {
   DownloadBacklog();
 
   // Retrieve the backlog of the existing unsynced commits and enqueue them for
-  // upload.
-  // TODO(ppi): either switch to a paginating API or (better?) ensure that long
-  // backlogs of local commits are squashed in storage, as otherwise the list of
-  // commits can be possibly very big.
+  // upload. Storage squashes the linear chains of unsynced commits when the
+  // page is opened, which keeps this backlog short after an offline period.
+  // The commits made while the page stays open are not squashed: they are all
+  // uploaded, batched together when possible.
   storage_->GetUnsyncedCommits(
       [this](storage::Status status,
              std::vector<std::unique_ptr<const storage::Commit>> commits) {
@@ -81,6 +92,17 @@ bool PageSyncImpl::IsIdle() {
          !batch_download_ && commits_to_download_.empty();
 }
 
+void PageSyncImpl::SetOnDownloadIdle(ftl::Closure on_download_idle) {
+  FTL_DCHECK(!on_download_idle_);
+  FTL_DCHECK(!started_);
+  on_download_idle_ = std::move(on_download_idle);
+}
+
+bool PageSyncImpl::IsDownloadIdle() {
+  return !batch_download_ && commits_to_download_.empty() &&
+         !backlog_page_pending_;
+}
+
 void PageSyncImpl::SetOnBacklogDownloaded(ftl::Closure on_backlog_downloaded) {
   FTL_DCHECK(!on_backlog_downloaded_);
   FTL_DCHECK(!started_);
@@ -129,6 +151,45 @@ void PageSyncImpl::GetObject(
   });
 }
 
+void PageSyncImpl::GetCommit(
+    storage::CommitIdView commit_id,
+    std::function<void(storage::Status status, std::string storage_bytes)>
+        callback) {
+  cloud_provider_->GetCommit(commit_id.ToString(), [
+    this, commit_id = commit_id.ToString(), callback
+  ](cloud_provider::Status status, cloud_provider::Commit commit) {
+    if (status == cloud_provider::Status::NETWORK_ERROR) {
+      FTL_LOG(WARNING)
+          << "GetCommit() failed due to a connection error, retrying.";
+      Retry([
+        this, commit_id = std::move(commit_id), callback = std::move(callback)
+      ] { GetCommit(commit_id, callback); });
+      return;
+    }
+
+    backoff_->Reset();
+    if (status != cloud_provider::Status::OK) {
+      FTL_LOG(WARNING) << "Fetching remote commit failed with status: "
+                       << status;
+      callback(storage::Status::IO_ERROR, "");
+      return;
+    }
+
+    // The objects bundled with the commit can't be retrieved from the cloud
+    // on their own: add them to storage along with the commit.
+    bundle_download_.AddBundledObjects(
+        commit.bundled_objects, ftl::MakeCopyable([
+          callback, content = std::move(commit.content)
+        ](storage::Status status) mutable {
+          if (status != storage::Status::OK) {
+            callback(status, "");
+            return;
+          }
+          callback(storage::Status::OK, std::move(content));
+        }));
+  });
+}
+
 void PageSyncImpl::OnRemoteCommit(cloud_provider::Commit commit,
                                   std::string timestamp) {
   std::vector<cloud_provider::Record> records;
@@ -169,48 +230,88 @@ void PageSyncImpl::DownloadBacklog() {
     HandleError("Failed to retrieve the sync metadata.");
     return;
   }
+  // Only the first download of the backlog, before any remote commit was added
+  // to storage, is shallow.
+  shallow_backlog_ =
+      shallow_initial_sync_ && status == storage::Status::NOT_FOUND;
 
-  // TODO(ppi): handle pagination when the response is huge.
-  cloud_provider_->GetCommits(
-      std::move(last_commit_ts),
-      [this](cloud_provider::Status cloud_status,
-             std::vector<cloud_provider::Record> records) {
-        if (cloud_status != cloud_provider::Status::OK) {
-          // Fetching the remote commits failed, schedule a retry.
-          FTL_LOG(WARNING)
-              << "Fetching the backlog of remote objects failed due to a "
-              << "connection error, status: " << cloud_status << ", retrying.";
-          Retry([this] { DownloadBacklog(); });
-          return;
-        }
-        backoff_->Reset();
-
-        if (records.empty()) {
-          // If there is no remote commits to add, announce that we're done.
-          BacklogDownloaded();
-        } else {
-          // If not, fire the backlog download callback when the remote commits
-          // are downloaded.
-          DownloadBatch(std::move(records), [this] { BacklogDownloaded(); });
-        }
+  DownloadBacklogPage(std::move(last_commit_ts));
+}
 
-        download_list_retrieved_ = true;
-        CheckIdle();
-        SetRemoteWatcher();
+void PageSyncImpl::DownloadBacklogPage(std::string min_timestamp) {
+  backlog_page_pending_ = true;
+  cloud_provider_->GetCommitsPage(min_timestamp, kBacklogPageSize, [
+    this, min_timestamp
+  ](cloud_provider::Status cloud_status,
+    std::vector<cloud_provider::Record> records, std::string next_timestamp) {
+    if (cloud_status != cloud_provider::Status::OK) {
+      // Fetching the remote commits failed, schedule a retry.
+      FTL_LOG(WARNING)
+          << "Fetching the backlog of remote objects failed due to a "
+          << "connection error, status: " << cloud_status << ", retrying.";
+      Retry([this, min_timestamp] { DownloadBacklogPage(min_timestamp); });
+      return;
+    }
+    backoff_->Reset();
+    backlog_page_pending_ = false;
+
+    if (shallow_backlog_) {
+      // All the commits of a shallow backlog are needed to find the latest
+      // ones: keep them until the last page is retrieved.
+      std::move(std::begin(records), std::end(records),
+                std::back_inserter(shallow_backlog_records_));
+      if (!next_timestamp.empty()) {
+        DownloadBacklogPage(next_timestamp);
+        return;
+      }
+      records = std::move(shallow_backlog_records_);
+      shallow_backlog_records_.clear();
+    }
+
+    if (!next_timestamp.empty()) {
+      // Download this page, then retrieve the next one. The pages are
+      // downloaded one after the other, so that only one page of commits is
+      // held in memory.
+      FTL_DCHECK(!records.empty());
+      DownloadBatch(std::move(records), [ this, next_timestamp ] {
+        DownloadBacklogPage(next_timestamp);
       });
+      return;
+    }
+
+    if (records.empty()) {
+      // If there is no remote commits to add, announce that we're done.
+      BacklogDownloaded();
+      CheckDownloadIdle();
+    } else {
+      // If not, fire the backlog download callback when the remote commits
+      // are downloaded.
+      DownloadBatch(std::move(records), [this] { BacklogDownloaded(); },
+                    shallow_backlog_ ? BatchDownload::Mode::SHALLOW
+                                     : BatchDownload::Mode::FULL);
+    }
+    shallow_backlog_ = false;
+
+    download_list_retrieved_ = true;
+    CheckIdle();
+    SetRemoteWatcher();
+  });
 }
 
 void PageSyncImpl::DownloadBatch(std::vector<cloud_provider::Record> records,
-                                 ftl::Closure on_done) {
+                                 ftl::Closure on_done,
+                                 BatchDownload::Mode mode) {
   FTL_DCHECK(!batch_download_);
   batch_download_ = std::make_unique<BatchDownload>(
-      storage_, std::move(records), [ this, on_done = std::move(on_done) ] {
+      storage_, cloud_provider_, std::move(records),
+      [ this, on_done = std::move(on_done) ] {
         if (on_done) {
           on_done();
         }
         batch_download_.reset();
 
         if (commits_to_download_.empty()) {
+          CheckDownloadIdle();
           CheckIdle();
           return;
         }
@@ -218,7 +319,8 @@ void PageSyncImpl::DownloadBatch(std::vector<cloud_provider::Record> records,
         commits_to_download_.clear();
         DownloadBatch(std::move(commits), nullptr);
       },
-      [this] { HandleError("Failed to persist a remote commit in storage"); });
+      [this] { HandleError("Failed to persist a remote commit in storage"); },
+      mode);
   batch_download_->Start();
 }
 
@@ -238,35 +340,113 @@ void PageSyncImpl::SetRemoteWatcher() {
 
 void PageSyncImpl::EnqueueUpload(
     std::unique_ptr<const storage::Commit> commit) {
-  // If there are no commits currently being uploaded, start the upload after
-  // enqueing this one.
-  const bool start_after_adding = commit_uploads_.empty();
-
-  commit_uploads_.emplace(
+  uint64_t upload_id = first_upload_id_ + commit_uploads_.size();
+  commit_uploads_.emplace_back(
       storage_, cloud_provider_, std::move(commit),
-      [this] {
-        // Upload succeeded, reset the backoff delay.
-        backoff_->Reset();
-
-        commit_uploads_.pop();
-        if (!commit_uploads_.empty()) {
-          commit_uploads_.front().Start();
-        } else {
-          CheckIdle();
-        }
-      },
-      [this] {
+      [this, upload_id] { OnUploadDone(upload_id); },
+      [this, upload_id] {
         FTL_LOG(WARNING)
             << "Uploading a commit and its associated objects failed "
             << "due to a connection error, retrying.";
-        Retry([this] { commit_uploads_.front().Start(); });
+        Retry([this, upload_id] {
+          FTL_DCHECK(upload_id >= first_upload_id_);
+          commit_uploads_[upload_id - first_upload_id_].Start();
+        });
       });
+  commit_uploads_.back().BundleSmallObjects(kMaxBundledObjectSize);
 
-  if (start_after_adding) {
-    commit_uploads_.front().Start();
+  StartPendingUploads();
+}
+
+void PageSyncImpl::StartPendingUploads() {
+  while (started_uploads_ < commit_uploads_.size() &&
+         uploads_with_pending_objects_ < kMaxConcurrentCommitUploads) {
+    CommitUpload& upload = commit_uploads_[started_uploads_];
+    // Commits are uploaded by UploadReadyCommits(), so that they are uploaded
+    // in order and batched together when several of them are ready.
+    upload.DeferCommitUpload([this] {
+      uploads_with_pending_objects_--;
+      StartPendingUploads();
+      UploadReadyCommits();
+    });
+    started_uploads_++;
+    uploads_with_pending_objects_++;
+    upload.Start();
   }
 }
 
+void PageSyncImpl::UploadReadyCommits() {
+  if (commits_upload_in_progress_) {
+    return;
+  }
+
+  // The uploads whose commit is already uploaded stay in the queue until their
+  // commit is marked as synced: skip them.
+  std::vector<cloud_provider::Commit> commits;
+  size_t next_upload = uploaded_commits_;
+  while (next_upload < started_uploads_ &&
+         commits.size() < kMaxCommitsPerBatch &&
+         commit_uploads_[next_upload].IsCommitReady()) {
+    commits.push_back(commit_uploads_[next_upload].GetCommitToUpload());
+    next_upload++;
+  }
+  if (commits.empty()) {
+    return;
+  }
+
+  commits_upload_in_progress_ = true;
+  size_t batch_size = commits.size();
+  auto on_uploaded = [this, batch_size](cloud_provider::Status status) {
+    if (status != cloud_provider::Status::OK) {
+      FTL_LOG(WARNING) << "Uploading a batch of " << batch_size
+                       << " commits failed due to a connection error, "
+                       << "status: " << status << ", retrying.";
+      Retry([this] {
+        commits_upload_in_progress_ = false;
+        UploadReadyCommits();
+      });
+      return;
+    }
+
+    // Each upload pops itself from the queue through OnUploadDone() once its
+    // commit is marked as synced, which may happen synchronously: collect the
+    // uploads of the batch first.
+    std::vector<CommitUpload*> uploads;
+    for (size_t i = 0; i < batch_size; ++i) {
+      uploads.push_back(&commit_uploads_[uploaded_commits_ + i]);
+    }
+    uploaded_commits_ += batch_size;
+    for (CommitUpload* upload : uploads) {
+      upload->OnCommitUploaded();
+    }
+    commits_upload_in_progress_ = false;
+    UploadReadyCommits();
+  };
+
+  if (commits.size() == 1) {
+    cloud_provider_->AddCommit(commits.front(), on_uploaded);
+  } else {
+    cloud_provider_->AddCommits(std::move(commits), on_uploaded);
+  }
+}
+
+void PageSyncImpl::OnUploadDone(uint64_t upload_id) {
+  FTL_DCHECK(upload_id == first_upload_id_);
+  FTL_DCHECK(uploaded_commits_ > 0);
+  // Upload succeeded, reset the backoff delay.
+  backoff_->Reset();
+
+  commit_uploads_.pop_front();
+  first_upload_id_++;
+  started_uploads_--;
+  uploaded_commits_--;
+  if (commit_uploads_.empty()) {
+    CheckIdle();
+    return;
+  }
+  StartPendingUploads();
+}
+
 void PageSyncImpl::Retry(ftl::Closure callable) {
   task_runner_->PostDelayedTask(
       [
@@ -298,6 +478,12 @@ void PageSyncImpl::CheckIdle() {
   }
 }
 
+void PageSyncImpl::CheckDownloadIdle() {
+  if (on_download_idle_ && IsDownloadIdle()) {
+    on_download_idle_();
+  }
+}
+
 void PageSyncImpl::BacklogDownloaded() {
   if (on_backlog_downloaded_) {
     on_backlog_downloaded_();
@@ -5,13 +5,15 @@
 #ifndef APPS_LEDGER_SRC_CLOUD_SYNC_IMPL_PAGE_SYNC_IMPL_H_
 #define APPS_LEDGER_SRC_CLOUD_SYNC_IMPL_PAGE_SYNC_IMPL_H_
 
+#include <deque>
 #include <functional>
-#include <queue>
+#include <string>
 
 #include "apps/ledger/src/backoff/backoff.h"
 #include "apps/ledger/src/cloud_provider/public/cloud_provider.h"
 #include "apps/ledger/src/cloud_provider/public/commit_watcher.h"
 #include "apps/ledger/src/cloud_sync/impl/batch_download.h"
+#include "apps/ledger/src/cloud_sync/impl/bundle_download.h"
 #include "apps/ledger/src/cloud_sync/impl/commit_upload.h"
 #include "apps/ledger/src/cloud_sync/public/page_sync.h"
 #include "apps/ledger/src/storage/public/commit_watcher.h"
@@ -28,13 +30,22 @@ namespace cloud_sync {
 //
 // Contract: commits are uploaded in the same order as storage delivers them.
 // The backlog of unsynced commits is uploaded first, then we upload commits
-// delivered through storage watcher in the notification order.
+// delivered through storage watcher in the notification order. The objects of
+// up to |kMaxConcurrentCommitUploads| commits are uploaded concurrently, but
+// each commit is only uploaded once the previous one is. The commits whose
+// objects are uploaded while a previous commit is being uploaded are then
+// uploaded together, in a single CloudProvider::AddCommits() call.
 //
 // Conversely for the remote commits: the backlog of remote commits is
 // downloaded first, then a cloud watcher is set to track new remote commits
 // appearing in the cloud provider. Remote commits are added to storage in the
 // order in which they were added to the cloud provided.
 //
+// When shallow initial sync is enabled, the first download of the backlog only
+// adds the latest commits to storage, along with their objects: the history of
+// the page is retrieved from the cloud provider when it is needed, e.g. to find
+// the common ancestor of a merge.
+//
 // In order to track which remote commits were already fetched, we keep track of
 // the server-side timestamp of the last commit we added to storage. As this
 // information needs to be persisted through reboots, we store the timestamp
@@ -54,6 +65,15 @@ class PageSyncImpl : public PageSync,
                      public storage::PageSyncDelegate,
                      public cloud_provider::CommitWatcher {
  public:
+  // Maximal number of commits whose objects are uploaded concurrently.
+  static constexpr size_t kMaxConcurrentCommitUploads = 4;
+  // Maximal number of commits uploaded in a single batch.
+  static constexpr size_t kMaxCommitsPerBatch = 100;
+  // Number of remote commits retrieved at once when downloading the backlog.
+  static constexpr size_t kBacklogPageSize = 500;
+  // Maximal size of the objects packed in bundles when uploading a commit.
+  static constexpr uint64_t kMaxBundledObjectSize = 4096;
+
   PageSyncImpl(ftl::RefPtr<ftl::TaskRunner> task_runner,
                storage::PageStorage* storage,
                cloud_provider::CloudProvider* cloud_provider,
@@ -61,6 +81,10 @@ class PageSyncImpl : public PageSync,
                ftl::Closure on_error);
   ~PageSyncImpl() override;
 
+  // Enables the shallow initial sync of the page. Must be called before
+  // Start().
+  void EnableShallowInitialSync();
+
   // PageSync:
   void Start() override;
 
@@ -68,6 +92,10 @@ class PageSyncImpl : public PageSync,
 
   bool IsIdle() override;
 
+  void SetOnDownloadIdle(ftl::Closure on_download_idle) override;
+
+  bool IsDownloadIdle() override;
+
   void SetOnBacklogDownloaded(ftl::Closure on_backlog_downloaded) override;
 
   // storage::CommitWatcher:
@@ -80,6 +108,10 @@ class PageSyncImpl : public PageSync,
                  std::function<void(storage::Status status,
                                     uint64_t size,
                                     mx::socket data)> callback) override;
+  void GetCommit(storage::CommitIdView commit_id,
+                 std::function<void(storage::Status status,
+                                    std::string storage_bytes)> callback)
+      override;
 
   // cloud_provider::CommitWatcher:
   void OnRemoteCommit(cloud_provider::Commit commit,
@@ -94,18 +126,38 @@ class PageSyncImpl : public PageSync,
   // watcher upon success.
   void DownloadBacklog();
 
+  // Downloads the page of the backlog of remote commits starting at
+  // |min_timestamp|, then the following ones.
+  void DownloadBacklogPage(std::string min_timestamp);
+
   // Downloads the given batch of commits.
   void DownloadBatch(std::vector<cloud_provider::Record> record,
-                     ftl::Closure on_done);
+                     ftl::Closure on_done,
+                     BatchDownload::Mode mode = BatchDownload::Mode::FULL);
 
   void SetRemoteWatcher();
 
   void EnqueueUpload(std::unique_ptr<const storage::Commit> commit);
 
+  // Starts the pending uploads, as long as there are less than
+  // |kMaxConcurrentCommitUploads| uploads uploading their objects.
+  void StartPendingUploads();
+
+  // Uploads the commits at the front of |commit_uploads_|, after the ones
+  // already uploaded, whose objects are uploaded, unless a previous batch of
+  // commits is still being uploaded.
+  void UploadReadyCommits();
+
+  // Called when the upload with the given id, which must be the first one of
+  // |commit_uploads_|, is done.
+  void OnUploadDone(uint64_t upload_id);
+
   void HandleError(const char error_description[]);
 
   void CheckIdle();
 
+  void CheckDownloadIdle();
+
   void BacklogDownloaded();
 
   // Schedules the given closure to execute after the delay determined by
@@ -119,6 +171,7 @@ class PageSyncImpl : public PageSync,
   const ftl::Closure on_error_;
 
   ftl::Closure on_idle_;
+  ftl::Closure on_download_idle_;
   ftl::Closure on_backlog_downloaded_;
   // Ensures that each instance is started only once.
   bool started_ = false;
@@ -132,13 +185,36 @@ class PageSyncImpl : public PageSync,
   // ensures that sync is not reported as idle until the commits to be
   // downloaded are retrieved.
   bool download_list_retrieved_ = false;
-
-  // A queue of pending commit uploads.
-  std::queue<CommitUpload> commit_uploads_;
+  // Set to true while a page of the backlog of remote commits is being
+  // retrieved.
+  bool backlog_page_pending_ = false;
+  // Whether the first download of the backlog is shallow, and whether the
+  // backlog being downloaded is.
+  bool shallow_initial_sync_ = false;
+  bool shallow_backlog_ = false;
+  // Remote commits of the previous pages of a shallow backlog, added to storage
+  // together once the last page is retrieved.
+  std::vector<cloud_provider::Record> shallow_backlog_records_;
+
+  // A queue of pending commit uploads. Only the first |started_uploads_| ones
+  // are in progress, |uploads_with_pending_objects_| of them still uploading
+  // their objects. The first |uploaded_commits_| ones have their commit
+  // uploaded, and are being marked as synced in storage. Uploads are
+  // identified by their position in the queue since the beginning of sync: the
+  // first upload of the queue has the id |first_upload_id_|.
+  std::deque<CommitUpload> commit_uploads_;
+  size_t started_uploads_ = 0;
+  size_t uploads_with_pending_objects_ = 0;
+  size_t uploaded_commits_ = 0;
+  uint64_t first_upload_id_ = 0;
+  // True iff a batch of commits is being uploaded, or waits to be retried.
+  bool commits_upload_in_progress_ = false;
   // The current batch of remote commits being downloaded.
   std::unique_ptr<BatchDownload> batch_download_;
   // Pending remote commits to download.
   std::vector<cloud_provider::Record> commits_to_download_;
+  // Adds the objects bundled with the commits retrieved through GetCommit().
+  BundleDownload bundle_download_;
 
   // Must be the last member field.
   ftl::WeakPtrFactory<PageSyncImpl> weak_factory_;
@@ -4,7 +4,10 @@
 
 #include "apps/ledger/src/cloud_sync/impl/page_sync_impl.h"
 
+#include <map>
 #include <memory>
+#include <set>
+#include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -12,6 +15,7 @@
 #include "apps/ledger/src/backoff/backoff.h"
 #include "apps/ledger/src/callback/capture.h"
 #include "apps/ledger/src/cloud_provider/test/cloud_provider_empty_impl.h"
+#include "apps/ledger/src/storage/public/object.h"
 #include "apps/ledger/src/storage/public/page_storage.h"
 #include "apps/ledger/src/storage/test/commit_empty_impl.h"
 #include "apps/ledger/src/storage/test/page_storage_empty_impl.h"
@@ -53,6 +57,27 @@ class TestCommit : public storage::test::CommitEmptyImpl {
   std::string content;
 };
 
+// Fake implementation of storage::Object, whose content is its id.
+class TestObject : public storage::Object {
+ public:
+  explicit TestObject(storage::ObjectId id) : id(std::move(id)) {}
+  ~TestObject() override = default;
+
+  storage::ObjectId GetId() const override { return id; }
+
+  storage::Status GetData(ftl::StringView* result) const override {
+    *result = id;
+    return storage::Status::OK;
+  }
+
+  storage::Status GetSize(uint64_t* size) const override {
+    *size = id.size();
+    return storage::Status::OK;
+  }
+
+  storage::ObjectId id;
+};
+
 // Fake implementation of storage::PageStorage. Injects the data that PageSync
 // asks about: page id, existing unsynced commits to be retrieved through
 // GetUnsyncedCommits() and new commits to be retrieved through GetCommit().
@@ -105,11 +130,62 @@ class TestPageStorage : public storage::test::PageStorageEmptyImpl {
     message_loop_->task_runner()->PostTask(confirm);
   }
 
+  void AddShallowCommitsFromSync(
+      std::vector<PageStorage::CommitIdAndBytes> ids_and_bytes,
+      std::function<void(storage::Status status)> callback) override {
+    add_shallow_commits_from_sync_calls++;
+    message_loop_->task_runner()->PostTask(ftl::MakeCopyable(
+        [ this, ids_and_bytes = std::move(ids_and_bytes), callback ]() {
+          for (auto& commit : ids_and_bytes) {
+            received_commits[std::move(commit.id)] = std::move(commit.bytes);
+          }
+          callback(storage::Status::OK);
+        }));
+  }
+
   void GetUnsyncedObjectIds(
       const storage::CommitId& commit_id,
       std::function<void(storage::Status, std::vector<storage::ObjectId>)>
           callback) override {
-    callback(storage::Status::OK, std::vector<storage::ObjectId>());
+    callback(storage::Status::OK, unsynced_objects_to_return[commit_id]);
+  }
+
+  void GetObject(
+      storage::ObjectIdView object_id,
+      Location location,
+      const std::function<void(storage::Status,
+                               std::unique_ptr<const storage::Object>)>&
+          callback) override {
+    if (missing_objects.count(object_id.ToString()) != 0) {
+      callback(storage::Status::NOT_FOUND, nullptr);
+      return;
+    }
+    callback(storage::Status::OK,
+             std::make_unique<TestObject>(object_id.ToString()));
+  }
+
+  void AddObjectFromSync(storage::ObjectIdView object_id,
+                         mx::socket data,
+                         size_t size,
+                         const std::function<void(storage::Status)>& callback)
+      override {
+    std::string content;
+    EXPECT_TRUE(mtl::BlockingCopyToString(std::move(data), &content));
+    EXPECT_EQ(size, content.size());
+    missing_objects.erase(object_id.ToString());
+    objects_added_from_sync[object_id.ToString()] = std::move(content);
+    callback(storage::Status::OK);
+  }
+
+  void MarkObjectSynced(
+      storage::ObjectIdView object_id,
+      std::function<void(storage::Status)> callback) override {
+    if (should_mark_synced_asynchronously) {
+      message_loop_->task_runner()->PostTask(
+          [callback] { callback(storage::Status::OK); });
+      return;
+    }
+    callback(storage::Status::OK);
   }
 
   storage::Status AddCommitWatcher(storage::CommitWatcher* watcher) override {
@@ -135,10 +211,20 @@ class TestPageStorage : public storage::test::PageStorageEmptyImpl {
     unsynced_commits_to_return.clear();
   }
 
-  storage::Status MarkCommitSynced(
-      const storage::CommitId& commit_id) override {
+  void MarkCommitSynced(
+      const storage::CommitId& commit_id,
+      std::function<void(storage::Status)> callback) override {
+    if (should_mark_synced_asynchronously) {
+      // Like the storage, only report the commit as synced once the change is
+      // written.
+      message_loop_->task_runner()->PostTask([this, commit_id, callback] {
+        commits_marked_as_synced.insert(commit_id);
+        callback(storage::Status::OK);
+      });
+      return;
+    }
     commits_marked_as_synced.insert(commit_id);
-    return storage::Status::OK;
+    callback(storage::Status::OK);
   }
 
   storage::Status SetSyncMetadata(ftl::StringView sync_state) override {
@@ -147,6 +233,9 @@ class TestPageStorage : public storage::test::PageStorageEmptyImpl {
   }
 
   storage::Status GetSyncMetadata(std::string* sync_state) override {
+    if (sync_metadata.empty()) {
+      return storage::Status::NOT_FOUND;
+    }
     *sync_state = sync_metadata;
     return storage::Status::OK;
   }
@@ -158,12 +247,21 @@ class TestPageStorage : public storage::test::PageStorageEmptyImpl {
   // Commits to be returned from GetCommit() calls.
   std::unordered_map<storage::CommitId, std::unique_ptr<const storage::Commit>>
       new_commits_to_return;
+  // Ids of the unsynced objects of each commit.
+  std::unordered_map<storage::CommitId, std::vector<storage::ObjectId>>
+      unsynced_objects_to_return;
+  // Objects reported as missing from GetObject() calls, until they are added
+  // through AddObjectFromSync().
+  std::set<storage::ObjectId> missing_objects;
+  std::unordered_map<storage::ObjectId, std::string> objects_added_from_sync;
   bool should_fail_get_unsynced_commits = false;
   bool should_fail_get_commit = false;
   bool should_fail_add_commit_from_sync = false;
   bool should_delay_add_commit_confirmation = false;
+  bool should_mark_synced_asynchronously = false;
   std::vector<ftl::Closure> delayed_add_commit_confirmations;
   unsigned int add_commits_from_sync_calls = 0u;
+  unsigned int add_shallow_commits_from_sync_calls = 0u;
 
   std::set<storage::CommitId> commits_marked_as_synced;
   bool watcher_set = false;
@@ -189,10 +287,32 @@ class TestCloudProvider : public cloud_provider::test::CloudProviderEmptyImpl {
       const cloud_provider::Commit& commit,
       const std::function<void(cloud_provider::Status)>& callback) override {
     received_commits.push_back(commit.Clone());
+    upload_log.push_back("commit:" + commit.id);
+    message_loop_->task_runner()->PostTask(
+        [this, callback]() { callback(commit_status_to_return); });
+  }
+
+  void AddCommits(
+      std::vector<cloud_provider::Commit> commits,
+      const std::function<void(cloud_provider::Status)>& callback) override {
+    add_commits_calls++;
+    for (auto& commit : commits) {
+      upload_log.push_back("commit:" + commit.id);
+      received_commits.push_back(std::move(commit));
+    }
     message_loop_->task_runner()->PostTask(
         [this, callback]() { callback(commit_status_to_return); });
   }
 
+  void AddObject(
+      cloud_provider::ObjectIdView object_id,
+      mx::vmo data,
+      std::function<void(cloud_provider::Status)> callback) override {
+    upload_log.push_back("object:" + object_id.ToString());
+    message_loop_->task_runner()->PostTask(
+        [callback]() { callback(cloud_provider::Status::OK); });
+  }
+
   void WatchCommits(const std::string& min_timestamp,
                     cloud_provider::CommitWatcher* watcher) override {
     watch_commits_calls++;
@@ -210,20 +330,37 @@ class TestCloudProvider : public cloud_provider::test::CloudProviderEmptyImpl {
     watcher_removed = true;
   }
 
-  void GetCommits(const std::string& min_timestamp,
-                  std::function<void(cloud_provider::Status,
-                                     std::vector<cloud_provider::Record>)>
-                      callback) override {
+  void GetCommitsPage(const std::string& min_timestamp,
+                      size_t max_count,
+                      std::function<void(cloud_provider::Status,
+                                         std::vector<cloud_provider::Record>,
+                                         std::string)> callback) override {
     get_commits_calls++;
+    get_commits_min_timestamps.push_back(min_timestamp);
     if (should_fail_get_commits) {
       message_loop_->task_runner()->PostTask([callback]() {
-        callback(cloud_provider::Status::NETWORK_ERROR, {});
+        callback(cloud_provider::Status::NETWORK_ERROR, {}, "");
       });
       return;
     }
 
+    if (!pages_to_return.empty()) {
+      // Each page is followed by the next one, starting at the timestamp of
+      // the last commit of the page.
+      std::vector<cloud_provider::Record> page =
+          std::move(pages_to_return.front());
+      pages_to_return.erase(pages_to_return.begin());
+      std::string next_timestamp = page.back().timestamp;
+      message_loop_->task_runner()->PostTask(ftl::MakeCopyable([
+        callback, page = std::move(page), next_timestamp
+      ]() mutable {
+        callback(cloud_provider::Status::OK, std::move(page), next_timestamp);
+      }));
+      return;
+    }
+
     message_loop_->task_runner()->PostTask([this, callback]() {
-      callback(cloud_provider::Status::OK, std::move(records_to_return));
+      callback(cloud_provider::Status::OK, std::move(records_to_return), "");
     });
   }
 
@@ -247,17 +384,57 @@ class TestCloudProvider : public cloud_provider::test::CloudProviderEmptyImpl {
         });
   }
 
+  void GetCommit(
+      const cloud_provider::CommitId& commit_id,
+      std::function<void(cloud_provider::Status, cloud_provider::Commit)>
+          callback) override {
+    get_commit_calls++;
+    if (should_fail_get_commit) {
+      message_loop_->task_runner()->PostTask([callback]() {
+        callback(cloud_provider::Status::NETWORK_ERROR,
+                 cloud_provider::Commit());
+      });
+      return;
+    }
+
+    message_loop_->task_runner()->PostTask([this, commit_id, callback]() {
+      auto it = commits_to_return.find(commit_id);
+      if (it == commits_to_return.end()) {
+        callback(cloud_provider::Status::NOT_FOUND, cloud_provider::Commit());
+        return;
+      }
+      cloud_provider::Commit commit(commit_id, it->second, {});
+      commit.bundled_objects = bundled_objects_to_return[commit_id];
+      callback(cloud_provider::Status::OK, std::move(commit));
+    });
+  }
+
   bool should_fail_get_commits = false;
+  bool should_fail_get_commit = false;
   bool should_fail_get_object = false;
   std::vector<cloud_provider::Record> records_to_return;
+  // Pages of commits returned before |records_to_return|.
+  std::vector<std::vector<cloud_provider::Record>> pages_to_return;
   std::vector<cloud_provider::Record> notifications_to_deliver;
   cloud_provider::Status commit_status_to_return = cloud_provider::Status::OK;
   std::unordered_map<std::string, std::string> objects_to_return;
+  // Content of the commits returned from GetCommit() calls.
+  std::unordered_map<std::string, std::string> commits_to_return;
+  // Objects bundled with the commits returned from GetCommit() calls.
+  std::unordered_map<std::string,
+                     std::map<cloud_provider::ObjectId,
+                              cloud_provider::ObjectLocation>>
+      bundled_objects_to_return;
 
   unsigned int watch_commits_calls = 0u;
   unsigned int get_commits_calls = 0u;
+  std::vector<std::string> get_commits_min_timestamps;
+  unsigned int get_commit_calls = 0u;
   unsigned int get_object_calls = 0u;
+  unsigned int add_commits_calls = 0u;
   std::vector<cloud_provider::Commit> received_commits;
+  // Uploaded commits and objects, in the order of the upload requests.
+  std::vector<std::string> upload_log;
   bool watcher_removed = false;
 
  private:
@@ -399,6 +576,86 @@ TEST_F(PageSyncImplTest, UploadExistingAndNewCommits) {
   EXPECT_EQ(1u, storage_.commits_marked_as_synced.count("id2"));
 }
 
+// Verifies that the objects of a commit are uploaded without waiting for the
+// previous commit to be uploaded, but that the commits are still uploaded in
+// order.
+TEST_F(PageSyncImplTest, PipelinedUploads) {
+  storage_.unsynced_commits_to_return.push_back(
+      std::make_unique<const TestCommit>("id1", "content1"));
+  storage_.unsynced_commits_to_return.push_back(
+      std::make_unique<const TestCommit>("id2", "content2"));
+  storage_.unsynced_objects_to_return["id1"] = {"obj1"};
+  storage_.unsynced_objects_to_return["id2"] = {"obj2"};
+  page_sync_.Start();
+
+  message_loop_.SetAfterTaskCallback([this] {
+    if (storage_.commits_marked_as_synced.size() == 2u) {
+      message_loop_.PostQuitTask();
+    }
+  });
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  std::vector<std::string> expected_log = {"object:obj1", "object:obj2",
+                                           "commit:id1", "commit:id2"};
+  EXPECT_EQ(expected_log, cloud_provider_.upload_log);
+}
+
+// Verifies that the commits that are ready to be uploaded while a previous
+// commit is not are uploaded together in a single batch.
+TEST_F(PageSyncImplTest, BatchedUploads) {
+  storage_.unsynced_commits_to_return.push_back(
+      std::make_unique<const TestCommit>("id1", "content1"));
+  storage_.unsynced_commits_to_return.push_back(
+      std::make_unique<const TestCommit>("id2", "content2"));
+  storage_.unsynced_commits_to_return.push_back(
+      std::make_unique<const TestCommit>("id3", "content3"));
+  storage_.unsynced_objects_to_return["id1"] = {"obj1"};
+  page_sync_.Start();
+
+  message_loop_.SetAfterTaskCallback([this] {
+    if (storage_.commits_marked_as_synced.size() == 3u) {
+      message_loop_.PostQuitTask();
+    }
+  });
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  std::vector<std::string> expected_log = {"object:obj1", "commit:id1",
+                                           "commit:id2", "commit:id3"};
+  EXPECT_EQ(expected_log, cloud_provider_.upload_log);
+  EXPECT_EQ(1u, cloud_provider_.add_commits_calls);
+  EXPECT_TRUE(page_sync_.IsIdle());
+}
+
+// Verifies that each commit of a batch is marked as synced once, and uploaded
+// once, when storage marks the commits as synced asynchronously.
+TEST_F(PageSyncImplTest, BatchedUploadsMarkedAsSyncedAsynchronously) {
+  storage_.should_mark_synced_asynchronously = true;
+  storage_.unsynced_commits_to_return.push_back(
+      std::make_unique<const TestCommit>("id1", "content1"));
+  storage_.unsynced_commits_to_return.push_back(
+      std::make_unique<const TestCommit>("id2", "content2"));
+  storage_.unsynced_commits_to_return.push_back(
+      std::make_unique<const TestCommit>("id3", "content3"));
+  storage_.unsynced_objects_to_return["id1"] = {"obj1"};
+  int on_idle_calls = 0;
+  page_sync_.SetOnIdle([this, &on_idle_calls] {
+    on_idle_calls++;
+    message_loop_.PostQuitTask();
+  });
+  page_sync_.Start();
+
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  std::vector<std::string> expected_log = {"object:obj1", "commit:id1",
+                                           "commit:id2", "commit:id3"};
+  EXPECT_EQ(expected_log, cloud_provider_.upload_log);
+  EXPECT_EQ(1u, cloud_provider_.add_commits_calls);
+  std::set<storage::CommitId> expected_synced = {"id1", "id2", "id3"};
+  EXPECT_EQ(expected_synced, storage_.commits_marked_as_synced);
+  EXPECT_EQ(1, on_idle_calls);
+  EXPECT_TRUE(page_sync_.IsIdle());
+}
+
 // Verifies that failing uploads are retried. In production the retries are
 // delayed, here we set the delays to 0.
 TEST_F(PageSyncImplTest, RetryUpload) {
@@ -522,6 +779,90 @@ TEST_F(PageSyncImplTest, DownloadBacklog) {
 
 // Verifies that callbacks are correctly run after downloading an empty backlog
 // of remote commits.
+// Verifies that the backlog of remote commits is downloaded page by page.
+TEST_F(PageSyncImplTest, DownloadBacklogPages) {
+  std::vector<cloud_provider::Record> page;
+  page.push_back(cloud_provider::Record(
+      cloud_provider::Commit("id1", "content1", {}), "42"));
+  cloud_provider_.pages_to_return.push_back(std::move(page));
+  cloud_provider_.records_to_return.push_back(cloud_provider::Record(
+      cloud_provider::Commit("id2", "content2", {}), "43"));
+
+  int on_backlog_downloaded_calls = 0;
+  page_sync_.SetOnBacklogDownloaded(
+      [&on_backlog_downloaded_calls] { on_backlog_downloaded_calls++; });
+  page_sync_.Start();
+
+  message_loop_.SetAfterTaskCallback([this] {
+    if (storage_.received_commits.size() == 2u) {
+      message_loop_.QuitNow();
+    }
+  });
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  EXPECT_EQ("content1", storage_.received_commits["id1"]);
+  EXPECT_EQ("content2", storage_.received_commits["id2"]);
+  EXPECT_EQ("43", storage_.sync_metadata);
+  EXPECT_EQ(2u, storage_.add_commits_from_sync_calls);
+  std::vector<std::string> expected_min_timestamps = {"", "42"};
+  EXPECT_EQ(expected_min_timestamps,
+            cloud_provider_.get_commits_min_timestamps);
+  EXPECT_EQ(1, on_backlog_downloaded_calls);
+}
+
+// Verifies that the commits of the initial backlog are added to storage at once
+// when shallow initial sync is enabled.
+TEST_F(PageSyncImplTest, ShallowDownloadBacklog) {
+  std::vector<cloud_provider::Record> page;
+  page.push_back(cloud_provider::Record(
+      cloud_provider::Commit("id1", "content1", {}), "42"));
+  cloud_provider_.pages_to_return.push_back(std::move(page));
+  cloud_provider_.records_to_return.push_back(cloud_provider::Record(
+      cloud_provider::Commit("id2", "content2", {}), "43"));
+
+  int on_backlog_downloaded_calls = 0;
+  page_sync_.SetOnBacklogDownloaded(
+      [&on_backlog_downloaded_calls] { on_backlog_downloaded_calls++; });
+  page_sync_.EnableShallowInitialSync();
+  page_sync_.Start();
+
+  message_loop_.SetAfterTaskCallback([this] {
+    if (storage_.received_commits.size() == 2u) {
+      message_loop_.QuitNow();
+    }
+  });
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  EXPECT_EQ("content1", storage_.received_commits["id1"]);
+  EXPECT_EQ("content2", storage_.received_commits["id2"]);
+  EXPECT_EQ("43", storage_.sync_metadata);
+  EXPECT_EQ(0u, storage_.add_commits_from_sync_calls);
+  EXPECT_EQ(1u, storage_.add_shallow_commits_from_sync_calls);
+  EXPECT_EQ(1, on_backlog_downloaded_calls);
+}
+
+// Verifies that shallow initial sync does not apply once remote commits were
+// added to storage.
+TEST_F(PageSyncImplTest, ShallowSyncAfterInitialSync) {
+  storage_.sync_metadata = "41";
+  cloud_provider_.records_to_return.push_back(cloud_provider::Record(
+      cloud_provider::Commit("id1", "content1", {}), "42"));
+
+  page_sync_.EnableShallowInitialSync();
+  page_sync_.Start();
+
+  message_loop_.SetAfterTaskCallback([this] {
+    if (storage_.received_commits.size() == 1u) {
+      message_loop_.QuitNow();
+    }
+  });
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  EXPECT_EQ("42", storage_.sync_metadata);
+  EXPECT_EQ(1u, storage_.add_commits_from_sync_calls);
+  EXPECT_EQ(0u, storage_.add_shallow_commits_from_sync_calls);
+}
+
 TEST_F(PageSyncImplTest, DownloadEmptyBacklog) {
   int on_backlog_downloaded_calls = 0;
   int on_idle_calls = 0;
@@ -727,6 +1068,64 @@ TEST_F(PageSyncImplTest, DownloadIdleCallback) {
   EXPECT_TRUE(page_sync_.IsIdle());
 }
 
+// Verifies that the download idle callback is called once all remote commits,
+// including the ones received during the download, are added to storage.
+TEST_F(PageSyncImplTest, DownloadIdleCallbackAfterBatch) {
+  cloud_provider_.records_to_return.push_back(cloud_provider::Record(
+      cloud_provider::Commit("id1", "content1", {}), "42"));
+  cloud_provider_.records_to_return.push_back(cloud_provider::Record(
+      cloud_provider::Commit("id2", "content2", {}), "43"));
+
+  int on_download_idle_calls = 0;
+  page_sync_.SetOnDownloadIdle(
+      [&on_download_idle_calls] { on_download_idle_calls++; });
+  page_sync_.Start();
+  // The backlog is being retrieved.
+  EXPECT_FALSE(page_sync_.IsDownloadIdle());
+
+  message_loop_.SetAfterTaskCallback([this] {
+    if (storage_.received_commits.size() == 2u) {
+      message_loop_.PostQuitTask();
+    }
+  });
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(1, on_download_idle_calls);
+  EXPECT_TRUE(page_sync_.IsDownloadIdle());
+
+  page_sync_.OnRemoteCommit(cloud_provider::Commit("id3", "content3", {}),
+                            "44");
+  EXPECT_FALSE(page_sync_.IsDownloadIdle());
+  // A commit received while the previous one is being downloaded does not
+  // trigger an additional callback.
+  page_sync_.OnRemoteCommit(cloud_provider::Commit("id4", "content4", {}),
+                            "45");
+  message_loop_.SetAfterTaskCallback([this] {
+    if (storage_.received_commits.size() == 4u) {
+      message_loop_.PostQuitTask();
+    }
+  });
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(2, on_download_idle_calls);
+  EXPECT_TRUE(page_sync_.IsDownloadIdle());
+}
+
+// Verifies that the download is not idle while the first page of the backlog is
+// being retrieved, even if the backlog is empty.
+TEST_F(PageSyncImplTest, DownloadIdleCallbackEmptyBacklog) {
+  int on_download_idle_calls = 0;
+  page_sync_.SetOnDownloadIdle([this, &on_download_idle_calls] {
+    on_download_idle_calls++;
+    message_loop_.PostQuitTask();
+  });
+  page_sync_.Start();
+  EXPECT_FALSE(page_sync_.IsDownloadIdle());
+
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(1, on_download_idle_calls);
+  EXPECT_TRUE(page_sync_.IsDownloadIdle());
+  EXPECT_EQ(1u, cloud_provider_.get_commits_calls);
+}
+
 // Verifies that sync correctly fetches objects from the cloud provider.
 TEST_F(PageSyncImplTest, GetObject) {
   cloud_provider_.objects_to_return["object_id"] = "content";
@@ -777,5 +1176,83 @@ TEST_F(PageSyncImplTest, RetryGetObject) {
   EXPECT_EQ("content", content);
 }
 
+TEST_F(PageSyncImplTest, GetCommit) {
+  cloud_provider_.commits_to_return["commit_id"] = "content";
+  page_sync_.Start();
+
+  storage::Status status;
+  std::string storage_bytes;
+  page_sync_.GetCommit(
+      storage::CommitIdView("commit_id"),
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status,
+                        &storage_bytes));
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  EXPECT_EQ(storage::Status::OK, status);
+  EXPECT_EQ("content", storage_bytes);
+}
+
+// Verifies that the objects bundled with a commit retrieved through GetCommit()
+// are added to storage, as they can't be retrieved on their own later.
+TEST_F(PageSyncImplTest, GetCommitWithBundledObjects) {
+  cloud_provider_.commits_to_return["commit_id"] = "content";
+  cloud_provider::ObjectLocation location1;
+  location1.bundle_id = "bundle_id";
+  location1.offset = 0;
+  location1.size = 4;
+  cloud_provider::ObjectLocation location2;
+  location2.bundle_id = "bundle_id";
+  location2.offset = 4;
+  location2.size = 5;
+  cloud_provider_.bundled_objects_to_return["commit_id"]["object_id1"] =
+      location1;
+  cloud_provider_.bundled_objects_to_return["commit_id"]["object_id2"] =
+      location2;
+  cloud_provider_.objects_to_return["bundle_id"] = "datamore!";
+  storage_.missing_objects.insert("object_id1");
+  storage_.missing_objects.insert("object_id2");
+  page_sync_.Start();
+
+  storage::Status status;
+  std::string storage_bytes;
+  page_sync_.GetCommit(
+      storage::CommitIdView("commit_id"),
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status,
+                        &storage_bytes));
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  EXPECT_EQ(storage::Status::OK, status);
+  EXPECT_EQ("content", storage_bytes);
+  EXPECT_EQ(1u, cloud_provider_.get_object_calls);
+  EXPECT_EQ(2u, storage_.objects_added_from_sync.size());
+  EXPECT_EQ("data", storage_.objects_added_from_sync["object_id1"]);
+  EXPECT_EQ("more!", storage_.objects_added_from_sync["object_id2"]);
+}
+
+// Verifies that sync retries GetCommit() attempts upon connection error.
+TEST_F(PageSyncImplTest, RetryGetCommit) {
+  cloud_provider_.should_fail_get_commit = true;
+  page_sync_.Start();
+
+  message_loop_.SetAfterTaskCallback([this] {
+    // Allow the operation to succeed after looping through five attempts.
+    if (cloud_provider_.get_commit_calls == 5u) {
+      cloud_provider_.should_fail_get_commit = false;
+      cloud_provider_.commits_to_return["commit_id"] = "content";
+    }
+  });
+  storage::Status status;
+  std::string storage_bytes;
+  page_sync_.GetCommit(
+      storage::CommitIdView("commit_id"),
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status,
+                        &storage_bytes));
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  EXPECT_EQ(6u, cloud_provider_.get_commit_calls);
+  EXPECT_EQ(storage::Status::OK, status);
+  EXPECT_EQ("content", storage_bytes);
+}
+
 }  // namespace
 }  // namespace cloud_sync
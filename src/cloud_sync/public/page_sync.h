@@ -36,6 +36,17 @@ class PageSync {
   // download work.
   virtual bool IsIdle() = 0;
 
+  // Sets a callback that will be called after Start() every time when PageSync
+  // finishes adding remote commits to storage, that is when the batch of
+  // remote commits being downloaded and the ones received in the meantime are
+  // all added to storage. Can be set at most once and only before calling
+  // Start().
+  virtual void SetOnDownloadIdle(ftl::Closure on_download_idle) = 0;
+
+  // Returns true iff PageSync is not currently adding remote commits to
+  // storage.
+  virtual bool IsDownloadIdle() = 0;
+
   // Sets a callback that will be called at most once after Start(), when all
   // remote commits added to the cloud between the last sync and starting the
   // current sync are added to storage. This can be used by the client to delay
@@ -22,6 +22,14 @@ bool PageSyncEmptyImpl::IsIdle() {
   return true;
 }
 
+void PageSyncEmptyImpl::SetOnDownloadIdle(
+    ftl::Closure on_download_idle_callback) {}
+
+bool PageSyncEmptyImpl::IsDownloadIdle() {
+  FTL_NOTIMPLEMENTED();
+  return true;
+}
+
 void PageSyncEmptyImpl::SetOnBacklogDownloaded(
     ftl::Closure on_backlog_downloaded_callback) {
   FTL_NOTIMPLEMENTED();
@@ -16,6 +16,8 @@ class PageSyncEmptyImpl : public PageSync {
   void Start() override;
   void SetOnIdle(ftl::Closure on_idle_callback) override;
   bool IsIdle() override;
+  void SetOnDownloadIdle(ftl::Closure on_download_idle_callback) override;
+  bool IsDownloadIdle() override;
   void SetOnBacklogDownloaded(
       ftl::Closure on_backlog_downloaded_callback) override;
 };
@@ -10,6 +10,8 @@ namespace configuration {
 
 Configuration::Configuration() : use_sync(false) {}
 
+Configuration::StorageParams::StorageParams() : use_ledger_database(false) {}
+
 Configuration::Configuration(const Configuration&) = default;
 
 Configuration::Configuration(Configuration&&) = default;
@@ -19,7 +21,8 @@ Configuration& Configuration::operator=(const Configuration&) = default;
 Configuration& Configuration::operator=(Configuration&&) = default;
 
 bool operator==(const Configuration& lhs, const Configuration& rhs) {
-  return lhs.use_sync == rhs.use_sync && lhs.sync_params == rhs.sync_params;
+  return lhs.use_sync == rhs.use_sync && lhs.sync_params == rhs.sync_params &&
+         lhs.storage_params == rhs.storage_params;
 }
 
 bool operator!=(const Configuration& lhs, const Configuration& rhs) {
@@ -38,4 +41,19 @@ bool operator!=(const Configuration::SyncParams& lhs,
   return !(lhs == rhs);
 }
 
+bool operator==(const Configuration::StorageParams& lhs,
+                const Configuration::StorageParams& rhs) {
+  return lhs.block_cache_size == rhs.block_cache_size &&
+         lhs.bloom_filter_bits_per_key == rhs.bloom_filter_bits_per_key &&
+         lhs.write_buffer_size == rhs.write_buffer_size &&
+         lhs.max_open_files == rhs.max_open_files &&
+         lhs.use_compression == rhs.use_compression &&
+         lhs.use_ledger_database == rhs.use_ledger_database;
+}
+
+bool operator!=(const Configuration::StorageParams& lhs,
+                const Configuration::StorageParams& rhs) {
+  return !(lhs == rhs);
+}
+
 }  // namespace configuration
@@ -5,8 +5,11 @@
 #ifndef APPS_LEDGER_SRC_CONFIGURATION_CONFIGURATION_H_
 #define APPS_LEDGER_SRC_CONFIGURATION_CONFIGURATION_H_
 
+#include <stddef.h>
+
 #include <string>
 
+#include "apps/ledger/src/storage/impl/db_options.h"
 #include "lib/ftl/strings/string_view.h"
 
 namespace configuration {
@@ -43,6 +46,19 @@ struct Configuration {
   // sync_params holds the parameters used for cloud synchronization if
   // |use_sync| is true.
   SyncParams sync_params;
+
+  // Parameters of the LevelDB databases backing the page storages. The LevelDB
+  // options and their default values are defined by storage::DbOptions.
+  struct StorageParams : public storage::DbOptions::Params {
+    StorageParams();
+
+    // Set to true to store the metadata of all the pages of a ledger in a
+    // single database. Existing pages are migrated when opened. The migration
+    // cannot be undone by setting this back to false.
+    bool use_ledger_database;
+  };
+
+  StorageParams storage_params;
 };
 
 bool operator==(const Configuration& lhs, const Configuration& rhs);
@@ -51,6 +67,10 @@ bool operator==(const Configuration::SyncParams& lhs,
                 const Configuration::SyncParams& rhs);
 bool operator!=(const Configuration::SyncParams& lhs,
                 const Configuration::SyncParams& rhs);
+bool operator==(const Configuration::StorageParams& lhs,
+                const Configuration::StorageParams& rhs);
+bool operator!=(const Configuration::StorageParams& lhs,
+                const Configuration::StorageParams& rhs);
 }  // namespace configuration
 
 #endif  // APPS_LEDGER_SRC_CONFIGURATION_CONFIGURATION_H_
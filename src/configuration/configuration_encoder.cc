@@ -22,7 +22,84 @@ const char kGcsBucket[] = "gcs_bucket";
 const char kFirebaseId[] = "firebase_id";
 const char kCloudPrefix[] = "cloud_prefix";
 const char kDeprecatedUserPrefix[] = "user_prefix";
+const char kStorage[] = "storage";
+const char kBlockCacheSize[] = "block_cache_size";
+const char kBloomFilterBitsPerKey[] = "bloom_filter_bits_per_key";
+const char kWriteBufferSize[] = "write_buffer_size";
+const char kMaxOpenFiles[] = "max_open_files";
+const char kUseCompression[] = "use_compression";
+const char kUseLedgerDatabase[] = "use_ledger_database";
+
+// Reads the optional storage parameters from |storage_config|. Parameters that
+// are not specified keep their default value.
+bool DecodeStorageParams(const rapidjson::Value& storage_config,
+                         Configuration::StorageParams* storage_params) {
+  if (!storage_config.IsObject()) {
+    FTL_LOG(ERROR) << "The " << kStorage << " parameter must be an object.";
+    return false;
+  }
+
+  if (storage_config.HasMember(kBlockCacheSize)) {
+    if (!storage_config[kBlockCacheSize].IsUint64()) {
+      FTL_LOG(ERROR) << "The " << kBlockCacheSize << " parameter inside "
+                     << kStorage << " must be a positive integer.";
+      return false;
+    }
+    storage_params->block_cache_size =
+        storage_config[kBlockCacheSize].GetUint64();
+  }
+
+  if (storage_config.HasMember(kBloomFilterBitsPerKey)) {
+    if (!storage_config[kBloomFilterBitsPerKey].IsUint()) {
+      FTL_LOG(ERROR) << "The " << kBloomFilterBitsPerKey << " parameter inside "
+                     << kStorage << " must be a positive integer.";
+      return false;
+    }
+    storage_params->bloom_filter_bits_per_key =
+        storage_config[kBloomFilterBitsPerKey].GetUint();
+  }
+
+  if (storage_config.HasMember(kWriteBufferSize)) {
+    if (!storage_config[kWriteBufferSize].IsUint64()) {
+      FTL_LOG(ERROR) << "The " << kWriteBufferSize << " parameter inside "
+                     << kStorage << " must be a positive integer.";
+      return false;
+    }
+    storage_params->write_buffer_size =
+        storage_config[kWriteBufferSize].GetUint64();
+  }
+
+  if (storage_config.HasMember(kMaxOpenFiles)) {
+    if (!storage_config[kMaxOpenFiles].IsUint()) {
+      FTL_LOG(ERROR) << "The " << kMaxOpenFiles << " parameter inside "
+                     << kStorage << " must be a positive integer.";
+      return false;
+    }
+    storage_params->max_open_files = storage_config[kMaxOpenFiles].GetUint();
+  }
+
+  if (storage_config.HasMember(kUseCompression)) {
+    if (!storage_config[kUseCompression].IsBool()) {
+      FTL_LOG(ERROR) << "The " << kUseCompression << " parameter inside "
+                     << kStorage << " must be a boolean.";
+      return false;
+    }
+    storage_params->use_compression = storage_config[kUseCompression].GetBool();
+  }
+
+  if (storage_config.HasMember(kUseLedgerDatabase)) {
+    if (!storage_config[kUseLedgerDatabase].IsBool()) {
+      FTL_LOG(ERROR) << "The " << kUseLedgerDatabase << " parameter inside "
+                     << kStorage << " must be a boolean.";
+      return false;
+    }
+    storage_params->use_ledger_database =
+        storage_config[kUseLedgerDatabase].GetBool();
+  }
+
+  return true;
 }
+}  // namespace
 
 bool ConfigurationEncoder::Decode(const std::string& configuration_path,
                                   Configuration* configuration) {
@@ -59,6 +136,12 @@ bool ConfigurationEncoder::DecodeFromString(const std::string& json,
 
   Configuration new_configuration;
 
+  if (document.HasMember(kStorage) &&
+      !DecodeStorageParams(document[kStorage],
+                           &new_configuration.storage_params)) {
+    return false;
+  }
+
   if (!document.HasMember(kSynchronization)) {
     new_configuration.use_sync = false;
     *configuration = std::move(new_configuration);
@@ -165,6 +248,27 @@ std::string ConfigurationEncoder::EncodeToString(
       }
     }
     writer.EndObject();
+
+    writer.Key(kStorage);
+
+    writer.StartObject();
+    {
+      const Configuration::StorageParams& storage_params =
+          configuration.storage_params;
+      writer.Key(kBlockCacheSize);
+      writer.Uint64(storage_params.block_cache_size);
+      writer.Key(kBloomFilterBitsPerKey);
+      writer.Uint(storage_params.bloom_filter_bits_per_key);
+      writer.Key(kWriteBufferSize);
+      writer.Uint64(storage_params.write_buffer_size);
+      writer.Key(kMaxOpenFiles);
+      writer.Uint(storage_params.max_open_files);
+      writer.Key(kUseCompression);
+      writer.Bool(storage_params.use_compression);
+      writer.Key(kUseLedgerDatabase);
+      writer.Bool(storage_params.use_ledger_database);
+    }
+    writer.EndObject();
   }
   writer.EndObject();
 
@@ -6,6 +6,7 @@
 
 #include "apps/ledger/src/configuration/configuration.h"
 #include "gtest/gtest.h"
+#include "lib/ftl/files/file.h"
 #include "lib/ftl/files/scoped_temp_dir.h"
 
 namespace configuration {
@@ -47,5 +48,41 @@ TEST_F(ConfigurationEncoderTest, EncodeWithSync) {
   EXPECT_TRUE(ConfigurationEncoder::Decode(file_path, &actual_config));
   EXPECT_EQ(expected_config, actual_config);
 }
+
+TEST_F(ConfigurationEncoderTest, EncodeWithStorageParams) {
+  std::string file_path;
+  temp_dir_.NewTempFile(&file_path);
+
+  Configuration expected_config;
+  expected_config.storage_params.block_cache_size = 4 * 1024 * 1024;
+  expected_config.storage_params.bloom_filter_bits_per_key = 0;
+  expected_config.storage_params.write_buffer_size = 512 * 1024;
+  expected_config.storage_params.max_open_files = 200;
+  expected_config.storage_params.use_compression = false;
+  expected_config.storage_params.use_ledger_database = true;
+
+  EXPECT_TRUE(ConfigurationEncoder::Write(file_path, expected_config));
+
+  Configuration actual_config;
+  EXPECT_TRUE(ConfigurationEncoder::Decode(file_path, &actual_config));
+  EXPECT_EQ(expected_config, actual_config);
+}
+
+TEST_F(ConfigurationEncoderTest, DecodePartialStorageParams) {
+  std::string file_path;
+  temp_dir_.NewTempFile(&file_path);
+  std::string json = "{\"storage\": {\"max_open_files\": 500}}";
+  ASSERT_TRUE(files::WriteFile(file_path, json.data(), json.size()));
+
+  Configuration config;
+  EXPECT_TRUE(ConfigurationEncoder::Decode(file_path, &config));
+  EXPECT_EQ(500, config.storage_params.max_open_files);
+  EXPECT_EQ(Configuration::StorageParams().block_cache_size,
+            config.storage_params.block_cache_size);
+
+  json = "{\"storage\": {\"use_compression\": 1}}";
+  ASSERT_TRUE(files::WriteFile(file_path, json.data(), json.size()));
+  EXPECT_FALSE(ConfigurationEncoder::Decode(file_path, &config));
+}
 }  // namespace
 }  // namespace configuration
@@ -10,8 +10,6 @@
 
 namespace ledger {
 
-namespace {}  // namespace
-
 Environment::Environment(configuration::Configuration configuration,
                          ftl::RefPtr<ftl::TaskRunner> main_runner,
                          NetworkService* network_service,
@@ -20,6 +18,8 @@ Environment::Environment(configuration::Configuration configuration,
       main_runner_(std::move(main_runner)),
       network_service_(network_service),
       coroutine_service_(std::make_unique<coroutine::CoroutineServiceImpl>()),
+      db_options_(
+          std::make_unique<storage::DbOptions>(configuration_.storage_params)),
       io_runner_(std::move(io_runner)) {}
 
 Environment::~Environment() {
@@ -5,11 +5,13 @@
 #ifndef APPS_LEDGER_SRC_ENVIRONMENT_ENVIRONMENT_H_
 #define APPS_LEDGER_SRC_ENVIRONMENT_ENVIRONMENT_H_
 
+#include <memory>
 #include <thread>
 
 #include "apps/ledger/src/configuration/configuration.h"
 #include "apps/ledger/src/coroutine/coroutine.h"
 #include "apps/ledger/src/network/network_service.h"
+#include "apps/ledger/src/storage/impl/db_options.h"
 #include "lib/ftl/macros.h"
 #include "lib/ftl/memory/weak_ptr.h"
 #include "lib/ftl/tasks/task_runner.h"
@@ -31,6 +33,8 @@ class Environment {
   coroutine::CoroutineService* coroutine_service() {
     return coroutine_service_.get();
   }
+  // Returns the LevelDB options shared by the databases of all pages.
+  const storage::DbOptions* db_options() { return db_options_.get(); }
 
   // Returns a TaskRunner allowing to access the I/O thread. The I/O thread
   // should be used to access the file system.
@@ -41,6 +45,7 @@ class Environment {
   ftl::RefPtr<ftl::TaskRunner> main_runner_;
   NetworkService* const network_service_;
   std::unique_ptr<coroutine::CoroutineService> coroutine_service_;
+  std::unique_ptr<storage::DbOptions> db_options_;
 
   std::thread io_thread_;
   ftl::RefPtr<ftl::TaskRunner> io_runner_;
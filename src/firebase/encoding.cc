@@ -79,6 +79,13 @@ std::string EncodeValue(convert::ExtendedStringView bytes) {
   return Encode(s, CanValueBeVerbatim(s));
 }
 
+std::string EncodeCompact(convert::ExtendedStringView bytes) {
+  std::string encoded;
+  glue::Base64UrlEncode(bytes, &encoded);
+  encoded.push_back('U');
+  return encoded;
+}
+
 bool Decode(const std::string& input, std::string* output) {
   if (input.empty()) {
     return false;
@@ -89,6 +96,11 @@ bool Decode(const std::string& input, std::string* output) {
     return true;
   }
 
+  if (input.back() == 'U') {
+    return glue::Base64UrlDecode(
+        ftl::StringView(input.data(), input.size() - 1), output);
+  }
+
   if (input.back() == 'B') {
     std::string encoded(input.data(), input.size() - 1);
     std::replace(encoded.begin(), encoded.end(), '_', '+');
@@ -26,9 +26,15 @@ namespace firebase {
 std::string EncodeKey(convert::ExtendedStringView bytes);
 std::string EncodeValue(convert::ExtendedStringView bytes);
 
+// Encodes the given bytes as unpadded base64url with "U" added at the end,
+// whatever their content. Unlike the methods above, this doesn't inspect the
+// data before encoding it, and the result is always both a valid Firebase key
+// and a valid Firebase value.
+std::string EncodeCompact(convert::ExtendedStringView bytes);
+
 // Returns true iff the key or value was correctly decoded and stored in |out|.
 // We don't need separate methods for keys and values, as the decoding algorithm
-// is identical.
+// is identical. All the encodings above are supported.
 bool Decode(const std::string& input, std::string* output);
 
 }  // namespace firebase
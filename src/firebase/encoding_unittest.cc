@@ -153,6 +153,25 @@ TEST(EncodingTest, Values) {
   EXPECT_EQ("+V", EncodeValue("+"));
 }
 
+TEST(EncodingTest, Compact) {
+  EXPECT_EQ("U", EncodeCompact(""));
+  EXPECT_EQ("YWJjU", EncodeCompact("abc"));
+  EXPECT_EQ("YWJjLwU", EncodeCompact("abc/"));
+  EXPECT_EQ("fwU", EncodeCompact("\x7F"));
+  EXPECT_EQ("_-8U", EncodeCompact("\xFF\xEF"));
+
+  std::string original = "\x02, \x7F, \xFF, [], $ and / \0 too!"_s;
+  std::string encoded = EncodeCompact(original);
+  EXPECT_TRUE(IsValidKey(encoded));
+  EXPECT_TRUE(IsValidValue(encoded));
+  std::string decoded;
+  EXPECT_TRUE(Decode(encoded, &decoded));
+  EXPECT_EQ(original, decoded);
+
+  EXPECT_FALSE(Decode("YWJjL=U", &decoded));
+  EXPECT_FALSE(Decode("Y+JjU", &decoded));
+}
+
 TEST(EncodingTest, ValidKeys) {
   std::string original;
   std::string encoded;
@@ -33,6 +33,20 @@ class Firebase {
       const std::function<void(Status status, const rapidjson::Value& value)>&
           callback) = 0;
 
+  // Retrieves the data under the given path like Get(), for data holding a
+  // JSON object or null. Instead of building the representation of the whole
+  // object in memory, the members of the object are parsed one by one as the
+  // response is received, and passed to |on_member|, which can return false to
+  // abort the request. |on_done| is called once the whole response has been
+  // received, with PARSE_ERROR if the data is not an object or if the request
+  // has been aborted.
+  virtual void GetObjectMembers(
+      const std::string& key,
+      const std::string& query,
+      std::function<bool(const std::string& key, const rapidjson::Value& value)>
+          on_member,
+      std::function<void(Status status)> on_done) = 0;
+
   // Overwrites the data under the given path. Data needs to be a valid JSON
   // object or JSON primitive value.
   // https://firebase.google.com/docs/database/rest/save-data
@@ -40,6 +54,15 @@ class Firebase {
                    const std::string& data,
                    const std::function<void(Status status)>& callback) = 0;
 
+  // Updates the children of the given path with the values in |data|, which
+  // needs to be a valid JSON object. The keys of |data| can be paths relative
+  // to |key|, which allows to write several locations in a single atomic
+  // operation: either all of them are written, or none is.
+  // https://firebase.google.com/docs/database/rest/save-data
+  virtual void Patch(const std::string& key,
+                     const std::string& data,
+                     const std::function<void(Status status)>& callback) = 0;
+
   // Deletes the data under the given path.
   virtual void Delete(const std::string& key,
                       const std::function<void(Status status)>& callback) = 0;
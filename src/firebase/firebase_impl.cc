@@ -90,6 +90,21 @@ void FirebaseImpl::Get(
   Request(BuildRequestUrl(key, query), "GET", "", request_callback);
 }
 
+void FirebaseImpl::GetObjectMembers(
+    const std::string& key,
+    const std::string& query,
+    std::function<bool(const std::string& key, const rapidjson::Value& value)>
+        on_member,
+    std::function<void(Status status)> on_done) {
+  requests_.emplace(network_service_->Request(
+      MakeRequest(BuildRequestUrl(key, query), "GET", ""),
+      [ this, on_member = std::move(on_member), on_done = std::move(on_done) ](
+          network::URLResponsePtr response) mutable {
+        OnObjectResponse(std::move(on_member), std::move(on_done),
+                         std::move(response));
+      }));
+}
+
 void FirebaseImpl::Put(const std::string& key,
                        const std::string& data,
                        const std::function<void(Status status)>& callback) {
@@ -101,6 +116,17 @@ void FirebaseImpl::Put(const std::string& key,
           });
 }
 
+void FirebaseImpl::Patch(const std::string& key,
+                         const std::string& data,
+                         const std::function<void(Status status)>& callback) {
+  Request(BuildRequestUrl(key, ""), "PATCH", data,
+          [callback](Status status, const std::string& response) {
+            // Ignore the response body, which is the same data we sent to the
+            // server.
+            callback(status);
+          });
+}
+
 void FirebaseImpl::Delete(const std::string& key,
                           const std::function<void(Status status)>& callback) {
   Request(BuildRequestUrl(key, ""), "DELETE", "",
@@ -196,6 +222,26 @@ void FirebaseImpl::OnResponse(
       [callback](const std::string& body) { callback(Status::OK, body); });
 }
 
+void FirebaseImpl::OnObjectResponse(
+    std::function<bool(const std::string& key, const rapidjson::Value& value)>
+        on_member,
+    std::function<void(Status status)> on_done,
+    network::URLResponsePtr response) {
+  if (response->error ||
+      (response->status_code != 200 && response->status_code != 204)) {
+    // Errors are reported the same way as for the other requests.
+    OnResponse([on_done = std::move(on_done)](
+                   Status status, std::string response) { on_done(status); },
+               std::move(response));
+    return;
+  }
+
+  FTL_DCHECK(response->body->is_stream());
+  auto& object_stream =
+      object_streams_.emplace(std::move(on_member), std::move(on_done));
+  object_stream.Start(std::move(response->body->get_stream()));
+}
+
 void FirebaseImpl::OnStream(WatchClient* watch_client,
                             network::URLResponsePtr response) {
   if (response->error) {
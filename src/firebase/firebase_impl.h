@@ -14,6 +14,7 @@
 #include "apps/ledger/src/callback/cancellable.h"
 #include "apps/ledger/src/firebase/event_stream.h"
 #include "apps/ledger/src/firebase/firebase.h"
+#include "apps/ledger/src/firebase/object_stream.h"
 #include "apps/ledger/src/firebase/status.h"
 #include "apps/ledger/src/firebase/watch_client.h"
 #include "apps/ledger/src/glue/socket/socket_drainer_client.h"
@@ -43,9 +44,18 @@ class FirebaseImpl : public Firebase {
       const std::string& query,
       const std::function<void(Status status, const rapidjson::Value& value)>&
           callback) override;
+  void GetObjectMembers(
+      const std::string& key,
+      const std::string& query,
+      std::function<bool(const std::string& key, const rapidjson::Value& value)>
+          on_member,
+      std::function<void(Status status)> on_done) override;
   void Put(const std::string& key,
            const std::string& data,
            const std::function<void(Status status)>& callback) override;
+  void Patch(const std::string& key,
+             const std::string& data,
+             const std::function<void(Status status)>& callback) override;
   void Delete(const std::string& key,
               const std::function<void(Status status)>& callback) override;
   void Watch(const std::string& key,
@@ -69,6 +79,12 @@ class FirebaseImpl : public Firebase {
       const std::function<void(Status status, std::string response)>& callback,
       network::URLResponsePtr response);
 
+  void OnObjectResponse(
+      std::function<bool(const std::string& key, const rapidjson::Value& value)>
+          on_member,
+      std::function<void(Status status)> on_done,
+      network::URLResponsePtr response);
+
   void OnStream(WatchClient* watch_client, network::URLResponsePtr response);
 
   void OnStreamComplete(WatchClient* watch_client);
@@ -89,6 +105,7 @@ class FirebaseImpl : public Firebase {
 
   callback::CancellableContainer requests_;
   callback::AutoCleanableSet<glue::SocketDrainerClient> drainers_;
+  callback::AutoCleanableSet<ObjectStream> object_streams_;
 
   struct WatchData;
   std::map<WatchClient*, std::unique_ptr<WatchData>> watch_data_;
@@ -5,7 +5,9 @@
 #include "apps/ledger/src/firebase/firebase_impl.h"
 
 #include <memory>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include <rapidjson/document.h>
 
@@ -131,6 +133,75 @@ TEST_F(FirebaseImplTest, GetWithQuery) {
   EXPECT_EQ("GET", fake_network_service_.GetRequest()->method);
 }
 
+// Verifies that the members of an object are retrieved one by one.
+TEST_F(FirebaseImplTest, GetObjectMembers) {
+  fake_network_service_.SetStringResponse("{\"a\": 1, \"b\": {\"c\": 2}}",
+                                          200);
+  std::vector<std::string> keys;
+  // Used for its allocator, to make copies of the values.
+  rapidjson::Document document;
+  std::vector<rapidjson::Value> values;
+  Status status = Status::NETWORK_ERROR;
+  firebase_.GetObjectMembers(
+      "bazinga", "orderBy=\"timestamp\"",
+      [&keys, &document, &values](const std::string& key,
+                                  const rapidjson::Value& value) {
+        keys.push_back(key);
+        values.push_back(rapidjson::Value(value, document.GetAllocator()));
+        return true;
+      },
+      [this, &status](Status s) {
+        status = s;
+        message_loop_.PostQuitTask();
+      });
+
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(Status::OK, status);
+  EXPECT_EQ(std::vector<std::string>({"a", "b"}), keys);
+  ASSERT_EQ(2u, values.size());
+  EXPECT_EQ(1, values[0]);
+  EXPECT_TRUE(values[1].IsObject());
+  EXPECT_EQ(
+      "https://example.firebaseio.com/pre/fix/"
+      "bazinga.json?orderBy=\"timestamp\"",
+      fake_network_service_.GetRequest()->url);
+  EXPECT_EQ("GET", fake_network_service_.GetRequest()->method);
+}
+
+TEST_F(FirebaseImplTest, GetObjectMembersNotAnObject) {
+  fake_network_service_.SetStringResponse("[1, 2]", 200);
+  Status status = Status::OK;
+  firebase_.GetObjectMembers(
+      "bazinga", "",
+      [](const std::string& key, const rapidjson::Value& value) {
+        return true;
+      },
+      [this, &status](Status s) {
+        status = s;
+        message_loop_.PostQuitTask();
+      });
+
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(Status::PARSE_ERROR, status);
+}
+
+TEST_F(FirebaseImplTest, GetObjectMembersError) {
+  fake_network_service_.SetStringResponse("{}", 404);
+  Status status = Status::OK;
+  firebase_.GetObjectMembers(
+      "bazinga", "",
+      [](const std::string& key, const rapidjson::Value& value) {
+        return true;
+      },
+      [this, &status](Status s) {
+        status = s;
+        message_loop_.PostQuitTask();
+      });
+
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(Status::SERVER_ERROR, status);
+}
+
 // Verifies that request urls for root of the db are correctly formed.
 TEST_F(FirebaseImplTest, Root) {
   fake_network_service_.SetStringResponse("42", 200);
@@ -159,6 +230,20 @@ TEST_F(FirebaseImplTest, Put) {
   EXPECT_EQ("PUT", fake_network_service_.GetRequest()->method);
 }
 
+// Verifies that PATCH requests are made correctly.
+TEST_F(FirebaseImplTest, Patch) {
+  fake_network_service_.SetStringResponse("{\"a\":1,\"b/c\":2}", 200);
+  firebase_.Patch("name", "{\"a\":1,\"b/c\":2}", [this](Status status) {
+    EXPECT_EQ(Status::OK, status);
+    message_loop_.PostQuitTask();
+  });
+
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ("https://example.firebaseio.com/pre/fix/name.json",
+            fake_network_service_.GetRequest()->url);
+  EXPECT_EQ("PATCH", fake_network_service_.GetRequest()->method);
+}
+
 // Verifies that DELETE requests are made correctly.
 TEST_F(FirebaseImplTest, Delete) {
   fake_network_service_.SetStringResponse("", 200);
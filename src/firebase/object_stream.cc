@@ -0,0 +1,42 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/firebase/object_stream.h"
+
+#include <utility>
+
+namespace firebase {
+
+ObjectStream::ObjectStream(ObjectStreamParser::MemberCallback on_member,
+                           std::function<void(Status)> on_done)
+    : parser_(std::move(on_member)),
+      on_done_(std::move(on_done)),
+      drainer_(this) {}
+
+ObjectStream::~ObjectStream() {}
+
+void ObjectStream::Start(mx::socket source) {
+  drainer_.Start(std::move(source));
+}
+
+void ObjectStream::OnDataAvailable(const void* data, size_t num_bytes) {
+  if (parse_error_) {
+    // Keep draining the socket, but ignore the rest of the data.
+    return;
+  }
+  parse_error_ = !parser_.Parse(
+      ftl::StringView(static_cast<const char*>(data), num_bytes));
+}
+
+void ObjectStream::OnDataComplete() {
+  Status status = (parse_error_ || !parser_.Finish()) ? Status::PARSE_ERROR
+                                                      : Status::OK;
+  ftl::Closure on_empty_callback = std::move(on_empty_callback_);
+  on_done_(status);
+  // This class might be deleted here. Do not access any field.
+  if (on_empty_callback)
+    on_empty_callback();
+}
+
+}  // namespace firebase
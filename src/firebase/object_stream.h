@@ -0,0 +1,52 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPS_LEDGER_SRC_FIREBASE_OBJECT_STREAM_H_
+#define APPS_LEDGER_SRC_FIREBASE_OBJECT_STREAM_H_
+
+#include <functional>
+#include <utility>
+
+#include "apps/ledger/src/firebase/object_stream_parser.h"
+#include "apps/ledger/src/firebase/status.h"
+#include "lib/ftl/functional/closure.h"
+#include "lib/ftl/macros.h"
+#include "lib/mtl/socket/socket_drainer.h"
+
+namespace firebase {
+
+// Drains a socket holding a JSON object, passing its members to the client as
+// they are received. See ObjectStreamParser.
+class ObjectStream : public mtl::SocketDrainer::Client {
+ public:
+  ObjectStream(ObjectStreamParser::MemberCallback on_member,
+               std::function<void(Status)> on_done);
+  ~ObjectStream() override;
+
+  // Starts draining |source|. |on_done| is called once all the data has been
+  // received, with PARSE_ERROR if the data is not an object or if the parsing
+  // was aborted by |on_member|.
+  void Start(mx::socket source);
+
+  void set_on_empty(ftl::Closure on_empty_callback) {
+    on_empty_callback_ = std::move(on_empty_callback);
+  }
+
+ private:
+  // mtl::SocketDrainer::Client:
+  void OnDataAvailable(const void* data, size_t num_bytes) override;
+  void OnDataComplete() override;
+
+  ObjectStreamParser parser_;
+  std::function<void(Status)> on_done_;
+  bool parse_error_ = false;
+  mtl::SocketDrainer drainer_;
+  ftl::Closure on_empty_callback_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(ObjectStream);
+};
+
+}  // namespace firebase
+
+#endif  // APPS_LEDGER_SRC_FIREBASE_OBJECT_STREAM_H_
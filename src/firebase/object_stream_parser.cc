@@ -0,0 +1,215 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/firebase/object_stream_parser.h"
+
+#include <utility>
+
+#include "lib/ftl/logging.h"
+
+namespace firebase {
+
+namespace {
+
+constexpr ftl::StringView kNull = "null";
+
+bool IsWhitespace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+}  // namespace
+
+ObjectStreamParser::ObjectStreamParser(MemberCallback on_member)
+    : on_member_(std::move(on_member)) {}
+
+ObjectStreamParser::~ObjectStreamParser() {}
+
+bool ObjectStreamParser::Parse(ftl::StringView chunk) {
+  if (state_ == State::ERROR) {
+    return false;
+  }
+  for (char c : chunk) {
+    if (!ParseChar(c)) {
+      state_ = State::ERROR;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ObjectStreamParser::Finish() {
+  return state_ == State::DONE;
+}
+
+bool ObjectStreamParser::ParseChar(char c) {
+  switch (state_) {
+    case State::START:
+      if (IsWhitespace(c)) {
+        return true;
+      }
+      if (c == '{') {
+        state_ = State::BEFORE_FIRST_KEY;
+        return true;
+      }
+      if (c == kNull[0]) {
+        state_ = State::NULL_LITERAL;
+        null_position_ = 1;
+        return true;
+      }
+      return false;
+    case State::NULL_LITERAL:
+      if (c != kNull[null_position_]) {
+        return false;
+      }
+      if (++null_position_ == kNull.size()) {
+        state_ = State::DONE;
+      }
+      return true;
+    case State::BEFORE_FIRST_KEY:
+      if (c == '}') {
+        state_ = State::DONE;
+        return true;
+      }
+    // Fallthrough.
+    case State::BEFORE_KEY:
+      if (IsWhitespace(c)) {
+        return true;
+      }
+      if (c != '"') {
+        return false;
+      }
+      key_.assign(1, c);
+      escaped_ = false;
+      state_ = State::KEY;
+      return true;
+    case State::KEY:
+      key_.push_back(c);
+      if (escaped_) {
+        escaped_ = false;
+      } else if (c == '\\') {
+        escaped_ = true;
+      } else if (c == '"') {
+        state_ = State::AFTER_KEY;
+      }
+      return true;
+    case State::AFTER_KEY:
+      if (IsWhitespace(c)) {
+        return true;
+      }
+      if (c != ':') {
+        return false;
+      }
+      state_ = State::BEFORE_VALUE;
+      return true;
+    case State::BEFORE_VALUE:
+      if (IsWhitespace(c)) {
+        return true;
+      }
+      value_.clear();
+      depth_ = 0;
+      in_string_ = false;
+      escaped_ = false;
+      state_ = State::VALUE;
+      return ParseValueChar(c);
+    case State::VALUE:
+      return ParseValueChar(c);
+    case State::AFTER_VALUE:
+      if (IsWhitespace(c)) {
+        return true;
+      }
+      if (c == ',') {
+        state_ = State::BEFORE_KEY;
+        return true;
+      }
+      if (c == '}') {
+        state_ = State::DONE;
+        return true;
+      }
+      return false;
+    case State::DONE:
+      return IsWhitespace(c);
+    case State::ERROR:
+      return false;
+  }
+  FTL_NOTREACHED();
+  return false;
+}
+
+bool ObjectStreamParser::ParseValueChar(char c) {
+  if (in_string_) {
+    value_.push_back(c);
+    if (escaped_) {
+      escaped_ = false;
+    } else if (c == '\\') {
+      escaped_ = true;
+    } else if (c == '"') {
+      in_string_ = false;
+      if (depth_ == 0) {
+        // End of a string value.
+        state_ = State::AFTER_VALUE;
+        return OnMember();
+      }
+    }
+    return true;
+  }
+
+  switch (c) {
+    case '"':
+      in_string_ = true;
+      value_.push_back(c);
+      return true;
+    case '{':
+    case '[':
+      ++depth_;
+      value_.push_back(c);
+      return true;
+    case '}':
+    case ']':
+      if (depth_ == 0) {
+        break;
+      }
+      value_.push_back(c);
+      if (--depth_ == 0) {
+        state_ = State::AFTER_VALUE;
+        return OnMember();
+      }
+      return true;
+    case ',':
+      if (depth_ == 0) {
+        break;
+      }
+      value_.push_back(c);
+      return true;
+    default:
+      if (depth_ == 0 && IsWhitespace(c)) {
+        break;
+      }
+      value_.push_back(c);
+      return true;
+  }
+
+  // |c| ends a number or a literal and belongs to the enclosing object.
+  state_ = State::AFTER_VALUE;
+  return OnMember() && ParseChar(c);
+}
+
+bool ObjectStreamParser::OnMember() {
+  rapidjson::Document key;
+  key.Parse(key_.c_str(), key_.size());
+  if (key.HasParseError() || !key.IsString()) {
+    return false;
+  }
+
+  rapidjson::Document value;
+  value.Parse(value_.c_str(), value_.size());
+  if (value.HasParseError()) {
+    return false;
+  }
+  value_.clear();
+
+  return on_member_(std::string(key.GetString(), key.GetStringLength()),
+                    value);
+}
+
+}  // namespace firebase
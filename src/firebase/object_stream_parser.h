@@ -0,0 +1,83 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPS_LEDGER_SRC_FIREBASE_OBJECT_STREAM_PARSER_H_
+#define APPS_LEDGER_SRC_FIREBASE_OBJECT_STREAM_PARSER_H_
+
+#include <functional>
+#include <string>
+
+#include "lib/ftl/macros.h"
+#include "lib/ftl/strings/string_view.h"
+
+#include <rapidjson/document.h>
+
+namespace firebase {
+
+// Incrementally parses a JSON object received in chunks of arbitrary size.
+//
+// Each member of the object is parsed and handed to the client as soon as it
+// has been received in full, after which its data is released: memory usage is
+// bounded by the size of the largest member, not by the size of the object. A
+// JSON null, which Firebase returns for empty locations, is parsed as an empty
+// object.
+class ObjectStreamParser {
+ public:
+  // Called for each member of the object, in order. Returning false aborts
+  // the parsing.
+  using MemberCallback = std::function<bool(const std::string& key,
+                                            const rapidjson::Value& value)>;
+
+  explicit ObjectStreamParser(MemberCallback on_member);
+  ~ObjectStreamParser();
+
+  // Parses the next |chunk| of the object. Returns false if the data is not a
+  // valid JSON object or if the parsing was aborted by the member callback. All
+  // subsequent calls return false after an error.
+  bool Parse(ftl::StringView chunk);
+
+  // Returns true if the data parsed so far forms a complete object.
+  bool Finish();
+
+ private:
+  enum class State {
+    START,
+    NULL_LITERAL,
+    BEFORE_FIRST_KEY,
+    BEFORE_KEY,
+    KEY,
+    AFTER_KEY,
+    BEFORE_VALUE,
+    VALUE,
+    AFTER_VALUE,
+    DONE,
+    ERROR
+  };
+
+  bool ParseChar(char c);
+  // Handles the next character of the current value.
+  bool ParseValueChar(char c);
+  // Parses the member made of |key_| and |value_| and hands it to the client.
+  bool OnMember();
+
+  MemberCallback on_member_;
+  State state_ = State::START;
+  // Number of characters of "null" matched so far.
+  size_t null_position_ = 0;
+  // Raw JSON text of the key and of the value of the current member.
+  std::string key_;
+  std::string value_;
+  // Nesting level of objects and arrays in |value_|.
+  size_t depth_ = 0;
+  // Whether the last character was inside a string, and whether it was an
+  // escaping backslash.
+  bool in_string_ = false;
+  bool escaped_ = false;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(ObjectStreamParser);
+};
+
+}  // namespace firebase
+
+#endif  // APPS_LEDGER_SRC_FIREBASE_OBJECT_STREAM_PARSER_H_
@@ -0,0 +1,114 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/firebase/object_stream_parser.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/ftl/macros.h"
+
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+namespace firebase {
+namespace {
+
+class ObjectStreamParserTest : public ::testing::Test {
+ public:
+  ObjectStreamParserTest()
+      : parser_([this](const std::string& key, const rapidjson::Value& value) {
+          keys_.push_back(key);
+          rapidjson::StringBuffer buffer;
+          rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+          value.Accept(writer);
+          values_.push_back(buffer.GetString());
+          return accept_members_;
+        }) {}
+  ~ObjectStreamParserTest() override {}
+
+ protected:
+  ObjectStreamParser parser_;
+  std::vector<std::string> keys_;
+  std::vector<std::string> values_;
+  bool accept_members_ = true;
+
+ private:
+  FTL_DISALLOW_COPY_AND_ASSIGN(ObjectStreamParserTest);
+};
+
+TEST_F(ObjectStreamParserTest, Object) {
+  EXPECT_TRUE(parser_.Parse(
+      "{\"a\": {\"b\": [1, \"}\"]}, \"c\\\"\" : 42 ,\"d\":\"e,\\\"}\","
+      "\"f\":true}"));
+  EXPECT_TRUE(parser_.Finish());
+
+  EXPECT_EQ(std::vector<std::string>({"a", "c\"", "d", "f"}), keys_);
+  EXPECT_EQ(std::vector<std::string>(
+                {"{\"b\":[1,\"}\"]}", "42", "\"e,\\\"}\"", "true"}),
+            values_);
+}
+
+TEST_F(ObjectStreamParserTest, ChunkedObject) {
+  std::string json = "{\"a\": {\"b\": 1}, \"c\": 42, \"d\": \"e\"}";
+  // Feed the object one character at a time: members must be reported as soon
+  // as they are complete.
+  for (size_t i = 0; i < json.size(); ++i) {
+    EXPECT_TRUE(parser_.Parse(ftl::StringView(json.data() + i, 1)));
+    if (i == json.find(',')) {
+      EXPECT_EQ(std::vector<std::string>({"a"}), keys_);
+    }
+  }
+  EXPECT_TRUE(parser_.Finish());
+
+  EXPECT_EQ(std::vector<std::string>({"a", "c", "d"}), keys_);
+  EXPECT_EQ(std::vector<std::string>({"{\"b\":1}", "42", "\"e\""}), values_);
+}
+
+TEST_F(ObjectStreamParserTest, EmptyObject) {
+  EXPECT_TRUE(parser_.Parse(" { } "));
+  EXPECT_TRUE(parser_.Finish());
+  EXPECT_TRUE(keys_.empty());
+}
+
+TEST_F(ObjectStreamParserTest, Null) {
+  EXPECT_TRUE(parser_.Parse("nu"));
+  EXPECT_TRUE(parser_.Parse("ll"));
+  EXPECT_TRUE(parser_.Finish());
+  EXPECT_TRUE(keys_.empty());
+}
+
+TEST_F(ObjectStreamParserTest, Incomplete) {
+  EXPECT_TRUE(parser_.Parse("{\"a\": 1, \"b\": {"));
+  EXPECT_FALSE(parser_.Finish());
+  EXPECT_EQ(std::vector<std::string>({"a"}), keys_);
+}
+
+TEST_F(ObjectStreamParserTest, Malformed) {
+  const std::vector<std::string> inputs = {
+      "[1, 2]", "\"a\"", "nul1", "{\"a\"}", "{\"a\": 1,}", "{a: 1}",
+      "{\"a\": tru}", "{\"a\": 1} 2", "{\"a\": {\"b\": 1]}",
+  };
+  for (const auto& input : inputs) {
+    ObjectStreamParser parser(
+        [](const std::string& key, const rapidjson::Value& value) {
+          return true;
+        });
+    bool result = parser.Parse(input) && parser.Finish();
+    EXPECT_FALSE(result) << input;
+    // Errors are sticky.
+    EXPECT_FALSE(parser.Parse(" "));
+  }
+}
+
+TEST_F(ObjectStreamParserTest, Abort) {
+  accept_members_ = false;
+  EXPECT_FALSE(parser_.Parse("{\"a\": 1, \"b\": 2}"));
+  EXPECT_FALSE(parser_.Finish());
+  EXPECT_EQ(std::vector<std::string>({"a"}), keys_);
+}
+
+}  // namespace
+}  // namespace firebase
@@ -4,6 +4,8 @@
 
 #include "apps/ledger/src/glue/crypto/base64.h"
 
+#include <string.h>
+
 #include <openssl/base64.h>
 
 #include "lib/ftl/logging.h"
@@ -20,6 +22,26 @@ uint8_t* ToUnsigned(std::string& str) {
   return reinterpret_cast<uint8_t*>(&str[0]);
 }
 
+const char kBase64UrlAlphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+// Marks the bytes that are not part of the base64url alphabet in
+// |Base64UrlReverseTable()|.
+constexpr uint8_t kInvalid = 0xFF;
+
+// Returns the table mapping each byte to its value in the base64url alphabet.
+const uint8_t* Base64UrlReverseTable() {
+  static const uint8_t* const table = [] {
+    static uint8_t table[256];
+    memset(table, kInvalid, sizeof(table));
+    for (uint8_t i = 0; i < 64; ++i) {
+      table[static_cast<uint8_t>(kBase64UrlAlphabet[i])] = i;
+    }
+    return table;
+  }();
+  return table;
+}
+
 }  // namespace
 
 void Base64Encode(ftl::StringView input, std::string* output) {
@@ -51,4 +73,92 @@ bool Base64Decode(ftl::StringView input, std::string* output) {
   return result;
 }
 
+void Base64UrlEncode(ftl::StringView input, std::string* output) {
+  const uint8_t* data = ToUnsigned(input);
+  size_t size = input.size();
+  std::string tmp_output;
+  tmp_output.resize((size * 4 + 2) / 3);
+  char* out = &tmp_output[0];
+
+  // Encode each group of 3 bytes as 4 characters of 6 bits.
+  size_t i = 0;
+  for (; i + 3 <= size; i += 3) {
+    uint32_t group = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+    *out++ = kBase64UrlAlphabet[(group >> 18) & 0x3F];
+    *out++ = kBase64UrlAlphabet[(group >> 12) & 0x3F];
+    *out++ = kBase64UrlAlphabet[(group >> 6) & 0x3F];
+    *out++ = kBase64UrlAlphabet[group & 0x3F];
+  }
+
+  // The last 1 or 2 bytes, without padding.
+  if (i + 1 == size) {
+    uint32_t group = data[i] << 16;
+    *out++ = kBase64UrlAlphabet[(group >> 18) & 0x3F];
+    *out++ = kBase64UrlAlphabet[(group >> 12) & 0x3F];
+  } else if (i + 2 == size) {
+    uint32_t group = (data[i] << 16) | (data[i + 1] << 8);
+    *out++ = kBase64UrlAlphabet[(group >> 18) & 0x3F];
+    *out++ = kBase64UrlAlphabet[(group >> 12) & 0x3F];
+    *out++ = kBase64UrlAlphabet[(group >> 6) & 0x3F];
+  }
+  FTL_DCHECK(out == tmp_output.data() + tmp_output.size());
+
+  output->swap(tmp_output);
+}
+
+bool Base64UrlDecode(ftl::StringView input, std::string* output) {
+  // A single character can't encode a whole byte.
+  if (input.size() % 4 == 1) {
+    return false;
+  }
+
+  const uint8_t* table = Base64UrlReverseTable();
+  const uint8_t* data = ToUnsigned(input);
+  size_t size = input.size();
+  std::string tmp_output;
+  tmp_output.resize(size * 3 / 4);
+  char* out = &tmp_output[0];
+
+  // Decode each group of 4 characters as 3 bytes. Invalid characters are
+  // accumulated in |invalid| and checked once at the end.
+  uint8_t invalid = 0;
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    uint8_t a = table[data[i]];
+    uint8_t b = table[data[i + 1]];
+    uint8_t c = table[data[i + 2]];
+    uint8_t d = table[data[i + 3]];
+    invalid |= (a | b | c | d) & 0xC0;
+    uint32_t group = (a << 18) | (b << 12) | (c << 6) | d;
+    *out++ = static_cast<char>(group >> 16);
+    *out++ = static_cast<char>(group >> 8);
+    *out++ = static_cast<char>(group);
+  }
+
+  // The last 2 or 3 characters. The bits past the last byte must be zero, so
+  // that each byte string has a single encoding.
+  if (i + 2 == size) {
+    uint8_t a = table[data[i]];
+    uint8_t b = table[data[i + 1]];
+    invalid |= ((a | b) & 0xC0) | (b & 0x0F);
+    *out++ = static_cast<char>((a << 2) | (b >> 4));
+  } else if (i + 3 == size) {
+    uint8_t a = table[data[i]];
+    uint8_t b = table[data[i + 1]];
+    uint8_t c = table[data[i + 2]];
+    invalid |= ((a | b | c) & 0xC0) | (c & 0x03);
+    uint32_t group = (a << 18) | (b << 12) | (c << 6);
+    *out++ = static_cast<char>(group >> 16);
+    *out++ = static_cast<char>(group >> 8);
+  }
+
+  if (invalid) {
+    return false;
+  }
+  FTL_DCHECK(out == tmp_output.data() + tmp_output.size());
+
+  output->swap(tmp_output);
+  return true;
+}
+
 }  // namespace glue
@@ -19,6 +19,16 @@ void Base64Encode(ftl::StringView input, std::string* output);
 // be done in-place.
 bool Base64Decode(ftl::StringView input, std::string* output);
 
+// Encodes the input string in unpadded base64url (RFC 4648, section 5), whose
+// alphabet is safe to use in URLs, file names and Firebase keys. The encoding
+// can be done in-place.
+void Base64UrlEncode(ftl::StringView input, std::string* output);
+
+// Decodes the unpadded base64url input string. Returns true if successful and
+// false otherwise. The output string is only modified if successful. The
+// decoding can be done in-place.
+bool Base64UrlDecode(ftl::StringView input, std::string* output);
+
 }  // namespace glue
 
 #endif  // GLUE_CRYPTO_BASE64_H_
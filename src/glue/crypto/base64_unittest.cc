@@ -0,0 +1,63 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/glue/crypto/base64.h"
+
+#include <string>
+#include <utility>
+
+#include "gtest/gtest.h"
+
+namespace glue {
+namespace {
+
+TEST(Base64Test, UrlEncode) {
+  // Test vectors from RFC 4648, without padding.
+  const std::pair<std::string, std::string> vectors[] = {
+      {"", ""},
+      {"f", "Zg"},
+      {"fo", "Zm8"},
+      {"foo", "Zm9v"},
+      {"foob", "Zm9vYg"},
+      {"fooba", "Zm9vYmE"},
+      {"foobar", "Zm9vYmFy"},
+      {"\xFF\xEF\xFE", "_-_-"},
+  };
+  for (const auto& vector : vectors) {
+    std::string encoded;
+    Base64UrlEncode(vector.first, &encoded);
+    EXPECT_EQ(vector.second, encoded);
+
+    std::string decoded;
+    EXPECT_TRUE(Base64UrlDecode(encoded, &decoded));
+    EXPECT_EQ(vector.first, decoded);
+  }
+}
+
+TEST(Base64Test, UrlBackAndForth) {
+  std::string bytes;
+  for (size_t i = 0; i < 256; ++i) {
+    bytes.push_back(static_cast<char>(i));
+    std::string value = bytes;
+    Base64UrlEncode(value, &value);
+    EXPECT_TRUE(Base64UrlDecode(value, &value));
+    EXPECT_EQ(bytes, value);
+  }
+}
+
+TEST(Base64Test, UrlDecodeInvalid) {
+  std::string output = "unchanged";
+  // Wrong length.
+  EXPECT_FALSE(Base64UrlDecode("Zm9vY", &output));
+  // Padding and characters of the standard alphabet are not allowed.
+  EXPECT_FALSE(Base64UrlDecode("Zg==", &output));
+  EXPECT_FALSE(Base64UrlDecode("Zm+v", &output));
+  EXPECT_FALSE(Base64UrlDecode("Zm/v", &output));
+  // Non canonical encoding of "f".
+  EXPECT_FALSE(Base64UrlDecode("Zh", &output));
+  EXPECT_EQ("unchanged", output);
+}
+
+}  // namespace
+}  // namespace glue
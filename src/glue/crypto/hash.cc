@@ -33,10 +33,8 @@ void SHA256StreamingHash::Finish(std::string* output) {
 std::string SHA256Hash(const void* input, size_t input_lenght) {
   std::string result;
   result.resize(SHA256_DIGEST_LENGTH);
-  SHA256_CTX sha256;
-  SHA256_Init(&sha256);
-  SHA256_Update(&sha256, input, input_lenght);
-  SHA256_Final(reinterpret_cast<uint8_t*>(&result[0]), &sha256);
+  SHA256(static_cast<const uint8_t*>(input), input_lenght,
+         reinterpret_cast<uint8_t*>(&result[0]));
   return result;
 }
 
@@ -12,6 +12,10 @@
 
 namespace glue {
 
+// The SHA-256 functions below are backed by BoringSSL, which selects at runtime
+// the implementation using the SHA extensions of the CPU (SHA-NI on x86, the
+// ARMv8 cryptography extensions on ARM) when they are available.
+
 class SHA256StreamingHash {
  public:
   SHA256StreamingHash();
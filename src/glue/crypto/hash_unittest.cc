@@ -0,0 +1,25 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/glue/crypto/hash.h"
+
+#include "gtest/gtest.h"
+
+namespace glue {
+namespace {
+
+TEST(HashTest, StreamingHashMatchesHash) {
+  std::string value = "Hello world";
+  SHA256StreamingHash streaming_hash;
+  streaming_hash.Update(value.data(), 5);
+  streaming_hash.Update(value.data() + 5, value.size() - 5);
+  std::string result;
+  streaming_hash.Finish(&result);
+
+  EXPECT_EQ(32u, result.size());
+  EXPECT_EQ(SHA256Hash(value.data(), value.size()), result);
+}
+
+}  // namespace
+}  // namespace glue
@@ -30,6 +30,10 @@ class FakeObject : public Object {
     *data = content_;
     return Status::OK;
   }
+  Status GetSize(uint64_t* size) const override {
+    *size = content_.size();
+    return Status::OK;
+  }
 
  private:
   ObjectId id_;
@@ -190,6 +194,30 @@ void FakePageStorage::GetEntryFromCommit(
   callback(Status::OK, Entry{key, entry.value, entry.priority});
 }
 
+void FakePageStorage::GetEntriesFromCommit(
+    const Commit& commit,
+    std::vector<std::string> keys,
+    std::function<void(Status, std::vector<Entry>)> callback) {
+  FakeJournalDelegate* journal = journals_[commit.GetId()].get();
+  if (!journal) {
+    callback(Status::NOT_FOUND, std::vector<Entry>());
+    return;
+  }
+  const std::map<std::string, fake::FakeJournalDelegate::Entry,
+                 convert::StringViewComparator>& data = journal->GetData();
+  std::vector<Entry> entries;
+  for (auto& key : keys) {
+    auto it = data.find(key);
+    if (it == data.end()) {
+      callback(Status::NOT_FOUND, std::vector<Entry>());
+      return;
+    }
+    entries.push_back(
+        Entry{std::move(key), it->second.value, it->second.priority});
+  }
+  callback(Status::OK, std::move(entries));
+}
+
 const std::map<std::string, std::unique_ptr<FakeJournalDelegate>>&
 FakePageStorage::GetJournals() const {
   return journals_;
@@ -52,6 +52,10 @@ class FakePageStorage : public test::PageStorageEmptyImpl {
   void GetEntryFromCommit(const Commit& commit,
                           std::string key,
                           std::function<void(Status, Entry)> callback) override;
+  void GetEntriesFromCommit(
+      const Commit& commit,
+      std::vector<std::string> keys,
+      std::function<void(Status, std::vector<Entry>)> callback) override;
 
   // For testing:
   void set_autocommit(bool autocommit) { autocommit_ = autocommit; }
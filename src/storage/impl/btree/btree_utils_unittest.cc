@@ -816,6 +816,38 @@ TEST_F(BTreeUtilsTest, ForEachEntryPrefix) {
   ASSERT_FALSE(RunLoopWithTimeout());
 }
 
+TEST_F(BTreeUtilsTest, GetEntries) {
+  // Create a tree from entries with keys from 00-99.
+  std::vector<EntryChange> entries;
+  ASSERT_TRUE(CreateEntryChanges(100, &entries));
+  ObjectId root_id = CreateTree(entries);
+
+  std::vector<std::string> keys;
+  for (int i = 0; i < 100; i += 7) {
+    keys.push_back(ftl::StringPrintf("key%02d", i));
+  }
+  Status status;
+  std::vector<Entry> found_entries;
+  GetEntries(&coroutine_service_, &fake_storage_, root_id, keys,
+             callback::Capture([this] { message_loop_.PostQuitTask(); },
+                               &status, &found_entries));
+  ASSERT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(Status::OK, status);
+  ASSERT_EQ(keys.size(), found_entries.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    EXPECT_EQ(keys[i], found_entries[i].key);
+    EXPECT_EQ(entries[7 * i].entry.object_id, found_entries[i].object_id);
+  }
+
+  // A missing key makes the whole lookup fail.
+  keys.push_back("key99_missing");
+  GetEntries(&coroutine_service_, &fake_storage_, root_id, keys,
+             callback::Capture([this] { message_loop_.PostQuitTask(); },
+                               &status, &found_entries));
+  ASSERT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(Status::NOT_FOUND, status);
+}
+
 TEST_F(BTreeUtilsTest, ForEachDiff) {
   std::unique_ptr<const Object> object;
   ASSERT_TRUE(AddObject("change1", &object));
@@ -849,7 +881,7 @@ TEST_F(BTreeUtilsTest, ForEachDiff) {
   // ForEachDiff should return all changes just applied.
   size_t current_change = 0;
   ForEachDiff(
-      &coroutine_service_, &fake_storage_, base_root_id, other_root_id,
+      &coroutine_service_, &fake_storage_, base_root_id, other_root_id, "",
       [&changes, &current_change](EntryChange e) {
         EXPECT_EQ(changes[current_change].deleted, e.deleted);
         if (e.deleted) {
@@ -866,6 +898,55 @@ TEST_F(BTreeUtilsTest, ForEachDiff) {
   EXPECT_EQ(changes.size(), current_change);
 }
 
+TEST_F(BTreeUtilsTest, ForEachDiffWithMinKey) {
+  std::unique_ptr<const Object> object;
+  ASSERT_TRUE(AddObject("change1", &object));
+  ObjectId object_id = object->GetId();
+
+  std::vector<EntryChange> changes;
+  ASSERT_TRUE(CreateEntryChanges(50, &changes));
+  ObjectId base_root_id = CreateTree(changes);
+  changes.clear();
+  // Update value for key1.
+  changes.push_back(
+      EntryChange{Entry{"key1", object_id, KeyPriority::LAZY}, false});
+  // Add entry key255.
+  changes.push_back(
+      EntryChange{Entry{"key255", object_id, KeyPriority::LAZY}, false});
+  // Remove entry key40.
+  changes.push_back(EntryChange{Entry{"key40", "", KeyPriority::LAZY}, true});
+
+  Status status;
+  ObjectId other_root_id;
+  std::unordered_set<ObjectId> new_nodes;
+  ApplyChanges(
+      &coroutine_service_, &fake_storage_, base_root_id,
+      std::make_unique<EntryChangeIterator>(changes.begin(), changes.end()),
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status,
+                        &other_root_id, &new_nodes),
+      &kTestNodeLevelCalculator);
+  ASSERT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(Status::OK, status);
+
+  // ForEachDiff with a min_key should skip the change on key1.
+  std::vector<EntryChange> found_changes;
+  ForEachDiff(&coroutine_service_, &fake_storage_, base_root_id, other_root_id,
+              "key2",
+              [&found_changes](EntryChange e) {
+                found_changes.push_back(std::move(e));
+                return true;
+              },
+              callback::Capture([this] { message_loop_.PostQuitTask(); },
+                                &status));
+  ASSERT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(Status::OK, status);
+  ASSERT_EQ(2u, found_changes.size());
+  EXPECT_EQ(changes[1].entry, found_changes[0].entry);
+  EXPECT_FALSE(found_changes[0].deleted);
+  EXPECT_EQ(changes[2].entry.key, found_changes[1].entry.key);
+  EXPECT_TRUE(found_changes[1].deleted);
+}
+
 }  // namespace
 }  // namespace btree
 }  // namespace storage
@@ -71,10 +71,11 @@ class NodeBuilder {
   // Returns whether the builder is null.
   explicit operator bool() const { return type_ != BuilderType::NULL_NODE; }
 
-  // Apply the given mutation on |node_builder|.
+  // Apply the given mutation on |node_builder|. |change| is only read: the
+  // builder copies the parts of it that it needs to retain.
   Status Apply(const NodeLevelCalculator* node_level_calculator,
                SynchronousStorage* page_storage,
-               EntryChange change,
+               const EntryChange& change,
                bool* did_mutate);
 
   // Build the tree node represented by the builder |node_builder| in the
@@ -125,7 +126,7 @@ class NodeBuilder {
   // greater or equal then the node level.
   Status Delete(SynchronousStorage* page_storage,
                 uint8_t key_level,
-                std::string key,
+                const std::string& key,
                 bool* did_mutate);
 
   // Update the tree by adding |entry| (or modifying the value associated to
@@ -133,14 +134,14 @@ class NodeBuilder {
   // |change_level| must be greater or equal than the node level.
   Status Update(SynchronousStorage* page_storage,
                 uint8_t change_level,
-                Entry entry,
+                const Entry& entry,
                 bool* did_mutate);
 
   // Split the current tree in 2 according to |key|. This method expects that
   // |key| is not in the tree. After the call, the left tree will be in the
   // current builder, and the right tree in |right|.
   Status Split(SynchronousStorage* page_storage,
-               std::string key,
+               const std::string& key,
                NodeBuilder* right);
 
   // Merge this tree with |other|. This expects all elements of |other| to be
@@ -233,7 +234,7 @@ Status NodeBuilder::FromId(SynchronousStorage* page_storage,
 
 Status NodeBuilder::Apply(const NodeLevelCalculator* node_level_calculator,
                           SynchronousStorage* page_storage,
-                          EntryChange change,
+                          const EntryChange& change,
                           bool* did_mutate) {
   if (!*this) {
     // If the change is a deletion, and the tree is null, the result is still
@@ -245,7 +246,7 @@ Status NodeBuilder::Apply(const NodeLevelCalculator* node_level_calculator,
 
     // Otherwise, create a node of the right level that contains only entry.
     std::vector<Entry> entries;
-    entries.push_back(std::move(change.entry));
+    entries.push_back(change.entry);
     *this = NodeBuilder::CreateNewBuilder(
         node_level_calculator->GetNodeLevel(change.entry.key),
         std::move(entries), std::vector<NodeBuilder>(2));
@@ -265,8 +266,8 @@ Status NodeBuilder::Apply(const NodeLevelCalculator* node_level_calculator,
                entries_[index].key != change.entry.key);
 
     NodeBuilder& child = children_[index];
-    RETURN_ON_ERROR(child.Apply(node_level_calculator, page_storage,
-                                std::move(change), did_mutate));
+    RETURN_ON_ERROR(
+        child.Apply(node_level_calculator, page_storage, change, did_mutate));
     if (!*did_mutate) {
       return Status::OK;
     }
@@ -281,12 +282,10 @@ Status NodeBuilder::Apply(const NodeLevelCalculator* node_level_calculator,
   }
 
   if (change.deleted) {
-    return Delete(page_storage, change_level, std::move(change.entry.key),
-                  did_mutate);
+    return Delete(page_storage, change_level, change.entry.key, did_mutate);
   }
 
-  return Update(page_storage, change_level, std::move(change.entry),
-                did_mutate);
+  return Update(page_storage, change_level, change.entry, did_mutate);
 }
 
 Status NodeBuilder::Build(SynchronousStorage* page_storage,
@@ -366,7 +365,7 @@ Status NodeBuilder::ComputeContent(SynchronousStorage* page_storage) {
 
 Status NodeBuilder::Delete(SynchronousStorage* page_storage,
                            uint8_t key_level,
-                           std::string key,
+                           const std::string& key,
                            bool* did_mutate) {
   FTL_DCHECK(*this);
   FTL_DCHECK(key_level >= level_);
@@ -406,7 +405,7 @@ Status NodeBuilder::Delete(SynchronousStorage* page_storage,
 
 Status NodeBuilder::Update(SynchronousStorage* page_storage,
                            uint8_t change_level,
-                           Entry entry,
+                           const Entry& entry,
                            bool* did_mutate) {
   FTL_DCHECK(*this);
   FTL_DCHECK(change_level >= level_);
@@ -419,7 +418,7 @@ Status NodeBuilder::Update(SynchronousStorage* page_storage,
     RETURN_ON_ERROR(Split(page_storage, entry.key, &right));
 
     std::vector<Entry> entries;
-    entries.push_back(std::move(entry));
+    entries.push_back(entry);
     std::vector<NodeBuilder> children;
     children.push_back(std::move(this->ToLevel(change_level - 1)));
     children.push_back(std::move(right.ToLevel(change_level - 1)));
@@ -447,7 +446,7 @@ Status NodeBuilder::Update(SynchronousStorage* page_storage,
 
     type_ = BuilderType::NEW_NODE;
     *did_mutate = true;
-    entries_[split_index].object_id = std::move(entry.object_id);
+    entries_[split_index].object_id = entry.object_id;
     return Status::OK;
   }
 
@@ -460,14 +459,14 @@ Status NodeBuilder::Update(SynchronousStorage* page_storage,
       children_[split_index].Split(page_storage, entry.key, &right));
 
   // Add |entry| to the list of entries of the result node.
-  entries_.insert(entries_.begin() + split_index, std::move(entry));
+  entries_.insert(entries_.begin() + split_index, entry);
   // Append the right node to the list of children.
   children_.insert(children_.begin() + split_index + 1, std::move(right));
   return Status::OK;
 }
 
 Status NodeBuilder::Split(SynchronousStorage* page_storage,
-                          std::string key,
+                          const std::string& key,
                           NodeBuilder* right) {
   if (!*this) {
     *right = NodeBuilder();
@@ -501,7 +500,7 @@ Status NodeBuilder::Split(SynchronousStorage* page_storage,
   // Recursively call |Split| on the child.
   NodeBuilder sub_right;
   RETURN_ON_ERROR(
-      child_to_split.Split(page_storage, std::move(key), &sub_right));
+      child_to_split.Split(page_storage, key, &sub_right));
 
   std::vector<Entry> right_entries;
 
@@ -592,13 +591,12 @@ Status ApplyChangesOnRoot(const NodeLevelCalculator* node_level_calculator,
                           ObjectId* object_id,
                           std::unordered_set<ObjectId>* new_ids) {
   Status status;
-  while (changes->Valid()) {
-    EntryChange change = std::move(**changes);
-    changes->Next();
-
+  // |changes| may reuse the same EntryChange for all its elements: each change
+  // must be fully applied before moving to the next one.
+  for (; changes->Valid(); changes->Next()) {
     bool did_mutate;
-    status = root.Apply(node_level_calculator, page_storage, std::move(change),
-                        &did_mutate);
+    status =
+        root.Apply(node_level_calculator, page_storage, **changes, &did_mutate);
     if (status != Status::OK) {
       return status;
     }
@@ -26,9 +26,11 @@ struct NodeLevelCalculator {
 const NodeLevelCalculator* GetDefaultNodeLevelCalculator();
 
 // Applies changes provided by |changes| to the BTree starting at |root_id|.
-// |changes| must provide |EntryChange| objects sorted by their key. The
-// callback will provide the status of the operation, the id of the new root
-// and the list of ids of all new nodes created after the changes.
+// |changes| must provide |EntryChange| objects sorted by their key. Each change
+// is applied before |changes| is advanced, so |changes| may reuse the same
+// EntryChange for all its elements. The callback will provide the status of
+// the operation, the id of the new root and the list of ids of all new nodes
+// created after the changes.
 void ApplyChanges(
     coroutine::CoroutineService* coroutine_service,
     PageStorage* page_storage,
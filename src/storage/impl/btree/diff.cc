@@ -20,10 +20,17 @@ class IteratorPair {
                const std::function<bool(EntryChange)>& on_next)
       : on_next_(on_next), left_(storage), right_(storage) {}
 
-  // Initialize the pair with the ids of both roots.
-  Status Init(ObjectIdView left_node_id, ObjectIdView right_node_id) {
+  // Initialize the pair with the ids of both roots, and position both
+  // iterators on the first key equal to or greater than |min_key|.
+  Status Init(ObjectIdView left_node_id,
+              ObjectIdView right_node_id,
+              ftl::StringView min_key) {
     RETURN_ON_ERROR(left_.Init(left_node_id));
     RETURN_ON_ERROR(right_.Init(right_node_id));
+    if (!min_key.empty()) {
+      RETURN_ON_ERROR(left_.SkipTo(min_key));
+      RETURN_ON_ERROR(right_.SkipTo(min_key));
+    }
     Normalize();
     if (!Finished() && !HasDiff()) {
       RETURN_ON_ERROR(Advance());
@@ -226,13 +233,14 @@ class IteratorPair {
 Status ForEachDiffInternal(SynchronousStorage* storage,
                            ObjectIdView left_node_id,
                            ObjectIdView right_node_id,
+                           ftl::StringView min_key,
                            const std::function<bool(EntryChange)>& on_next) {
   if (left_node_id == right_node_id) {
     return Status::OK;
   }
 
   IteratorPair iterators(storage, on_next);
-  RETURN_ON_ERROR(iterators.Init(left_node_id, right_node_id));
+  RETURN_ON_ERROR(iterators.Init(left_node_id, right_node_id, min_key));
 
   while (!iterators.Finished()) {
     if (!iterators.SendDiff()) {
@@ -250,16 +258,17 @@ void ForEachDiff(coroutine::CoroutineService* coroutine_service,
                  PageStorage* page_storage,
                  ObjectIdView base_root_id,
                  ObjectIdView other_root_id,
+                 std::string min_key,
                  std::function<bool(EntryChange)> on_next,
                  std::function<void(Status)> on_done) {
   coroutine_service->StartCoroutine([
-    page_storage, base_root_id, other_root_id, on_next = std::move(on_next),
-    on_done = std::move(on_done)
+    page_storage, base_root_id, other_root_id, min_key = std::move(min_key),
+    on_next = std::move(on_next), on_done = std::move(on_done)
   ](coroutine::CoroutineHandler * handler) {
     SynchronousStorage storage(page_storage, handler);
 
-    on_done(
-        ForEachDiffInternal(&storage, base_root_id, other_root_id, on_next));
+    on_done(ForEachDiffInternal(&storage, base_root_id, other_root_id, min_key,
+                                on_next));
   });
 }
 
@@ -15,14 +15,16 @@ namespace storage {
 namespace btree {
 
 // Iterates through the differences between two trees given their root ids
-// |base_root_id| and |other_root_id| and calls |on_next| on found differences.
-// Returning false from |on_next| will immediately stop the iteration. |on_done|
-// is called once, upon successfull completion, i.e. when there are no more
-// differences or iteration was interrupted, or if an error occurs.
+// |base_root_id| and |other_root_id| and calls |on_next| on found differences
+// with a key equal to or greater than |min_key|. Returning false from |on_next|
+// will immediately stop the iteration. |on_done| is called once, upon
+// successfull completion, i.e. when there are no more differences or iteration
+// was interrupted, or if an error occurs.
 void ForEachDiff(coroutine::CoroutineService* coroutine_service,
                  PageStorage* page_storage,
                  ObjectIdView base_root_id,
                  ObjectIdView other_root_id,
+                 std::string min_key,
                  std::function<bool(EntryChange)> on_next,
                  std::function<void(Status)> on_done);
 
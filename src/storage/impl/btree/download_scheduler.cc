@@ -0,0 +1,95 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/storage/impl/btree/download_scheduler.h"
+
+#include <utility>
+
+#include "lib/ftl/functional/make_copyable.h"
+#include "lib/ftl/logging.h"
+
+namespace storage {
+namespace btree {
+
+DownloadScheduler::DownloadScheduler(PageStorage* page_storage,
+                                     size_t max_concurrent_downloads)
+    : page_storage_(page_storage),
+      max_concurrent_downloads_(max_concurrent_downloads),
+      weak_factory_(this) {
+  FTL_DCHECK(page_storage);
+  FTL_DCHECK(max_concurrent_downloads > 0);
+}
+
+DownloadScheduler::~DownloadScheduler() {}
+
+void DownloadScheduler::GetObject(
+    ObjectIdView object_id,
+    Priority priority,
+    std::function<void(Status, std::unique_ptr<const Object>)> callback) {
+  Request request{object_id.ToString(), std::move(callback)};
+  // Objects available locally don't need a download slot: check for them
+  // first.
+  page_storage_->GetObject(
+      object_id, PageStorage::Location::LOCAL, ftl::MakeCopyable([
+        weak_this = weak_factory_.GetWeakPtr(), request = std::move(request),
+        priority
+      ](Status status, std::unique_ptr<const Object> object) mutable {
+        if (!weak_this) {
+          return;
+        }
+        if (status != Status::NOT_FOUND) {
+          request.callback(status, std::move(object));
+          return;
+        }
+        weak_this->Enqueue(std::move(request), priority);
+      }));
+}
+
+void DownloadScheduler::Enqueue(Request request, Priority priority) {
+  if (priority == Priority::NODE) {
+    pending_nodes_.push_back(std::move(request));
+  } else {
+    pending_values_.push_back(std::move(request));
+  }
+  StartPendingDownloads();
+}
+
+void DownloadScheduler::StartPendingDownloads() {
+  while (downloads_in_flight_ < max_concurrent_downloads_) {
+    std::deque<Request>* queue;
+    if (!pending_nodes_.empty()) {
+      queue = &pending_nodes_;
+    } else if (!pending_values_.empty()) {
+      queue = &pending_values_;
+    } else {
+      return;
+    }
+    Request request = std::move(queue->front());
+    queue->pop_front();
+    Download(std::move(request));
+  }
+}
+
+void DownloadScheduler::Download(Request request) {
+  downloads_in_flight_++;
+  ObjectId object_id = request.object_id;
+  page_storage_->GetObject(
+      object_id, PageStorage::Location::NETWORK, ftl::MakeCopyable([
+        weak_this = weak_factory_.GetWeakPtr(),
+        callback = std::move(request.callback)
+      ](Status status, std::unique_ptr<const Object> object) {
+        if (!weak_this) {
+          return;
+        }
+        weak_this->downloads_in_flight_--;
+        callback(status, std::move(object));
+        // The scheduler might have been deleted by the callback.
+        if (weak_this) {
+          weak_this->StartPendingDownloads();
+        }
+      }));
+}
+
+}  // namespace btree
+}  // namespace storage
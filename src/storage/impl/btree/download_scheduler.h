@@ -0,0 +1,73 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPS_LEDGER_SRC_STORAGE_IMPL_BTREE_DOWNLOAD_SCHEDULER_H_
+#define APPS_LEDGER_SRC_STORAGE_IMPL_BTREE_DOWNLOAD_SCHEDULER_H_
+
+#include <deque>
+#include <functional>
+#include <memory>
+
+#include "apps/ledger/src/storage/public/object.h"
+#include "apps/ledger/src/storage/public/page_storage.h"
+#include "apps/ledger/src/storage/public/types.h"
+#include "lib/ftl/macros.h"
+#include "lib/ftl/memory/weak_ptr.h"
+
+namespace storage {
+namespace btree {
+
+// Retrieves objects for a tree traversal, downloading at most a given number
+// of them concurrently. Objects already available locally are returned without
+// waiting for a download slot. Pending tree nodes are downloaded before pending
+// values, as the content of the nodes is needed to find the next objects to
+// retrieve.
+//
+// Pending requests are dropped, without calling their callbacks, when the
+// scheduler is deleted.
+class DownloadScheduler {
+ public:
+  enum class Priority { NODE, VALUE };
+
+  DownloadScheduler(PageStorage* page_storage, size_t max_concurrent_downloads);
+  ~DownloadScheduler();
+
+  // Retrieves the object with the given id, downloading it from the network if
+  // it is not available locally.
+  void GetObject(
+      ObjectIdView object_id,
+      Priority priority,
+      std::function<void(Status, std::unique_ptr<const Object>)> callback);
+
+  size_t downloads_in_flight() const { return downloads_in_flight_; }
+
+ private:
+  struct Request {
+    ObjectId object_id;
+    std::function<void(Status, std::unique_ptr<const Object>)> callback;
+  };
+
+  // Queues the download of an object missing locally.
+  void Enqueue(Request request, Priority priority);
+  // Starts the pending downloads, by order of priority, while download slots
+  // are available.
+  void StartPendingDownloads();
+  void Download(Request request);
+
+  PageStorage* const page_storage_;
+  const size_t max_concurrent_downloads_;
+  std::deque<Request> pending_nodes_;
+  std::deque<Request> pending_values_;
+  size_t downloads_in_flight_ = 0;
+
+  // Must be the last member.
+  ftl::WeakPtrFactory<DownloadScheduler> weak_factory_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(DownloadScheduler);
+};
+
+}  // namespace btree
+}  // namespace storage
+
+#endif  // APPS_LEDGER_SRC_STORAGE_IMPL_BTREE_DOWNLOAD_SCHEDULER_H_
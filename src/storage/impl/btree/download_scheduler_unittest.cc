@@ -0,0 +1,173 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/storage/impl/btree/download_scheduler.h"
+
+#include <functional>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "apps/ledger/src/storage/test/page_storage_empty_impl.h"
+#include "gtest/gtest.h"
+#include "lib/ftl/macros.h"
+
+namespace storage {
+namespace btree {
+namespace {
+
+class TestObject : public Object {
+ public:
+  explicit TestObject(ObjectId id) : id_(std::move(id)) {}
+  ~TestObject() override {}
+
+  ObjectId GetId() const override { return id_; }
+
+  Status GetData(ftl::StringView* data) const override {
+    *data = id_;
+    return Status::OK;
+  }
+
+  Status GetSize(uint64_t* size) const override {
+    *size = id_.size();
+    return Status::OK;
+  }
+
+ private:
+  ObjectId id_;
+};
+
+// Fake implementation of PageStorage. Serves the local objects immediately and
+// keeps the network requests pending until the test completes them.
+class TestPageStorage : public test::PageStorageEmptyImpl {
+ public:
+  TestPageStorage() {}
+  ~TestPageStorage() override {}
+
+  void GetObject(
+      ObjectIdView object_id,
+      Location location,
+      const std::function<void(Status, std::unique_ptr<const Object>)>&
+          callback) override {
+    if (local_objects.count(object_id.ToString())) {
+      callback(Status::OK, std::make_unique<TestObject>(object_id.ToString()));
+      return;
+    }
+    if (location == Location::LOCAL) {
+      callback(Status::NOT_FOUND, nullptr);
+      return;
+    }
+    network_requests.push_back(object_id.ToString());
+    pending_callbacks.push_back(callback);
+  }
+
+  // Completes the oldest pending network request.
+  void CompleteNextRequest(Status status) {
+    auto callback = std::move(pending_callbacks.front());
+    pending_callbacks.erase(pending_callbacks.begin());
+    callback(status, nullptr);
+  }
+
+  std::set<ObjectId> local_objects;
+  std::vector<ObjectId> network_requests;
+  std::vector<std::function<void(Status, std::unique_ptr<const Object>)>>
+      pending_callbacks;
+};
+
+class DownloadSchedulerTest : public ::testing::Test {
+ public:
+  DownloadSchedulerTest() {}
+  ~DownloadSchedulerTest() override {}
+
+ protected:
+  // Requests the object with the given id, and appends its id to
+  // |retrieved_objects_| once it is retrieved.
+  void GetObject(DownloadScheduler* scheduler,
+                 ObjectId object_id,
+                 DownloadScheduler::Priority priority) {
+    scheduler->GetObject(
+        object_id, priority,
+        [this, object_id](Status status, std::unique_ptr<const Object> object) {
+          EXPECT_EQ(Status::OK, status);
+          retrieved_objects_.push_back(object_id);
+        });
+  }
+
+  TestPageStorage storage_;
+  std::vector<ObjectId> retrieved_objects_;
+
+ private:
+  FTL_DISALLOW_COPY_AND_ASSIGN(DownloadSchedulerTest);
+};
+
+TEST_F(DownloadSchedulerTest, LocalObjects) {
+  DownloadScheduler scheduler(&storage_, 1u);
+  storage_.local_objects = {"node", "value"};
+
+  GetObject(&scheduler, "node", DownloadScheduler::Priority::NODE);
+  GetObject(&scheduler, "value", DownloadScheduler::Priority::VALUE);
+
+  // Local objects are returned without issuing network requests.
+  EXPECT_EQ(std::vector<ObjectId>({"node", "value"}), retrieved_objects_);
+  EXPECT_TRUE(storage_.network_requests.empty());
+  EXPECT_EQ(0u, scheduler.downloads_in_flight());
+}
+
+TEST_F(DownloadSchedulerTest, BoundedConcurrentDownloads) {
+  DownloadScheduler scheduler(&storage_, 2u);
+  for (int i = 0; i < 5; ++i) {
+    GetObject(&scheduler, "value" + std::to_string(i),
+              DownloadScheduler::Priority::VALUE);
+  }
+
+  EXPECT_EQ(2u, storage_.network_requests.size());
+  EXPECT_EQ(2u, scheduler.downloads_in_flight());
+
+  storage_.CompleteNextRequest(Status::OK);
+  EXPECT_EQ(3u, storage_.network_requests.size());
+  EXPECT_EQ(2u, scheduler.downloads_in_flight());
+
+  while (!storage_.pending_callbacks.empty()) {
+    storage_.CompleteNextRequest(Status::OK);
+    EXPECT_GE(2u, scheduler.downloads_in_flight());
+  }
+  EXPECT_EQ(5u, storage_.network_requests.size());
+  EXPECT_EQ(5u, retrieved_objects_.size());
+  EXPECT_EQ(0u, scheduler.downloads_in_flight());
+}
+
+TEST_F(DownloadSchedulerTest, NodesBeforeValues) {
+  DownloadScheduler scheduler(&storage_, 1u);
+  GetObject(&scheduler, "value1", DownloadScheduler::Priority::VALUE);
+  GetObject(&scheduler, "value2", DownloadScheduler::Priority::VALUE);
+  GetObject(&scheduler, "node1", DownloadScheduler::Priority::NODE);
+  GetObject(&scheduler, "node2", DownloadScheduler::Priority::NODE);
+
+  while (!storage_.pending_callbacks.empty()) {
+    storage_.CompleteNextRequest(Status::OK);
+  }
+
+  // The first value took the only download slot, but the pending nodes are
+  // downloaded before the pending values.
+  EXPECT_EQ(std::vector<ObjectId>({"value1", "node1", "node2", "value2"}),
+            storage_.network_requests);
+  EXPECT_EQ(storage_.network_requests, retrieved_objects_);
+}
+
+TEST_F(DownloadSchedulerTest, DeleteWithPendingDownloads) {
+  auto scheduler = std::make_unique<DownloadScheduler>(&storage_, 1u);
+  GetObject(scheduler.get(), "value1", DownloadScheduler::Priority::VALUE);
+  GetObject(scheduler.get(), "value2", DownloadScheduler::Priority::VALUE);
+  scheduler.reset();
+
+  // The callbacks of the dropped requests are not called.
+  storage_.CompleteNextRequest(Status::OK);
+  EXPECT_TRUE(retrieved_objects_.empty());
+  EXPECT_EQ(std::vector<ObjectId>({"value1"}), storage_.network_requests);
+}
+
+}  // namespace
+}  // namespace btree
+}  // namespace storage
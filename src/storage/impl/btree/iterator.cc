@@ -4,7 +4,10 @@
 
 #include "apps/ledger/src/storage/impl/btree/iterator.h"
 
+#include <algorithm>
+
 #include "apps/ledger/src/callback/waiter.h"
+#include "apps/ledger/src/storage/impl/btree/download_scheduler.h"
 #include "apps/ledger/src/storage/impl/btree/internal_helper.h"
 #include "lib/ftl/functional/make_copyable.h"
 
@@ -13,6 +16,10 @@ namespace btree {
 
 namespace {
 
+// Maximal number of objects downloaded concurrently when retrieving a tree from
+// sync.
+constexpr size_t kMaxConcurrentDownloads = 10;
+
 Status ForEachEntryInternal(
     SynchronousStorage* storage,
     ObjectIdView root_id,
@@ -33,6 +40,112 @@ Status ForEachEntryInternal(
   return Status::OK;
 }
 
+// Appends to |entries| the entries with the keys in [|begin|, |end|) from the
+// subtree rooted at |node_id|.
+Status GetEntriesInternal(SynchronousStorage* storage,
+                          ObjectIdView node_id,
+                          std::vector<std::string>::const_iterator begin,
+                          std::vector<std::string>::const_iterator end,
+                          std::vector<Entry>* entries) {
+  if (begin == end) {
+    return Status::OK;
+  }
+  if (node_id.empty()) {
+    return Status::NOT_FOUND;
+  }
+  std::unique_ptr<const TreeNode> node;
+  RETURN_ON_ERROR(storage->TreeNodeFromId(node_id, &node));
+  const std::vector<Entry>& node_entries = node->entries();
+  const std::vector<ObjectId>& children_ids = node->children_ids();
+  auto key_it = begin;
+  for (size_t i = 0; key_it != end; ++i) {
+    if (i == node_entries.size()) {
+      // All remaining keys are in the last child.
+      return GetEntriesInternal(storage, children_ids[i], key_it, end,
+                                entries);
+    }
+    // Keys lower than the i-th entry are in the i-th child.
+    auto child_end = std::lower_bound(key_it, end, node_entries[i].key);
+    RETURN_ON_ERROR(
+        GetEntriesInternal(storage, children_ids[i], key_it, child_end,
+                           entries));
+    key_it = child_end;
+    while (key_it != end && *key_it == node_entries[i].key) {
+      entries->push_back(node_entries[i]);
+      ++key_it;
+    }
+  }
+  return Status::OK;
+}
+
+// Retrieves the tree rooted at |root_id| level by level: the nodes of a level
+// are retrieved concurrently, and the values of their eager entries are
+// retrieved in the background while the next levels are explored.
+Status GetObjectsFromSyncInternal(PageStorage* page_storage,
+                                  coroutine::CoroutineHandler* handler,
+                                  ObjectIdView root_id) {
+  DownloadScheduler scheduler(page_storage, kMaxConcurrentDownloads);
+  auto values_waiter = callback::StatusWaiter<Status>::Create(Status::OK);
+
+  std::vector<ObjectId> level = {root_id.ToString()};
+  while (!level.empty()) {
+    auto nodes_waiter =
+        callback::Waiter<Status, std::unique_ptr<const Object>>::Create(
+            Status::OK);
+    for (const auto& node_id : level) {
+      scheduler.GetObject(node_id, DownloadScheduler::Priority::NODE,
+                          nodes_waiter->NewCallback());
+    }
+    Status status;
+    std::vector<std::unique_ptr<const Object>> objects;
+    if (coroutine::SyncCall(
+            handler,
+            [nodes_waiter](
+                std::function<void(
+                    Status, std::vector<std::unique_ptr<const Object>>)>
+                    callback) { nodes_waiter->Finalize(std::move(callback)); },
+            &status, &objects)) {
+      return Status::ILLEGAL_STATE;
+    }
+    RETURN_ON_ERROR(status);
+
+    std::vector<ObjectId> next_level;
+    for (auto& object : objects) {
+      std::unique_ptr<const TreeNode> node;
+      RETURN_ON_ERROR(
+          TreeNode::FromObject(page_storage, std::move(object), &node));
+      for (const auto& entry : node->entries()) {
+        if (entry.priority != KeyPriority::EAGER) {
+          continue;
+        }
+        scheduler.GetObject(
+            entry.object_id, DownloadScheduler::Priority::VALUE,
+            [callback = values_waiter->NewCallback()](
+                Status value_status, std::unique_ptr<const Object> value) {
+              callback(value_status);
+            });
+      }
+      for (const auto& child_id : node->children_ids()) {
+        if (!child_id.empty()) {
+          next_level.push_back(child_id);
+        }
+      }
+    }
+    level = std::move(next_level);
+  }
+
+  Status status;
+  if (coroutine::SyncCall(
+          handler,
+          [values_waiter](std::function<void(Status)> callback) {
+            values_waiter->Finalize(std::move(callback));
+          },
+          &status)) {
+    return Status::ILLEGAL_STATE;
+  }
+  return status;
+}
+
 }  // namespace
 
 BTreeIterator::BTreeIterator(SynchronousStorage* storage) : storage_(storage) {}
@@ -186,28 +299,12 @@ void GetObjectsFromSync(coroutine::CoroutineService* coroutine_service,
                         PageStorage* page_storage,
                         ObjectIdView root_id,
                         std::function<void(Status)> callback) {
-  ftl::RefPtr<callback::Waiter<Status, std::unique_ptr<const Object>>> waiter_ =
-      callback::Waiter<Status, std::unique_ptr<const Object>>::Create(
-          Status::OK);
-  auto on_next = [page_storage, waiter_](EntryAndNodeId e) {
-    if (e.entry.priority == KeyPriority::EAGER) {
-      page_storage->GetObject(e.entry.object_id, PageStorage::Location::NETWORK,
-                              waiter_->NewCallback());
-    }
-    return true;
-  };
-  auto on_done = [ callback = std::move(callback), waiter_ ](Status status) {
-    if (status != Status::OK) {
-      callback(status);
-      return;
-    }
-    waiter_->Finalize([callback = std::move(callback)](
-        Status s, std::vector<std::unique_ptr<const Object>> objects) {
-      callback(s);
-    });
-  };
-  ForEachEntry(coroutine_service, page_storage, root_id, "", std::move(on_next),
-               std::move(on_done));
+  FTL_DCHECK(!root_id.empty());
+  coroutine_service->StartCoroutine([
+    page_storage, root_id = root_id.ToString(), callback = std::move(callback)
+  ](coroutine::CoroutineHandler * handler) {
+    callback(GetObjectsFromSyncInternal(page_storage, handler, root_id));
+  });
 }
 
 void ForEachEntry(coroutine::CoroutineService* coroutine_service,
@@ -227,5 +324,30 @@ void ForEachEntry(coroutine::CoroutineService* coroutine_service,
   });
 }
 
+void GetEntries(coroutine::CoroutineService* coroutine_service,
+                PageStorage* page_storage,
+                ObjectIdView root_id,
+                std::vector<std::string> keys,
+                std::function<void(Status, std::vector<Entry>)> callback) {
+  FTL_DCHECK(!root_id.empty());
+  FTL_DCHECK(std::is_sorted(keys.begin(), keys.end()));
+  coroutine_service->StartCoroutine([
+    page_storage, root_id, keys = std::move(keys),
+    callback = std::move(callback)
+  ](coroutine::CoroutineHandler * handler) {
+    SynchronousStorage storage(page_storage, handler);
+
+    std::vector<Entry> entries;
+    entries.reserve(keys.size());
+    Status status = GetEntriesInternal(&storage, root_id, keys.begin(),
+                                       keys.end(), &entries);
+    if (status != Status::OK) {
+      callback(status, std::vector<Entry>());
+      return;
+    }
+    callback(Status::OK, std::move(entries));
+  });
+}
+
 }  // namespace btree
 }  // namespace storage
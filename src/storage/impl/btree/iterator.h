@@ -97,8 +97,9 @@ void GetObjectIds(coroutine::CoroutineService* coroutine_service,
                   std::function<void(Status, std::set<ObjectId>)> callback);
 
 // Tries to download all tree nodes and values with EAGER priority that are not
-// locally available from sync. To do this PageStorage::GetObject is called for
-// all corresponding objects.
+// locally available from sync. The tree is retrieved level by level, with a
+// bounded number of concurrent downloads, tree nodes being downloaded before
+// values. Objects available locally are not requested from the network.
 void GetObjectsFromSync(coroutine::CoroutineService* coroutine_service,
                         PageStorage* page_storage,
                         ObjectIdView root_id,
@@ -118,6 +119,17 @@ void ForEachEntry(coroutine::CoroutineService* coroutine_service,
                   std::function<bool(EntryAndNodeId)> on_next,
                   std::function<void(Status)> on_done);
 
+// Retrieves the entries with the given |keys| from the tree with the given
+// root. |keys| must be sorted. All keys are looked up in a single traversal of
+// the tree: each tree node is read at most once, and only if it may contain one
+// of the keys. |callback| is called with the entries, in the order of |keys|,
+// or with |NOT_FOUND| if one of the keys is not in the tree.
+void GetEntries(coroutine::CoroutineService* coroutine_service,
+                PageStorage* page_storage,
+                ObjectIdView root_id,
+                std::vector<std::string> keys,
+                std::function<void(Status, std::vector<Entry>)> callback);
+
 }  // namespace btree
 }  // namespace storage
 
@@ -28,6 +28,12 @@ class TreeNode {
       ObjectIdView id,
       std::function<void(Status, std::unique_ptr<const TreeNode>)> callback);
 
+  // Creates a |TreeNode| object for an existing |object| and stores it in the
+  // given |node|.
+  static Status FromObject(PageStorage* page_storage,
+                           std::unique_ptr<const Object> object,
+                           std::unique_ptr<const TreeNode>* node);
+
   // Creates a |TreeNode| object with the given entries and children. An empty
   // id in the children's vector indicates that there is no child in that
   // index. The |callback| will be called with the success or error status and
@@ -84,12 +90,6 @@ class TreeNode {
            std::vector<Entry> entries,
            std::vector<ObjectId> children);
 
-  // Creates a |TreeNode| object for an existing |object| and stores it in the
-  // given |node|.
-  static Status FromObject(PageStorage* page_storage,
-                           std::unique_ptr<const Object> object,
-                           std::unique_ptr<const TreeNode>* node);
-
   PageStorage* page_storage_;
   ObjectId id_;
   const uint8_t level_;
@@ -5,6 +5,7 @@
 #ifndef APPS_LEDGER_SRC_STORAGE_IMPL_DB_H_
 #define APPS_LEDGER_SRC_STORAGE_IMPL_DB_H_
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -29,8 +30,15 @@ class DB {
     Batch() {}
     virtual ~Batch() {}
 
+    // Writes the batch synchronously.
     virtual Status Execute() = 0;
 
+    // Writes the batch without blocking the calling thread. |callback| is
+    // called on the thread that started the batch, with the result of the
+    // write. |callback| is not called if the DB object is deleted before the
+    // write completes.
+    virtual void Execute(std::function<void(Status)> callback) = 0;
+
    private:
     FTL_DISALLOW_COPY_AND_ASSIGN(Batch);
   };
@@ -68,6 +76,10 @@ class DB {
   virtual Status GetCommitStorageBytes(CommitIdView commit_id,
                                        std::string* storage_bytes) = 0;
 
+  // Returns |OK| if the commit with the given |commit_id| is in the database or
+  // |NOT_FOUND| if not. The storage bytes of the commit are not read.
+  virtual Status ContainsCommit(CommitIdView commit_id) = 0;
+
   // Adds the given |commit| in the database.
   virtual Status AddCommitStorageBytes(const CommitId& commit_id,
                                        ftl::StringView storage_bytes) = 0;
@@ -75,6 +87,20 @@ class DB {
   // Removes the commit with the given |commit_id| from the commits.
   virtual Status RemoveCommit(const CommitId& commit_id) = 0;
 
+  // Remote commits.
+  // Remote commits are commits of the history of the page that are not stored
+  // locally, but are available from sync.
+
+  // Adds the given |commit_id| in the set of remote commits.
+  virtual Status AddRemoteCommitId(const CommitId& commit_id) = 0;
+
+  // Removes the given |commit_id| from the remote commits.
+  virtual Status RemoveRemoteCommitId(const CommitId& commit_id) = 0;
+
+  // Returns |OK| if the commit with the given |commit_id| is a remote commit
+  // or |NOT_FOUND| if not.
+  virtual Status ContainsRemoteCommit(CommitIdView commit_id) = 0;
+
   // Journals.
   // Creates a new |Journal| with the given |base| commit id and stores it on
   // the |journal| parameter.
@@ -138,7 +164,9 @@ class DB {
                                   std::vector<std::string>* values) = 0;
 
   // Finds all the entries of the journal with the given |journal_id| and stores
-  // an interator over the results on |entires|.
+  // an interator over the results on |entires|. The iterator may reuse the same
+  // EntryChange for all the entries: the EntryChange of an entry is only valid
+  // until the iterator is advanced.
   virtual Status GetJournalEntries(
       const JournalId& journal_id,
       std::unique_ptr<Iterator<const EntryChange>>* entries) = 0;
@@ -39,6 +39,9 @@ Status DbEmptyImpl::GetCommitStorageBytes(CommitIdView commit_id,
                                           std::string* storage_bytes) {
   return Status::NOT_IMPLEMENTED;
 }
+Status DbEmptyImpl::ContainsCommit(CommitIdView commit_id) {
+  return Status::NOT_IMPLEMENTED;
+}
 Status DbEmptyImpl::AddCommitStorageBytes(const CommitId& commit_id,
                                           ftl::StringView storage_bytes) {
   return Status::NOT_IMPLEMENTED;
@@ -46,6 +49,15 @@ Status DbEmptyImpl::AddCommitStorageBytes(const CommitId& commit_id,
 Status DbEmptyImpl::RemoveCommit(const CommitId& commit_id) {
   return Status::NOT_IMPLEMENTED;
 }
+Status DbEmptyImpl::AddRemoteCommitId(const CommitId& commit_id) {
+  return Status::NOT_IMPLEMENTED;
+}
+Status DbEmptyImpl::RemoveRemoteCommitId(const CommitId& commit_id) {
+  return Status::NOT_IMPLEMENTED;
+}
+Status DbEmptyImpl::ContainsRemoteCommit(CommitIdView commit_id) {
+  return Status::NOT_IMPLEMENTED;
+}
 Status DbEmptyImpl::GetImplicitJournalIds(std::vector<JournalId>* journal_ids) {
   return Status::NOT_IMPLEMENTED;
 }
@@ -29,9 +29,13 @@ class DbEmptyImpl : public DB {
   Status ContainsHead(const CommitId& commit_id) override;
   Status GetCommitStorageBytes(CommitIdView commit_id,
                                std::string* storage_bytes) override;
+  Status ContainsCommit(CommitIdView commit_id) override;
   Status AddCommitStorageBytes(const CommitId& commit_id,
                                ftl::StringView storage_bytes) override;
   Status RemoveCommit(const CommitId& commit_id) override;
+  Status AddRemoteCommitId(const CommitId& commit_id) override;
+  Status RemoveRemoteCommitId(const CommitId& commit_id) override;
+  Status ContainsRemoteCommit(CommitIdView commit_id) override;
   Status GetImplicitJournalIds(std::vector<JournalId>* journal_ids) override;
   Status GetImplicitJournal(const JournalId& journal_id,
                             std::unique_ptr<Journal>* journal) override;
@@ -4,6 +4,8 @@
 
 #include "apps/ledger/src/storage/impl/db_impl.h"
 
+#include <string.h>
+
 #include <algorithm>
 #include <string>
 
@@ -12,6 +14,7 @@
 #include "apps/ledger/src/storage/impl/journal_db_impl.h"
 #include "apps/ledger/src/storage/impl/page_storage_impl.h"
 #include "lib/ftl/files/directory.h"
+#include "lib/ftl/functional/make_copyable.h"
 #include "lib/ftl/strings/concatenate.h"
 #include "lib/ftl/strings/string_number_conversions.h"
 
@@ -19,19 +22,28 @@ namespace storage {
 
 namespace {
 
-constexpr ftl::StringView kHeadPrefix = "heads/";
-constexpr ftl::StringView kCommitPrefix = "commits/";
-
-// Journal keys
+// Keys are made of the key prefix of the page, empty unless the database is
+// shared by all the pages of a ledger, followed by a one-byte table tag and
+// the key of the row in the table.
+const char kSchemaVersionTag = 0x00;
+const char kHeadTag = 0x01;
+const char kCommitTag = 0x02;
+const char kImplicitJournalMetaTag = 0x03;
+const char kJournalEntryTag = 0x04;
+const char kJournalCounterTag = 0x05;
+const char kUnsyncedCommitTag = 0x06;
+const char kUnsyncedObjectTag = 0x07;
+const char kSyncMetadataTag = 0x08;
+const char kRemoteCommitTag = 0x09;
+
+// Version of the key schema, stored under |kSchemaVersionTag|. Databases
+// without a version use the legacy textual keys.
+constexpr ftl::StringView kKeySchemaVersion = "1";
+
+// Journal ids
 const size_t kJournalIdSize = 16;
-constexpr ftl::StringView kJournalPrefix = "journals/";
-constexpr ftl::StringView kImplicitJournalMetaPrefix = "journals/implicit/";
-constexpr ftl::StringView kJournalEntry = "entry/";
-constexpr ftl::StringView kJournalCounter = "counter/";
 const char kImplicitJournalIdPrefix = 'I';
 const char kExplicitJournalIdPrefix = 'E';
-const size_t kJournalEntryPrefixSize =
-    kJournalPrefix.size() + kJournalIdSize + 1 + kJournalEntry.size();
 // Journal values
 const char kJournalEntryAdd = 'A';
 constexpr ftl::StringView kJournalEntryDelete = "D";
@@ -39,37 +51,103 @@ const char kJournalLazyEntry = 'L';
 const char kJournalEagerEntry = 'E';
 const size_t kJournalEntryAddPrefixSize = 2;
 
-constexpr ftl::StringView kUnsyncedCommitPrefix = "unsynced/commits/";
-constexpr ftl::StringView kUnsyncedObjectPrefix = "unsynced/objects/";
-
-constexpr ftl::StringView kSyncMetadata = "sync-metadata";
-
-std::string GetHeadKeyFor(CommitIdView head) {
-  return ftl::Concatenate({kHeadPrefix, head});
-}
-
-std::string GetCommitKeyFor(CommitIdView commit_id) {
-  return ftl::Concatenate({kCommitPrefix, commit_id});
-}
-
-std::string GetUnsyncedCommitKeyFor(const CommitId& commit_id) {
-  return ftl::Concatenate({kUnsyncedCommitPrefix, commit_id});
-}
+// Prefixes of the legacy textual keys.
+constexpr ftl::StringView kLegacyHeadPrefix = "heads/";
+constexpr ftl::StringView kLegacyCommitPrefix = "commits/";
+constexpr ftl::StringView kLegacyJournalPrefix = "journals/";
+constexpr ftl::StringView kLegacyImplicitJournalMetaPrefix =
+    "journals/implicit/";
+constexpr ftl::StringView kLegacyJournalEntry = "/entry/";
+constexpr ftl::StringView kLegacyJournalCounter = "/counter/";
+constexpr ftl::StringView kLegacyUnsyncedCommitPrefix = "unsynced/commits/";
+constexpr ftl::StringView kLegacyUnsyncedObjectPrefix = "unsynced/objects/";
+constexpr ftl::StringView kLegacySyncMetadata = "sync-metadata";
+
+// A database key: the key prefix of the page, a table tag and the row key,
+// given in up to two parts. Keys fitting in the inline buffer are built
+// without any allocation.
+class DbKey {
+ public:
+  DbKey(ftl::StringView key_prefix,
+        char tag,
+        ftl::StringView part_1 = ftl::StringView(),
+        ftl::StringView part_2 = ftl::StringView())
+      : size_(key_prefix.size() + 1 + part_1.size() + part_2.size()) {
+    char* data = inline_buffer_;
+    if (size_ > sizeof(inline_buffer_)) {
+      heap_buffer_.resize(size_);
+      data = &heap_buffer_[0];
+    }
+    data_ = data;
+    memcpy(data, key_prefix.data(), key_prefix.size());
+    data += key_prefix.size();
+    *data++ = tag;
+    memcpy(data, part_1.data(), part_1.size());
+    data += part_1.size();
+    memcpy(data, part_2.data(), part_2.size());
+  }
 
-std::string GetUnsyncedObjectKeyFor(ObjectIdView object_id) {
-  return ftl::Concatenate({kUnsyncedObjectPrefix, object_id});
-}
+  operator leveldb::Slice() const { return leveldb::Slice(data_, size_); }
 
-std::string GetImplicitJournalMetaKeyFor(const JournalId& journal_id) {
-  return ftl::Concatenate({kImplicitJournalMetaPrefix, journal_id});
-}
+ private:
+  char inline_buffer_[128];
+  std::string heap_buffer_;
+  const char* data_;
+  const size_t size_;
 
-std::string GetJournalEntryPrefixFor(const JournalId& journal_id) {
-  return ftl::Concatenate({kJournalPrefix, journal_id, "/", kJournalEntry});
-}
+  FTL_DISALLOW_COPY_AND_ASSIGN(DbKey);
+};
 
-std::string GetJournalEntryKeyFor(const JournalId id, ftl::StringView key) {
-  return ftl::Concatenate({GetJournalEntryPrefixFor(id), key});
+// Converts |key|, a legacy textual key without the page key prefix, to the
+// current schema. Returns false if |key| is not a known legacy key.
+bool ConvertLegacyKey(ftl::StringView key, std::string* new_key) {
+  auto convert_prefix = [&key, new_key](ftl::StringView legacy_prefix,
+                                        char tag) {
+    if (key.substr(0, legacy_prefix.size()) != legacy_prefix) {
+      return false;
+    }
+    new_key->assign(1, tag);
+    new_key->append(key.data() + legacy_prefix.size(),
+                    key.size() - legacy_prefix.size());
+    return true;
+  };
+  if (convert_prefix(kLegacyHeadPrefix, kHeadTag) ||
+      convert_prefix(kLegacyCommitPrefix, kCommitTag) ||
+      convert_prefix(kLegacyImplicitJournalMetaPrefix,
+                     kImplicitJournalMetaTag) ||
+      convert_prefix(kLegacyUnsyncedCommitPrefix, kUnsyncedCommitTag) ||
+      convert_prefix(kLegacyUnsyncedObjectPrefix, kUnsyncedObjectTag)) {
+    return true;
+  }
+  if (key == kLegacySyncMetadata) {
+    new_key->assign(1, kSyncMetadataTag);
+    return true;
+  }
+  // Journal entries and counters: "journals/<id>/entry/<key>" and
+  // "journals/<id>/counter/<value>".
+  size_t id_end = kLegacyJournalPrefix.size() + kJournalIdSize;
+  if (key.size() < id_end ||
+      key.substr(0, kLegacyJournalPrefix.size()) != kLegacyJournalPrefix) {
+    return false;
+  }
+  ftl::StringView journal_id =
+      key.substr(kLegacyJournalPrefix.size(), kJournalIdSize);
+  ftl::StringView rest = key.substr(id_end);
+  char tag;
+  if (rest.substr(0, kLegacyJournalEntry.size()) == kLegacyJournalEntry) {
+    tag = kJournalEntryTag;
+    rest = rest.substr(kLegacyJournalEntry.size());
+  } else if (rest.substr(0, kLegacyJournalCounter.size()) ==
+             kLegacyJournalCounter) {
+    tag = kJournalCounterTag;
+    rest = rest.substr(kLegacyJournalCounter.size());
+  } else {
+    return false;
+  }
+  new_key->assign(1, tag);
+  new_key->append(journal_id.data(), journal_id.size());
+  new_key->append(rest.data(), rest.size());
+  return true;
 }
 
 std::string GetJournalEntryValueFor(ftl::StringView value,
@@ -87,15 +165,6 @@ Status ExtractObjectId(ftl::StringView db_value, ObjectId* id) {
   return Status::OK;
 }
 
-std::string GetJournalCounterPrefixFor(const JournalId& id) {
-  return ftl::Concatenate({kJournalPrefix, id, "/", kJournalCounter});
-}
-
-std::string GetJournalCounterKeyFor(const JournalId& id,
-                                    ftl::StringView value) {
-  return ftl::Concatenate({GetJournalCounterPrefixFor(id), value});
-}
-
 std::string NewJournalId(JournalType journal_type) {
   std::string id;
   id.resize(kJournalIdSize);
@@ -140,71 +209,116 @@ class JournalEntryIterator : public Iterator<const EntryChange> {
     return it_->status().ok() ? Status::OK : Status::INTERNAL_IO_ERROR;
   }
 
-  const EntryChange& operator*() const override { return *(change_.get()); }
-  const EntryChange* operator->() const override { return change_.get(); }
+  // The returned EntryChange is reused for all entries: it is only valid until
+  // the next call to |Next()|.
+  const EntryChange& operator*() const override { return change_; }
+  const EntryChange* operator->() const override { return &change_; }
 
  private:
+  // Fills |change_| with the current entry. The strings of |change_| are
+  // assigned in place so that their buffers are reused across entries.
   void PrepareEntry() {
     if (!Valid()) {
-      change_.reset(nullptr);
       return;
     }
-    change_ = std::make_unique<EntryChange>();
 
     leveldb::Slice key_slice = it_->key();
-    key_slice.remove_prefix(kJournalEntryPrefixSize);
-    change_->entry.key = key_slice.ToString();
+    key_slice.remove_prefix(prefix_.size());
+    change_.entry.key.assign(key_slice.data(), key_slice.size());
 
     leveldb::Slice value = it_->value();
     if (value.data()[0] == kJournalEntryAdd) {
-      change_->deleted = false;
-      change_->entry.priority = (value.data()[1] == kJournalLazyEntry)
-                                    ? KeyPriority::LAZY
-                                    : KeyPriority::EAGER;
+      change_.deleted = false;
+      change_.entry.priority = (value.data()[1] == kJournalLazyEntry)
+                                   ? KeyPriority::LAZY
+                                   : KeyPriority::EAGER;
 
       value.remove_prefix(kJournalEntryAddPrefixSize);
-      change_->entry.object_id = value.ToString();
+      change_.entry.object_id.assign(value.data(), value.size());
     } else {
-      change_->deleted = true;
+      change_.deleted = true;
+      change_.entry.object_id.clear();
     }
   }
 
   std::unique_ptr<leveldb::Iterator> it_;
   const std::string prefix_;
 
-  std::unique_ptr<EntryChange> change_;
+  EntryChange change_;
 };
 
-class BatchImpl : public DB::Batch {
+Status ConvertWriteStatus(leveldb::Status status) {
+  if (!status.ok()) {
+    FTL_LOG(ERROR) << "Fail to execute batch with status: "
+                   << status.ToString();
+    return Status::INTERNAL_IO_ERROR;
+  }
+  return Status::OK;
+}
+
+}  // namespace
+
+class DbImpl::BatchImpl : public DB::Batch {
  public:
-  BatchImpl(std::function<Status(bool)> callback)
-      : callback_(callback), executed_(false) {}
+  explicit BatchImpl(DbImpl* db) : db_(db), executed_(false) {}
 
   ~BatchImpl() override {
     if (!executed_)
-      callback_(false);
+      db_->batch_.reset();
   }
 
   Status Execute() override {
     FTL_DCHECK(!executed_);
     executed_ = true;
-    return callback_(true);
+    return db_->ExecuteBatch(std::move(db_->batch_));
+  }
+
+  void Execute(std::function<void(Status)> callback) override {
+    FTL_DCHECK(!executed_);
+    executed_ = true;
+    db_->ExecuteBatchAsync(std::move(db_->batch_), std::move(callback));
   }
 
  private:
-  std::function<Status(bool)> callback_;
+  DbImpl* const db_;
   bool executed_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(BatchImpl);
 };
 
-}  // namespace
+DbImpl::DbImpl(ftl::RefPtr<ftl::TaskRunner> main_runner,
+               ftl::RefPtr<ftl::TaskRunner> io_runner,
+               coroutine::CoroutineService* coroutine_service,
+               PageStorageImpl* page_storage,
+               std::string db_path,
+               const DbOptions* db_options)
+    : main_runner_(std::move(main_runner)),
+      io_runner_(std::move(io_runner)),
+      coroutine_service_(coroutine_service),
+      page_storage_(page_storage),
+      db_path_(db_path),
+      db_options_(db_options),
+      weak_ptr_factory_(this) {
+  FTL_DCHECK(page_storage);
+}
 
-DbImpl::DbImpl(coroutine::CoroutineService* coroutine_service,
+DbImpl::DbImpl(ftl::RefPtr<ftl::TaskRunner> main_runner,
+               ftl::RefPtr<ftl::TaskRunner> io_runner,
+               coroutine::CoroutineService* coroutine_service,
                PageStorageImpl* page_storage,
-               std::string db_path)
-    : coroutine_service_(coroutine_service),
+               std::shared_ptr<leveldb::DB> db,
+               std::string key_prefix)
+    : main_runner_(std::move(main_runner)),
+      io_runner_(std::move(io_runner)),
+      coroutine_service_(coroutine_service),
       page_storage_(page_storage),
-      db_path_(db_path) {
+      db_options_(nullptr),
+      key_prefix_(std::move(key_prefix)),
+      db_(std::move(db)),
+      weak_ptr_factory_(this) {
   FTL_DCHECK(page_storage);
+  FTL_DCHECK(db_);
+  FTL_DCHECK(!key_prefix_.empty());
 }
 
 DbImpl::~DbImpl() {
@@ -212,12 +326,17 @@ DbImpl::~DbImpl() {
 }
 
 Status DbImpl::Init() {
+  if (db_) {
+    // The database is shared and already opened.
+    return MigrateKeySchema();
+  }
   if (!files::CreateDirectory(db_path_)) {
     FTL_LOG(ERROR) << "Failed to create directory under " << db_path_;
     return Status::INTERNAL_IO_ERROR;
   }
   leveldb::DB* db = nullptr;
-  leveldb::Options options;
+  leveldb::Options options =
+      db_options_ ? db_options_->options() : leveldb::Options();
   options.create_if_missing = true;
   leveldb::Status status = leveldb::DB::Open(options, db_path_, &db);
   if (!status.ok()) {
@@ -226,55 +345,60 @@ Status DbImpl::Init() {
     return Status::INTERNAL_IO_ERROR;
   }
   db_.reset(db);
-  return Status::OK;
+  return MigrateKeySchema();
 }
 
 std::unique_ptr<DB::Batch> DbImpl::StartBatch() {
   FTL_DCHECK(!batch_);
   batch_ = std::make_unique<leveldb::WriteBatch>();
-  return std::make_unique<BatchImpl>([this](bool execute) {
-    std::unique_ptr<leveldb::WriteBatch> batch = std::move(batch_);
-    if (execute) {
-      leveldb::Status status = db_->Write(write_options_, batch.get());
-      if (!status.ok()) {
-        FTL_LOG(ERROR) << "Fail to execute batch with status: "
-                       << status.ToString();
-        return Status::INTERNAL_IO_ERROR;
-      }
-    }
-    return Status::OK;
-  });
+  return std::make_unique<BatchImpl>(this);
 }
 
 Status DbImpl::GetHeads(std::vector<CommitId>* heads) {
-  return GetByPrefix(convert::ToSlice(kHeadPrefix), heads);
+  return GetByPrefix(DbKey(key_prefix_, kHeadTag), heads);
 }
 
 Status DbImpl::AddHead(CommitIdView head) {
-  return Put(GetHeadKeyFor(head), "");
+  return Put(DbKey(key_prefix_, kHeadTag, head), "");
 }
 
 Status DbImpl::RemoveHead(CommitIdView head) {
-  return Delete(GetHeadKeyFor(head));
+  return Delete(DbKey(key_prefix_, kHeadTag, head));
 }
 
 Status DbImpl::ContainsHead(const CommitId& commit_id) {
   std::string value;
-  return Get(GetHeadKeyFor(commit_id), &value);
+  return Get(DbKey(key_prefix_, kHeadTag, commit_id), &value);
 }
 
 Status DbImpl::GetCommitStorageBytes(CommitIdView commit_id,
                                      std::string* storage_bytes) {
-  return Get(GetCommitKeyFor(commit_id), storage_bytes);
+  return Get(DbKey(key_prefix_, kCommitTag, commit_id), storage_bytes);
+}
+
+Status DbImpl::ContainsCommit(CommitIdView commit_id) {
+  return HasKey(DbKey(key_prefix_, kCommitTag, commit_id));
 }
 
 Status DbImpl::AddCommitStorageBytes(const CommitId& commit_id,
                                      ftl::StringView storage_bytes) {
-  return Put(GetCommitKeyFor(commit_id), storage_bytes);
+  return Put(DbKey(key_prefix_, kCommitTag, commit_id), storage_bytes);
 }
 
 Status DbImpl::RemoveCommit(const CommitId& commit_id) {
-  return Delete(GetCommitKeyFor(commit_id));
+  return Delete(DbKey(key_prefix_, kCommitTag, commit_id));
+}
+
+Status DbImpl::AddRemoteCommitId(const CommitId& commit_id) {
+  return Put(DbKey(key_prefix_, kRemoteCommitTag, commit_id), "");
+}
+
+Status DbImpl::RemoveRemoteCommitId(const CommitId& commit_id) {
+  return Delete(DbKey(key_prefix_, kRemoteCommitTag, commit_id));
+}
+
+Status DbImpl::ContainsRemoteCommit(CommitIdView commit_id) {
+  return HasKey(DbKey(key_prefix_, kRemoteCommitTag, commit_id));
 }
 
 Status DbImpl::CreateJournal(JournalType journal_type,
@@ -284,7 +408,7 @@ Status DbImpl::CreateJournal(JournalType journal_type,
   *journal = JournalDBImpl::Simple(journal_type, coroutine_service_,
                                    page_storage_, this, id, base);
   if (journal_type == JournalType::IMPLICIT) {
-    return Put(GetImplicitJournalMetaKeyFor(id), base);
+    return Put(DbKey(key_prefix_, kImplicitJournalMetaTag, id), base);
   }
   return Status::OK;
 }
@@ -299,7 +423,7 @@ Status DbImpl::CreateMergeJournal(const CommitId& base,
 }
 
 Status DbImpl::GetImplicitJournalIds(std::vector<JournalId>* journal_ids) {
-  return GetByPrefix(convert::ToSlice(kImplicitJournalMetaPrefix), journal_ids);
+  return GetByPrefix(DbKey(key_prefix_, kImplicitJournalMetaTag), journal_ids);
 }
 
 Status DbImpl::GetImplicitJournal(const JournalId& journal_id,
@@ -307,7 +431,8 @@ Status DbImpl::GetImplicitJournal(const JournalId& journal_id,
   FTL_DCHECK(journal_id.size() == kJournalIdSize);
   FTL_DCHECK(journal_id[0] == kImplicitJournalIdPrefix);
   CommitId base;
-  Status s = Get(GetImplicitJournalMetaKeyFor(journal_id), &base);
+  Status s =
+      Get(DbKey(key_prefix_, kImplicitJournalMetaTag, journal_id), &base);
   if (s == Status::OK) {
     *journal = JournalDBImpl::Simple(JournalType::IMPLICIT, coroutine_service_,
                                      page_storage_, this, journal_id, base);
@@ -316,39 +441,46 @@ Status DbImpl::GetImplicitJournal(const JournalId& journal_id,
 }
 
 Status DbImpl::RemoveExplicitJournals() {
-  static std::string kExplicitJournalPrefix = ftl::Concatenate(
-      {kJournalPrefix, ftl::StringView(&kImplicitJournalIdPrefix, 1)});
-  return DeleteByPrefix(kExplicitJournalPrefix);
+  ftl::StringView explicit_id_prefix(&kExplicitJournalIdPrefix, 1);
+  Status s = DeleteByPrefix(
+      DbKey(key_prefix_, kJournalEntryTag, explicit_id_prefix));
+  if (s != Status::OK) {
+    return s;
+  }
+  return DeleteByPrefix(
+      DbKey(key_prefix_, kJournalCounterTag, explicit_id_prefix));
 }
 
 Status DbImpl::RemoveJournal(const JournalId& journal_id) {
   if (journal_id[0] == kImplicitJournalIdPrefix) {
-    Status s = Delete(GetImplicitJournalMetaKeyFor(journal_id));
+    Status s = Delete(DbKey(key_prefix_, kImplicitJournalMetaTag, journal_id));
     if (s != Status::OK) {
       return s;
     }
   }
-  return DeleteByPrefix(GetJournalEntryPrefixFor(journal_id));
+  return DeleteByPrefix(DbKey(key_prefix_, kJournalEntryTag, journal_id));
 }
 
 Status DbImpl::AddJournalEntry(const JournalId& journal_id,
                                ftl::StringView key,
                                ftl::StringView value,
                                KeyPriority priority) {
-  return Put(GetJournalEntryKeyFor(journal_id, key),
+  return Put(DbKey(key_prefix_, kJournalEntryTag, journal_id, key),
              GetJournalEntryValueFor(value, priority));
 }
 
 Status DbImpl::RemoveJournalEntry(const JournalId& journal_id,
                                   convert::ExtendedStringView key) {
-  return Put(GetJournalEntryKeyFor(journal_id, key), kJournalEntryDelete);
+  return Put(DbKey(key_prefix_, kJournalEntryTag, journal_id, key),
+             kJournalEntryDelete);
 }
 
 Status DbImpl::GetJournalValue(const JournalId& journal_id,
                                ftl::StringView key,
                                std::string* value) {
   std::string db_value;
-  Status s = Get(GetJournalEntryKeyFor(journal_id, key), &db_value);
+  Status s =
+      Get(DbKey(key_prefix_, kJournalEntryTag, journal_id, key), &db_value);
   if (s != Status::OK) {
     return s;
   }
@@ -359,7 +491,9 @@ Status DbImpl::GetJournalEntries(
     const JournalId& journal_id,
     std::unique_ptr<Iterator<const EntryChange>>* entries) {
   std::unique_ptr<leveldb::Iterator> it(db_->NewIterator(read_options_));
-  std::string prefix = GetJournalEntryPrefixFor(journal_id);
+  std::string prefix =
+      leveldb::Slice(DbKey(key_prefix_, kJournalEntryTag, journal_id))
+          .ToString();
   it->Seek(prefix);
 
   *entries = std::make_unique<JournalEntryIterator>(std::move(it), prefix);
@@ -370,7 +504,8 @@ Status DbImpl::GetJournalValueCounter(const JournalId& journal_id,
                                       ftl::StringView value,
                                       int* counter) {
   std::string counter_str;
-  Status s = Get(GetJournalCounterKeyFor(journal_id, value), &counter_str);
+  Status s = Get(DbKey(key_prefix_, kJournalCounterTag, journal_id, value),
+                 &counter_str);
   if (s == Status::NOT_FOUND) {
     *counter = 0;
     return Status::OK;
@@ -387,20 +522,21 @@ Status DbImpl::SetJournalValueCounter(const JournalId& journal_id,
                                       int counter) {
   FTL_DCHECK(counter >= 0);
   if (counter == 0) {
-    return Delete(GetJournalCounterKeyFor(journal_id, value));
+    return Delete(DbKey(key_prefix_, kJournalCounterTag, journal_id, value));
   }
-  return Put(GetJournalCounterKeyFor(journal_id, value),
+  return Put(DbKey(key_prefix_, kJournalCounterTag, journal_id, value),
              ftl::NumberToString(counter));
 }
 Status DbImpl::GetJournalValues(const JournalId& journal_id,
                                 std::vector<std::string>* values) {
-  return GetByPrefix(GetJournalCounterPrefixFor(journal_id), values);
+  return GetByPrefix(DbKey(key_prefix_, kJournalCounterTag, journal_id),
+                     values);
 }
 
 Status DbImpl::GetUnsyncedCommitIds(std::vector<CommitId>* commit_ids) {
   std::vector<std::pair<std::string, std::string>> entries;
   Status s =
-      GetEntriesByPrefix(convert::ToSlice(kUnsyncedCommitPrefix), &entries);
+      GetEntriesByPrefix(DbKey(key_prefix_, kUnsyncedCommitTag), &entries);
   if (s != Status::OK) {
     return s;
   }
@@ -419,18 +555,18 @@ Status DbImpl::GetUnsyncedCommitIds(std::vector<CommitId>* commit_ids) {
 }
 
 Status DbImpl::MarkCommitIdSynced(const CommitId& commit_id) {
-  return Delete(GetUnsyncedCommitKeyFor(commit_id));
+  return Delete(DbKey(key_prefix_, kUnsyncedCommitTag, commit_id));
 }
 
 Status DbImpl::MarkCommitIdUnsynced(const CommitId& commit_id,
                                     int64_t timestamp) {
-  return Put(GetUnsyncedCommitKeyFor(commit_id),
+  return Put(DbKey(key_prefix_, kUnsyncedCommitTag, commit_id),
              ftl::NumberToString(timestamp));
 }
 
 Status DbImpl::IsCommitSynced(const CommitId& commit_id, bool* is_synced) {
   std::string value;
-  Status s = Get(GetUnsyncedCommitKeyFor(commit_id), &value);
+  Status s = Get(DbKey(key_prefix_, kUnsyncedCommitTag, commit_id), &value);
   if (s == Status::INTERNAL_IO_ERROR) {
     return s;
   }
@@ -439,20 +575,20 @@ Status DbImpl::IsCommitSynced(const CommitId& commit_id, bool* is_synced) {
 }
 
 Status DbImpl::GetUnsyncedObjectIds(std::vector<ObjectId>* object_ids) {
-  return GetByPrefix(convert::ToSlice(kUnsyncedObjectPrefix), object_ids);
+  return GetByPrefix(DbKey(key_prefix_, kUnsyncedObjectTag), object_ids);
 }
 
 Status DbImpl::MarkObjectIdSynced(ObjectIdView object_id) {
-  return Delete(GetUnsyncedObjectKeyFor(object_id));
+  return Delete(DbKey(key_prefix_, kUnsyncedObjectTag, object_id));
 }
 
 Status DbImpl::MarkObjectIdUnsynced(ObjectIdView object_id) {
-  return Put(GetUnsyncedObjectKeyFor(object_id), "");
+  return Put(DbKey(key_prefix_, kUnsyncedObjectTag, object_id), "");
 }
 
 Status DbImpl::IsObjectSynced(ObjectIdView object_id, bool* is_synced) {
   std::string value;
-  Status s = Get(GetUnsyncedObjectKeyFor(object_id), &value);
+  Status s = Get(DbKey(key_prefix_, kUnsyncedObjectTag, object_id), &value);
   if (s == Status::INTERNAL_IO_ERROR) {
     return s;
   }
@@ -461,11 +597,34 @@ Status DbImpl::IsObjectSynced(ObjectIdView object_id, bool* is_synced) {
 }
 
 Status DbImpl::SetSyncMetadata(ftl::StringView sync_state) {
-  return Put(kSyncMetadata, sync_state);
+  return Put(DbKey(key_prefix_, kSyncMetadataTag), sync_state);
 }
 
 Status DbImpl::GetSyncMetadata(std::string* sync_state) {
-  return Get(kSyncMetadata, sync_state);
+  return Get(DbKey(key_prefix_, kSyncMetadataTag), sync_state);
+}
+
+Status DbImpl::ExecuteBatch(std::unique_ptr<leveldb::WriteBatch> batch) {
+  return ConvertWriteStatus(db_->Write(write_options_, batch.get()));
+}
+
+void DbImpl::ExecuteBatchAsync(std::unique_ptr<leveldb::WriteBatch> batch,
+                               std::function<void(Status)> callback) {
+  io_runner_->PostTask(ftl::MakeCopyable([
+    db = db_, write_options = write_options_, batch = std::move(batch),
+    main_runner = main_runner_, weak_this = weak_ptr_factory_.GetWeakPtr(),
+    callback = std::move(callback)
+  ]() mutable {
+    // Called on the io runner.
+    Status status = ConvertWriteStatus(db->Write(write_options, batch.get()));
+    main_runner->PostTask(ftl::MakeCopyable(
+        [ weak_this, status, callback = std::move(callback) ] {
+          // Called on the main runner.
+          if (weak_this) {
+            callback(status);
+          }
+        }));
+  }));
 }
 
 Status DbImpl::GetByPrefix(const leveldb::Slice& prefix,
@@ -513,11 +672,21 @@ Status DbImpl::DeleteByPrefix(const leveldb::Slice& prefix) {
   return ConvertStatus(it->status());
 }
 
-Status DbImpl::Get(convert::ExtendedStringView key, std::string* value) {
+Status DbImpl::Get(const leveldb::Slice& key, std::string* value) {
   return ConvertStatus(db_->Get(read_options_, key, value));
 }
 
-Status DbImpl::Put(convert::ExtendedStringView key, ftl::StringView value) {
+Status DbImpl::HasKey(const leveldb::Slice& key) {
+  std::unique_ptr<leveldb::Iterator> it(db_->NewIterator(read_options_));
+  it->Seek(key);
+  if (it->Valid() && it->key() == key) {
+    return Status::OK;
+  }
+  Status s = ConvertStatus(it->status());
+  return s == Status::OK ? Status::NOT_FOUND : s;
+}
+
+Status DbImpl::Put(const leveldb::Slice& key, ftl::StringView value) {
   if (batch_) {
     batch_->Put(key, convert::ToSlice(value));
     return Status::OK;
@@ -525,7 +694,7 @@ Status DbImpl::Put(convert::ExtendedStringView key, ftl::StringView value) {
   return ConvertStatus(db_->Put(write_options_, key, convert::ToSlice(value)));
 }
 
-Status DbImpl::Delete(convert::ExtendedStringView key) {
+Status DbImpl::Delete(const leveldb::Slice& key) {
   if (batch_) {
     batch_->Delete(key);
     return Status::OK;
@@ -533,4 +702,45 @@ Status DbImpl::Delete(convert::ExtendedStringView key) {
   return ConvertStatus(db_->Delete(write_options_, key));
 }
 
+Status DbImpl::MigrateKeySchema() {
+  std::string version;
+  Status s = Get(DbKey(key_prefix_, kSchemaVersionTag), &version);
+  if (s == Status::OK) {
+    if (version != kKeySchemaVersion) {
+      FTL_LOG(ERROR) << "Unsupported key schema version: " << version;
+      return Status::INTERNAL_IO_ERROR;
+    }
+    return Status::OK;
+  }
+  if (s != Status::NOT_FOUND) {
+    return s;
+  }
+
+  // Rewrite all the legacy keys of the page and set the schema version in a
+  // single batch, so that an interrupted migration is restarted from scratch.
+  // If a key is not recognized, nothing is written: the page is left in the
+  // legacy schema rather than losing data.
+  leveldb::WriteBatch batch;
+  std::string new_key;
+  std::unique_ptr<leveldb::Iterator> it(db_->NewIterator(read_options_));
+  for (it->Seek(key_prefix_); it->Valid() && it->key().starts_with(key_prefix_);
+       it->Next()) {
+    leveldb::Slice key = it->key();
+    key.remove_prefix(key_prefix_.size());
+    if (!ConvertLegacyKey(convert::ToStringView(key), &new_key)) {
+      FTL_LOG(ERROR) << "Unable to migrate unknown legacy key of size "
+                     << key.size();
+      return Status::FORMAT_ERROR;
+    }
+    batch.Put(ftl::Concatenate({key_prefix_, new_key}), it->value());
+    batch.Delete(it->key());
+  }
+  if (!it->status().ok()) {
+    return ConvertStatus(it->status());
+  }
+  batch.Put(DbKey(key_prefix_, kSchemaVersionTag),
+            convert::ToSlice(kKeySchemaVersion));
+  return ConvertWriteStatus(db_->Write(write_options_, &batch));
+}
+
 }  // namespace storage
@@ -5,10 +5,15 @@
 #ifndef APPS_LEDGER_SRC_STORAGE_IMPL_DB_IMPL_H_
 #define APPS_LEDGER_SRC_STORAGE_IMPL_DB_IMPL_H_
 
+#include <memory>
 #include <utility>
 
 #include "apps/ledger/src/coroutine/coroutine.h"
 #include "apps/ledger/src/storage/impl/db.h"
+#include "apps/ledger/src/storage/impl/db_options.h"
+#include "lib/ftl/memory/ref_ptr.h"
+#include "lib/ftl/memory/weak_ptr.h"
+#include "lib/ftl/tasks/task_runner.h"
 
 #include "leveldb/db.h"
 #include "leveldb/write_batch.h"
@@ -19,9 +24,23 @@ class PageStorageImpl;
 
 class DbImpl : public DB {
  public:
-  DbImpl(coroutine::CoroutineService* coroutine_service,
+  // Asynchronous batches are written on |io_runner| and their callbacks are
+  // called on |main_runner|. The database is opened with |db_options| if not
+  // null, and with the default LevelDB options otherwise.
+  DbImpl(ftl::RefPtr<ftl::TaskRunner> main_runner,
+         ftl::RefPtr<ftl::TaskRunner> io_runner,
+         coroutine::CoroutineService* coroutine_service,
          PageStorageImpl* page_storage,
-         std::string db_path);
+         std::string db_path,
+         const DbOptions* db_options = nullptr);
+  // Creates a DbImpl storing its data in the already opened database |db|,
+  // shared with other pages. All keys are prefixed with |key_prefix|.
+  DbImpl(ftl::RefPtr<ftl::TaskRunner> main_runner,
+         ftl::RefPtr<ftl::TaskRunner> io_runner,
+         coroutine::CoroutineService* coroutine_service,
+         PageStorageImpl* page_storage,
+         std::shared_ptr<leveldb::DB> db,
+         std::string key_prefix);
   ~DbImpl() override;
 
   Status Init() override;
@@ -32,9 +51,13 @@ class DbImpl : public DB {
   Status ContainsHead(const CommitId& commit_id) override;
   Status GetCommitStorageBytes(CommitIdView commit_id,
                                std::string* storage_bytes) override;
+  Status ContainsCommit(CommitIdView commit_id) override;
   Status AddCommitStorageBytes(const CommitId& commit_id,
                                ftl::StringView storage_bytes) override;
   Status RemoveCommit(const CommitId& commit_id) override;
+  Status AddRemoteCommitId(const CommitId& commit_id) override;
+  Status RemoveRemoteCommitId(const CommitId& commit_id) override;
+  Status ContainsRemoteCommit(CommitIdView commit_id) override;
   Status CreateJournal(JournalType journal_type,
                        const CommitId& base,
                        std::unique_ptr<Journal>* journal) override;
@@ -79,25 +102,45 @@ class DbImpl : public DB {
   Status GetSyncMetadata(std::string* sync_state) override;
 
  private:
+  class BatchImpl;
+
+  Status ExecuteBatch(std::unique_ptr<leveldb::WriteBatch> batch);
+  void ExecuteBatchAsync(std::unique_ptr<leveldb::WriteBatch> batch,
+                         std::function<void(Status)> callback);
   Status GetByPrefix(const leveldb::Slice& prefix,
                      std::vector<std::string>* key_suffixes);
   Status GetEntriesByPrefix(
       const leveldb::Slice& prefix,
       std::vector<std::pair<std::string, std::string>>* key_value_pairs);
   Status DeleteByPrefix(const leveldb::Slice& prefix);
-  Status Get(convert::ExtendedStringView key, std::string* value);
-  Status Put(convert::ExtendedStringView key, ftl::StringView value);
-  Status Delete(convert::ExtendedStringView key);
+  Status Get(const leveldb::Slice& key, std::string* value);
+  // Returns |OK| if |key| is in the database or |NOT_FOUND| if not, without
+  // reading the associated value.
+  Status HasKey(const leveldb::Slice& key);
+  Status Put(const leveldb::Slice& key, ftl::StringView value);
+  Status Delete(const leveldb::Slice& key);
+  // Rewrites the keys stored with the legacy textual schema to the current
+  // one, if needed.
+  Status MigrateKeySchema();
 
+  const ftl::RefPtr<ftl::TaskRunner> main_runner_;
+  const ftl::RefPtr<ftl::TaskRunner> io_runner_;
   coroutine::CoroutineService* const coroutine_service_;
   PageStorageImpl* const page_storage_;
   const std::string db_path_;
-  std::unique_ptr<leveldb::DB> db_;
+  const DbOptions* const db_options_;
+  const std::string key_prefix_;
+  // Shared with the pending asynchronous writes, so that the database outlives
+  // them, and with the other pages if the database is per-ledger.
+  std::shared_ptr<leveldb::DB> db_;
 
   const leveldb::WriteOptions write_options_;
   const leveldb::ReadOptions read_options_;
 
   std::unique_ptr<leveldb::WriteBatch> batch_;
+
+  // This must be the last member of the class.
+  ftl::WeakPtrFactory<DbImpl> weak_ptr_factory_;
 };
 
 }  // namespace storage
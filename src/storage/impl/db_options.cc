@@ -0,0 +1,56 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/storage/impl/db_options.h"
+
+#include <algorithm>
+
+#include "lib/ftl/strings/string_printf.h"
+
+namespace storage {
+
+namespace {
+
+// Bounds applied by LevelDB when opening a database.
+constexpr int kMinOpenFiles = 64 + 10;
+constexpr int kMaxOpenFiles = 50000;
+constexpr size_t kMinWriteBufferSize = 64 << 10;
+constexpr size_t kMaxWriteBufferSize = 1 << 30;
+
+}  // namespace
+
+DbOptions::DbOptions(const Params& params)
+    : block_cache_size_(params.block_cache_size),
+      bloom_filter_bits_per_key_(
+          std::max(0, params.bloom_filter_bits_per_key)),
+      block_cache_(leveldb::NewLRUCache(block_cache_size_)) {
+  if (bloom_filter_bits_per_key_ > 0) {
+    filter_policy_.reset(
+        leveldb::NewBloomFilterPolicy(bloom_filter_bits_per_key_));
+  }
+  options_.create_if_missing = true;
+  options_.block_cache = block_cache_.get();
+  options_.filter_policy = filter_policy_.get();
+  options_.write_buffer_size =
+      std::max(kMinWriteBufferSize,
+               std::min(kMaxWriteBufferSize, params.write_buffer_size));
+  options_.max_open_files = std::max(
+      kMinOpenFiles, std::min(kMaxOpenFiles, params.max_open_files));
+  options_.compression = params.use_compression ? leveldb::kSnappyCompression
+                                                : leveldb::kNoCompression;
+}
+
+DbOptions::~DbOptions() {}
+
+std::string DbOptions::ToString() const {
+  return ftl::StringPrintf(
+      "block cache: %zu bytes (shared), bloom filter: %d bits per key, "
+      "write buffer: %zu bytes, max open files: %d, compression: %s",
+      block_cache_size_, bloom_filter_bits_per_key_,
+      options_.write_buffer_size, options_.max_open_files,
+      options_.compression == leveldb::kSnappyCompression ? "snappy"
+                                                          : "none");
+}
+
+}  // namespace storage
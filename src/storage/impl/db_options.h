@@ -0,0 +1,66 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPS_LEDGER_SRC_STORAGE_IMPL_DB_OPTIONS_H_
+#define APPS_LEDGER_SRC_STORAGE_IMPL_DB_OPTIONS_H_
+
+#include <stddef.h>
+
+#include <memory>
+#include <string>
+
+#include "leveldb/cache.h"
+#include "leveldb/filter_policy.h"
+#include "leveldb/options.h"
+#include "lib/ftl/macros.h"
+
+namespace storage {
+
+// LevelDB options used to open the databases of the page storages. The block
+// cache and the bloom filter policy are shared by all the databases opened
+// with these options, which bounds the memory used by the cache independently
+// of the number of open pages.
+//
+// A DbOptions object must outlive all the databases opened with its options.
+class DbOptions {
+ public:
+  // The default values favor many small databases, one per page.
+  struct Params {
+    // Size in bytes of the shared block cache.
+    size_t block_cache_size = 16 * 1024 * 1024;
+    // Number of bits per key of the bloom filters. Bloom filters are disabled
+    // if 0.
+    int bloom_filter_bits_per_key = 10;
+    // Size in bytes of the in-memory write buffer of each database.
+    size_t write_buffer_size = 1024 * 1024;
+    // Maximal number of files kept open by each database.
+    int max_open_files = 100;
+    // Set to true to compress the database blocks.
+    bool use_compression = true;
+  };
+
+  explicit DbOptions(const Params& params);
+  ~DbOptions();
+
+  // Returns the options with which to open a database.
+  const leveldb::Options& options() const { return options_; }
+
+  // Returns a human readable description of the effective settings. LevelDB
+  // clamps some of the requested values, in which case the effective values
+  // are reported.
+  std::string ToString() const;
+
+ private:
+  const size_t block_cache_size_;
+  const int bloom_filter_bits_per_key_;
+  std::unique_ptr<leveldb::Cache> block_cache_;
+  std::unique_ptr<const leveldb::FilterPolicy> filter_policy_;
+  leveldb::Options options_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(DbOptions);
+};
+
+}  // namespace storage
+
+#endif  // APPS_LEDGER_SRC_STORAGE_IMPL_DB_OPTIONS_H_
@@ -9,6 +9,7 @@
 #include <utility>
 #include <vector>
 
+#include "apps/ledger/src/callback/capture.h"
 #include "apps/ledger/src/coroutine/coroutine_impl.h"
 #include "apps/ledger/src/glue/crypto/rand.h"
 #include "apps/ledger/src/storage/impl/commit_impl.h"
@@ -18,10 +19,10 @@
 #include "apps/ledger/src/storage/public/constants.h"
 #include "apps/ledger/src/storage/test/commit_random_impl.h"
 #include "apps/ledger/src/storage/test/storage_test_utils.h"
+#include "apps/ledger/src/test/test_with_message_loop.h"
 #include "gtest/gtest.h"
 #include "lib/ftl/files/scoped_temp_dir.h"
 #include "lib/ftl/macros.h"
-#include "lib/mtl/tasks/message_loop.h"
 
 namespace storage {
 namespace {
@@ -36,7 +37,7 @@ void ExpectChangesEqual(const EntryChange& expected, const EntryChange& found) {
   }
 }
 
-class DBTest : public ::testing::Test {
+class DBTest : public ::test::TestWithMessageLoop {
  public:
   DBTest()
       : page_storage_(message_loop_.task_runner(),
@@ -44,7 +45,11 @@ class DBTest : public ::testing::Test {
                       &coroutine_service_,
                       tmp_dir_.path(),
                       "page_id"),
-        db_(&coroutine_service_, &page_storage_, tmp_dir_.path()) {}
+        db_(message_loop_.task_runner(),
+            message_loop_.task_runner(),
+            &coroutine_service_,
+            &page_storage_,
+            tmp_dir_.path()) {}
 
   ~DBTest() override {}
 
@@ -55,7 +60,6 @@ class DBTest : public ::testing::Test {
   }
 
  protected:
-  mtl::MessageLoop message_loop_;
   files::ScopedTempDir tmp_dir_;
   coroutine::CoroutineServiceImpl coroutine_service_;
   PageStorageImpl page_storage_;
@@ -91,16 +95,32 @@ TEST_F(DBTest, Commits) {
 
   EXPECT_EQ(Status::NOT_FOUND,
             db_.GetCommitStorageBytes(commit->GetId(), &storage_bytes));
+  EXPECT_EQ(Status::NOT_FOUND, db_.ContainsCommit(commit->GetId()));
 
   EXPECT_EQ(Status::OK, db_.AddCommitStorageBytes(commit->GetId(),
                                                   commit->GetStorageBytes()));
   EXPECT_EQ(Status::OK,
             db_.GetCommitStorageBytes(commit->GetId(), &storage_bytes));
+  EXPECT_EQ(Status::OK, db_.ContainsCommit(commit->GetId()));
   EXPECT_EQ(storage_bytes, commit->GetStorageBytes());
 
   EXPECT_EQ(Status::OK, db_.RemoveCommit(commit->GetId()));
   EXPECT_EQ(Status::NOT_FOUND,
             db_.GetCommitStorageBytes(commit->GetId(), &storage_bytes));
+  EXPECT_EQ(Status::NOT_FOUND, db_.ContainsCommit(commit->GetId()));
+}
+
+TEST_F(DBTest, RemoteCommits) {
+  CommitId commit_id = RandomId(kCommitIdSize);
+
+  EXPECT_EQ(Status::NOT_FOUND, db_.ContainsRemoteCommit(commit_id));
+  EXPECT_EQ(Status::OK, db_.AddRemoteCommitId(commit_id));
+  EXPECT_EQ(Status::OK, db_.ContainsRemoteCommit(commit_id));
+  // Remote commits are not stored commits.
+  EXPECT_EQ(Status::NOT_FOUND, db_.ContainsCommit(commit_id));
+
+  EXPECT_EQ(Status::OK, db_.RemoveRemoteCommitId(commit_id));
+  EXPECT_EQ(Status::NOT_FOUND, db_.ContainsRemoteCommit(commit_id));
 }
 
 TEST_F(DBTest, Journals) {
@@ -243,6 +263,24 @@ TEST_F(DBTest, Batch) {
   EXPECT_EQ(object_id, object_ids[0]);
 }
 
+TEST_F(DBTest, AsyncBatch) {
+  std::unique_ptr<DB::Batch> batch = db_.StartBatch();
+
+  ObjectId object_id = RandomId(kObjectIdSize);
+  EXPECT_EQ(Status::OK, db_.MarkObjectIdUnsynced(object_id));
+
+  Status status;
+  batch->Execute(
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status));
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(Status::OK, status);
+
+  std::vector<ObjectId> object_ids;
+  EXPECT_EQ(Status::OK, db_.GetUnsyncedObjectIds(&object_ids));
+  EXPECT_EQ(1u, object_ids.size());
+  EXPECT_EQ(object_id, object_ids[0]);
+}
+
 TEST_F(DBTest, SyncMetadata) {
   std::string sync_state;
   EXPECT_EQ(Status::NOT_FOUND, db_.GetSyncMetadata(&sync_state));
@@ -252,5 +290,92 @@ TEST_F(DBTest, SyncMetadata) {
   EXPECT_EQ("bazinga", sync_state);
 }
 
+TEST_F(DBTest, MigrateLegacyKeys) {
+  std::string db_path = tmp_dir_.path() + "/legacy";
+  CommitId head = RandomId(kCommitIdSize);
+  ObjectId object_id = RandomId(kObjectIdSize);
+  JournalId journal_id = "I" + RandomId(15);
+  {
+    leveldb::DB* db = nullptr;
+    leveldb::Options options;
+    options.create_if_missing = true;
+    ASSERT_TRUE(leveldb::DB::Open(options, db_path, &db).ok());
+    std::unique_ptr<leveldb::DB> legacy_db(db);
+    std::vector<std::pair<std::string, std::string>> legacy_entries = {
+        {"heads/" + head, ""},
+        {"unsynced/objects/" + object_id, ""},
+        {"sync-metadata", "state"},
+        {"journals/implicit/" + journal_id, head},
+        {"journals/" + journal_id + "/entry/key", "AE" + object_id},
+    };
+    for (const auto& entry : legacy_entries) {
+      EXPECT_TRUE(
+          legacy_db->Put(leveldb::WriteOptions(), entry.first, entry.second)
+              .ok());
+    }
+  }
+
+  DbImpl db(message_loop_.task_runner(), message_loop_.task_runner(),
+            &coroutine_service_, &page_storage_, db_path);
+  ASSERT_EQ(Status::OK, db.Init());
+
+  std::vector<CommitId> heads;
+  EXPECT_EQ(Status::OK, db.GetHeads(&heads));
+  EXPECT_EQ(std::vector<CommitId>({head}), heads);
+  std::vector<ObjectId> object_ids;
+  EXPECT_EQ(Status::OK, db.GetUnsyncedObjectIds(&object_ids));
+  EXPECT_EQ(std::vector<ObjectId>({object_id}), object_ids);
+  std::string sync_state;
+  EXPECT_EQ(Status::OK, db.GetSyncMetadata(&sync_state));
+  EXPECT_EQ("state", sync_state);
+  std::vector<JournalId> journal_ids;
+  EXPECT_EQ(Status::OK, db.GetImplicitJournalIds(&journal_ids));
+  EXPECT_EQ(std::vector<JournalId>({journal_id}), journal_ids);
+  ObjectId value;
+  EXPECT_EQ(Status::OK, db.GetJournalValue(journal_id, "key", &value));
+  EXPECT_EQ(object_id, value);
+}
+
+TEST_F(DBTest, MigrateUnknownLegacyKeys) {
+  std::string db_path = tmp_dir_.path() + "/legacy";
+  CommitId head = RandomId(kCommitIdSize);
+  leveldb::Options options;
+  options.create_if_missing = true;
+  {
+    leveldb::DB* db = nullptr;
+    ASSERT_TRUE(leveldb::DB::Open(options, db_path, &db).ok());
+    std::unique_ptr<leveldb::DB> legacy_db(db);
+    EXPECT_TRUE(
+        legacy_db->Put(leveldb::WriteOptions(), "heads/" + head, "").ok());
+    EXPECT_TRUE(
+        legacy_db->Put(leveldb::WriteOptions(), "unknown/key", "value").ok());
+  }
+
+  // The migration fails, and is attempted again on the next initialization.
+  for (int i = 0; i < 2; ++i) {
+    DbImpl db(message_loop_.task_runner(), message_loop_.task_runner(),
+              &coroutine_service_, &page_storage_, db_path);
+    EXPECT_EQ(Status::FORMAT_ERROR, db.Init());
+  }
+
+  // No key is dropped or rewritten.
+  leveldb::DB* db = nullptr;
+  ASSERT_TRUE(leveldb::DB::Open(options, db_path, &db).ok());
+  std::unique_ptr<leveldb::DB> legacy_db(db);
+  std::string value;
+  EXPECT_TRUE(
+      legacy_db->Get(leveldb::ReadOptions(), "unknown/key", &value).ok());
+  EXPECT_EQ("value", value);
+  EXPECT_TRUE(
+      legacy_db->Get(leveldb::ReadOptions(), "heads/" + head, &value).ok());
+  size_t key_count = 0;
+  std::unique_ptr<leveldb::Iterator> it(
+      legacy_db->NewIterator(leveldb::ReadOptions()));
+  for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    key_count++;
+  }
+  EXPECT_EQ(2u, key_count);
+}
+
 }  // namespace
 }  // namespace storage
@@ -0,0 +1,172 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/storage/impl/ledger_db.h"
+
+#include <dirent.h>
+
+#include <vector>
+
+#include "apps/ledger/src/convert/convert.h"
+#include "leveldb/write_batch.h"
+#include "lib/ftl/files/directory.h"
+#include "lib/ftl/files/path.h"
+#include "lib/ftl/logging.h"
+#include "lib/ftl/strings/concatenate.h"
+
+namespace storage {
+
+namespace {
+
+constexpr ftl::StringView kPagePrefix = "pages/";
+
+// Maximal number of entries written to the ledger database in a single batch
+// during a migration.
+constexpr size_t kMaxMigrationBatchSize = 1000;
+
+Status OpenDb(const std::string& db_path,
+              const DbOptions* db_options,
+              leveldb::DB** db) {
+  leveldb::Options options =
+      db_options ? db_options->options() : leveldb::Options();
+  options.create_if_missing = true;
+  leveldb::Status status = leveldb::DB::Open(options, db_path, db);
+  if (!status.ok()) {
+    FTL_LOG(ERROR) << "Failed to open database at " << db_path
+                   << " with status: " << status.ToString();
+    return Status::INTERNAL_IO_ERROR;
+  }
+  return Status::OK;
+}
+
+// Writes |batch| to |db|. If |sync| is true, the write, and all the previous
+// ones, are flushed to disk before returning.
+Status WriteBatch(leveldb::DB* db, leveldb::WriteBatch* batch, bool sync) {
+  leveldb::WriteOptions write_options;
+  write_options.sync = sync;
+  leveldb::Status status = db->Write(write_options, batch);
+  if (!status.ok()) {
+    FTL_LOG(ERROR) << "Failed to write to the ledger database: "
+                   << status.ToString();
+    return Status::INTERNAL_IO_ERROR;
+  }
+  batch->Clear();
+  return Status::OK;
+}
+
+}  // namespace
+
+std::string GetPageKeyPrefix(ftl::StringView page_dir_name) {
+  // Directory names do not contain '/', so the prefixes of different pages
+  // never prefix each other.
+  return ftl::Concatenate({kPagePrefix, page_dir_name, "/"});
+}
+
+Status OpenLedgerDb(const std::string& ledger_dir,
+                    const DbOptions* db_options,
+                    std::shared_ptr<leveldb::DB>* db) {
+  std::string db_path = ftl::Concatenate({ledger_dir, "/", kLevelDbDirName});
+  if (!files::CreateDirectory(db_path)) {
+    FTL_LOG(ERROR) << "Failed to create directory under " << db_path;
+    return Status::INTERNAL_IO_ERROR;
+  }
+  leveldb::DB* ledger_db = nullptr;
+  Status status = OpenDb(db_path, db_options, &ledger_db);
+  if (status != Status::OK) {
+    return status;
+  }
+  db->reset(ledger_db);
+  return Status::OK;
+}
+
+Status MigratePageDb(leveldb::DB* ledger_db,
+                     const std::string& page_dir,
+                     ftl::StringView key_prefix) {
+  std::string page_db_path =
+      ftl::Concatenate({page_dir, "/", kLevelDbDirName});
+  if (!files::IsDirectory(page_db_path)) {
+    return Status::OK;
+  }
+
+  leveldb::DB* db = nullptr;
+  Status status = OpenDb(page_db_path, nullptr, &db);
+  if (status != Status::OK) {
+    return status;
+  }
+  std::unique_ptr<leveldb::DB> page_db(db);
+
+  // Entries already copied by an interrupted migration are overwritten with
+  // the same values.
+  leveldb::WriteBatch batch;
+  size_t batch_size = 0;
+  std::unique_ptr<leveldb::Iterator> it(
+      page_db->NewIterator(leveldb::ReadOptions()));
+  for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    batch.Put(ftl::Concatenate({key_prefix, convert::ToStringView(it->key())}),
+              it->value());
+    if (++batch_size == kMaxMigrationBatchSize) {
+      status = WriteBatch(ledger_db, &batch, false);
+      if (status != Status::OK) {
+        return status;
+      }
+      batch_size = 0;
+    }
+  }
+  if (!it->status().ok()) {
+    FTL_LOG(ERROR) << "Failed to read the page database at " << page_db_path
+                   << ": " << it->status().ToString();
+    return Status::INTERNAL_IO_ERROR;
+  }
+  // The page database is deleted right after: the last write is synced, so
+  // that the migrated entries are on disk before.
+  status = WriteBatch(ledger_db, &batch, true);
+  if (status != Status::OK) {
+    return status;
+  }
+
+  it.reset();
+  page_db.reset();
+  if (!files::DeletePath(page_db_path, true)) {
+    FTL_LOG(ERROR) << "Unable to delete: " << page_db_path;
+    return Status::INTERNAL_IO_ERROR;
+  }
+  return Status::OK;
+}
+
+Status MigrateLedgerDir(const std::string& ledger_dir,
+                        const DbOptions* db_options) {
+  std::vector<std::string> page_dir_names;
+  DIR* dir = opendir(ledger_dir.c_str());
+  if (!dir) {
+    FTL_LOG(ERROR) << "Unable to open directory: " << ledger_dir;
+    return Status::INTERNAL_IO_ERROR;
+  }
+  while (struct dirent* entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if (name == "." || name == ".." || name == kLevelDbDirName) {
+      continue;
+    }
+    if (files::IsDirectory(ftl::Concatenate({ledger_dir, "/", name}))) {
+      page_dir_names.push_back(std::move(name));
+    }
+  }
+  closedir(dir);
+
+  std::shared_ptr<leveldb::DB> ledger_db;
+  Status status = OpenLedgerDb(ledger_dir, db_options, &ledger_db);
+  if (status != Status::OK) {
+    return status;
+  }
+  for (const std::string& page_dir_name : page_dir_names) {
+    status = MigratePageDb(ledger_db.get(),
+                           ftl::Concatenate({ledger_dir, "/", page_dir_name}),
+                           GetPageKeyPrefix(page_dir_name));
+    if (status != Status::OK) {
+      return status;
+    }
+  }
+  return Status::OK;
+}
+
+}  // namespace storage
@@ -0,0 +1,52 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPS_LEDGER_SRC_STORAGE_IMPL_LEDGER_DB_H_
+#define APPS_LEDGER_SRC_STORAGE_IMPL_LEDGER_DB_H_
+
+#include <memory>
+#include <string>
+
+#include "apps/ledger/src/storage/impl/db_options.h"
+#include "apps/ledger/src/storage/public/types.h"
+#include "leveldb/db.h"
+#include "lib/ftl/strings/string_view.h"
+
+namespace storage {
+
+// Utilities for the per-ledger database layout, in which the metadata of all
+// the pages of a ledger are stored in a single LevelDB database, each page
+// using a distinct key prefix. In the default layout, each page has its own
+// database in its directory.
+
+// Name of the LevelDB directory, both inside a page directory for the
+// per-page layout and inside the ledger directory for the per-ledger one.
+constexpr ftl::StringView kLevelDbDirName = "leveldb";
+
+// Returns the prefix of the keys of the page stored in the directory named
+// |page_dir_name| in the per-ledger database.
+std::string GetPageKeyPrefix(ftl::StringView page_dir_name);
+
+// Opens the per-ledger database in |ledger_dir|, creating it if needed. Uses
+// |db_options| if not null.
+Status OpenLedgerDb(const std::string& ledger_dir,
+                    const DbOptions* db_options,
+                    std::shared_ptr<leveldb::DB>* db);
+
+// Moves the content of the per-page database of the page stored in
+// |page_dir| into |ledger_db| under |key_prefix|, and then deletes the
+// per-page database. Does nothing if the page has no per-page database. This
+// can be safely retried if interrupted.
+Status MigratePageDb(leveldb::DB* ledger_db,
+                     const std::string& page_dir,
+                     ftl::StringView key_prefix);
+
+// Migrates all the pages of the ledger stored in |ledger_dir| to the
+// per-ledger database.
+Status MigrateLedgerDir(const std::string& ledger_dir,
+                        const DbOptions* db_options);
+
+}  // namespace storage
+
+#endif  // APPS_LEDGER_SRC_STORAGE_IMPL_LEDGER_DB_H_
@@ -8,8 +8,10 @@
 #include <iterator>
 
 #include "apps/ledger/src/glue/crypto/base64.h"
+#include "apps/ledger/src/storage/impl/ledger_db.h"
 #include "apps/ledger/src/storage/impl/page_storage_impl.h"
 #include "apps/ledger/src/storage/public/constants.h"
+#include "leveldb/write_batch.h"
 #include "lib/ftl/files/directory.h"
 #include "lib/ftl/files/path.h"
 #include "lib/ftl/functional/make_copyable.h"
@@ -44,10 +46,14 @@ LedgerStorageImpl::LedgerStorageImpl(
     ftl::RefPtr<ftl::TaskRunner> io_runner,
     coroutine::CoroutineService* coroutine_service,
     const std::string& base_storage_dir,
-    const std::string& ledger_name)
+    const std::string& ledger_name,
+    const DbOptions* db_options,
+    DbLayout db_layout)
     : main_runner_(std::move(main_runner)),
       io_runner_(std::move(io_runner)),
-      coroutine_service_(coroutine_service) {
+      coroutine_service_(coroutine_service),
+      db_options_(db_options),
+      db_layout_(db_layout) {
   storage_dir_ = ftl::Concatenate({base_storage_dir, "/", kSerializationVersion,
                                    "/", GetDirectoryName(ledger_name)});
 }
@@ -63,8 +69,12 @@ void LedgerStorageImpl::CreatePageStorage(
     callback(Status::INTERNAL_IO_ERROR, nullptr);
     return;
   }
-  auto result = std::make_unique<PageStorageImpl>(
-      main_runner_, io_runner_, coroutine_service_, path, std::move(page_id));
+  std::unique_ptr<PageStorageImpl> result;
+  Status status = NewPageStorage(std::move(page_id), path, &result);
+  if (status != Status::OK) {
+    callback(status, nullptr);
+    return;
+  }
   result->Init(ftl::MakeCopyable([
     callback = std::move(callback), result = std::move(result)
   ](Status status) mutable {
@@ -82,8 +92,12 @@ void LedgerStorageImpl::GetPageStorage(
     const std::function<void(Status, std::unique_ptr<PageStorage>)>& callback) {
   std::string path = GetPathFor(page_id);
   if (files::IsDirectory(path)) {
-    auto result = std::make_unique<PageStorageImpl>(
-        main_runner_, io_runner_, coroutine_service_, path, std::move(page_id));
+    std::unique_ptr<PageStorageImpl> result;
+    Status status = NewPageStorage(std::move(page_id), path, &result);
+    if (status != Status::OK) {
+      callback(status, nullptr);
+      return;
+    }
     result->Init(ftl::MakeCopyable([
       callback = std::move(callback), result = std::move(result)
     ](Status status) mutable {
@@ -106,6 +120,27 @@ bool LedgerStorageImpl::DeletePageStorage(PageIdView page_id) {
   if (!files::IsDirectory(path)) {
     return false;
   }
+  if (db_layout_ == DbLayout::PER_LEDGER) {
+    if (OpenLedgerDbIfNeeded() != Status::OK) {
+      return false;
+    }
+    std::string prefix = GetPageKeyPrefix(GetDirectoryName(page_id));
+    leveldb::WriteBatch batch;
+    std::unique_ptr<leveldb::Iterator> it(
+        ledger_db_->NewIterator(leveldb::ReadOptions()));
+    for (it->Seek(prefix); it->Valid() && it->key().starts_with(prefix);
+         it->Next()) {
+      batch.Delete(it->key());
+    }
+    leveldb::Status status =
+        it->status().ok() ? ledger_db_->Write(leveldb::WriteOptions(), &batch)
+                          : it->status();
+    if (!status.ok()) {
+      FTL_LOG(ERROR) << "Unable to delete the page from the ledger database: "
+                     << status.ToString();
+      return false;
+    }
+  }
   if (!files::DeletePath(path, true)) {
     FTL_LOG(ERROR) << "Unable to delete: " << path;
     return false;
@@ -118,4 +153,38 @@ std::string LedgerStorageImpl::GetPathFor(PageIdView page_id) {
   return ftl::Concatenate({storage_dir_, "/", GetDirectoryName(page_id)});
 }
 
+Status LedgerStorageImpl::NewPageStorage(
+    PageId page_id,
+    const std::string& path,
+    std::unique_ptr<PageStorageImpl>* page_storage) {
+  if (db_layout_ == DbLayout::PER_PAGE) {
+    *page_storage = std::make_unique<PageStorageImpl>(
+        main_runner_, io_runner_, coroutine_service_, path, std::move(page_id),
+        db_options_);
+    return Status::OK;
+  }
+
+  Status status = OpenLedgerDbIfNeeded();
+  if (status != Status::OK) {
+    return status;
+  }
+  std::string key_prefix = GetPageKeyPrefix(GetDirectoryName(page_id));
+  status = MigratePageDb(ledger_db_.get(), path, key_prefix);
+  if (status != Status::OK) {
+    return status;
+  }
+  *page_storage = std::make_unique<PageStorageImpl>(
+      main_runner_, io_runner_, coroutine_service_, path, std::move(page_id),
+      ledger_db_, std::move(key_prefix));
+  return Status::OK;
+}
+
+Status LedgerStorageImpl::OpenLedgerDbIfNeeded() {
+  FTL_DCHECK(db_layout_ == DbLayout::PER_LEDGER);
+  if (ledger_db_) {
+    return Status::OK;
+  }
+  return OpenLedgerDb(storage_dir_, db_options_, &ledger_db_);
+}
+
 }  // namespace storage
@@ -5,21 +5,38 @@
 #ifndef APPS_LEDGER_SRC_STORAGE_IMPL_LEDGER_STORAGE_IMPL_H_
 #define APPS_LEDGER_SRC_STORAGE_IMPL_LEDGER_STORAGE_IMPL_H_
 
+#include <memory>
 #include <string>
 
 #include "apps/ledger/src/coroutine/coroutine.h"
+#include "apps/ledger/src/storage/impl/db_options.h"
 #include "apps/ledger/src/storage/public/ledger_storage.h"
+#include "leveldb/db.h"
 #include "lib/ftl/tasks/task_runner.h"
 
 namespace storage {
 
+class PageStorageImpl;
+
 class LedgerStorageImpl : public LedgerStorage {
  public:
+  // Layout of the databases holding the metadata of the pages.
+  enum class DbLayout {
+    // Each page has its own database, in its directory.
+    PER_PAGE,
+    // All the pages of the ledger share a single database, each page using a
+    // distinct key prefix. Pages using the per-page layout are migrated when
+    // they are opened.
+    PER_LEDGER,
+  };
+
   LedgerStorageImpl(ftl::RefPtr<ftl::TaskRunner> main_runner,
                     ftl::RefPtr<ftl::TaskRunner> io_runner,
                     coroutine::CoroutineService* coroutine_service,
                     const std::string& base_storage_dir,
-                    const std::string& ledger_name);
+                    const std::string& ledger_name,
+                    const DbOptions* db_options = nullptr,
+                    DbLayout db_layout = DbLayout::PER_PAGE);
   ~LedgerStorageImpl() override;
 
   void CreatePageStorage(
@@ -36,11 +53,22 @@ class LedgerStorageImpl : public LedgerStorage {
 
  private:
   std::string GetPathFor(PageIdView page_id);
+  // Creates the PageStorageImpl of the page stored in |path|, using the
+  // database layout of this ledger.
+  Status NewPageStorage(PageId page_id,
+                        const std::string& path,
+                        std::unique_ptr<PageStorageImpl>* page_storage);
+  // Opens the per-ledger database if it is not opened yet.
+  Status OpenLedgerDbIfNeeded();
 
   ftl::RefPtr<ftl::TaskRunner> main_runner_;
   ftl::RefPtr<ftl::TaskRunner> io_runner_;
   coroutine::CoroutineService* const coroutine_service_;
+  const DbOptions* const db_options_;
+  const DbLayout db_layout_;
   std::string storage_dir_;
+  // The database shared by all pages, if |db_layout_| is |PER_LEDGER|.
+  std::shared_ptr<leveldb::DB> ledger_db_;
 };
 
 }  // namespace storage
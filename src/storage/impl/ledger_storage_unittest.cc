@@ -28,11 +28,9 @@ class LedgerStorageTest : public test::TestWithMessageLoop {
 
   ~LedgerStorageTest() override {}
 
- private:
+ protected:
   files::ScopedTempDir tmp_dir_;
   coroutine::CoroutineServiceImpl coroutine_service_;
-
- protected:
   LedgerStorageImpl storage_;
 
   FTL_DISALLOW_COPY_AND_ASSIGN(LedgerStorageTest);
@@ -99,5 +97,41 @@ TEST_F(LedgerStorageTest, CreateDeletePageStorage) {
   EXPECT_FALSE(RunLoopWithTimeout());
 }
 
+TEST_F(LedgerStorageTest, MigrateToPerLedgerLayout) {
+  PageId page_id = "1234";
+  Status status;
+  std::unique_ptr<PageStorage> page_storage;
+  storage_.CreatePageStorage(
+      page_id, callback::Capture([this] { message_loop_.PostQuitTask(); },
+                                 &status, &page_storage));
+  EXPECT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(Status::OK, status);
+  EXPECT_EQ(Status::OK, page_storage->SetSyncMetadata("metadata"));
+  page_storage.reset();
+
+  LedgerStorageImpl per_ledger_storage(
+      message_loop_.task_runner(), message_loop_.task_runner(),
+      &coroutine_service_, tmp_dir_.path(), "test_app", nullptr,
+      LedgerStorageImpl::DbLayout::PER_LEDGER);
+  per_ledger_storage.GetPageStorage(
+      page_id, callback::Capture([this] { message_loop_.PostQuitTask(); },
+                                 &status, &page_storage));
+  EXPECT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(Status::OK, status);
+  std::string sync_metadata;
+  EXPECT_EQ(Status::OK, page_storage->GetSyncMetadata(&sync_metadata));
+  EXPECT_EQ("metadata", sync_metadata);
+  page_storage.reset();
+
+  // Deleting the page removes its keys from the ledger database.
+  EXPECT_TRUE(per_ledger_storage.DeletePageStorage(page_id));
+  per_ledger_storage.CreatePageStorage(
+      page_id, callback::Capture([this] { message_loop_.PostQuitTask(); },
+                                 &status, &page_storage));
+  EXPECT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(Status::OK, status);
+  EXPECT_EQ(Status::NOT_FOUND, page_storage->GetSyncMetadata(&sync_metadata));
+}
+
 }  // namespace
 }  // namespace storage
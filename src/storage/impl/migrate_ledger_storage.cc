@@ -0,0 +1,51 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Moves the per-page databases of existing ledgers into per-ledger
+// databases. Ledger migrates pages lazily when the per-ledger layout is
+// enabled; this tool allows to migrate whole ledgers ahead of time.
+
+#include <stdio.h>
+
+#include <string>
+
+#include "apps/ledger/src/storage/impl/ledger_db.h"
+#include "lib/ftl/command_line.h"
+#include "lib/ftl/files/directory.h"
+
+namespace {
+const char kHelpArg[] = "help";
+
+void PrintHelp() {
+  printf("Migrates ledgers to a single database per ledger.\n");
+  printf("\n");
+  printf("Usage: migrate_ledger_storage <ledger_dir>...\n");
+  printf("  <ledger_dir>: directory of a ledger, containing one directory\n");
+  printf("    per page.\n");
+  printf("  --help: prints this help.\n");
+}
+}  // namespace
+
+int main(int argc, const char** argv) {
+  ftl::CommandLine command_line = ftl::CommandLineFromArgcArgv(argc, argv);
+
+  if (command_line.HasOption(kHelpArg) ||
+      command_line.positional_args().empty()) {
+    PrintHelp();
+    return command_line.HasOption(kHelpArg) ? 0 : 1;
+  }
+
+  for (const std::string& ledger_dir : command_line.positional_args()) {
+    if (!files::IsDirectory(ledger_dir)) {
+      printf("Not a directory: %s\n", ledger_dir.c_str());
+      return 1;
+    }
+    if (storage::MigrateLedgerDir(ledger_dir, nullptr) != storage::Status::OK) {
+      printf("Failed to migrate: %s\n", ledger_dir.c_str());
+      return 1;
+    }
+    printf("Migrated: %s\n", ledger_dir.c_str());
+  }
+  return 0;
+}
@@ -6,6 +6,7 @@
 
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include <vector>
@@ -37,4 +38,17 @@ Status ObjectImpl::GetData(ftl::StringView* data) const {
   return Status::OK;
 }
 
+Status ObjectImpl::GetSize(uint64_t* size) const {
+  if (!data_.empty()) {
+    *size = data_.size();
+    return Status::OK;
+  }
+  struct stat file_stat;
+  if (stat(file_path_.c_str(), &file_stat) != 0) {
+    return Status::INTERNAL_IO_ERROR;
+  }
+  *size = file_stat.st_size;
+  return Status::OK;
+}
+
 }  // namespace storage
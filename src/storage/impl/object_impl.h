@@ -19,6 +19,7 @@ class ObjectImpl : public Object {
   // Object:
   ObjectId GetId() const override;
   Status GetData(ftl::StringView* data) const override;
+  Status GetSize(uint64_t* size) const override;
 
  private:
   const ObjectId id_;
@@ -63,6 +63,9 @@ TEST_F(ObjectTest, Object) {
 
   ObjectImpl object((std::string(object_id_)), std::string(object_file_path_));
   EXPECT_EQ(object_id_, object.GetId());
+  uint64_t size;
+  EXPECT_EQ(Status::OK, object.GetSize(&size));
+  EXPECT_EQ(kFileSize, size);
   ftl::StringView found_data;
   EXPECT_EQ(Status::OK, object.GetData(&found_data));
   EXPECT_EQ(kFileSize, found_data.size());
@@ -22,6 +22,7 @@
 #include "apps/ledger/src/storage/impl/btree/diff.h"
 #include "apps/ledger/src/storage/impl/btree/iterator.h"
 #include "apps/ledger/src/storage/impl/commit_impl.h"
+#include "apps/ledger/src/storage/impl/ledger_db.h"
 #include "apps/ledger/src/storage/impl/object_impl.h"
 #include "apps/ledger/src/storage/public/constants.h"
 #include "apps/tracing/lib/trace/event.h"
@@ -41,12 +42,18 @@ namespace storage {
 
 namespace {
 
-const char kLevelDbDir[] = "/leveldb";
 const char kObjectDir[] = "/objects";
 const char kStagingDir[] = "/staging";
 
 const char kHexDigits[] = "0123456789ABCDEF";
 
+// Maximal number of parsed commits kept in memory.
+constexpr size_t kMaxCachedCommits = 256;
+
+// Minimal number of commits in a chain of unsynced commits for it to be
+// squashed.
+constexpr size_t kMinSquashedChainLength = 2;
+
 struct StringPointerComparator {
   using is_transparent = std::true_type;
 
@@ -291,13 +298,41 @@ PageStorageImpl::PageStorageImpl(ftl::RefPtr<ftl::TaskRunner> task_runner,
                                  ftl::RefPtr<ftl::TaskRunner> io_runner,
                                  coroutine::CoroutineService* coroutine_service,
                                  std::string page_dir,
-                                 PageId page_id)
+                                 PageId page_id,
+                                 const DbOptions* db_options)
+    : main_runner_(task_runner),
+      io_runner_(io_runner),
+      coroutine_service_(coroutine_service),
+      page_dir_(page_dir),
+      page_id_(std::move(page_id)),
+      db_(main_runner_,
+          io_runner_,
+          coroutine_service,
+          this,
+          ftl::Concatenate({page_dir_, "/", kLevelDbDirName}),
+          db_options),
+      objects_dir_(page_dir_ + kObjectDir),
+      staging_dir_(page_dir_ + kStagingDir),
+      page_sync_(nullptr) {}
+
+PageStorageImpl::PageStorageImpl(ftl::RefPtr<ftl::TaskRunner> task_runner,
+                                 ftl::RefPtr<ftl::TaskRunner> io_runner,
+                                 coroutine::CoroutineService* coroutine_service,
+                                 std::string page_dir,
+                                 PageId page_id,
+                                 std::shared_ptr<leveldb::DB> ledger_db,
+                                 std::string key_prefix)
     : main_runner_(task_runner),
       io_runner_(io_runner),
       coroutine_service_(coroutine_service),
       page_dir_(page_dir),
       page_id_(std::move(page_id)),
-      db_(coroutine_service, this, page_dir_ + kLevelDbDir),
+      db_(main_runner_,
+          io_runner_,
+          coroutine_service,
+          this,
+          std::move(ledger_db),
+          std::move(key_prefix)),
       objects_dir_(page_dir_ + kObjectDir),
       staging_dir_(page_dir_ + kStagingDir),
       page_sync_(nullptr) {}
@@ -333,6 +368,15 @@ void PageStorageImpl::Init(std::function<void(Status)> callback) {
       callback(s);
       return;
     }
+    heads.push_back(kFirstPageCommitId);
+  }
+  for (const CommitId& head : heads) {
+    if (!FixedId::IsValid(head)) {
+      FTL_LOG(ERROR) << "Invalid head commit id: " << ToHex(head);
+      callback(Status::FORMAT_ERROR);
+      return;
+    }
+    heads_.insert(FixedId(head));
   }
 
   // Remove uncommited explicit journals.
@@ -366,7 +410,15 @@ void PageStorageImpl::Init(std::function<void(Status)> callback) {
     });
   }
 
-  waiter->Finalize(std::move(callback));
+  waiter->Finalize([ this, callback = std::move(callback) ](Status s) {
+    if (s != Status::OK) {
+      callback(s);
+      return;
+    }
+    // No client can refer to the local commits yet: squash the unsynced ones
+    // before they are uploaded.
+    SquashUnsyncedCommits(callback);
+  });
 }
 
 PageId PageStorageImpl::GetId() {
@@ -378,7 +430,12 @@ void PageStorageImpl::SetSyncDelegate(PageSyncDelegate* page_sync) {
 }
 
 Status PageStorageImpl::GetHeadCommitIds(std::vector<CommitId>* commit_ids) {
-  return db_.GetHeads(commit_ids);
+  commit_ids->clear();
+  commit_ids->reserve(heads_.size());
+  for (const FixedId& head : heads_) {
+    commit_ids->push_back(head.ToString());
+  }
+  return Status::OK;
 }
 
 void PageStorageImpl::GetCommit(
@@ -388,18 +445,29 @@ void PageStorageImpl::GetCommit(
     CommitImpl::Empty(this, std::move(callback));
     return;
   }
+  std::unique_ptr<const Commit> commit = GetFromCommitCache(commit_id);
+  if (commit) {
+    callback(Status::OK, std::move(commit));
+    return;
+  }
   std::string bytes;
   Status s = db_.GetCommitStorageBytes(commit_id, &bytes);
+  if (s == Status::NOT_FOUND &&
+      db_.ContainsRemoteCommit(commit_id) == Status::OK) {
+    GetCommitFromSync(commit_id, std::move(callback));
+    return;
+  }
   if (s != Status::OK) {
     callback(s, nullptr);
     return;
   }
-  std::unique_ptr<const Commit> commit = CommitImpl::FromStorageBytes(
-      this, commit_id.ToString(), std::move(bytes));
+  commit = CommitImpl::FromStorageBytes(this, commit_id.ToString(),
+                                        std::move(bytes));
   if (!commit) {
     callback(Status::FORMAT_ERROR, nullptr);
     return;
   }
+  AddToCommitCache(*commit);
   callback(Status::OK, std::move(commit));
 }
 
@@ -422,6 +490,11 @@ void PageStorageImpl::AddCommitsFromSync(
   for (auto& id_and_bytes : ids_and_bytes) {
     ObjectId id = std::move(id_and_bytes.id);
     std::string storage_bytes = std::move(id_and_bytes.bytes);
+    if (!FixedId::IsValid(id)) {
+      FTL_LOG(ERROR) << "Invalid commit id from sync: " << ToHex(id);
+      callback(Status::FORMAT_ERROR);
+      return;
+    }
     if (ContainsCommit(id) == Status::OK) {
       continue;
     }
@@ -469,6 +542,84 @@ void PageStorageImpl::AddCommitsFromSync(
   }));
 }
 
+void PageStorageImpl::AddShallowCommitsFromSync(
+    std::vector<CommitIdAndBytes> ids_and_bytes,
+    std::function<void(Status)> callback) {
+  std::vector<std::unique_ptr<const Commit>> commits;
+  std::set<CommitId> parent_ids;
+  commits.reserve(ids_and_bytes.size());
+
+  for (auto& id_and_bytes : ids_and_bytes) {
+    ObjectId id = std::move(id_and_bytes.id);
+    std::string storage_bytes = std::move(id_and_bytes.bytes);
+    if (!FixedId::IsValid(id)) {
+      FTL_LOG(ERROR) << "Invalid commit id from sync: " << ToHex(id);
+      callback(Status::FORMAT_ERROR);
+      return;
+    }
+    if (ContainsCommit(id) == Status::OK) {
+      continue;
+    }
+
+    std::unique_ptr<const Commit> commit =
+        CommitImpl::FromStorageBytes(this, id, std::move(storage_bytes));
+    if (!commit) {
+      FTL_LOG(ERROR) << "Unable to add commit. Id: " << ToHex(id);
+      callback(Status::FORMAT_ERROR);
+      return;
+    }
+    for (const auto& parent_id : commit->GetParentIds()) {
+      parent_ids.insert(parent_id.ToString());
+    }
+    commits.push_back(std::move(commit));
+  }
+
+  // Only the commits that are not parents of other commits are added, the
+  // others are recorded as remote commits.
+  std::vector<std::unique_ptr<const Commit>> heads;
+  std::unique_ptr<DB::Batch> batch = db_.StartBatch();
+  for (auto& commit : commits) {
+    if (parent_ids.count(commit->GetId()) == 0) {
+      heads.push_back(std::move(commit));
+      continue;
+    }
+    Status s = db_.AddRemoteCommitId(commit->GetId());
+    if (s != Status::OK) {
+      callback(s);
+      return;
+    }
+  }
+
+  batch->Execute(ftl::MakeCopyable([
+    this, heads = std::move(heads), callback = std::move(callback)
+  ](Status status) mutable {
+    if (status != Status::OK) {
+      callback(status);
+      return;
+    }
+    if (heads.empty()) {
+      callback(Status::OK);
+      return;
+    }
+
+    auto waiter = callback::StatusWaiter<Status>::Create(Status::OK);
+    for (const auto& head : heads) {
+      btree::GetObjectsFromSync(coroutine_service_, this, head->GetRootId(),
+                                waiter->NewCallback());
+    }
+    waiter->Finalize(ftl::MakeCopyable([
+      this, heads = std::move(heads), callback = std::move(callback)
+    ](Status status) mutable {
+      if (status != Status::OK) {
+        callback(status);
+        return;
+      }
+
+      AddCommits(std::move(heads), ChangeSource::SYNC, callback);
+    }));
+  }));
+}
+
 Status PageStorageImpl::StartCommit(const CommitId& commit_id,
                                     JournalType journal_type,
                                     std::unique_ptr<Journal>* journal) {
@@ -522,8 +673,17 @@ void PageStorageImpl::GetUnsyncedCommits(
   });
 }
 
-Status PageStorageImpl::MarkCommitSynced(const CommitId& commit_id) {
-  return db_.MarkCommitIdSynced(commit_id);
+void PageStorageImpl::MarkCommitSynced(const CommitId& commit_id,
+                                       std::function<void(Status)> callback) {
+  // The write goes through a batch to be done on the io thread, after the
+  // pending writes of the commits.
+  std::unique_ptr<DB::Batch> batch = db_.StartBatch();
+  Status s = db_.MarkCommitIdSynced(commit_id);
+  if (s != Status::OK) {
+    callback(s);
+    return;
+  }
+  batch->Execute(std::move(callback));
 }
 
 Status PageStorageImpl::GetDeltaObjects(const CommitId& commit_id,
@@ -563,8 +723,15 @@ void PageStorageImpl::GetUnsyncedObjectIds(
   });
 }
 
-Status PageStorageImpl::MarkObjectSynced(ObjectIdView object_id) {
-  return db_.MarkObjectIdSynced(object_id);
+void PageStorageImpl::MarkObjectSynced(ObjectIdView object_id,
+                                       std::function<void(Status)> callback) {
+  std::unique_ptr<DB::Batch> batch = db_.StartBatch();
+  Status s = db_.MarkObjectIdSynced(object_id);
+  if (s != Status::OK) {
+    callback(s);
+    return;
+  }
+  batch->Execute(std::move(callback));
 }
 
 void PageStorageImpl::AddObjectFromSync(
@@ -595,7 +762,9 @@ void PageStorageImpl::AddObjectFromLocal(
   AddObject(std::move(data), size,
             [ this, callback = std::move(callback) ](Status status,
                                                      ObjectId object_id) {
-              untracked_objects_.insert(object_id);
+              if (status == Status::OK) {
+                untracked_objects_.insert(FixedId(object_id));
+              }
               callback(status, std::move(object_id));
             });
 }
@@ -668,14 +837,49 @@ void PageStorageImpl::GetEntryFromCommit(
                       std::move(key), std::move(on_next), std::move(on_done));
 }
 
+void PageStorageImpl::GetEntriesFromCommit(
+    const Commit& commit,
+    std::vector<std::string> keys,
+    std::function<void(Status, std::vector<Entry>)> callback) {
+  // The tree is traversed with sorted keys: keep track of the original
+  // position of each key to return the entries in the requested order.
+  std::vector<size_t> order(keys.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&keys](size_t lhs, size_t rhs) {
+    return keys[lhs] < keys[rhs];
+  });
+  std::vector<std::string> sorted_keys;
+  sorted_keys.reserve(keys.size());
+  for (size_t index : order) {
+    sorted_keys.push_back(std::move(keys[index]));
+  }
+  btree::GetEntries(
+      coroutine_service_, this, commit.GetRootId(), std::move(sorted_keys),
+      [ order = std::move(order), callback = std::move(callback) ](
+          Status s, std::vector<Entry> sorted_entries) {
+        if (s != Status::OK) {
+          callback(s, std::vector<Entry>());
+          return;
+        }
+        std::vector<Entry> entries(sorted_entries.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+          entries[order[i]] = std::move(sorted_entries[i]);
+        }
+        callback(Status::OK, std::move(entries));
+      });
+}
+
 void PageStorageImpl::GetCommitContentsDiff(
     const Commit& base_commit,
     const Commit& other_commit,
+    std::string min_key,
     std::function<bool(EntryChange)> on_next_diff,
     std::function<void(Status)> on_done) {
   btree::ForEachDiff(coroutine_service_, this, base_commit.GetRootId(),
-                     other_commit.GetRootId(), std::move(on_next_diff),
-                     std::move(on_done));
+                     other_commit.GetRootId(), std::move(min_key),
+                     std::move(on_next_diff), std::move(on_done));
 }
 
 void PageStorageImpl::NotifyWatchers(
@@ -693,6 +897,7 @@ void PageStorageImpl::AddCommits(
   // Apply all changes atomically.
   std::unique_ptr<DB::Batch> batch = db_.StartBatch();
   std::set<const CommitId*, StringPointerComparator> added_commits;
+  std::set<FixedId> heads = heads_;
 
   for (const auto& commit : commits) {
     Status s =
@@ -716,12 +921,18 @@ void PageStorageImpl::AddCommits(
       callback(s);
       return;
     }
+    heads.insert(FixedId(commit->GetId()));
 
     // Commits must arrive in order: Check that the parents are stored in DB and
     // remove them from the heads if they are present.
     for (const CommitIdView& parent_id : commit->GetParentIds()) {
       if (added_commits.count(&parent_id) == 0) {
         s = ContainsCommit(parent_id);
+        if (s == Status::NOT_FOUND) {
+          // The history of commits added by AddShallowCommitsFromSync() is
+          // only available from sync.
+          s = db_.ContainsRemoteCommit(parent_id);
+        }
         if (s != Status::OK) {
           FTL_LOG(ERROR) << "Failed to find parent commit \""
                          << ToHex(parent_id) << "\" of commit \""
@@ -735,26 +946,278 @@ void PageStorageImpl::AddCommits(
         }
       }
       db_.RemoveHead(parent_id);
+      heads.erase(FixedId(parent_id));
     }
 
     added_commits.insert(&commit->GetId());
   }
 
-  Status s = batch->Execute();
-  callback(s);
-  if (s != Status::OK) {
-    return;
+  // The first commit of the page is an ancestor of all commits: it is not a
+  // head anymore once commits are added, even if they don't descend from it
+  // through the local history, as is the case for the commits added by
+  // AddShallowCommitsFromSync().
+  FixedId first_commit_id(kFirstPageCommitId);
+  if (!commits.empty() && heads.count(first_commit_id) != 0) {
+    Status s = db_.RemoveHead(kFirstPageCommitId);
+    if (s != Status::OK) {
+      callback(s);
+      return;
+    }
+    heads.erase(first_commit_id);
   }
 
-  NotifyWatchers(std::move(commits), source);
+  // The batch is written on the io thread. The in-memory heads and commits
+  // are updated right away, so that the commits added before the write
+  // completes see them.
+  heads_.swap(heads);
+  for (const auto& commit : commits) {
+    AddToCommitCache(*commit);
+    pending_commits_.emplace(FixedId(commit->GetId()), commit->Clone());
+  }
+  batch->Execute(ftl::MakeCopyable([
+    this, commits = std::move(commits), source, callback = std::move(callback)
+  ](Status status) {
+    for (const auto& commit : commits) {
+      pending_commits_.erase(FixedId(commit->GetId()));
+    }
+    if (status != Status::OK) {
+      // Restore the heads as they are stored in the database.
+      std::vector<CommitId> heads;
+      if (db_.GetHeads(&heads) == Status::OK) {
+        heads_.clear();
+        for (const CommitId& head : heads) {
+          heads_.insert(FixedId(head));
+        }
+      }
+      for (const auto& commit : commits) {
+        auto it = cached_commits_index_.find(FixedId(commit->GetId()));
+        if (it != cached_commits_index_.end()) {
+          cached_commits_.erase(it->second);
+          cached_commits_index_.erase(it);
+        }
+      }
+      callback(status);
+      return;
+    }
+    callback(status);
+    NotifyWatchers(commits, source);
+  }));
+}
+
+void PageStorageImpl::SquashUnsyncedCommits(
+    std::function<void(Status)> callback) {
+  GetUnsyncedCommits([ this, callback = std::move(callback) ](
+      Status s, std::vector<std::unique_ptr<const Commit>> commits) {
+    if (s != Status::OK) {
+      callback(s);
+      return;
+    }
+
+    // Commits from sync never have unsynced parents, so the children of an
+    // unsynced commit are all unsynced.
+    std::unordered_map<FixedId, const Commit*> unsynced_commits;
+    std::unordered_map<FixedId, size_t> child_counts;
+    for (const auto& commit : commits) {
+      if (!FixedId::IsValid(commit->GetId())) {
+        FTL_LOG(ERROR) << "Invalid unsynced commit id: "
+                       << ToHex(commit->GetId());
+        callback(Status::FORMAT_ERROR);
+        return;
+      }
+      unsynced_commits[FixedId(commit->GetId())] = commit.get();
+    }
+    for (const auto& commit : commits) {
+      for (CommitIdView parent_id : commit->GetParentIds()) {
+        child_counts[FixedId(parent_id)]++;
+      }
+    }
+
+    // Chains of commits, from the last to the first one.
+    std::vector<std::vector<const Commit*>> chains;
+    for (const auto& commit : commits) {
+      FixedId id(commit->GetId());
+      if (heads_.count(id) == 0 || child_counts[id] != 0) {
+        continue;
+      }
+      std::vector<const Commit*> chain = {commit.get()};
+      while (true) {
+        std::vector<CommitIdView> parent_ids = chain.back()->GetParentIds();
+        if (parent_ids.size() != 1) {
+          break;
+        }
+        FixedId parent_id(parent_ids[0]);
+        auto it = unsynced_commits.find(parent_id);
+        if (it == unsynced_commits.end() || child_counts[parent_id] != 1) {
+          break;
+        }
+        chain.push_back(it->second);
+      }
+      if (chain.size() >= kMinSquashedChainLength) {
+        chains.push_back(std::move(chain));
+      }
+    }
+    if (chains.empty()) {
+      callback(Status::OK);
+      return;
+    }
+
+    auto waiter =
+        callback::Waiter<Status, std::unique_ptr<const Commit>>::Create(
+            Status::OK);
+    for (const auto& chain : chains) {
+      for (CommitIdView parent_id : chain.back()->GetParentIds()) {
+        GetCommit(parent_id, waiter->NewCallback());
+      }
+    }
+    waiter->Finalize(ftl::MakeCopyable([
+      this, commits = std::move(commits), chains = std::move(chains),
+      callback = std::move(callback)
+    ](Status s, std::vector<std::unique_ptr<const Commit>> parents) {
+      if (s != Status::OK) {
+        callback(s);
+        return;
+      }
+
+      // Apply all changes atomically.
+      std::unique_ptr<DB::Batch> batch = db_.StartBatch();
+      std::vector<std::unique_ptr<const Commit>> squashed_commits;
+      std::vector<CommitId> squashed_heads;
+      std::vector<CommitId> removed_commits;
+      auto next_parent = parents.begin();
+      for (const auto& chain : chains) {
+        const Commit* last = chain.front();
+        std::vector<std::unique_ptr<const Commit>> chain_parents;
+        for (size_t i = 0; i < chain.back()->GetParentIds().size(); ++i) {
+          chain_parents.push_back(std::move(*next_parent++));
+        }
+        std::unique_ptr<const Commit> squashed =
+            CommitImpl::FromContentAndParents(this, last->GetRootId(),
+                                              std::move(chain_parents));
+
+        s = db_.AddCommitStorageBytes(squashed->GetId(),
+                                      squashed->GetStorageBytes());
+        if (s != Status::OK) {
+          callback(s);
+          return;
+        }
+        s = db_.MarkCommitIdUnsynced(squashed->GetId(),
+                                     squashed->GetTimestamp());
+        if (s != Status::OK) {
+          callback(s);
+          return;
+        }
+        // The commits of the chain are replaced by the squashed one: they are
+        // neither uploaded nor kept.
+        for (const Commit* commit : chain) {
+          s = db_.MarkCommitIdSynced(commit->GetId());
+          if (s != Status::OK) {
+            callback(s);
+            return;
+          }
+          s = db_.RemoveCommit(commit->GetId());
+          if (s != Status::OK) {
+            callback(s);
+            return;
+          }
+          removed_commits.push_back(commit->GetId());
+        }
+        s = db_.RemoveHead(last->GetId());
+        if (s != Status::OK) {
+          callback(s);
+          return;
+        }
+        s = db_.AddHead(squashed->GetId());
+        if (s != Status::OK) {
+          callback(s);
+          return;
+        }
+
+        squashed_heads.push_back(last->GetId());
+        squashed_commits.push_back(std::move(squashed));
+      }
+
+      batch->Execute(ftl::MakeCopyable([
+        this, squashed_commits = std::move(squashed_commits),
+        squashed_heads = std::move(squashed_heads),
+        removed_commits = std::move(removed_commits),
+        callback = std::move(callback)
+      ](Status status) {
+        if (status != Status::OK) {
+          callback(status);
+          return;
+        }
+        for (const CommitId& commit_id : removed_commits) {
+          RemoveFromCommitCache(commit_id);
+        }
+        for (size_t i = 0; i < squashed_commits.size(); ++i) {
+          heads_.erase(FixedId(squashed_heads[i]));
+          heads_.insert(FixedId(squashed_commits[i]->GetId()));
+          AddToCommitCache(*squashed_commits[i]);
+        }
+        callback(Status::OK);
+      }));
+    }));
+  });
 }
 
 Status PageStorageImpl::ContainsCommit(CommitIdView id) {
   if (IsFirstCommit(id)) {
     return Status::OK;
   }
-  std::string bytes;
-  return db_.GetCommitStorageBytes(id, &bytes);
+  if (FixedId::IsValid(id)) {
+    FixedId fixed_id(id);
+    if (cached_commits_index_.find(fixed_id) != cached_commits_index_.end() ||
+        pending_commits_.find(fixed_id) != pending_commits_.end()) {
+      return Status::OK;
+    }
+  }
+  return db_.ContainsCommit(id);
+}
+
+void PageStorageImpl::AddToCommitCache(const Commit& commit) {
+  FixedId commit_id(commit.GetId());
+  auto it = cached_commits_index_.find(commit_id);
+  if (it != cached_commits_index_.end()) {
+    cached_commits_.splice(cached_commits_.end(), cached_commits_, it->second);
+    return;
+  }
+  cached_commits_.push_back(commit.Clone());
+  cached_commits_index_[commit_id] = std::prev(cached_commits_.end());
+  if (cached_commits_.size() > kMaxCachedCommits) {
+    cached_commits_index_.erase(FixedId(cached_commits_.front()->GetId()));
+    cached_commits_.pop_front();
+  }
+}
+
+void PageStorageImpl::RemoveFromCommitCache(CommitIdView commit_id) {
+  if (!FixedId::IsValid(commit_id)) {
+    return;
+  }
+  auto it = cached_commits_index_.find(FixedId(commit_id));
+  if (it == cached_commits_index_.end()) {
+    return;
+  }
+  cached_commits_.erase(it->second);
+  cached_commits_index_.erase(it);
+}
+
+std::unique_ptr<const Commit> PageStorageImpl::GetFromCommitCache(
+    CommitIdView commit_id) {
+  if (!FixedId::IsValid(commit_id)) {
+    return nullptr;
+  }
+  FixedId fixed_id(commit_id);
+  auto it = cached_commits_index_.find(fixed_id);
+  if (it == cached_commits_index_.end()) {
+    auto pending_it = pending_commits_.find(fixed_id);
+    if (pending_it != pending_commits_.end()) {
+      return pending_it->second->Clone();
+    }
+    return nullptr;
+  }
+  // Mark the commit as the most recently used one.
+  cached_commits_.splice(cached_commits_.end(), cached_commits_, it->second);
+  return (*it->second)->Clone();
 }
 
 bool PageStorageImpl::IsFirstCommit(CommitIdView id) {
@@ -820,18 +1283,77 @@ void PageStorageImpl::GetObjectFromSync(
   });
 }
 
+void PageStorageImpl::GetCommitFromSync(
+    CommitIdView commit_id,
+    std::function<void(Status, std::unique_ptr<const Commit>)> callback) {
+  if (!page_sync_) {
+    callback(Status::NOT_CONNECTED_ERROR, nullptr);
+    return;
+  }
+  page_sync_->GetCommit(commit_id, ftl::MakeCopyable([
+    this, commit_id = commit_id.ToString(), callback = std::move(callback)
+  ](Status status, std::string storage_bytes) mutable {
+    if (status != Status::OK) {
+      callback(status, nullptr);
+      return;
+    }
+    std::unique_ptr<const Commit> commit =
+        CommitImpl::FromStorageBytes(this, commit_id, std::move(storage_bytes));
+    if (!commit) {
+      FTL_LOG(ERROR) << "Unable to add commit. Id: " << ToHex(commit_id);
+      callback(Status::FORMAT_ERROR, nullptr);
+      return;
+    }
+
+    // The commit is only stored as part of the history of the page: the heads
+    // are not updated, and its missing parents are remote commits in turn.
+    std::unique_ptr<DB::Batch> batch = db_.StartBatch();
+    status = db_.AddCommitStorageBytes(commit_id, commit->GetStorageBytes());
+    if (status != Status::OK) {
+      callback(status, nullptr);
+      return;
+    }
+    for (const CommitIdView& parent_id : commit->GetParentIds()) {
+      status = ContainsCommit(parent_id);
+      if (status == Status::NOT_FOUND) {
+        status = db_.AddRemoteCommitId(parent_id.ToString());
+      }
+      if (status != Status::OK) {
+        callback(status, nullptr);
+        return;
+      }
+    }
+    status = db_.RemoveRemoteCommitId(commit_id);
+    if (status != Status::OK) {
+      callback(status, nullptr);
+      return;
+    }
+    batch->Execute(ftl::MakeCopyable([
+      this, commit = std::move(commit), callback = std::move(callback)
+    ](Status status) mutable {
+      if (status != Status::OK) {
+        callback(status, nullptr);
+        return;
+      }
+      AddToCommitCache(*commit);
+      callback(Status::OK, std::move(commit));
+    }));
+  }));
+}
+
 std::string PageStorageImpl::GetFilePath(ObjectIdView object_id) const {
   return storage::GetFilePath(objects_dir_, object_id);
 }
 
 bool PageStorageImpl::ObjectIsUntracked(ObjectIdView object_id) {
-  return untracked_objects_.find(object_id) != untracked_objects_.end();
+  return FixedId::IsValid(object_id) &&
+         untracked_objects_.find(FixedId(object_id)) !=
+             untracked_objects_.end();
 }
 
 void PageStorageImpl::MarkObjectTracked(ObjectIdView object_id) {
-  auto it = untracked_objects_.find(object_id);
-  if (it != untracked_objects_.end()) {
-    untracked_objects_.erase(it);
+  if (FixedId::IsValid(object_id)) {
+    untracked_objects_.erase(FixedId(object_id));
   }
 }
 
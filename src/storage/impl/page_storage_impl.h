@@ -7,11 +7,15 @@
 
 #include "apps/ledger/src/storage/public/page_storage.h"
 
+#include <list>
 #include <set>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "apps/ledger/src/convert/convert.h"
 #include "apps/ledger/src/coroutine/coroutine.h"
 #include "apps/ledger/src/storage/impl/db_impl.h"
+#include "apps/ledger/src/storage/public/fixed_id.h"
 #include "apps/ledger/src/storage/public/page_sync_delegate.h"
 #include "lib/ftl/memory/ref_ptr.h"
 #include "lib/ftl/strings/string_view.h"
@@ -25,12 +29,24 @@ class PageStorageImpl : public PageStorage {
                   ftl::RefPtr<ftl::TaskRunner> io_runner,
                   coroutine::CoroutineService* coroutine_service,
                   std::string page_dir,
-                  PageId page_id);
+                  PageId page_id,
+                  const DbOptions* db_options = nullptr);
+  // Creates a PageStorageImpl storing its metadata in |ledger_db|, the
+  // database shared by all the pages of a ledger, under |key_prefix|. Objects
+  // are still stored in |page_dir|.
+  PageStorageImpl(ftl::RefPtr<ftl::TaskRunner> main_runner,
+                  ftl::RefPtr<ftl::TaskRunner> io_runner,
+                  coroutine::CoroutineService* coroutine_service,
+                  std::string page_dir,
+                  PageId page_id,
+                  std::shared_ptr<leveldb::DB> ledger_db,
+                  std::string key_prefix);
   ~PageStorageImpl() override;
 
   // Initializes this PageStorageImpl. This includes initializing the underlying
   // database, adding the default page head if the page is empty, removing
-  // uncommitted explicit and committing implicit journals.
+  // uncommitted explicit and committing implicit journals, and squashing the
+  // chains of unsynced local commits.
   void Init(std::function<void(Status)> callback);
 
   // Adds the given locally created |commit| in this |PageStorage|.
@@ -54,6 +70,8 @@ class PageStorageImpl : public PageStorage {
                      callback) override;
   void AddCommitsFromSync(std::vector<CommitIdAndBytes> ids_and_bytes,
                           std::function<void(Status)>) override;
+  void AddShallowCommitsFromSync(std::vector<CommitIdAndBytes> ids_and_bytes,
+                                 std::function<void(Status)> callback) override;
   Status StartCommit(const CommitId& commit_id,
                      JournalType journal_type,
                      std::unique_ptr<Journal>* journal) override;
@@ -65,13 +83,15 @@ class PageStorageImpl : public PageStorage {
   void GetUnsyncedCommits(
       std::function<void(Status, std::vector<std::unique_ptr<const Commit>>)>
           callback) override;
-  Status MarkCommitSynced(const CommitId& commit_id) override;
+  void MarkCommitSynced(const CommitId& commit_id,
+                        std::function<void(Status)> callback) override;
   Status GetDeltaObjects(const CommitId& commit_id,
                          std::vector<ObjectId>* objects) override;
   void GetUnsyncedObjectIds(
       const CommitId& commit_id,
       std::function<void(Status, std::vector<ObjectId>)> callback) override;
-  Status MarkObjectSynced(ObjectIdView object_id) override;
+  void MarkObjectSynced(ObjectIdView object_id,
+                        std::function<void(Status)> callback) override;
   void AddObjectFromSync(ObjectIdView object_id,
                          mx::socket data,
                          size_t size,
@@ -96,8 +116,13 @@ class PageStorageImpl : public PageStorage {
   void GetEntryFromCommit(const Commit& commit,
                           std::string key,
                           std::function<void(Status, Entry)> callback) override;
+  void GetEntriesFromCommit(
+      const Commit& commit,
+      std::vector<std::string> keys,
+      std::function<void(Status, std::vector<Entry>)> callback) override;
   void GetCommitContentsDiff(const Commit& base_commit,
                              const Commit& other_commit,
+                             std::string min_key,
                              std::function<bool(EntryChange)> on_next_diff,
                              std::function<void(Status)> on_done) override;
 
@@ -108,7 +133,22 @@ class PageStorageImpl : public PageStorage {
   void AddCommits(std::vector<std::unique_ptr<const Commit>> commits,
                   ChangeSource source,
                   std::function<void(Status)> callback);
+  // Replaces each linear chain of unsynced commits ending in a head by a single
+  // unsynced commit with the same parents as the first commit of the chain and
+  // the tree of the last one. The commits of the chain, which were never
+  // uploaded, are deleted. Only called from Init(), before any client can refer
+  // to the squashed commits.
+  void SquashUnsyncedCommits(std::function<void(Status)> callback);
   Status ContainsCommit(CommitIdView id);
+  // Adds |commit| to the cache of parsed commits, evicting the least recently
+  // used one if the cache is full.
+  void AddToCommitCache(const Commit& commit);
+  // Removes the commit with the given |commit_id| from the cache of parsed
+  // commits, if it is there.
+  void RemoveFromCommitCache(CommitIdView commit_id);
+  // Returns a copy of the cached or pending commit with the given
+  // |commit_id|, or nullptr if it is in neither.
+  std::unique_ptr<const Commit> GetFromCommitCache(CommitIdView commit_id);
   bool IsFirstCommit(CommitIdView id);
   void AddObject(mx::socket data,
                  int64_t size,
@@ -117,6 +157,11 @@ class PageStorageImpl : public PageStorage {
       ObjectIdView object_id,
       const std::function<void(Status, std::unique_ptr<const Object>)>&
           callback);
+  // Retrieves the remote commit with the given |commit_id| from sync and stores
+  // it locally.
+  void GetCommitFromSync(
+      CommitIdView commit_id,
+      std::function<void(Status, std::unique_ptr<const Commit>)> callback);
   std::string GetFilePath(ObjectIdView object_id) const;
 
   // Notifies the registered watchers with the given |commits|.
@@ -129,8 +174,18 @@ class PageStorageImpl : public PageStorage {
   const std::string page_dir_;
   const PageId page_id_;
   DbImpl db_;
+  // Ids of the head commits. This mirrors the heads stored in |db_|.
+  std::set<FixedId> heads_;
+  // Recently used commits, from the least to the most recently used one.
+  std::list<std::unique_ptr<const Commit>> cached_commits_;
+  std::unordered_map<FixedId,
+                     std::list<std::unique_ptr<const Commit>>::iterator>
+      cached_commits_index_;
+  // Commits whose write to |db_| is in progress. They are kept until the write
+  // completes, as they might be evicted from the commit cache before.
+  std::unordered_map<FixedId, std::unique_ptr<const Commit>> pending_commits_;
   std::vector<CommitWatcher*> watchers_;
-  std::set<ObjectId, convert::StringViewComparator> untracked_objects_;
+  std::unordered_set<FixedId> untracked_objects_;
   std::string objects_dir_;
   std::string staging_dir_;
   std::vector<std::unique_ptr<FileWriter>> writers_;
@@ -6,7 +6,9 @@
 
 #include <dirent.h>
 
+#include <algorithm>
 #include <chrono>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <thread>
@@ -115,10 +117,29 @@ class FakeSyncDelegate : public PageSyncDelegate {
     callback(Status::OK, value.size(), mtl::WriteStringToSocket(value));
   }
 
+  void AddCommit(const Commit& commit) {
+    id_to_commit_[commit.GetId()] = commit.GetStorageBytes().ToString();
+  }
+
+  void GetCommit(
+      CommitIdView commit_id,
+      std::function<void(Status status, std::string storage_bytes)> callback) {
+    std::string id = commit_id.ToString();
+    commit_requests.insert(id);
+    auto it = id_to_commit_.find(id);
+    if (it == id_to_commit_.end()) {
+      callback(Status::NOT_FOUND, "");
+      return;
+    }
+    callback(Status::OK, it->second);
+  }
+
   std::set<ObjectId> object_requests;
+  std::set<CommitId> commit_requests;
 
  private:
   std::map<ObjectId, std::string> id_to_value_;
+  std::map<CommitId, std::string> id_to_commit_;
 };
 
 // Implements |Init()|, |CreateJournal() and |CreateMergeJournal()| and
@@ -370,7 +391,10 @@ TEST_F(PageStorageTest, AddGetLocalCommits) {
 
   // Search for a commit that exist and check the content.
   storage_->AddCommitFromLocal(
-      std::move(commit), [](Status status) { EXPECT_EQ(Status::OK, status); });
+      std::move(commit),
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status));
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(Status::OK, status);
   std::unique_ptr<const Commit> found = GetCommit(id);
   EXPECT_EQ(storage_bytes, found->GetStorageBytes());
 }
@@ -454,6 +478,43 @@ TEST_F(PageStorageTest, AddGetSyncedCommits) {
   EXPECT_TRUE(commits.empty());
 }
 
+TEST_F(PageStorageTest, AddCommitsFromSyncInvalidId) {
+  std::vector<std::unique_ptr<const Commit>> parent;
+  parent.emplace_back(GetFirstHead());
+  std::unique_ptr<Commit> commit = CommitImpl::FromContentAndParents(
+      storage_.get(), RandomId(kObjectIdSize), std::move(parent));
+  std::string storage_bytes = commit->GetStorageBytes().ToString();
+
+  // Commit ids received from sync that don't have the size of a commit id are
+  // rejected.
+  for (const std::string& id : {std::string("short id"),
+                                RandomId(2 * kCommitIdSize)}) {
+    bool called = false;
+    Status status;
+    std::vector<PageStorage::CommitIdAndBytes> ids_and_bytes;
+    ids_and_bytes.emplace_back(id, storage_bytes);
+    storage_->AddCommitsFromSync(
+        std::move(ids_and_bytes),
+        callback::Capture([&called] { called = true; }, &status));
+    EXPECT_TRUE(called);
+    EXPECT_EQ(Status::FORMAT_ERROR, status);
+
+    called = false;
+    ids_and_bytes.clear();
+    ids_and_bytes.emplace_back(id, storage_bytes);
+    storage_->AddShallowCommitsFromSync(
+        std::move(ids_and_bytes),
+        callback::Capture([&called] { called = true; }, &status));
+    EXPECT_TRUE(called);
+    EXPECT_EQ(Status::FORMAT_ERROR, status);
+  }
+
+  std::vector<CommitId> heads;
+  EXPECT_EQ(Status::OK, storage_->GetHeadCommitIds(&heads));
+  ASSERT_EQ(1u, heads.size());
+  EXPECT_EQ(kFirstPageCommitId.ToString(), heads[0]);
+}
+
 TEST_F(PageStorageTest, SyncCommits) {
   std::vector<std::unique_ptr<const Commit>> commits = GetUnsyncedCommits();
 
@@ -468,18 +529,76 @@ TEST_F(PageStorageTest, SyncCommits) {
   CommitId id = commit->GetId();
   std::string storage_bytes = commit->GetStorageBytes().ToString();
 
+  Status status;
   storage_->AddCommitFromLocal(
-      std::move(commit), [](Status status) { EXPECT_EQ(Status::OK, status); });
+      std::move(commit),
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status));
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(Status::OK, status);
   commits = GetUnsyncedCommits();
   EXPECT_EQ(1u, commits.size());
   EXPECT_EQ(storage_bytes, commits[0]->GetStorageBytes());
 
   // Mark it as synced.
-  EXPECT_EQ(Status::OK, storage_->MarkCommitSynced(id));
+  storage_->MarkCommitSynced(
+      id, callback::Capture([this] { message_loop_.PostQuitTask(); }, &status));
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(Status::OK, status);
   commits = GetUnsyncedCommits();
   EXPECT_TRUE(commits.empty());
 }
 
+// Verifies that chains of unsynced local commits are squashed into a single
+// commit when the storage is initialized.
+TEST_F(PageStorageTest, SquashUnsyncedCommitsOnInit) {
+  PageId page_id = storage_->GetId();
+  std::vector<CommitId> chain_ids;
+  chain_ids.push_back(TryCommitFromLocal(JournalType::EXPLICIT, 1));
+  chain_ids.push_back(TryCommitFromLocal(JournalType::EXPLICIT, 2));
+  chain_ids.push_back(TryCommitFromLocal(JournalType::EXPLICIT, 3));
+  std::unique_ptr<const Commit> last = GetCommit(chain_ids.back());
+  EXPECT_EQ(3u, GetUnsyncedCommits().size());
+
+  // Reopen the storage.
+  storage_.reset();
+  storage_ = std::make_unique<PageStorageImpl>(
+      message_loop_.task_runner(), io_runner_, &coroutine_service_,
+      tmp_dir_.path(), page_id);
+  Status status;
+  storage_->Init(
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status));
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(Status::OK, status);
+
+  // A single commit with the content of the last one is left to upload.
+  std::vector<std::unique_ptr<const Commit>> commits = GetUnsyncedCommits();
+  ASSERT_EQ(1u, commits.size());
+  const Commit& squashed = *commits[0];
+  EXPECT_NE(last->GetId(), squashed.GetId());
+  EXPECT_EQ(last->GetRootId().ToString(), squashed.GetRootId().ToString());
+  std::vector<CommitIdView> parent_ids = squashed.GetParentIds();
+  ASSERT_EQ(1u, parent_ids.size());
+  EXPECT_EQ(kFirstPageCommitId.ToString(), parent_ids[0].ToString());
+  EXPECT_EQ(1u, squashed.GetGeneration());
+  EXPECT_EQ(3u, GetCommitContents(squashed).size());
+
+  // The squashed commit replaces the last one as the head.
+  std::vector<CommitId> heads;
+  EXPECT_EQ(Status::OK, storage_->GetHeadCommitIds(&heads));
+  ASSERT_EQ(1u, heads.size());
+  EXPECT_EQ(squashed.GetId(), heads[0]);
+
+  // The commits of the chain, never uploaded, are deleted.
+  for (const CommitId& commit_id : chain_ids) {
+    std::unique_ptr<const Commit> commit;
+    storage_->GetCommit(
+        commit_id, callback::Capture([this] { message_loop_.PostQuitTask(); },
+                                     &status, &commit));
+    EXPECT_FALSE(RunLoopWithTimeout());
+    EXPECT_EQ(Status::NOT_FOUND, status);
+  }
+}
+
 TEST_F(PageStorageTest, HeadCommits) {
   // Every page should have one initial head commit.
   std::vector<CommitId> heads;
@@ -494,13 +613,63 @@ TEST_F(PageStorageTest, HeadCommits) {
       storage_.get(), RandomId(kObjectIdSize), std::move(parent));
   CommitId id = commit->GetId();
 
+  Status status;
   storage_->AddCommitFromLocal(
-      std::move(commit), [](Status status) { EXPECT_EQ(Status::OK, status); });
+      std::move(commit),
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status));
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(Status::OK, status);
   EXPECT_EQ(Status::OK, storage_->GetHeadCommitIds(&heads));
   EXPECT_EQ(1u, heads.size());
   EXPECT_EQ(id, heads[0]);
 }
 
+TEST_F(PageStorageTest, GetPendingCommitsEvictedFromCache) {
+  // Add more commits than the commit cache holds without waiting for them to
+  // be written: the first ones are evicted from the cache, but must still be
+  // found.
+  const size_t kCommitCount = 300;
+  std::unique_ptr<const Commit> head = GetFirstHead();
+  CommitId first_id;
+  size_t pending_commits = 0;
+  for (size_t i = 0; i < kCommitCount; ++i) {
+    std::vector<std::unique_ptr<const Commit>> parent;
+    parent.push_back(std::move(head));
+    std::unique_ptr<Commit> commit = CommitImpl::FromContentAndParents(
+        storage_.get(), RandomId(kObjectIdSize), std::move(parent));
+    if (i == 0) {
+      first_id = commit->GetId();
+    }
+    head = commit->Clone();
+    pending_commits++;
+    storage_->AddCommitFromLocal(std::move(commit), [
+      this, &pending_commits
+    ](Status status) {
+      EXPECT_EQ(Status::OK, status);
+      if (--pending_commits == 0) {
+        message_loop_.PostQuitTask();
+      }
+    });
+  }
+
+  std::vector<CommitId> heads;
+  EXPECT_EQ(Status::OK, storage_->GetHeadCommitIds(&heads));
+  ASSERT_EQ(1u, heads.size());
+  EXPECT_EQ(head->GetId(), heads[0]);
+
+  Status status;
+  std::unique_ptr<const Commit> found;
+  storage_->GetCommit(first_id, callback::Capture([] {}, &status, &found));
+  EXPECT_EQ(Status::OK, status);
+  ASSERT_TRUE(found);
+  EXPECT_EQ(first_id, found->GetId());
+
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(0u, pending_commits);
+  // Once written, the commits are read from the database.
+  EXPECT_EQ(first_id, GetCommit(first_id)->GetId());
+}
+
 TEST_F(PageStorageTest, CreateJournals) {
   // Explicit journal.
   CommitId left_id = TryCommitFromLocal(JournalType::EXPLICIT, 5);
@@ -557,6 +726,60 @@ TEST_F(PageStorageTest, DestroyUncommittedJournal) {
             journal->Put("key", RandomId(kObjectIdSize), KeyPriority::EAGER));
 }
 
+// Verifies that a journal mixing puts and deletes of existing and new keys is
+// applied entry by entry: the journal entries are read through an iterator
+// that reuses the same EntryChange for all of them.
+TEST_F(PageStorageTest, JournalWithPutsAndDeletes) {
+  std::map<std::string, Entry> expected;
+  std::unique_ptr<Journal> journal;
+  EXPECT_EQ(Status::OK, storage_->StartCommit(GetFirstHead()->GetId(),
+                                              JournalType::EXPLICIT, &journal));
+  for (int i = 0; i < 100; ++i) {
+    Entry entry{ftl::StringPrintf("key%03d", i), RandomId(kObjectIdSize),
+                KeyPriority::EAGER};
+    EXPECT_EQ(Status::OK,
+              journal->Put(entry.key, entry.object_id, entry.priority));
+    expected[entry.key] = std::move(entry);
+  }
+  TryCommitJournal(&journal, Status::OK);
+
+  // Delete one key out of three, update the other odd keys with lazy values,
+  // and add new keys between the existing ones.
+  EXPECT_EQ(Status::OK, storage_->StartCommit(GetFirstHead()->GetId(),
+                                              JournalType::EXPLICIT, &journal));
+  for (int i = 0; i < 100; ++i) {
+    std::string key = ftl::StringPrintf("key%03d", i);
+    if (i % 3 == 0) {
+      EXPECT_EQ(Status::OK, journal->Delete(key));
+      expected.erase(key);
+    } else if (i % 2 == 1) {
+      Entry entry{key, RandomId(kObjectIdSize), KeyPriority::LAZY};
+      EXPECT_EQ(Status::OK,
+                journal->Put(entry.key, entry.object_id, entry.priority));
+      expected[key] = std::move(entry);
+    }
+    if (i % 5 == 0) {
+      Entry entry{key + "_new", RandomId(kObjectIdSize), KeyPriority::EAGER};
+      EXPECT_EQ(Status::OK,
+                journal->Put(entry.key, entry.object_id, entry.priority));
+      expected[entry.key] = std::move(entry);
+    }
+  }
+  EXPECT_EQ(Status::OK, journal->Delete("key_does_not_exist"));
+  std::unique_ptr<const Commit> commit = TryCommitJournal(&journal, Status::OK);
+  ASSERT_TRUE(commit);
+
+  std::vector<Entry> entries = GetCommitContents(*commit);
+  ASSERT_EQ(expected.size(), entries.size());
+  size_t i = 0;
+  for (const auto& expected_entry : expected) {
+    EXPECT_EQ(expected_entry.second.key, entries[i].key);
+    EXPECT_EQ(expected_entry.second.object_id, entries[i].object_id);
+    EXPECT_EQ(expected_entry.second.priority, entries[i].priority);
+    ++i;
+  }
+}
+
 TEST_F(PageStorageTest, AddObjectFromLocal) {
   ObjectData data("Some data");
 
@@ -744,8 +967,12 @@ TEST_F(PageStorageTest, UnsyncedObjects) {
 
   // Mark the 2nd object as synced. We now expect to find the 2 unsynced values
   // and the (also unsynced) root node.
-  EXPECT_EQ(Status::OK, storage_->MarkObjectSynced(data[1].object_id));
   Status status;
+  storage_->MarkObjectSynced(
+      data[1].object_id,
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status));
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(Status::OK, status);
   std::vector<ObjectId> objects;
   storage_->GetUnsyncedObjectIds(
       commits[2], callback::Capture([this] { message_loop_.PostQuitTask(); },
@@ -958,6 +1185,107 @@ TEST_F(PageStorageTest, AddMultipleCommitsFromSync) {
             sync.object_requests.end());
 }
 
+TEST_F(PageStorageTest, AddShallowCommitsFromSync) {
+  FakeSyncDelegate sync;
+  storage_->SetSyncDelegate(&sync);
+
+  ObjectId root_id;
+  ASSERT_TRUE(GetEmptyNodeId(&root_id));
+
+  // Build the chain of commits: first head <- commit1 <- commit2.
+  std::vector<std::unique_ptr<const Commit>> parent;
+  parent.emplace_back(GetFirstHead());
+  std::unique_ptr<const Commit> commit1 = CommitImpl::FromContentAndParents(
+      storage_.get(), root_id, std::move(parent));
+  parent.emplace_back(commit1->Clone());
+  std::unique_ptr<const Commit> commit2 = CommitImpl::FromContentAndParents(
+      storage_.get(), root_id, std::move(parent));
+  sync.AddCommit(*commit1);
+
+  std::vector<PageStorage::CommitIdAndBytes> commits_and_bytes;
+  commits_and_bytes.emplace_back(commit1->GetId(),
+                                 commit1->GetStorageBytes().ToString());
+  commits_and_bytes.emplace_back(commit2->GetId(),
+                                 commit2->GetStorageBytes().ToString());
+
+  Status status;
+  storage_->AddShallowCommitsFromSync(
+      std::move(commits_and_bytes),
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status));
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(Status::OK, status);
+
+  // Only the head is stored locally.
+  std::vector<CommitId> heads;
+  EXPECT_EQ(Status::OK, storage_->GetHeadCommitIds(&heads));
+  EXPECT_EQ(std::vector<CommitId>({commit2->GetId()}), heads);
+  EXPECT_TRUE(sync.commit_requests.empty());
+
+  // The parent of the head is retrieved from sync when requested.
+  std::unique_ptr<const Commit> found = GetCommit(commit1->GetId());
+  ASSERT_TRUE(found);
+  EXPECT_EQ(commit1->GetStorageBytes(), found->GetStorageBytes());
+  EXPECT_EQ(std::set<CommitId>({commit1->GetId()}), sync.commit_requests);
+
+  // The commit retrieved from sync does not become a head.
+  EXPECT_EQ(Status::OK, storage_->GetHeadCommitIds(&heads));
+  EXPECT_EQ(std::vector<CommitId>({commit2->GetId()}), heads);
+}
+
+TEST_F(PageStorageTest, AddShallowCommitsFromSyncRemoteParents) {
+  FakeSyncDelegate sync;
+  storage_->SetSyncDelegate(&sync);
+
+  ObjectId empty_root_id;
+  ASSERT_TRUE(GetEmptyNodeId(&empty_root_id));
+  ObjectData value("value");
+  std::vector<Entry> entries = {
+      Entry{"key", value.object_id, storage::KeyPriority::EAGER}};
+  std::unique_ptr<const TreeNode> node;
+  ASSERT_TRUE(CreateNodeFromEntries(
+      entries, std::vector<ObjectId>(entries.size() + 1), &node));
+  ObjectId root_id = node->GetId();
+  sync.AddObject(value.object_id, value.value);
+
+  // Build the commit tree:
+  //   first head <- commit1 <- commit2
+  //                         <- commit3
+  // where commit2 and commit3 are the heads of the page in the cloud.
+  std::vector<std::unique_ptr<const Commit>> parent;
+  parent.emplace_back(GetFirstHead());
+  std::unique_ptr<const Commit> commit1 = CommitImpl::FromContentAndParents(
+      storage_.get(), empty_root_id, std::move(parent));
+  parent.emplace_back(commit1->Clone());
+  std::unique_ptr<const Commit> commit2 = CommitImpl::FromContentAndParents(
+      storage_.get(), empty_root_id, std::move(parent));
+  parent.emplace_back(commit1->Clone());
+  std::unique_ptr<const Commit> commit3 = CommitImpl::FromContentAndParents(
+      storage_.get(), root_id, std::move(parent));
+
+  std::vector<PageStorage::CommitIdAndBytes> commits_and_bytes;
+  for (const auto* commit : {commit1.get(), commit2.get(), commit3.get()}) {
+    commits_and_bytes.emplace_back(commit->GetId(),
+                                   commit->GetStorageBytes().ToString());
+  }
+
+  Status status;
+  storage_->AddShallowCommitsFromSync(
+      std::move(commits_and_bytes),
+      callback::Capture([this] { message_loop_.PostQuitTask(); }, &status));
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(Status::OK, status);
+
+  // The parent of both heads is remote-only, and the first commit of the page
+  // is not a head anymore: no merge is needed.
+  std::vector<CommitId> heads;
+  EXPECT_EQ(Status::OK, storage_->GetHeadCommitIds(&heads));
+  std::sort(heads.begin(), heads.end());
+  std::vector<CommitId> expected_heads = {commit2->GetId(), commit3->GetId()};
+  std::sort(expected_heads.begin(), expected_heads.end());
+  EXPECT_EQ(expected_heads, heads);
+  EXPECT_TRUE(sync.commit_requests.empty());
+}
+
 TEST_F(PageStorageTest, Generation) {
   const CommitId commit_id1 = TryCommitFromLocal(JournalType::EXPLICIT, 3);
   std::unique_ptr<const Commit> commit1 = GetCommit(commit_id1);
@@ -1023,5 +1351,35 @@ TEST_F(PageStorageTest, GetEntryFromCommit) {
   }
 }
 
+TEST_F(PageStorageTest, GetEntriesFromCommit) {
+  int size = 10;
+  CommitId commit_id = TryCommitFromLocal(JournalType::EXPLICIT, size);
+  std::unique_ptr<const Commit> commit = GetCommit(commit_id);
+
+  // Keys are requested in reverse order.
+  std::vector<std::string> keys;
+  for (int i = size - 1; i >= 0; --i) {
+    keys.push_back(ftl::StringPrintf("key%d", i));
+  }
+  Status status;
+  std::vector<Entry> entries;
+  storage_->GetEntriesFromCommit(
+      *commit, keys, callback::Capture([this] { message_loop_.PostQuitTask(); },
+                                       &status, &entries));
+  ASSERT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(Status::OK, status);
+  ASSERT_EQ(keys.size(), entries.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    EXPECT_EQ(keys[i], entries[i].key);
+  }
+
+  keys.push_back("key not found");
+  storage_->GetEntriesFromCommit(
+      *commit, keys, callback::Capture([this] { message_loop_.PostQuitTask(); },
+                                       &status, &entries));
+  ASSERT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(Status::NOT_FOUND, status);
+}
+
 }  // namespace
 }  // namespace storage
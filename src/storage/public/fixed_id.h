@@ -0,0 +1,93 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPS_LEDGER_SRC_STORAGE_PUBLIC_FIXED_ID_H_
+#define APPS_LEDGER_SRC_STORAGE_PUBLIC_FIXED_ID_H_
+
+#include <string.h>
+
+#include <functional>
+#include <string>
+#include <type_traits>
+
+#include "apps/ledger/src/convert/convert.h"
+#include "apps/ledger/src/storage/public/constants.h"
+#include "lib/ftl/logging.h"
+#include "lib/ftl/strings/string_view.h"
+
+namespace storage {
+
+// A commit or object id, stored inline.
+//
+// Commit and object ids are SHA-256 digests of |kSize| bytes. |CommitId| and
+// |ObjectId| keep them in heap allocated strings; a FixedId holds the bytes
+// directly, is trivially copyable and is hashed and compared without going
+// through the generic string code. It is used for the in-memory indexes of
+// ids, and is converted from and to the string ids at their boundaries.
+class FixedId {
+ public:
+  static constexpr size_t kSize = 32;
+
+  FixedId() : bytes_{} {}
+
+  // |id| must be |kSize| bytes long.
+  explicit FixedId(convert::ExtendedStringView id) {
+    FTL_DCHECK(IsValid(id));
+    memcpy(bytes_, id.data(), kSize);
+  }
+
+  // Returns whether |id| can be converted to a FixedId.
+  static bool IsValid(convert::ExtendedStringView id) {
+    return id.size() == kSize;
+  }
+
+  ftl::StringView view() const {
+    return ftl::StringView(reinterpret_cast<const char*>(bytes_), kSize);
+  }
+
+  std::string ToString() const { return view().ToString(); }
+
+  size_t Hash() const {
+    // Ids are digests: folding the words of the id is enough to spread them.
+    uint64_t words[kSize / sizeof(uint64_t)];
+    memcpy(words, bytes_, kSize);
+    uint64_t hash = words[0];
+    for (size_t i = 1; i < kSize / sizeof(uint64_t); ++i) {
+      hash = (hash * 0x100000001b3ull) ^ words[i];
+    }
+    return static_cast<size_t>(hash);
+  }
+
+  bool operator==(const FixedId& other) const {
+    return memcmp(bytes_, other.bytes_, kSize) == 0;
+  }
+  bool operator!=(const FixedId& other) const { return !(*this == other); }
+  // Orders ids as their string representation.
+  bool operator<(const FixedId& other) const {
+    return memcmp(bytes_, other.bytes_, kSize) < 0;
+  }
+
+ private:
+  uint8_t bytes_[kSize];
+};
+
+static_assert(std::is_trivially_copyable<FixedId>::value,
+              "FixedId must be trivially copyable.");
+static_assert(FixedId::kSize == kCommitIdSize,
+              "FixedId must be able to hold a commit id.");
+static_assert(FixedId::kSize == kObjectIdSize,
+              "FixedId must be able to hold an object id.");
+
+}  // namespace storage
+
+namespace std {
+
+template <>
+struct hash<storage::FixedId> {
+  size_t operator()(const storage::FixedId& id) const { return id.Hash(); }
+};
+
+}  // namespace std
+
+#endif  // APPS_LEDGER_SRC_STORAGE_PUBLIC_FIXED_ID_H_
@@ -0,0 +1,66 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/ledger/src/storage/public/fixed_id.h"
+
+#include <set>
+#include <unordered_set>
+
+#include "gtest/gtest.h"
+
+namespace storage {
+namespace {
+
+std::string MakeId(char first, char last) {
+  std::string id(FixedId::kSize, '\0');
+  id.front() = first;
+  id.back() = last;
+  return id;
+}
+
+TEST(FixedIdTest, IsValid) {
+  EXPECT_TRUE(FixedId::IsValid(MakeId('a', 'b')));
+  EXPECT_FALSE(FixedId::IsValid(""));
+  EXPECT_FALSE(FixedId::IsValid(std::string(FixedId::kSize + 1, 'a')));
+}
+
+TEST(FixedIdTest, RoundTrip) {
+  std::string id = MakeId('a', 'b');
+  FixedId fixed_id(id);
+  EXPECT_EQ(id, fixed_id.ToString());
+  EXPECT_EQ(id, fixed_id.view().ToString());
+  EXPECT_EQ(std::string(FixedId::kSize, '\0'), FixedId().ToString());
+}
+
+TEST(FixedIdTest, Compare) {
+  FixedId id1(MakeId('a', 'a'));
+  FixedId id2(MakeId('a', 'b'));
+  FixedId id3(MakeId('\xff', 'a'));
+
+  EXPECT_EQ(id1, FixedId(MakeId('a', 'a')));
+  EXPECT_NE(id1, id2);
+  EXPECT_EQ(id1.Hash(), FixedId(MakeId('a', 'a')).Hash());
+
+  // FixedIds are ordered as their string representation.
+  EXPECT_LT(id1, id2);
+  EXPECT_LT(id2, id3);
+  EXPECT_LT(id1.ToString(), id2.ToString());
+  EXPECT_LT(id2.ToString(), id3.ToString());
+}
+
+TEST(FixedIdTest, Containers) {
+  std::unordered_set<FixedId> ids;
+  ids.insert(FixedId(MakeId('a', 'a')));
+  ids.insert(FixedId(MakeId('a', 'b')));
+  ids.insert(FixedId(MakeId('a', 'a')));
+  EXPECT_EQ(2u, ids.size());
+  EXPECT_EQ(1u, ids.count(FixedId(MakeId('a', 'b'))));
+  EXPECT_EQ(0u, ids.count(FixedId(MakeId('b', 'b'))));
+
+  std::set<FixedId> sorted_ids(ids.begin(), ids.end());
+  EXPECT_EQ(MakeId('a', 'a'), sorted_ids.begin()->ToString());
+}
+
+}  // namespace
+}  // namespace storage
@@ -24,6 +24,10 @@ class Object {
   // Returns the data of this object.
   virtual Status GetData(ftl::StringView* data) const = 0;
 
+  // Returns the size of the data of this object, in bytes. This does not
+  // require reading the data.
+  virtual Status GetSize(uint64_t* size) const = 0;
+
  private:
   FTL_DISALLOW_COPY_AND_ASSIGN(Object);
 };
@@ -67,6 +67,14 @@ class PageStorage {
   // fetched all referenced objects and is ready to accept subsequent commits.
   virtual void AddCommitsFromSync(std::vector<CommitIdAndBytes> ids_and_bytes,
                                   std::function<void(Status)> callback) = 0;
+  // Adds the given commits from sync as the latest state of the page, without
+  // their history: only the commits that are not parents of other commits of
+  // |ids_and_bytes| are added, along with their referenced objects. The other
+  // commits are recorded as remote-only, and are retrieved from sync if they
+  // are needed later, e.g. to find the common ancestor of commits to merge.
+  virtual void AddShallowCommitsFromSync(
+      std::vector<CommitIdAndBytes> ids_and_bytes,
+      std::function<void(Status)> callback) = 0;
   // Starts a new |journal| based on the commit with the given |commit_id|. The
   // base commit must be one of  the head commits. If |implicit| is false all
   // changes will be lost after a crash. Otherwise, changes to implicit
@@ -95,7 +103,8 @@ class PageStorage {
           callback) = 0;
 
   // Marks the given commit as synced.
-  virtual Status MarkCommitSynced(const CommitId& commit_id) = 0;
+  virtual void MarkCommitSynced(const CommitId& commit_id,
+                                std::function<void(Status)> callback) = 0;
 
   // Finds all objects introduced by the commit with the given |commit_id| and
   // adds them in the given |objects| vector. This includes all objects present
@@ -109,7 +118,8 @@ class PageStorage {
       const CommitId& commit_id,
       std::function<void(Status, std::vector<ObjectId>)> callback) = 0;
   // Marks the object with the given |object_id| as synced.
-  virtual Status MarkObjectSynced(ObjectIdView object_id) = 0;
+  virtual void MarkObjectSynced(ObjectIdView object_id,
+                                std::function<void(Status)> callback) = 0;
   // Adds the given synced object. |object_id| will be validated against the
   // expected one based on the |data| and an |OBJECT_ID_MISSMATCH| error will be
   // returned in case of missmatch.
@@ -164,14 +174,26 @@ class PageStorage {
       std::string key,
       std::function<void(Status, Entry)> on_done) = 0;
 
+  // Retrieves the entries with the given |keys|, in any order, and calls
+  // |on_done| with the entries in the order of |keys|. All keys are looked up
+  // at once, which is more efficient than calling |GetEntryFromCommit| for each
+  // of them. The status of |on_done| will be |OK| on success, |NOT_FOUND| if
+  // one of the keys is not in the given commit or an error status on failure.
+  virtual void GetEntriesFromCommit(
+      const Commit& commit,
+      std::vector<std::string> keys,
+      std::function<void(Status, std::vector<Entry>)> on_done) = 0;
+
   // Iterates over the difference between the contents of two commits and calls
-  // |on_next_diff| on found changed entries. Returning false from
-  // |on_next_diff| will immediately stop the iteration. |on_done| is called
-  // once, upon successfull completion, i.e. when there are no more differences
-  // or iteration was interrupted, or if an error occurs.
+  // |on_next_diff| on found changed entries with a key equal to or greater than
+  // |min_key|. Returning false from |on_next_diff| will immediately stop the
+  // iteration. |on_done| is called once, upon successfull completion, i.e. when
+  // there are no more differences or iteration was interrupted, or if an error
+  // occurs.
   virtual void GetCommitContentsDiff(
       const Commit& base_commit,
       const Commit& other_commit,
+      std::string min_key,
       std::function<bool(EntryChange)> on_next_diff,
       std::function<void(Status)> on_done) = 0;
 
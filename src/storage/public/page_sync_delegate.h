@@ -6,6 +6,7 @@
 #define APPS_LEDGER_SRC_STORAGE_PUBLIC_PAGE_SYNC_DELEGATE_H_
 
 #include <functional>
+#include <string>
 
 #include <mx/socket.h>
 
@@ -29,6 +30,12 @@ class PageSyncDelegate {
       std::function<void(Status status, uint64_t size, mx::socket data)>
           callback) = 0;
 
+  // Retrieves the storage bytes of the commit of the given id from the cloud.
+  virtual void GetCommit(
+      CommitIdView commit_id,
+      std::function<void(Status status, std::string storage_bytes)>
+          callback) = 0;
+
  private:
   FTL_DISALLOW_COPY_AND_ASSIGN(PageSyncDelegate);
 };
@@ -38,6 +38,13 @@ void PageStorageEmptyImpl::AddCommitsFromSync(
   callback(Status::NOT_IMPLEMENTED);
 }
 
+void PageStorageEmptyImpl::AddShallowCommitsFromSync(
+    std::vector<CommitIdAndBytes> ids_and_bytes,
+    std::function<void(Status)> callback) {
+  FTL_NOTIMPLEMENTED();
+  callback(Status::NOT_IMPLEMENTED);
+}
+
 Status PageStorageEmptyImpl::StartCommit(const CommitId& commit_id,
                                          JournalType journal_type,
                                          std::unique_ptr<Journal>* journal) {
@@ -70,9 +77,11 @@ void PageStorageEmptyImpl::GetUnsyncedCommits(
   callback(Status::NOT_IMPLEMENTED, {});
 }
 
-Status PageStorageEmptyImpl::MarkCommitSynced(const CommitId& commit_id) {
+void PageStorageEmptyImpl::MarkCommitSynced(
+    const CommitId& commit_id,
+    std::function<void(Status)> callback) {
   FTL_NOTIMPLEMENTED();
-  return Status::NOT_IMPLEMENTED;
+  callback(Status::NOT_IMPLEMENTED);
 }
 
 Status PageStorageEmptyImpl::GetDeltaObjects(const CommitId& commit_id,
@@ -88,9 +97,11 @@ void PageStorageEmptyImpl::GetUnsyncedObjectIds(
   callback(Status::NOT_IMPLEMENTED, std::vector<ObjectId>());
 }
 
-Status PageStorageEmptyImpl::MarkObjectSynced(ObjectIdView object_id) {
+void PageStorageEmptyImpl::MarkObjectSynced(
+    ObjectIdView object_id,
+    std::function<void(Status)> callback) {
   FTL_NOTIMPLEMENTED();
-  return Status::NOT_IMPLEMENTED;
+  callback(Status::NOT_IMPLEMENTED);
 }
 
 void PageStorageEmptyImpl::AddObjectFromSync(
@@ -146,9 +157,18 @@ void PageStorageEmptyImpl::GetEntryFromCommit(
   callback(Status::NOT_IMPLEMENTED, Entry());
 }
 
+void PageStorageEmptyImpl::GetEntriesFromCommit(
+    const Commit& commit,
+    std::vector<std::string> keys,
+    std::function<void(Status, std::vector<Entry>)> callback) {
+  FTL_NOTIMPLEMENTED();
+  callback(Status::NOT_IMPLEMENTED, std::vector<Entry>());
+}
+
 void PageStorageEmptyImpl::GetCommitContentsDiff(
     const Commit& base_commit,
     const Commit& other_commit,
+    std::string min_key,
     std::function<bool(EntryChange)> on_next_diff,
     std::function<void(Status)> on_done) {
   FTL_NOTIMPLEMENTED();
@@ -35,6 +35,9 @@ class PageStorageEmptyImpl : public PageStorage {
   void AddCommitsFromSync(std::vector<CommitIdAndBytes> ids_and_bytes,
                           std::function<void(Status)> callback) override;
 
+  void AddShallowCommitsFromSync(std::vector<CommitIdAndBytes> ids_and_bytes,
+                                 std::function<void(Status)> callback) override;
+
   Status StartCommit(const CommitId& commit_id,
                      JournalType journal_type,
                      std::unique_ptr<Journal>* journal) override;
@@ -51,7 +54,8 @@ class PageStorageEmptyImpl : public PageStorage {
       std::function<void(Status, std::vector<std::unique_ptr<const Commit>>)>
           callback) override;
 
-  Status MarkCommitSynced(const CommitId& commit_id) override;
+  void MarkCommitSynced(const CommitId& commit_id,
+                        std::function<void(Status)> callback) override;
 
   Status GetDeltaObjects(const CommitId& commit_id,
                          std::vector<ObjectId>* objects) override;
@@ -60,7 +64,8 @@ class PageStorageEmptyImpl : public PageStorage {
       const CommitId& commit_id,
       std::function<void(Status, std::vector<ObjectId>)> callback) override;
 
-  Status MarkObjectSynced(ObjectIdView object_id) override;
+  void MarkObjectSynced(ObjectIdView object_id,
+                        std::function<void(Status)> callback) override;
 
   void AddObjectFromSync(ObjectIdView object_id,
                          mx::socket data,
@@ -91,8 +96,14 @@ class PageStorageEmptyImpl : public PageStorage {
                           std::string key,
                           std::function<void(Status, Entry)> callback) override;
 
+  void GetEntriesFromCommit(
+      const Commit& commit,
+      std::vector<std::string> keys,
+      std::function<void(Status, std::vector<Entry>)> callback) override;
+
   void GetCommitContentsDiff(const Commit& base_commit,
                              const Commit& other_commit,
+                             std::string min_key,
                              std::function<bool(EntryChange)> on_next_diff,
                              std::function<void(Status)> on_done) override;
 };